@@ -1,8 +1,10 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <cmath>
-#include <algorithm>    // for std::fill_n
+#include <algorithm>    // for std::min
 #include <chrono>
 
 
@@ -16,11 +18,12 @@ CCircularRcvBuffer::CCircularRcvBuffer() {
     _index    = -1;
     _bInit    = false;
     _buffer   = NULL;
-    _seqArray = NULL;
     _nbElmt   = -1;
     _closed   = true;
-    _size     = 0;
-    _q        = NULL;
+    _lastRcvSeq = -1;
+    _packets  = 0;
+    _lost     = 0;
+    _event    = NULL;
     _samplesize = -1;
 };
 
@@ -28,25 +31,46 @@ CCircularRcvBuffer::~CCircularRcvBuffer() {
     close();
 };
 
-int CCircularRcvBuffer::init(CQueue<int>* q, const char* remote_addr, const char* local_addr, int port, int nbElmt, int index) {
+/*!
+* \fn init
+* \brief allocate the ring and start the receive thread of the leg
+*
+* \param event event to notify on each packet received
+* \param remote_addr multicast group, or NULL
+* \param local_addr address of the interface to receive on, or NULL
+* \param port UDP port of the leg
+* \param nbElmt nb of packets kept, rounded up to a power of two (65536 at most)
+* \param index index of the leg
+* \param rxBatch max nb of packets received per syscall
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CCircularRcvBuffer::init(CRingEvent* event, const char* remote_addr, const char* local_addr, int port, int nbElmt, int index, int rxBatch) {
 
     LOG_INFO("[%d] --> (port=%d, nbElmt=%d)", index, port, nbElmt);
 
-    if (nbElmt <= 0 || port <= 0)
+    if (nbElmt <= 0 || port <= 0 || event == NULL)
         return VMI_E_INVALID_PARAMETER;
 
     close();
 
-    _q        = q;
+    // slot = seq mod _nbElmt: _nbElmt must divide the 16 bits seq range
+    _nbElmt   = 1;
+    while (_nbElmt < nbElmt && _nbElmt < 65536)
+        _nbElmt <<= 1;
+    _event    = event;
     _index    = index;
     _closed   = false;
-    _nbElmt   = nbElmt;
-    _buffer   = new char[_nbElmt*RTP_PACKET_SIZE];
-    _seqArray = new int[_nbElmt];
-    _wr_idx   = -1;
-    _rd_idx   = -1;
-    std::fill(_seqArray, _seqArray+_nbElmt, -1);
+    _buffer   = new char[(size_t)_nbElmt*RTP_PACKET_SIZE];
+    _slots.reset(new Slot[_nbElmt]);
+    for (int i = 0; i < _nbElmt; i++) {
+        _slots[i].seq = -1;
+        _slots[i].len = 0;
+    }
+    _lastRcvSeq = -1;
+    _packets  = 0;
+    _lost     = 0;
 
+    _udpSock.enableBatchReceive(rxBatch);
     if (!_udpSock.isValid())
         int result = _udpSock.openSocket(remote_addr, local_addr, port, true);
 
@@ -54,7 +78,7 @@ int CCircularRcvBuffer::init(CQueue<int>* q, const char* remote_addr, const char
 
     _bInit = true;
 
-    LOG_INFO("[%d] <--", _index);
+    LOG_INFO("[%d] <-- (%d slots)", _index, _nbElmt);
     return VMI_E_OK;
 };
 
@@ -79,9 +103,8 @@ int CCircularRcvBuffer::close() {
     if (_buffer)
         delete[] _buffer;
     _buffer   = NULL;
-    if (_seqArray)
-        delete[] _seqArray;
-    _seqArray = NULL;
+    _slots.reset();
+    _bInit    = false;
 
     return VMI_E_OK;
 };
@@ -89,8 +112,6 @@ int CCircularRcvBuffer::close() {
 void* CCircularRcvBuffer::_rcv_thread() {
 
     LOG_INFO("[%d] -->", _index);
-    int seq = 0;
-    CRTPFrame rtpframe;
     while (!_closed) {
 //#define _DEBUG
 #ifdef _DEBUG
@@ -111,157 +132,100 @@ void* CCircularRcvBuffer::_rcv_thread() {
             }
         }
 #endif
-        seq = write();
-        if (seq < 0) {
-            //LOG_ERROR("[%d] error when reading RTP frame: seq=%d", _index, seq);
-            //abort();
-            //break;
-        }
-        else {
-            // No error, push the packet to the datasourceSPSRTP
-            int p = (_index << 16) + (seq & 0xFFFF);
-            _q->push(p);
-            _lastRcvSeq = seq;
-        }
+        write();
         if (_closed) {
             LOG_INFO("[%d] closing...", _index);
             break;
         }
-
-        //if( result%1000==0) LOG_INFO("Rcv packet #%d", result);
-        //std::this_thread::yield();
     }
     LOG_INFO("[%d] <--", _index);
     return 0;
 }
-#include <iostream>
+
+/*!
+* \fn write
+* \brief receive one packet, and store it in the slot of its sequence number, replacing the
+*        packet received _nbElmt sequences before
+*
+* \return seq number of the packet, -1 if error
+*/
 int CCircularRcvBuffer::write() {
-    int result = -1;
-    int len = RTP_PACKET_SIZE;
-
-    std::unique_lock<std::mutex> lock(_mtx);
-
-    if (_buffer == NULL || _seqArray == NULL)
-        return result;
-        
-    //inc the write pointer for next packet to read
-    int old_wr_idx = _wr_idx;
-    _wr_idx = (_wr_idx + 1) % _nbElmt;
-
-    if (_wr_idx > 0 && _rd_idx < 0) _rd_idx = 0;
-    if (_wr_idx == _rd_idx) {
-        // We don't read fast enough... 
-        // For master, wait for free slot: i.e. don't inc the write pointer, and return (do nothing)
-        // For secundary, delete oldest RTP packet: i.e. inc the read pointer
-        if (_isMaster) {
-            //LOG_INFO("[%d] we don't read fast enough..., _rd_idx=%d, _wr_idx=%d, q=%d", _index, _rd_idx, _wr_idx, _q->size());
-            _wr_idx = old_wr_idx;
-            return -1;
-        }
-        else
-            _rd_idx = (_wr_idx + 1) % _nbElmt;
-    }
-    _seqArray[_wr_idx] = -1;
 
-    // Read one packet from RTP stream and write it on the buffer at correct place
-    char* wr_ptr = _buffer + (_wr_idx * RTP_PACKET_SIZE);
-    result = _udpSock.readSocket(wr_ptr, &len);
-    if (result <= 0) {
-        if( !_closed)
+    if (_buffer == NULL)
+        return -1;
+
+    char* packet = NULL;
+    int len = 0;
+    int result = _udpSock.readPacket(&packet, &len);
+    if (result <= 0 || len < RTP_HEADERS_LENGTH) {
+        if (result <= 0 && !_closed)
             LOG_ERROR("[%d] error when reading RTP frame: result=%d", _index, result);
-        result = -1; // Be carefull, result==0 is an "error", but return value is -1 if error. If return 0, it's a packet seq nb.
-        return result;
+        return -1;
     }
     if (_samplesize == -1)
-        _samplesize = result;
+        _samplesize = len;
 
-    // Get seq number of this RTP packet, and update the seq array
     CRTPFrame rtpframe;
-    rtpframe.setBuffer((unsigned char*)wr_ptr, len);
+    rtpframe.setBuffer((unsigned char*)packet, len);
     rtpframe.readHeader();
-    _seqArray[_wr_idx] = rtpframe._seq;
-    result = rtpframe._seq;
-    _size = (_wr_idx > _rd_idx) ? (_wr_idx - _rd_idx) : (65536-(_rd_idx- _wr_idx));
-    _writed++;
-
-    //if (rtpframe._seq % 1000 == 0) LOG_INFO("[%d] write packet#%d at pos %d [%d..%d]", _index, _seqArray[_wr_idx], _wr_idx, _seqArray[_rd_idx<0?0: _rd_idx], _seqArray[_wr_idx]);
-   // if ((rtpframe._seq % 1000 == 0) && _index == 1) LOG_INFO("[%d] write packet#%d at pos %d [%d..%d], _size=%d", _index, _seqArray[_wr_idx], _wr_idx, _rd_idx, _wr_idx, _size);
-
-    return result;
+    int seq = rtpframe._seq & 0xFFFF;
+    int idx = seq & (_nbElmt - 1);
+    len = std::min(len, RTP_PACKET_SIZE);
+
+    // Duplicated packet, already in its slot
+    Slot& slot = _slots[idx];
+    if (slot.seq.load(std::memory_order_relaxed) == seq)
+        return seq;
+
+    // The slot is invalid while the packet is copied: a reader which started before checks the
+    // stamp again after its copy (see read())
+    slot.seq.store(-1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(_buffer + (size_t)idx*RTP_PACKET_SIZE, packet, len);
+    slot.len.store(len, std::memory_order_relaxed);
+    slot.seq.store(seq, std::memory_order_release);
+
+    // Highest seq received, and packets missing before it: a packet received out of order was
+    // counted missing. A large step back is a restart of the sequence
+    int last = _lastRcvSeq.load(std::memory_order_relaxed);
+    int dif = (int16_t)(seq - last);
+    unsigned long long lost = _lost.load(std::memory_order_relaxed);
+    if (last != -1 && dif > 1)
+        _lost.store(lost + dif - 1, std::memory_order_relaxed);
+    else if (last != -1 && dif < 0 && dif >= -_nbElmt / 2 && lost > 0)
+        _lost.store(lost - 1, std::memory_order_relaxed);
+    if (last == -1 || dif > 0 || dif < -_nbElmt / 2)
+        _lastRcvSeq.store(seq, std::memory_order_release);
+    _packets.store(_packets.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _event->notify();
+
+    return seq;
 };
 
+/*!
+* \fn read
+* \brief copy the packet of a given sequence, if it's in the ring
+*
+* \param wantedSeq RTP seq of the packet
+* \param buffer buffer receiving the packet
+* \param buflen size of the buffer
+* \return size of the packet, -1 if not available
+*/
 int CCircularRcvBuffer::read(int wantedSeq, char* buffer, int buflen) {
-    int result = -1;
-
-    std::unique_lock<std::mutex> lock(_mtx);
-
-    if (_buffer == NULL || _seqArray == NULL)
-        return result;
-
-    _rd_idx = (_rd_idx + 1) % _nbElmt;
-    int lastseq = _seqArray[_rd_idx];
-    if (lastseq == wantedSeq) {
-        char* rd_ptr = _buffer + _rd_idx*RTP_PACKET_SIZE;
-        memcpy(buffer, rd_ptr, RTP_PACKET_SIZE);
-        result = lastseq;
-        _seqArray[_rd_idx] = -1;
-        _readed++;
-        //if(_index == 1) LOG_INFO("[%d]  found pck#%d at pos %d, _readed=%d, _writed=%d", _index, wantedSeq, _rd_idx, _readed, _writed);
-    }
-    lock.unlock();
-
-    if(result==-1){
-        LOG("[%d] want packet#%d but find %d#, rd=%d, wr=%d , val=[%d..%d]", _index, wantedSeq, lastseq, _rd_idx, _wr_idx, _seqArray[_rd_idx], _seqArray[_wr_idx]);
-        //LOG_ERROR("[%d] want %d, find %d at pos %d", _index, wantedSeq, lastseq, _rd_idx);
-        result = searchFor(wantedSeq, buffer, buflen);
-    }
-
-    return result;
-}
-
-int CCircularRcvBuffer::searchFor(int wantedSeq, char* buffer, int buflen) {
-
-    int result = -1;
-
-    if (_buffer == NULL || _seqArray == NULL)
-        return result;
-
-    std::unique_lock<std::mutex> lock(_mtx);
-
-    for (int i = 0; i < _nbElmt; i++) {
-        //if (_seqArray[_rd_idx] == -1)
-        //    continue;
-        //if (min == -1 || min > _seqArray[_rd_idx]) min = _seqArray[_rd_idx];
-        //if (max == -1 || max < _seqArray[_rd_idx]) max = _seqArray[_rd_idx];
-        if (wantedSeq == _seqArray[i]) {
-            // Found!!!
-            char* rd_ptr = _buffer + (i * RTP_PACKET_SIZE);
-            memcpy(buffer, rd_ptr, RTP_PACKET_SIZE);
-            result = i;
-            _rd_idx = i;
-            LOG("[%d] found pck#%d at pos %d", _index, wantedSeq, i);
-            return result;
-        }
-    }
-#define _DEBUG
-#ifdef _DEBUG
-    _dump();
-#endif
-    LOG_ERROR("[%d] can't find wanted pck#%d", _index, wantedSeq);
-
-    return result;
-}
-
-void  CCircularRcvBuffer::_dump() {
-
-    if (_rd_idx<_wr_idx)
-        LOG_INFO("[%d] struct [0   r=%d...w=%d   %d]", _index, _rd_idx, _wr_idx, _nbElmt);
-    else 
-        LOG_INFO("[%d] struct [0...w=%d   r=%d...%d]", _index, _wr_idx, _rd_idx, _nbElmt);
-    
-    if(_seqArray[_rd_idx]<_seqArray[_wr_idx])
-        LOG_INFO("[%d] stored packets# [%d...%d]", _index, _seqArray[_rd_idx], _seqArray[_wr_idx]);
-    else
-        LOG_INFO("[%d] stored packets# [%d...65535][0...%d]", _index, _seqArray[_rd_idx], _seqArray[_wr_idx]);
 
+    if (_buffer == NULL || !_slots)
+        return -1;
+
+    int idx = wantedSeq & (_nbElmt - 1);
+    Slot& slot = _slots[idx];
+    if (slot.seq.load(std::memory_order_acquire) != wantedSeq)
+        return -1;
+    int len = std::min(slot.len.load(std::memory_order_relaxed), buflen);
+    memcpy(buffer, _buffer + (size_t)idx*RTP_PACKET_SIZE, len);
+
+    // Replaced by a newer packet while copied?
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != wantedSeq)
+        return -1;
+    return len;
 }
@@ -1,49 +1,57 @@
 #ifndef _CIRCULARBUFFER_H
 #define _CIRCULARBUFFER_H
 
-#include <mutex>
+#include <atomic>
+#include <memory>
 #include <thread>
-#include "queue.h"
+#include "ringqueue.h"
 #include "tcp_basic.h"
 
+/**********************************************************************************************
+*
+* CCircularRcvBuffer
+*
+* Receive buffer of one leg of a SMPTE ST 2022-7 stream: the packets are stored in a ring
+* indexed by their RTP sequence number (slot = seq mod nb of slots), written by the receive
+* thread of the leg without lock. The reader gets a given sequence in O(1) with read(): each
+* slot is stamped with the sequence of its packet, -1 while it's written.
+*
+***********************************************************************************************/
 class CCircularRcvBuffer {
 
+    struct Slot {
+        std::atomic<int> seq;               /* RTP seq of the packet of the slot, -1 if none or being written */
+        std::atomic<int> len;
+    };
+
     int         _index;
-    int         _nbElmt;
+    int         _nbElmt;                    /* nb of slots, a power of two dividing 65536 */
     UDP         _udpSock;
     char*       _buffer;
-    int*        _seqArray;
-    int         _wr_idx;
-    int         _rd_idx;
-    int         _lastRcvSeq;
-    std::mutex  _mtx;
+    std::unique_ptr<Slot[]> _slots;
+    std::atomic<int> _lastRcvSeq;           /* highest seq received, -1 if none */
+    std::atomic<unsigned long long> _packets;   /* nb of packets received */
+    std::atomic<unsigned long long> _lost;      /* nb of packets missing in the sequence received */
     bool        _bInit;
-    bool        _closed;
+    std::atomic<bool> _closed;
     std::thread _th_rcv;
-    int         _size;
-    int         _readed;
-    int         _writed;
-    CQueue<int>* _q;
-    bool        _isMaster;
+    CRingEvent* _event;                     /* notified on each packet received */
     int         _samplesize;
 
     void* _rcv_thread();
 
-    void  _dump();
-
 public:
     CCircularRcvBuffer();
     ~CCircularRcvBuffer();
 
-    int  init(CQueue<int>* q, const char* remote_addr, const char* local_addr, int port, int nbElmt, int index);
+    int  init(CRingEvent* event, const char* remote_addr, const char* local_addr, int port, int nbElmt, int index, int rxBatch = UDP_RXRING_DEFAULT_PACKETS);
     int  close();
     int  write();
     int  read(int wantedSeq, char* buffer, int buflen);
-    int  searchFor(int wantedSeq, char* buffer, int buflen);
-    int  getLastRecvSeq() { return _lastRcvSeq;  };
+    int  getLastRecvSeq() { return _lastRcvSeq.load(std::memory_order_acquire); };
+    unsigned long long getPacketCount() { return _packets.load(std::memory_order_relaxed); };
+    unsigned long long getLostCount() { return _lost.load(std::memory_order_relaxed); };
     int  getIndex() { return _index; };
-    bool isMaster() { return _isMaster; };
-    void setMaster(bool flag) { _isMaster = flag; };
     int  getSampleSize() { return _samplesize; };
 };
 
@@ -29,12 +29,15 @@ enum PinType {
     PIN_TYPE_DEVNULL     = 4,   // (out)    Pin allowing to do nothing with video data
     PIN_TYPE_RTP         = 5,   // (in/out) Pin allowing to receive/send video frames using RTP (UDP socket)
     PIN_TYPE_SMPTE       = 7,   // (in/out) Pin allowing to receive/send SMPTE stream (on top of RTP)
-    PIN_TYPE_TCP_THUMB   = 8,   // (out)    Pin allowing to send thumbnail of video (monitoring). To use only for 8bits stream.
+    PIN_TYPE_TCP_THUMB   = 8,   // (out)    Pin allowing to send thumbnail of video (monitoring). YCbCr 4:2:2 8/10 bits or RGB(A) streams.
     PIN_TYPE_RAWRTP      = 9,
     PIN_TYPE_RAWX264     = 10,  // (out)    Pin allowing to broadcast x264 stream
     PIN_TYPE_TR03        = 11,  // (in/out) Pin allowing to receive/send TR03 stream (on top of RTP)
     PIN_TYPE_AES67       = 12,  // (in)     Pin allowing to receive AES67
     PIN_TYPE_STORAGE     = 13,  // (out)
+    PIN_TYPE_SHMEM_RING  = 14,  // (in/out) Pin allowing to receive/send video frames using a ring of frame slots in shared memory (zero-copy receive)
+    PIN_TYPE_ST2110      = 15,  // (in)     Pin allowing to receive SMPTE ST 2110-20 video (on top of RTP)
+    PIN_TYPE_FANOUT      = 16,  // (out)    Pin allowing to send a RTP or SMPTE stream to several destinations, packetized once
     PIN_TYPE_MAX
 };
 
@@ -48,11 +51,14 @@ enum PinType {
                               a == PIN_TYPE_RAWX264    || \
                               a == PIN_TYPE_SMPTE      || \
                               a == PIN_TYPE_TR03       || \
+                              a == PIN_TYPE_ST2110     || \
+                              a == PIN_TYPE_FANOUT     || \
                               a == PIN_TYPE_AES67       || \
                               a == PIN_TYPE_STORAGE    || \
                               a == PIN_TYPE_TCP_THUMB   )
 
-#define MEMORY_TYPE(a)      ( a == PIN_TYPE_SHMEM      )
+#define MEMORY_TYPE(a)      ( a == PIN_TYPE_SHMEM      || \
+                              a == PIN_TYPE_SHMEM_RING )
 
 /*
 * \brief Transport type enumeration
@@ -91,6 +97,11 @@ enum INTERLACED_MODE {
 #define VMI_MEM_MSG_LEN     64
 #define VMI_MEM_MSG_FORMAT  "GO:key=%d:size=%d:offset=%d:sid=%lld"     /* Format = "GO:key=%SHMEM_KEY%:size=%MEM_SIZE%:offset=%MEM_OFFSET%:sid=%SESSION_ID%" */
 
+/*
+* \brief Frames prepared by an output pin in advance of their transmission, see COut::prepare()
+*/
+#define COUT_STAGES         2
+
 
 /*
  *
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+
+#include "common.h"
+#include "tools.h"
+#include "log.h"
+#include "workerpool.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CONVERT_HAVE_X86
+#include <immintrin.h>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef _WIN32
+#define CONVERT_TARGET(isa)
+#else
+#define CONVERT_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// Conversion of a big frame is splitted on the worker pool, by slices of this size (input bytes)
+#define CONVERT_SLICE_SIZE  (1024 * 1024)
+
+/*
+* 10 bits components are packed big endian, 4 components (40 bits) on 5 bytes. 8 bits
+* components are the 8 MSB of the 10 bits ones. On 8 to 10 bits conversion, the components are
+* clamped on the legal range: [16, 240] for Cb/Cr (even index) and [16, 235] for Y (odd index).
+*/
+
+typedef void (*convertKernel)(const unsigned char* in, int nbGroups, unsigned char* out);
+
+static unsigned char g_clamp8bits[2][256];  /* legal range clamping tables, for even and odd components */
+
+static void _init_clamp_tables() {
+    for (int v = 0; v < 256; v++) {
+        g_clamp8bits[0][v] = (unsigned char)MAX(16, MIN(v, 240));
+        g_clamp8bits[1][v] = (unsigned char)MAX(16, MIN(v, 235));
+    }
+}
+
+/*!
+* \fn _convert10to8_scalar
+* \brief reference implementation: convert nbGroups groups of 4 components, from 10 bits (5 bytes)
+*        to 8 bits (4 bytes). in and out may be the same buffer.
+*/
+static void _convert10to8_scalar(const unsigned char* in, int nbGroups, unsigned char* out) {
+    for (int g = 0; g < nbGroups; g++) {
+        out[0] = in[0];
+        out[1] = (unsigned char)((in[1] << 2) | (in[2] >> 6));
+        out[2] = (unsigned char)((in[2] << 4) | (in[3] >> 4));
+        out[3] = (unsigned char)((in[3] << 6) | (in[4] >> 2));
+        in += 5;
+        out += 4;
+    }
+}
+
+/*!
+* \fn _convert8to10_scalar
+* \brief reference implementation: convert nbGroups groups of 4 components, from 8 bits (4 bytes)
+*        to 10 bits (5 bytes), with legal range clamping
+*/
+static void _convert8to10_scalar(const unsigned char* in, int nbGroups, unsigned char* out) {
+    const unsigned char* even = g_clamp8bits[0];
+    const unsigned char* odd = g_clamp8bits[1];
+    for (int g = 0; g < nbGroups; g++) {
+        unsigned int v0 = even[in[0]];
+        unsigned int v1 = odd[in[1]];
+        unsigned int v2 = even[in[2]];
+        unsigned int v3 = odd[in[3]];
+        out[0] = (unsigned char)v0;
+        out[1] = (unsigned char)(v1 >> 2);
+        out[2] = (unsigned char)((v1 << 6) | (v2 >> 4));
+        out[3] = (unsigned char)((v2 << 4) | (v3 >> 6));
+        out[4] = (unsigned char)(v3 << 2);
+        in += 4;
+        out += 5;
+    }
+}
+
+#ifdef CONVERT_HAVE_X86
+
+/*
+* 10 to 8 bits: component k of a group is ((in[k] << 8 | in[k+1]) << 2k) >> 8. pshufb gathers
+* the two bytes in a 16 bits lane, a multiply by 1, 4, 16, 64 does the variable shift.
+* Each 128 bits lane converts 2 groups (10 input bytes, 16 bytes loaded).
+*
+* 8 to 10 bits: pmaddwd builds (v0 << 10 | v1) and (v2 << 10 | v3) in the 32 bits lanes, then
+* the 40 bits group of each 64 bits lane is (x << 22) | (x >> 30). pshufb writes the 5 bytes
+* big endian. Each 128 bits lane converts 2 groups (10 output bytes, 16 bytes stored).
+*/
+
+#define SHUF_10TO8  1, 0, 2, 1, 3, 2, 4, 3, 6, 5, 7, 6, 8, 7, 9, 8
+#define MUL_10TO8   1, 4, 16, 64, 1, 4, 16, 64
+#define MADD_8TO10  1024, 1, 1024, 1, 1024, 1, 1024, 1
+#define SHUF_8TO10  4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1
+#define CLAMP_8TO10 (char)240, (char)235, (char)240, (char)235, (char)240, (char)235, (char)240, (char)235, \
+                    (char)240, (char)235, (char)240, (char)235, (char)240, (char)235, (char)240, (char)235
+
+CONVERT_TARGET("ssse3,sse4.1")
+static void _convert10to8_sse41(const unsigned char* in, int nbGroups, unsigned char* out) {
+    const __m128i shuf = _mm_setr_epi8(SHUF_10TO8);
+    const __m128i mul = _mm_setr_epi16(MUL_10TO8);
+    int g = 0;
+    // 4 groups per iteration, the last load reads 6 bytes after the groups
+    for (; g + 4 + 2 <= nbGroups; g += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(in));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + 10));
+        a = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(a, shuf), mul), 8);
+        b = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(b, shuf), mul), 8);
+        _mm_storeu_si128((__m128i*)out, _mm_packus_epi16(a, b));
+        in += 20;
+        out += 16;
+    }
+    _convert10to8_scalar(in, nbGroups - g, out);
+}
+
+CONVERT_TARGET("ssse3,sse4.1")
+static void _convert8to10_sse41(const unsigned char* in, int nbGroups, unsigned char* out) {
+    const __m128i vmin = _mm_set1_epi8(16);
+    const __m128i vmax = _mm_setr_epi8(CLAMP_8TO10);
+    const __m128i madd = _mm_setr_epi16(MADD_8TO10);
+    const __m128i shuf = _mm_setr_epi8(SHUF_8TO10);
+    int g = 0;
+    // 4 groups per iteration, the last store writes 6 bytes after the groups
+    for (; g + 4 + 2 <= nbGroups; g += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)in);
+        v = _mm_max_epu8(_mm_min_epu8(v, vmax), vmin);
+        __m128i a = _mm_madd_epi16(_mm_cvtepu8_epi16(v), madd);
+        __m128i b = _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(v, 8)), madd);
+        a = _mm_shuffle_epi8(_mm_or_si128(_mm_slli_epi64(a, 22), _mm_srli_epi64(a, 30)), shuf);
+        b = _mm_shuffle_epi8(_mm_or_si128(_mm_slli_epi64(b, 22), _mm_srli_epi64(b, 30)), shuf);
+        _mm_storeu_si128((__m128i*)out, a);
+        _mm_storeu_si128((__m128i*)(out + 10), b);
+        in += 16;
+        out += 20;
+    }
+    _convert8to10_scalar(in, nbGroups - g, out);
+}
+
+CONVERT_TARGET("avx2")
+static void _convert10to8_avx2(const unsigned char* in, int nbGroups, unsigned char* out) {
+    const __m256i shuf = _mm256_setr_epi8(SHUF_10TO8, SHUF_10TO8);
+    const __m256i mul = _mm256_setr_epi16(MUL_10TO8, MUL_10TO8);
+    int g = 0;
+    for (; g + 8 + 2 <= nbGroups; g += 8) {
+        __m256i a = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)in)),
+                                            _mm_loadu_si128((const __m128i*)(in + 10)), 1);
+        __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + 20))),
+                                            _mm_loadu_si128((const __m128i*)(in + 30)), 1);
+        a = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_shuffle_epi8(a, shuf), mul), 8);
+        b = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_shuffle_epi8(b, shuf), mul), 8);
+        // packus works by 128 bits lane: restore the order of the 4 x 8 components
+        __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)out, r);
+        in += 40;
+        out += 32;
+    }
+    _convert10to8_sse41(in, nbGroups - g, out);
+}
+
+CONVERT_TARGET("avx2")
+static void _convert8to10_avx2(const unsigned char* in, int nbGroups, unsigned char* out) {
+    const __m256i vmin = _mm256_set1_epi8(16);
+    const __m256i vmax = _mm256_setr_epi8(CLAMP_8TO10, CLAMP_8TO10);
+    const __m256i madd = _mm256_setr_epi16(MADD_8TO10, MADD_8TO10);
+    const __m256i shuf = _mm256_setr_epi8(SHUF_8TO10, SHUF_8TO10);
+    int g = 0;
+    for (; g + 8 + 2 <= nbGroups; g += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)in);
+        v = _mm256_max_epu8(_mm256_min_epu8(v, vmax), vmin);
+        __m256i a = _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)), madd);
+        __m256i b = _mm256_madd_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)), madd);
+        a = _mm256_shuffle_epi8(_mm256_or_si256(_mm256_slli_epi64(a, 22), _mm256_srli_epi64(a, 30)), shuf);
+        b = _mm256_shuffle_epi8(_mm256_or_si256(_mm256_slli_epi64(b, 22), _mm256_srli_epi64(b, 30)), shuf);
+        _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(a));
+        _mm_storeu_si128((__m128i*)(out + 10), _mm256_extracti128_si256(a, 1));
+        _mm_storeu_si128((__m128i*)(out + 20), _mm256_castsi256_si128(b));
+        _mm_storeu_si128((__m128i*)(out + 30), _mm256_extracti128_si256(b, 1));
+        in += 32;
+        out += 40;
+    }
+    _convert8to10_sse41(in, nbGroups - g, out);
+}
+
+CONVERT_TARGET("avx512f,avx512bw")
+static void _convert10to8_avx512(const unsigned char* in, int nbGroups, unsigned char* out) {
+    const __m512i shuf = _mm512_broadcast_i32x4(_mm_setr_epi8(SHUF_10TO8));
+    const __m512i mul = _mm512_broadcast_i32x4(_mm_setr_epi16(MUL_10TO8));
+    const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+    int g = 0;
+    for (; g + 16 + 2 <= nbGroups; g += 16) {
+        __m512i a = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)in));
+        a = _mm512_inserti32x4(a, _mm_loadu_si128((const __m128i*)(in + 10)), 1);
+        a = _mm512_inserti32x4(a, _mm_loadu_si128((const __m128i*)(in + 20)), 2);
+        a = _mm512_inserti32x4(a, _mm_loadu_si128((const __m128i*)(in + 30)), 3);
+        __m512i b = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i*)(in + 40)));
+        b = _mm512_inserti32x4(b, _mm_loadu_si128((const __m128i*)(in + 50)), 1);
+        b = _mm512_inserti32x4(b, _mm_loadu_si128((const __m128i*)(in + 60)), 2);
+        b = _mm512_inserti32x4(b, _mm_loadu_si128((const __m128i*)(in + 70)), 3);
+        a = _mm512_srli_epi16(_mm512_mullo_epi16(_mm512_shuffle_epi8(a, shuf), mul), 8);
+        b = _mm512_srli_epi16(_mm512_mullo_epi16(_mm512_shuffle_epi8(b, shuf), mul), 8);
+        __m512i r = _mm512_permutexvar_epi64(order, _mm512_packus_epi16(a, b));
+        _mm512_storeu_si512((void*)out, r);
+        in += 80;
+        out += 64;
+    }
+    _convert10to8_avx2(in, nbGroups - g, out);
+}
+
+CONVERT_TARGET("avx512f,avx512bw")
+static void _convert8to10_avx512(const unsigned char* in, int nbGroups, unsigned char* out) {
+    const __m512i vmin = _mm512_set1_epi8(16);
+    const __m512i vmax = _mm512_broadcast_i32x4(_mm_setr_epi8(CLAMP_8TO10));
+    const __m512i madd = _mm512_broadcast_i32x4(_mm_setr_epi16(MADD_8TO10));
+    const __m512i shuf = _mm512_broadcast_i32x4(_mm_setr_epi8(SHUF_8TO10));
+    int g = 0;
+    for (; g + 16 + 2 <= nbGroups; g += 16) {
+        __m512i v = _mm512_loadu_si512((const void*)in);
+        v = _mm512_max_epu8(_mm512_min_epu8(v, vmax), vmin);
+        __m512i a = _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm512_castsi512_si256(v)), madd);
+        __m512i b = _mm512_madd_epi16(_mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(v, 1)), madd);
+        a = _mm512_shuffle_epi8(_mm512_or_si512(_mm512_slli_epi64(a, 22), _mm512_srli_epi64(a, 30)), shuf);
+        b = _mm512_shuffle_epi8(_mm512_or_si512(_mm512_slli_epi64(b, 22), _mm512_srli_epi64(b, 30)), shuf);
+        _mm_storeu_si128((__m128i*)out, _mm512_castsi512_si128(a));
+        _mm_storeu_si128((__m128i*)(out + 10), _mm512_extracti32x4_epi32(a, 1));
+        _mm_storeu_si128((__m128i*)(out + 20), _mm512_extracti32x4_epi32(a, 2));
+        _mm_storeu_si128((__m128i*)(out + 30), _mm512_extracti32x4_epi32(a, 3));
+        _mm_storeu_si128((__m128i*)(out + 40), _mm512_castsi512_si128(b));
+        _mm_storeu_si128((__m128i*)(out + 50), _mm512_extracti32x4_epi32(b, 1));
+        _mm_storeu_si128((__m128i*)(out + 60), _mm512_extracti32x4_epi32(b, 2));
+        _mm_storeu_si128((__m128i*)(out + 70), _mm512_extracti32x4_epi32(b, 3));
+        in += 64;
+        out += 80;
+    }
+    _convert8to10_avx2(in, nbGroups - g, out);
+}
+
+static void _cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#ifdef _WIN32
+    __cpuidex((int*)regs, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long _read_xcr0() {
+#ifdef _WIN32
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+#endif // CONVERT_HAVE_X86
+
+static convertKernel g_convert10to8 = _convert10to8_scalar;
+static convertKernel g_convert8to10 = _convert8to10_scalar;
+static const char*   g_convertKernelName = "scalar";
+static int           g_simdLevel = TOOLS_SIMD_SCALAR;
+static std::once_flag g_convertInitFlag;
+
+/*!
+* \fn _init_kernels
+* \brief select the conversion kernels for the CPU, at the first conversion
+*/
+static void _init_kernels() {
+    _init_clamp_tables();
+#ifdef CONVERT_HAVE_X86
+    unsigned int regs[4] = { 0 };
+    _cpuid(0, 0, regs);
+    unsigned int maxLeaf = regs[0];
+    _cpuid(1, 0, regs);
+    bool sse41 = (regs[2] & (1 << 19)) != 0;
+    bool ssse3 = (regs[2] & (1 << 9)) != 0;
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _read_xcr0() : 0;
+    bool avx2 = false, avx512 = false;
+    if (maxLeaf >= 7) {
+        _cpuid(7, 0, regs);
+        // AVX2 needs the OS to save YMM state, AVX-512 the OPMASK and ZMM states too
+        avx2 = (regs[1] & (1 << 5)) != 0 && (xcr0 & 0x06) == 0x06;
+        avx512 = (regs[1] & (1 << 16)) != 0 && (regs[1] & (1 << 30)) != 0 && (xcr0 & 0xE6) == 0xE6;
+    }
+    // VMI_SIMD environment variable limits the instruction set: scalar, sse4.1 or avx2
+    string limit = tools::getEnv("VMI_SIMD");
+    if (limit == "scalar")
+        sse41 = avx2 = avx512 = false;
+    else if (limit == "sse4.1")
+        avx2 = avx512 = false;
+    else if (limit == "avx2")
+        avx512 = false;
+    if (avx512) {
+        g_convert10to8 = _convert10to8_avx512;
+        g_convert8to10 = _convert8to10_avx512;
+        g_convertKernelName = "avx512";
+        g_simdLevel = TOOLS_SIMD_AVX512;
+    }
+    else if (avx2) {
+        g_convert10to8 = _convert10to8_avx2;
+        g_convert8to10 = _convert8to10_avx2;
+        g_convertKernelName = "avx2";
+        g_simdLevel = TOOLS_SIMD_AVX2;
+    }
+    else if (sse41 && ssse3) {
+        g_convert10to8 = _convert10to8_sse41;
+        g_convert8to10 = _convert8to10_sse41;
+        g_convertKernelName = "sse4.1";
+        g_simdLevel = TOOLS_SIMD_SSE41;
+    }
+#endif
+    LOG_INFO("10/8 bits conversion kernels: %s", g_convertKernelName);
+}
+
+/*!
+* \fn _convert
+* \brief convert nbGroups groups with a kernel. Big conversions are splitted by slices on the
+*        worker pool, if in and out don't overlap: the in-place 10 to 8 bits conversion
+*        overwrites the input of the previous slices and stays single threaded.
+*/
+static void _convert(convertKernel kernel, const unsigned char* in, int inGroupSize, unsigned char* out, int outGroupSize, int nbGroups) {
+    int groupsPerSlice = CONVERT_SLICE_SIZE / inGroupSize;
+    int nbSlices = (nbGroups + groupsPerSlice - 1) / groupsPerSlice;
+    bool overlap = (in < out + (size_t)nbGroups * outGroupSize) && (out < in + (size_t)nbGroups * inGroupSize);
+    if (nbSlices <= 1 || overlap) {
+        kernel(in, nbGroups, out);
+        return;
+    }
+    CWorkerPool::getInstance()->parallelFor(nbSlices, [=](int slice) {
+        int first = slice * groupsPerSlice;
+        kernel(in + (size_t)first * inGroupSize, std::min(groupsPerSlice, nbGroups - first), out + (size_t)first * outGroupSize);
+    });
+}
+
+VMILIBRARY_API_TOOLS int tools::convert10bitsto8bits(unsigned char* in, int in_size, unsigned char* out) {
+    std::call_once(g_convertInitFlag, _init_kernels);
+    _convert(g_convert10to8, in, 5, out, 4, in_size / 5);
+    return 0;
+}
+
+VMILIBRARY_API_TOOLS int tools::convert8bitsto10bits(unsigned char* in, int in_size, unsigned char* out) {
+    std::call_once(g_convertInitFlag, _init_kernels);
+    _convert(g_convert8to10, in, 4, out, 5, in_size / 4);
+    return 0;
+}
+
+VMILIBRARY_API_TOOLS int tools::convert10bitsto8bitsScalar(unsigned char* in, int in_size, unsigned char* out) {
+    std::call_once(g_convertInitFlag, _init_kernels);
+    _convert10to8_scalar(in, in_size / 5, out);
+    return 0;
+}
+
+VMILIBRARY_API_TOOLS int tools::convert8bitsto10bitsScalar(unsigned char* in, int in_size, unsigned char* out) {
+    std::call_once(g_convertInitFlag, _init_kernels);
+    _convert8to10_scalar(in, in_size / 4, out);
+    return 0;
+}
+
+VMILIBRARY_API_TOOLS const char* tools::getConvertKernelName() {
+    std::call_once(g_convertInitFlag, _init_kernels);
+    return g_convertKernelName;
+}
+
+VMILIBRARY_API_TOOLS int tools::getSIMDLevel() {
+    std::call_once(g_convertInitFlag, _init_kernels);
+    return g_simdLevel;
+}
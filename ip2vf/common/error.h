@@ -33,6 +33,11 @@ enum _ERRORCODE {
     VMI_E_NOT_PRIMARY_SRC,
     VMI_E_PACKET_LOST,
 
+    // Errors relative to shared memory ring
+    VMI_E_RING_NOT_READY,
+    VMI_E_RING_SLOT_BUSY,
+    VMI_E_RING_TIMEOUT,
+
 };
 
 #endif  // _ERROR_H
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "common.h"
+#include "log.h"
+#include "framearena.h"
+
+#ifndef _WIN32
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT          26
+#endif
+#define FRAMEARENA_MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#define FRAMEARENA_MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#define FRAMEARENA_MPOL_PREFERRED   1       /* mbind() mode: allocate on the node if possible */
+#endif
+
+CFrameArena* CFrameArena::_instance = nullptr;
+
+CFrameArena::CFrameArena()
+{
+    std::memset(&_stats, 0, sizeof(_stats));
+    _bHugeTLB = true;
+}
+
+/*!
+* \fn getInstance
+* \brief return the arena shared by all the frames of the module
+*
+* \return CFrameArena object
+*/
+CFrameArena* CFrameArena::getInstance()
+{
+    static std::mutex mtx;
+    std::unique_lock<std::mutex> lock(mtx);
+    if (_instance)
+        return _instance;
+    _instance = new CFrameArena();
+    return _instance;
+}
+
+size_t CFrameArena::_size_class(size_t size)
+{
+    if (size >= FRAMEARENA_HUGEPAGE)
+        return (size + FRAMEARENA_HUGEPAGE - 1) / FRAMEARENA_HUGEPAGE * FRAMEARENA_HUGEPAGE;
+    size_t c = FRAMEARENA_MIN_CLASS;
+    while (c < size)
+        c <<= 1;
+    return c;
+}
+
+/*!
+* \fn _current_node
+* \brief NUMA node of the core the calling thread runs on
+*
+* \return node, -1 if unknown
+*/
+int CFrameArena::_current_node()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+        return (int)node;
+#endif
+    return -1;
+}
+
+/*!
+* \fn _map
+* \brief map a block: on 1 GB or 2 MB huge pages if its size allows it and some are available,
+*        with transparent huge pages otherwise, bound to a NUMA node, and touched
+*
+* \param size size of the block, a size class
+* \param node NUMA node, -1 if unknown
+* \param pageSize receive the size of the pages of the block
+* \return the block, NULL if error
+*/
+void* CFrameArena::_map(size_t size, int node, size_t* pageSize)
+{
+    void* p = NULL;
+#ifdef _WIN32
+    p = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    *pageSize = 4096;
+#else
+    *pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    if (_bHugeTLB && size % FRAMEARENA_HUGEPAGE == 0) {
+        if (size % FRAMEARENA_GIGAPAGE == 0) {
+            p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | FRAMEARENA_MAP_HUGE_1GB, -1, 0);
+            if (p != MAP_FAILED)
+                *pageSize = FRAMEARENA_GIGAPAGE;
+        }
+        if (p == NULL || p == MAP_FAILED) {
+            p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | FRAMEARENA_MAP_HUGE_2MB, -1, 0);
+            if (p != MAP_FAILED)
+                *pageSize = FRAMEARENA_HUGEPAGE;
+        }
+        if (p == MAP_FAILED) {
+            LOG_INFO("no huge page available (%s), using transparent huge pages", strerror(errno));
+            _bHugeTLB = false;
+        }
+    }
+    if (p == NULL || p == MAP_FAILED) {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+#ifdef MADV_HUGEPAGE
+        if (size >= FRAMEARENA_HUGEPAGE)
+            madvise(p, size, MADV_HUGEPAGE);
+#endif
+    }
+#if defined(__linux__) && defined(SYS_mbind)
+    // Preferred, not strict, binding: the block is still mapped when the node is full
+    if (node >= 0 && node < (int)(8 * sizeof(unsigned long))) {
+        unsigned long mask = 1UL << node;
+        syscall(SYS_mbind, p, size, FRAMEARENA_MPOL_PREFERRED, &mask, 8 * sizeof(unsigned long) + 1, 0);
+    }
+#endif
+#endif
+    if (p != NULL)
+        std::memset(p, 0, size);
+    return p;
+}
+
+/*!
+* \fn alloc
+* \brief give a buffer, from the free list of its class on the node of the calling thread if
+*        possible, mapped otherwise
+*
+* \param size minimal size of the buffer
+* \param capacity receive the size of the buffer, the size class
+* \return the buffer, aligned on FRAMEARENA_ALIGN bytes at least, NULL if error
+*/
+unsigned char* CFrameArena::alloc(size_t size, size_t* capacity)
+{
+    if (size == 0)
+        return NULL;
+    size_t c = _size_class(size);
+    int node = _current_node();
+
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        auto it = _free.find(std::make_pair(node, c));
+        if (it != _free.end() && !it->second.empty()) {
+            void* p = it->second.back();
+            it->second.pop_back();
+            Block& b = _blocks[p];
+            b.inUse = true;
+            _stats.bytesInUse += c;
+            _stats.faultsAvoided += c / b.pageSize;
+            _stats.allocations++;
+            _stats.recycled++;
+            *capacity = c;
+            return (unsigned char*)p;
+        }
+    }
+
+    // Mapped and touched without lock: it takes a few ms for a frame
+    size_t pageSize = 0;
+    void* p = _map(c, node, &pageSize);
+    if (p == NULL) {
+        LOG_ERROR("failed to map %zu bytes", c);
+        return NULL;
+    }
+    std::unique_lock<std::mutex> lock(_mtx);
+    Block b;
+    b.size = c;
+    b.node = node;
+    b.pageSize = pageSize;
+    b.inUse = true;
+    _blocks[p] = b;
+    _stats.bytesReserved += c;
+    if (pageSize >= FRAMEARENA_HUGEPAGE)
+        _stats.bytesHugePages += c;
+    _stats.bytesInUse += c;
+    _stats.allocations++;
+    LOG_INFO("new buffer of %zu bytes on node %d, %zu bytes pages, %lld bytes reserved", c, node, pageSize, _stats.bytesReserved);
+    *capacity = c;
+    return (unsigned char*)p;
+}
+
+/*!
+* \fn release
+* \brief give back a buffer given by alloc(): it goes to the free list of its class and node
+*
+* \param buffer the buffer
+*/
+void CFrameArena::release(unsigned char* buffer)
+{
+    if (buffer == NULL)
+        return;
+    std::unique_lock<std::mutex> lock(_mtx);
+    auto it = _blocks.find(buffer);
+    if (it == _blocks.end() || !it->second.inUse) {
+        LOG_ERROR("%p is not a buffer in use of the arena", buffer);
+        return;
+    }
+    it->second.inUse = false;
+    _stats.bytesInUse -= it->second.size;
+    _free[std::make_pair(it->second.node, it->second.size)].push_back(buffer);
+}
+
+void CFrameArena::getStats(FrameArenaStats* stats)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    *stats = _stats;
+}
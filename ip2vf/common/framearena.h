@@ -0,0 +1,72 @@
+#ifndef _FRAMEARENA_H
+#define _FRAMEARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define FRAMEARENA_ALIGN        64                  /* alignment of the buffers, at least */
+#define FRAMEARENA_HUGEPAGE     (2*1024*1024)       /* size of a huge page */
+#define FRAMEARENA_GIGAPAGE     (1024*1024*1024)    /* size of a 1 GB huge page */
+#define FRAMEARENA_MIN_CLASS    4096                /* smallest buffer */
+
+/* Counters of the frame arena */
+struct FrameArenaStats {
+    long long   bytesReserved;      /* memory mapped by the arena */
+    long long   bytesInUse;         /* memory of the buffers given to the frames */
+    long long   bytesHugePages;     /* part of bytesReserved mapped on huge pages (hugetlbfs) */
+    long long   faultsAvoided;      /* page faults of the buffers recycled instead of mapped again */
+    long long   allocations;        /* buffers given */
+    long long   recycled;           /* buffers given from the free lists */
+};
+
+/**********************************************************************************************
+*
+* CFrameArena
+*
+* Memory of the frame buffers: the buffers are mapped by size class, on huge pages if possible
+* (hugetlbfs, transparent huge pages otherwise), on the NUMA node of the thread which asks for
+* them, and touched once so that their page faults are paid at reservation time. A released
+* buffer goes back to the free list of its class and node, to be given again: the buffers are
+* never unmapped.
+*
+* Size classes: powers of two up to FRAMEARENA_HUGEPAGE, then multiples of FRAMEARENA_HUGEPAGE.
+*
+***********************************************************************************************/
+
+class CFrameArena
+{
+    struct Block {
+        size_t      size;           /* size class */
+        int         node;           /* NUMA node the block is bound to, -1 if unknown */
+        size_t      pageSize;       /* size of the pages of the block */
+        bool        inUse;
+    };
+
+    std::mutex      _mtx;
+    std::unordered_map<void*, Block> _blocks;                   /* all the blocks, by address */
+    std::map<std::pair<int, size_t>, std::vector<void*>> _free; /* free blocks, by node and size class */
+    FrameArenaStats _stats;
+    std::atomic<bool> _bHugeTLB;    /* false once a hugetlbfs mapping failed */
+
+    static CFrameArena* _instance;
+
+    CFrameArena();
+
+    static size_t _size_class(size_t size);
+    static int    _current_node();
+    void* _map(size_t size, int node, size_t* pageSize);
+
+public:
+    static CFrameArena* getInstance();
+
+    unsigned char* alloc(size_t size, size_t* capacity);
+    void release(unsigned char* buffer);
+    void getStats(FrameArenaStats* stats);
+};
+
+#endif // _FRAMEARENA_H
@@ -0,0 +1,610 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include "common.h"
+#include "tools.h"
+#include "log.h"
+#include "workerpool.h"
+#include "framecodec.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CODEC_HAVE_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <intrin.h>
+#define CODEC_TARGET(isa)
+#else
+#define CODEC_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#define FRAMECODEC_BLOCK        32      /* residuals per Rice block */
+#define FRAMECODEC_QMAX         16      /* longest unary quotient, an escape code beyond */
+#define FRAMECODEC_ZERO_BLOCK   15      /* Rice parameter of a block of null residuals */
+#define FRAMECODEC_STORED       0x80000000u
+#define FRAMECODEC_PAD          8       /* extra components of the line buffers */
+
+/*
+* The residual of a component is x - median(a, b, a + b - c), with a, b, c its left, upper and
+* upper-left neighbours, reduced modulo 2^depth in [-2^(depth-1), 2^(depth-1)) and mapped to
+* [0, 2^depth) (0, -1, 1, -2, ...). The left neighbour of the first pixel group of a line is the
+* upper one, the line above the first line of a slice is mid-grey: its components are predicted
+* from their left neighbour.
+*/
+
+typedef void (*residualKernel)(const int16_t* cur, const int16_t* prev, int period, int n, int depth, uint16_t* out);
+typedef void (*reconstructKernel)(const uint16_t* u, const int16_t* prev, int period, int n, int mask, int16_t* cur);
+
+// Branchless: the predictions of noisy content would mispredict the branches of std::min/max
+static inline int _min(int x, int y) { return y + ((x - y) & ((x - y) >> 31)); }
+static inline int _max(int x, int y) { return x - ((x - y) & ((x - y) >> 31)); }
+
+static inline int _predict(int a, int b, int c) {
+    int mn = _min(a, b), mx = _max(a, b);
+    return _max(mn, _min(mx, a + b - c));
+}
+
+/*!
+* \fn _residuals_scalar
+* \brief reference implementation: mapped residuals of the n components of a line
+*/
+static void _residuals_scalar(const int16_t* cur, const int16_t* prev, int period, int n, int depth, uint16_t* out) {
+    int half = 1 << (depth - 1), mask = (1 << depth) - 1;
+    for (int i = 0; i < n; i++) {
+        int r = ((cur[i] - _predict(cur[i - period], prev[i], prev[i - period]) + half) & mask) - half;
+        out[i] = (uint16_t)((r << 1) ^ (r >> 15));
+    }
+}
+
+/*!
+* \fn _reconstruct_scalar
+* \brief reference implementation: components of a line from their mapped residuals. The left
+*        neighbour of a component is the one just decoded: the left and upper-left neighbours
+*        of the PERIOD components of a pixel group are kept in registers, so that the PERIOD
+*        dependency chains run in parallel.
+*/
+template <int PERIOD>
+static void _reconstruct_period(const uint16_t* u, const int16_t* prev, int n, int mask, int16_t* cur) {
+    int a[PERIOD], c[PERIOD];
+    for (int j = 0; j < PERIOD; j++)
+        a[j] = c[j] = prev[j];
+    for (int i = 0; i < n; i += PERIOD) {
+        for (int j = 0; j < PERIOD; j++) {
+            int b = prev[i + j];
+            int r = (u[i + j] >> 1) ^ -(u[i + j] & 1);
+            a[j] = (_predict(a[j], b, c[j]) + r) & mask;
+            c[j] = b;
+            cur[i + j] = (int16_t)a[j];
+        }
+    }
+}
+
+static void _reconstruct_scalar(const uint16_t* u, const int16_t* prev, int period, int n, int mask, int16_t* cur) {
+    if (period == 4)
+        _reconstruct_period<4>(u, prev, n, mask, cur);
+    else
+        _reconstruct_period<3>(u, prev, n, mask, cur);
+}
+
+#ifdef CODEC_HAVE_X86
+
+CODEC_TARGET("sse2")
+static void _residuals_sse2(const int16_t* cur, const int16_t* prev, int period, int n, int depth, uint16_t* out) {
+    const __m128i half = _mm_set1_epi16((short)(1 << (depth - 1)));
+    const __m128i mask = _mm_set1_epi16((short)((1 << depth) - 1));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(cur + i - period));
+        __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(prev + i - period));
+        __m128i x = _mm_loadu_si128((const __m128i*)(cur + i));
+        __m128i g = _mm_sub_epi16(_mm_add_epi16(a, b), c);
+        __m128i p = _mm_max_epi16(_mm_min_epi16(a, b), _mm_min_epi16(_mm_max_epi16(a, b), g));
+        __m128i r = _mm_sub_epi16(_mm_and_si128(_mm_add_epi16(_mm_sub_epi16(x, p), half), mask), half);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(_mm_slli_epi16(r, 1), _mm_srai_epi16(r, 15)));
+    }
+    _residuals_scalar(cur + i, prev + i, period, n - i, depth, out + i);
+}
+
+CODEC_TARGET("avx2")
+static void _residuals_avx2(const int16_t* cur, const int16_t* prev, int period, int n, int depth, uint16_t* out) {
+    const __m256i half = _mm256_set1_epi16((short)(1 << (depth - 1)));
+    const __m256i mask = _mm256_set1_epi16((short)((1 << depth) - 1));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(cur + i - period));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(prev + i));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(prev + i - period));
+        __m256i x = _mm256_loadu_si256((const __m256i*)(cur + i));
+        __m256i g = _mm256_sub_epi16(_mm256_add_epi16(a, b), c);
+        __m256i p = _mm256_max_epi16(_mm256_min_epi16(a, b), _mm256_min_epi16(_mm256_max_epi16(a, b), g));
+        __m256i r = _mm256_sub_epi16(_mm256_and_si256(_mm256_add_epi16(_mm256_sub_epi16(x, p), half), mask), half);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(_mm256_slli_epi16(r, 1), _mm256_srai_epi16(r, 15)));
+    }
+    _residuals_sse2(cur + i, prev + i, period, n - i, depth, out + i);
+}
+
+/*
+* The pixel groups are reconstructed one after the other, the components of a group in parallel
+* in the 4 first lanes of a register. With 3 components per group, the 4th lane reads and writes
+* the first component of the next group, which is written again by the next group: the buffers
+* have FRAMECODEC_PAD extra components.
+*/
+CODEC_TARGET("sse2")
+static void _reconstruct_sse2(const uint16_t* u, const int16_t* prev, int period, int n, int mask, int16_t* cur) {
+    const __m128i m = _mm_set1_epi16((short)mask);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_loadl_epi64((const __m128i*)prev);
+    __m128i c = a;
+    for (int i = 0; i < n; i += period) {
+        __m128i b = _mm_loadl_epi64((const __m128i*)(prev + i));
+        __m128i v = _mm_loadl_epi64((const __m128i*)(u + i));
+        __m128i r = _mm_xor_si128(_mm_srli_epi16(v, 1), _mm_sub_epi16(zero, _mm_and_si128(v, one)));
+        __m128i g = _mm_sub_epi16(_mm_add_epi16(a, b), c);
+        __m128i p = _mm_max_epi16(_mm_min_epi16(a, b), _mm_min_epi16(_mm_max_epi16(a, b), g));
+        a = _mm_and_si128(_mm_add_epi16(p, r), m);
+        c = b;
+        _mm_storel_epi64((__m128i*)(cur + i), a);
+    }
+}
+
+#endif // CODEC_HAVE_X86
+
+static residualKernel   g_residuals = _residuals_scalar;
+static reconstructKernel g_reconstruct = _reconstruct_scalar;
+static std::once_flag   g_codecInitFlag;
+
+/*!
+* \fn _init_kernels
+* \brief select the kernels for the CPU, with the instruction set of the 10/8 bits conversions
+*/
+static void _init_kernels() {
+    const char* name = "scalar";
+#ifdef CODEC_HAVE_X86
+    int level = tools::getSIMDLevel();
+    if (level >= TOOLS_SIMD_AVX2) {
+        g_residuals = _residuals_avx2;
+        g_reconstruct = _reconstruct_sse2;
+        name = "avx2";
+    }
+    else if (level >= TOOLS_SIMD_SSE41) {
+        g_residuals = _residuals_sse2;
+        g_reconstruct = _reconstruct_sse2;
+        name = "sse2";
+    }
+#endif
+    LOG_INFO("frame codec kernels: %s", name);
+}
+
+static inline int _clz64(uint64_t v) {
+#ifdef _WIN32
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return 63 - (int)index;
+#else
+    return __builtin_clzll(v);
+#endif
+}
+
+static inline uint64_t _bswap64(uint64_t v) {
+#ifdef _WIN32
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+}
+
+/*
+* Unpacking and packing of the components of a line: big endian 10 bits words, 4 in 5 bytes
+*/
+
+static void _unpack_line(const unsigned char* in, int n, int depth, int16_t* out) {
+    if (depth == 8) {
+        for (int i = 0; i < n; i++)
+            out[i] = in[i];
+        return;
+    }
+    for (int i = 0; i < n; i += 4, in += 5) {
+        out[i + 0] = (int16_t)((in[0] << 2) | (in[1] >> 6));
+        out[i + 1] = (int16_t)(((in[1] & 0x3F) << 4) | (in[2] >> 4));
+        out[i + 2] = (int16_t)(((in[2] & 0x0F) << 6) | (in[3] >> 2));
+        out[i + 3] = (int16_t)(((in[3] & 0x03) << 8) | in[4]);
+    }
+}
+
+static void _pack_line(const int16_t* in, int n, int depth, unsigned char* out) {
+    if (depth == 8) {
+        for (int i = 0; i < n; i++)
+            out[i] = (unsigned char)in[i];
+        return;
+    }
+    for (int i = 0; i < n; i += 4, out += 5) {
+        out[0] = (unsigned char)(in[i] >> 2);
+        out[1] = (unsigned char)((in[i] << 6) | (in[i + 1] >> 4));
+        out[2] = (unsigned char)((in[i + 1] << 4) | (in[i + 2] >> 6));
+        out[3] = (unsigned char)((in[i + 2] << 2) | (in[i + 3] >> 8));
+        out[4] = (unsigned char)in[i + 3];
+    }
+}
+
+/*
+* Bit writer and reader, MSB first
+*/
+
+class CBitWriter
+{
+    unsigned char* _p;
+    uint64_t       _acc;
+    int            _bits;           /* bits of _acc not yet written */
+public:
+    CBitWriter(unsigned char* p) : _p(p), _acc(0), _bits(0) {};
+    inline void put(uint32_t value, int nbits) {
+        _acc = (_acc << nbits) | value;
+        _bits += nbits;
+        if (_bits >= 32) {
+            _bits -= 32;
+            uint32_t w = (uint32_t)(_acc >> _bits);
+            _p[0] = (unsigned char)(w >> 24);
+            _p[1] = (unsigned char)(w >> 16);
+            _p[2] = (unsigned char)(w >> 8);
+            _p[3] = (unsigned char)w;
+            _p += 4;
+        }
+    }
+    unsigned char* flush() {
+        while (_bits > 0) {
+            int n = std::min(_bits, 8);
+            *_p++ = (unsigned char)((_acc >> (_bits - n)) << (8 - n));
+            _bits -= n;
+        }
+        return _p;
+    }
+    unsigned char* position() { return _p; };
+};
+
+class CBitReader
+{
+    const unsigned char* _p;
+    const unsigned char* _end;
+    uint64_t             _window;   /* next bits, left aligned */
+    int                  _bits;     /* valid bits in _window */
+public:
+    CBitReader(const unsigned char* p, int size) : _p(p), _end(p + size), _window(0), _bits(0) {};
+    inline void refill() {
+        if ((unsigned int)_bits > 32)
+            return;             // enough for a code, or beyond the end
+        if (_end - _p >= 8) {
+            uint64_t v;
+            memcpy(&v, _p, 8);
+            _window |= _bswap64(v) >> _bits;
+            int n = (63 - _bits) >> 3;
+            _p += n;
+            _bits += n * 8;
+        }
+        else {
+            while (_bits <= 56 && _p < _end) {
+                _window |= (uint64_t)*_p++ << (56 - _bits);
+                _bits += 8;
+            }
+        }
+    }
+    inline uint64_t window() { return _window; };
+    inline void skip(int nbits) {
+        _window <<= nbits;
+        _bits -= nbits;
+    }
+    inline bool overrun() { return _bits < 0; };    /* bits skipped beyond the end */
+};
+
+/**********************************************************************************************
+*
+* CFrameCodec
+*
+***********************************************************************************************/
+
+CFrameCodec::CFrameCodec() {
+    _w = 0;
+    _h = 0;
+    _fmt = SAMPLINGFMT::YCbCr_4_2_2;
+    _depth = 8;
+    _period = 4;
+    _line_samples = 0;
+    _line_size = 0;
+    _nb_slices = 0;
+    _bConfigured = false;
+}
+
+/*!
+* \fn configure
+* \brief set the format of the frames and allocate the work buffers
+*
+* \param w width of the frames
+* \param h height of the frames
+* \param fmt sampling format
+* \param depth bits per component
+* \param nbSlices nb of slices the frames are cut in, limited to the nb of lines
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CFrameCodec::configure(int w, int h, SAMPLINGFMT fmt, int depth, int nbSlices) {
+
+    std::call_once(g_codecInitFlag, _init_kernels);
+    _bConfigured = false;
+
+    if (w <= 0 || h <= 0 || nbSlices < 1 || nbSlices > FRAMECODEC_MAX_SLICES) {
+        LOG_ERROR("invalid codec parameters: %dx%d, %d slices", w, h, nbSlices);
+        return VMI_E_INVALID_PARAMETER;
+    }
+    if (fmt == SAMPLINGFMT::YCbCr_4_2_2) {
+        if ((depth != 8 && depth != 10) || (w % 2) != 0) {
+            LOG_ERROR("codec not supported for YCbCr 4:2:2 %d bits, width %d", depth, w);
+            return VMI_E_NOT_SUPPORTED;
+        }
+        _period = 4;
+        _line_samples = w * 2;
+    }
+    else if ((fmt == SAMPLINGFMT::RGB || fmt == SAMPLINGFMT::BGR || fmt == SAMPLINGFMT::RGBA || fmt == SAMPLINGFMT::BGRA) && depth == 8) {
+        _period = (fmt == SAMPLINGFMT::RGB || fmt == SAMPLINGFMT::BGR ? 3 : 4);
+        _line_samples = w * _period;
+    }
+    else {
+        LOG_ERROR("codec not supported for sampling format %d, %d bits", fmt, depth);
+        return VMI_E_NOT_SUPPORTED;
+    }
+
+    _w = w;
+    _h = h;
+    _fmt = fmt;
+    _depth = depth;
+    _line_size = _line_samples * depth / 8;
+    _nb_slices = std::min(nbSlices, h);
+
+    // A coded slice bigger than its lines is stored: the coder stops one line beyond
+    int worstLine = (_line_samples * (FRAMECODEC_QMAX + 1 + depth) + (_line_samples / FRAMECODEC_BLOCK + 1) * 4) / 8 + 8;
+    _slices.resize(_nb_slices);
+    for (int i = 0; i < _nb_slices; i++) {
+        Slice& s = _slices[i];
+        int lines = _slice_first_line(i + 1) - _slice_first_line(i);
+        s.lines.assign(2 * (_period + _line_samples + FRAMECODEC_PAD), 0);
+        s.residuals.assign(_line_samples + FRAMECODEC_PAD, 0);
+        s.coded.assign((size_t)lines * _line_size + worstLine, 0);
+        s.size = 0;
+        s.stored = false;
+    }
+
+    LOG_INFO("codec of %dx%d fmt=%d %d bits: %d slices", _w, _h, _fmt, _depth, _nb_slices);
+    _bConfigured = true;
+    return VMI_E_OK;
+}
+
+/*!
+* \fn isConfigured
+* \brief check if the codec is configured for a frame format
+*/
+bool CFrameCodec::isConfigured(int w, int h, SAMPLINGFMT fmt, int depth) {
+    return _bConfigured && _w == w && _h == h && _fmt == fmt && _depth == depth;
+}
+
+/*!
+* \fn _encode_slice
+* \brief code the lines of a slice in its buffer, or mark it stored if it doesn't compress
+*/
+void CFrameCodec::_encode_slice(const unsigned char* media, int slice) {
+
+    Slice& s = _slices[slice];
+    int first = _slice_first_line(slice), last = _slice_first_line(slice + 1);
+    int n = _line_samples, period = _period, depth = _depth;
+    int limit = (last - first) * _line_size;
+    int16_t* prev = s.lines.data() + period;
+    int16_t* cur = prev + n + FRAMECODEC_PAD + period;
+    uint16_t* u = s.residuals.data();
+
+    std::fill(s.lines.begin(), s.lines.begin() + period + n, (int16_t)(1 << (depth - 1)));
+    CBitWriter bw(s.coded.data());
+    s.stored = false;
+    for (int y = first; y < last; y++) {
+        _unpack_line(media + (size_t)y * _line_size, n, depth, cur);
+        for (int i = 0; i < period; i++)
+            cur[i - period] = prev[i - period] = prev[i];
+        g_residuals(cur, prev, period, n, depth, u);
+
+        for (int b = 0; b < n; b += FRAMECODEC_BLOCK) {
+            int len = std::min(FRAMECODEC_BLOCK, n - b);
+            uint32_t sum = 0;
+            for (int i = b; i < b + len; i++)
+                sum += u[i];
+            if (sum == 0) {
+                bw.put(FRAMECODEC_ZERO_BLOCK, 4);
+                continue;
+            }
+            int k = 0;
+            while (k < depth && ((uint32_t)len << (k + 1)) <= sum)
+                k++;
+            bw.put(k, 4);
+            for (int i = b; i < b + len; i++) {
+                uint32_t q = u[i] >> k;
+                if (q < FRAMECODEC_QMAX)
+                    bw.put((1u << k) | (u[i] & ((1u << k) - 1)), (int)q + 1 + k);
+                else
+                    bw.put((1u << depth) | u[i], FRAMECODEC_QMAX + 1 + depth);
+            }
+        }
+        std::swap(prev, cur);
+
+        if (bw.position() - s.coded.data() >= limit) {
+            s.stored = true;
+            break;
+        }
+    }
+    unsigned char* end = bw.flush();
+    if (!s.stored && end - s.coded.data() >= limit)
+        s.stored = true;
+    s.size = (s.stored ? limit : (int)(end - s.coded.data()));
+}
+
+/*!
+* \fn _decode_slice
+* \brief decode a slice at its place in the media
+*
+* \return VMI_E_OK if Ok, VMI_E_INVALID_FRAME if the slice is corrupted
+*/
+int CFrameCodec::_decode_slice(const unsigned char* in, int size, bool stored, unsigned char* media, int slice) {
+
+    Slice& s = _slices[slice];
+    int first = _slice_first_line(slice), last = _slice_first_line(slice + 1);
+    if (stored) {
+        if (size != (last - first) * _line_size)
+            return VMI_E_INVALID_FRAME;
+        memcpy(media + (size_t)first * _line_size, in, size);
+        return VMI_E_OK;
+    }
+
+    int n = _line_samples, period = _period, depth = _depth;
+    int half = 1 << (depth - 1), mask = (1 << depth) - 1;
+    int16_t* prev = s.lines.data() + period;
+    int16_t* cur = prev + n + FRAMECODEC_PAD + period;
+    uint16_t* u = s.residuals.data();
+
+    std::fill(s.lines.begin(), s.lines.begin() + period + n, (int16_t)half);
+    CBitReader br(in, size);
+    for (int y = first; y < last; y++) {
+        for (int b = 0; b < n; b += FRAMECODEC_BLOCK) {
+            int len = std::min(FRAMECODEC_BLOCK, n - b);
+            br.refill();
+            int k = (int)(br.window() >> 60);
+            br.skip(4);
+            if (k == FRAMECODEC_ZERO_BLOCK) {
+                memset(u + b, 0, len * sizeof(uint16_t));
+                continue;
+            }
+            if (k > depth)
+                return VMI_E_INVALID_FRAME;
+            for (int i = b; i < b + len; i++) {
+                br.refill();
+                uint64_t w = br.window();
+                int q = _clz64(w | 1);
+                int bits;
+                if (q < FRAMECODEC_QMAX) {
+                    bits = q + 1 + k;
+                    u[i] = (uint16_t)((q << k) | (int)((w >> (64 - bits)) & ((1u << k) - 1)));
+                }
+                else if (q == FRAMECODEC_QMAX) {
+                    bits = FRAMECODEC_QMAX + 1 + depth;
+                    u[i] = (uint16_t)((w >> (64 - bits)) & mask);
+                }
+                else
+                    return VMI_E_INVALID_FRAME;
+                br.skip(bits);
+            }
+            if (br.overrun())
+                return VMI_E_INVALID_FRAME;
+        }
+
+        g_reconstruct(u, prev, period, n, mask, cur);
+        _pack_line(cur, n, depth, media + (size_t)y * _line_size);
+        std::swap(prev, cur);
+    }
+    return (br.overrun() ? VMI_E_INVALID_FRAME : VMI_E_OK);
+}
+
+/*!
+* \fn encode
+* \brief compress the media of a frame
+*
+* \param media media of the frame
+* \param media_size size of the media, getMediaSize()
+* \param out buffer receiving the compressed media
+* \param out_size size of out, getMaxCodedSize() at least
+* \param coded_size receive the size of the compressed media
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CFrameCodec::encode(const unsigned char* media, int media_size, unsigned char* out, int out_size, int* coded_size) {
+
+    if (!_bConfigured || media == NULL || out == NULL || media_size != getMediaSize() || out_size < getMaxCodedSize())
+        return VMI_E_INVALID_PARAMETER;
+
+    CWorkerPool::getInstance()->parallelFor(_nb_slices, [=](int slice) {
+        _encode_slice(media, slice);
+    });
+
+    out[0] = FRAMECODEC_VERSION;
+    out[1] = 0;     // Reserved
+    out[2] = (_nb_slices >> 8) & 0b11111111;
+    out[3] = _nb_slices & 0b11111111;
+    unsigned char* table = out + FRAMECODEC_HEADER_LENGTH;
+    unsigned char* p = table + 4 * _nb_slices;
+    for (int i = 0; i < _nb_slices; i++) {
+        Slice& s = _slices[i];
+        uint32_t entry = (uint32_t)s.size | (s.stored ? FRAMECODEC_STORED : 0);
+        table[4 * i + 0] = (entry >> 24) & 0b11111111;
+        table[4 * i + 1] = (entry >> 16) & 0b11111111;
+        table[4 * i + 2] = (entry >> 8) & 0b11111111;
+        table[4 * i + 3] = entry & 0b11111111;
+        if (s.stored)
+            memcpy(p, media + (size_t)_slice_first_line(i) * _line_size, s.size);
+        else
+            memcpy(p, s.coded.data(), s.size);
+        p += s.size;
+    }
+    *coded_size = (int)(p - out);
+    return VMI_E_OK;
+}
+
+/*!
+* \fn decode
+* \brief decompress the media of a frame compressed by encode()
+*
+* \param in compressed media
+* \param in_size size of the compressed media
+* \param media buffer receiving the media
+* \param media_size size of media, getMediaSize()
+* \return VMI_E_OK if Ok, VMI_E_INVALID_FRAME if the compressed media is corrupted
+*/
+int CFrameCodec::decode(const unsigned char* in, int in_size, unsigned char* media, int media_size) {
+
+    if (!_bConfigured || in == NULL || media == NULL || media_size != getMediaSize())
+        return VMI_E_INVALID_PARAMETER;
+    if (in_size < FRAMECODEC_HEADER_LENGTH || in[0] != FRAMECODEC_VERSION) {
+        LOG_ERROR("unsupported compressed media, version %d", (in_size > 0 ? in[0] : -1));
+        return VMI_E_INVALID_FRAME;
+    }
+    int nbSlices = (in[2] << 8) + in[3];
+    if (nbSlices != _nb_slices && configure(_w, _h, _fmt, _depth, nbSlices) != VMI_E_OK)
+        return VMI_E_INVALID_FRAME;
+    if (nbSlices != _nb_slices || in_size < FRAMECODEC_HEADER_LENGTH + 4 * nbSlices) {
+        LOG_ERROR("invalid compressed media: %d slices, %d bytes", nbSlices, in_size);
+        return VMI_E_INVALID_FRAME;
+    }
+
+    // Place of each slice
+    std::vector<int> offsets(nbSlices + 1);
+    std::vector<bool> stored(nbSlices);
+    const unsigned char* table = in + FRAMECODEC_HEADER_LENGTH;
+    offsets[0] = FRAMECODEC_HEADER_LENGTH + 4 * nbSlices;
+    for (int i = 0; i < nbSlices; i++) {
+        uint32_t entry = ((uint32_t)table[4 * i] << 24) | (table[4 * i + 1] << 16) | (table[4 * i + 2] << 8) | table[4 * i + 3];
+        stored[i] = (entry & FRAMECODEC_STORED) != 0;
+        long long end = (long long)offsets[i] + (entry & ~FRAMECODEC_STORED);
+        if (end > in_size) {
+            LOG_ERROR("invalid compressed media: slice %d ends at %lld, beyond %d bytes", i, end, in_size);
+            return VMI_E_INVALID_FRAME;
+        }
+        offsets[i + 1] = (int)end;
+    }
+
+    std::atomic<int> errors(0);
+    CWorkerPool::getInstance()->parallelFor(nbSlices, [&](int slice) {
+        if (_decode_slice(in + offsets[slice], offsets[slice + 1] - offsets[slice], stored[slice], media, slice) != VMI_E_OK)
+            errors++;
+    });
+    if (errors > 0) {
+        LOG_ERROR("%d corrupted slices in compressed media", errors.load());
+        return VMI_E_INVALID_FRAME;
+    }
+    return VMI_E_OK;
+}
@@ -0,0 +1,74 @@
+#ifndef _FRAMECODEC_H
+#define _FRAMECODEC_H
+
+#include <cstdint>
+#include <vector>
+
+#include "libvMI.h"
+
+/* Codec of the media of a vMI frame, see CFrameHeaders::GetCodec() */
+#define VMI_CODEC_NONE          0       /* uncompressed media */
+#define VMI_CODEC_DPCM          1       /* lossless slice DPCM + Rice, see CFrameCodec */
+
+#define FRAMECODEC_VERSION          1       /* version of the compressed media format */
+#define FRAMECODEC_DEFAULT_SLICES   16      /* slices coded in parallel */
+#define FRAMECODEC_MAX_SLICES       256
+#define FRAMECODEC_HEADER_LENGTH    4       /* version, reserved, nb of slices (16 bits) */
+
+/**********************************************************************************************
+*
+* CFrameCodec
+*
+* Lossless compression of the video frames of a vMI stream (VMI_CODEC_DPCM). The frame is cut
+* in slices of lines, coded independently of each other on the worker pool. Each component is
+* predicted from its left, upper and upper-left neighbours (median edge detector of LOCO-I), the
+* prediction residuals are reduced modulo 2^depth and coded by blocks of FRAMECODEC_BLOCK
+* residuals with a Rice code whose parameter is chosen per block. A slice that doesn't compress
+* is stored as is.
+*
+* Compressed media: FRAMECODEC_HEADER_LENGTH bytes, the size of each slice (4 bytes, bit 31 set
+* for a stored slice), then the slices.
+*
+* Supported sources: packed YCbCr 4:2:2 (Cb Y Cr Y) 8 or 10 bits, RGB, BGR, RGBA and BGRA 8
+* bits, with a media size of exactly height lines.
+*
+***********************************************************************************************/
+
+class CFrameCodec
+{
+    /* Work buffers of a slice */
+    struct Slice {
+        std::vector<int16_t>        lines;          /* previous and current lines, unpacked, with their left margin */
+        std::vector<uint16_t>       residuals;      /* mapped prediction residuals of the current line */
+        std::vector<unsigned char>  coded;          /* coded slice (encoder) */
+        int                         size;           /* size of the coded slice, -1 if error */
+        bool                        stored;         /* the slice is stored as is */
+    };
+
+    int         _w;
+    int         _h;
+    SAMPLINGFMT _fmt;
+    int         _depth;                 /* bits per component */
+    int         _period;                /* components per pixel group: the left neighbour is _period components before */
+    int         _line_samples;          /* components per line */
+    int         _line_size;             /* bytes per line */
+    int         _nb_slices;
+    std::vector<Slice> _slices;
+    bool        _bConfigured;
+
+    int  _slice_first_line(int slice) { return (int)((long long)slice * _h / _nb_slices); };
+    void _encode_slice(const unsigned char* media, int slice);
+    int  _decode_slice(const unsigned char* in, int size, bool stored, unsigned char* media, int slice);
+
+public:
+    CFrameCodec();
+
+    int  configure(int w, int h, SAMPLINGFMT fmt, int depth, int nbSlices);
+    bool isConfigured(int w, int h, SAMPLINGFMT fmt, int depth);
+    int  getMediaSize() { return _line_size * _h; };
+    int  getMaxCodedSize() { return FRAMECODEC_HEADER_LENGTH + 4 * _nb_slices + getMediaSize(); };
+    int  encode(const unsigned char* media, int media_size, unsigned char* out, int out_size, int* coded_size);
+    int  decode(const unsigned char* in, int in_size, unsigned char* media, int media_size);
+};
+
+#endif // _FRAMECODEC_H
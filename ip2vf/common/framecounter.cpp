@@ -19,6 +19,12 @@ void CFrameCounter::tick(const std::string &msg)
         if (_zmq_logger) {
             _zmq_logger->setFPS(fps,_pinId);
             _zmq_logger->setFrameCounter(_total_frame_count, _pinId);
+            if (_rxStats)
+                _zmq_logger->setRxStats(*_rxStats, _pinId);
+            if (_txStats)
+                _zmq_logger->setTxStats(*_txStats, _pinId);
+            if (_spsStats)
+                _zmq_logger->setSPSStats(*_spsStats, _pinId);
             _zmq_logger->tick();
         }
         _time  = currentTime;
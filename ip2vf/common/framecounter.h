@@ -15,6 +15,9 @@ public:
     int         _total_frame_count;
     int         _pinId;
     MetricsCollector*  _zmq_logger;     // A reference to the zmq_logger of the module.
+    const vMIRxStats*  _rxStats;        // Packet loss counters of the input pin, if any
+    const vMITxStats*  _txStats;        // Output pipeline counters of the output pin, if any
+    const vMISPSStats* _spsStats;       // SMPTE ST 2022-7 counters of the input pin, if any
 public:
     CFrameCounter() { 
         _time = 0.0; 
@@ -22,6 +25,9 @@ public:
         _total_frame_count = 0;
         _pinId = -1;
         _zmq_logger = NULL;
+        _rxStats = NULL;
+        _txStats = NULL;
+        _spsStats = NULL;
     };
     ~CFrameCounter() { 
         // don't delete _zmq_logger: it's managed by the caller
@@ -36,6 +42,18 @@ public:
         _pinId = pinId;
     };
 
+    inline void setRxStats(const vMIRxStats* stats) {
+        _rxStats = stats;
+    };
+
+    inline void setTxStats(const vMITxStats* stats) {
+        _txStats = stats;
+    };
+
+    inline void setSPSStats(const vMISPSStats* stats) {
+        _spsStats = stats;
+    };
+
     inline int getCount() { 
         return _total_frame_count; 
     };
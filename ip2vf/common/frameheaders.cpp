@@ -27,10 +27,10 @@
 #define MEDIA_HEADER_OFFSET     COMMON_HEADER_LENGTH 
 #define MEDIA_HEADER_LENGTH     12       // in bytes
 #define EXT_HEADER_OFFSET       MEDIA_HEADER_OFFSET+MEDIA_HEADER_LENGTH  
-#define EXT_HEADER_LENGTH       (16+FRAME_NAME_LENGTH)      // in bytes 16+FRAME_NAME_LENGTH
+#define EXT_HEADER_LENGTH       (16+FRAME_NAME_LENGTH+16)   // in bytes 16+FRAME_NAME_LENGTH+16
 
 #define EXTRACT_INTEGER(p, i)   ((p[i+0] << 24) + (p[i+1] << 16) + (p[i+2] << 8) + p[i+3])
-#define EXTRACT_LONG_LONG(p, i) (((unsigned long long)p[i+0] << 56) + ((unsigned long long)p[i+1] << 48) + ((unsigned long long)p[i+2] << 40) + ((unsigned long long)p[i+3] << 32) + (p[i+4] << 24) + (p[i+5] << 16) + (p[i+6] << 8) + p[i+7])
+#define EXTRACT_LONG_LONG(p, i) (((unsigned long long)p[i+0] << 56) + ((unsigned long long)p[i+1] << 48) + ((unsigned long long)p[i+2] << 40) + ((unsigned long long)p[i+3] << 32) + ((unsigned int)p[i+4] << 24) + (p[i+5] << 16) + (p[i+6] << 8) + p[i+7])
 
 
 CFrameHeaders::CFrameHeaders() {
@@ -45,6 +45,7 @@ CFrameHeaders::CFrameHeaders() {
     _mediasize      = 0;
     _mediatimestamp = 0;
     _srctimestamp   = 0;
+    _codec          = 0;
     // media video
     _w              = 0;
     _h              = 0;
@@ -65,6 +66,9 @@ CFrameHeaders::CFrameHeaders() {
     _inputtimestamp = 0;
     _outputtimestamp= 0;
     _namedata[0]    = '\0';
+    _lostpackets    = 0;
+    _lostmap        = 0;
+    _rawmediasize   = 0;
 };
 
 /*!
@@ -84,6 +88,7 @@ void CFrameHeaders::CopyHeaders(const CFrameHeaders* from) {
     _mediasize      = from->_mediasize;
     _mediatimestamp = from->_mediatimestamp;
     _srctimestamp   = from->_srctimestamp;
+    _codec          = from->_codec;
     // Media Audio/video spcific part
     _w              = from->_w;
     _h              = from->_h;
@@ -104,6 +109,9 @@ void CFrameHeaders::CopyHeaders(const CFrameHeaders* from) {
     _outputtimestamp= from->_outputtimestamp;
     STRNCPY(_namedata, from->_namedata, FRAME_NAME_LENGTH);
     _namedata[FRAME_NAME_LENGTH - 1] = '\0';
+    _lostpackets    = from->_lostpackets;
+    _lostmap        = from->_lostmap;
+    _rawmediasize   = from->_rawmediasize;
 }
 
 int CFrameHeaders::WriteHeaders(unsigned char* buffer, int frame_nb) {
@@ -137,7 +145,7 @@ int CFrameHeaders::WriteHeaders(unsigned char* buffer, int frame_nb) {
 
         buffer[12] = _moduleid;
         buffer[13] = (int)_mediafmt;
-        buffer[14] = 0;  // Reserved
+        buffer[14] = _codec & 0b11111111;   // Reserved before: 0 means uncompressed for the older senders
         buffer[15] = 0;  // Reserved
 
         buffer[16] = (_mediasize >> 24) & 0b11111111;
@@ -209,6 +217,27 @@ int CFrameHeaders::WriteHeaders(unsigned char* buffer, int frame_nb) {
         buffer[EXT_HEADER_OFFSET + 15] = _outputtimestamp & 0b11111111;
 
         STRNCPY((char*)&buffer[EXT_HEADER_OFFSET + 16], _namedata, FRAME_NAME_LENGTH);
+
+        // These bytes were reserved before: 0 means "no lost packet" for the older senders
+        buffer[EXT_HEADER_OFFSET + 64] = (_lostpackets >> 24) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 65] = (_lostpackets >> 16) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 66] = (_lostpackets >> 8) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 67] = _lostpackets & 0b11111111;
+
+        buffer[EXT_HEADER_OFFSET + 68] = (_lostmap >> 56) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 69] = (_lostmap >> 48) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 70] = (_lostmap >> 40) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 71] = (_lostmap >> 32) & 0b11111111;
+
+        buffer[EXT_HEADER_OFFSET + 72] = (_lostmap >> 24) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 73] = (_lostmap >> 16) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 74] = (_lostmap >> 8) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 75] = _lostmap & 0b11111111;
+
+        buffer[EXT_HEADER_OFFSET + 76] = (_rawmediasize >> 24) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 77] = (_rawmediasize >> 16) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 78] = (_rawmediasize >> 8) & 0b11111111;
+        buffer[EXT_HEADER_OFFSET + 79] = _rawmediasize & 0b11111111;
     }
     catch (...) {
         LOG_ERROR("Major error when writing vMI headers... seems data is corrupted. skip this frame!");
@@ -248,6 +277,7 @@ int CFrameHeaders::ReadHeaders(unsigned char* buffer) {
         _framenb = EXTRACT_INTEGER(p, 8);
         _moduleid = p[12];
         _mediafmt = static_cast<MEDIAFORMAT>(p[13]);
+        _codec = p[14];
         _mediasize = EXTRACT_INTEGER(p, 16);
 
         _mediatimestamp = EXTRACT_INTEGER(p, 20);
@@ -279,6 +309,9 @@ int CFrameHeaders::ReadHeaders(unsigned char* buffer) {
         _outputtimestamp = EXTRACT_LONG_LONG(p, 8);
         STRNCPY(_namedata, (const char*)&p[16], FRAME_NAME_LENGTH);
         _namedata[FRAME_NAME_LENGTH - 1] = '\0';
+        _lostpackets = EXTRACT_INTEGER(p, 64);
+        _lostmap = EXTRACT_LONG_LONG(p, 68);
+        _rawmediasize = EXTRACT_INTEGER(p, 76);
     }
     catch (...) {
         LOG_ERROR("Major error when reading vMI headers... seems data is corrupted. skip this frame!");
@@ -303,6 +336,7 @@ void CFrameHeaders::DumpHeaders(unsigned char* frame)
     LOG_INFO("_mediasize = %d", _mediasize);
     LOG_INFO("_mediatimestamp = %lu", _mediatimestamp);
     LOG_INFO("_srctimestamp = %llu", _srctimestamp);
+    LOG_INFO("_codec = %d", _codec);
     if (_mediafmt == MEDIAFORMAT::VIDEO) {
         LOG_INFO("(_w, _h) = (%d, %d)", _w, _h);
         LOG_INFO("_frametype = %d", _frametype);
@@ -324,6 +358,9 @@ void CFrameHeaders::DumpHeaders(unsigned char* frame)
     LOG_INFO("_inputtimestamp = %llu", _inputtimestamp);
     LOG_INFO("_outputtimestamp = %llu", _outputtimestamp);
     LOG_INFO("_namedata = '%s'", (_namedata?_namedata:"<null>"));
+    LOG_INFO("_lostpackets = %d", _lostpackets);
+    LOG_INFO("_lostmap = 0x%llx", _lostmap);
+    LOG_INFO("_rawmediasize = %d", _rawmediasize);
 }
 
 void CFrameHeaders::InitVideoHeadersFromSMPTE(int w, int h, SAMPLINGFMT samplingfmt, bool interlaced)
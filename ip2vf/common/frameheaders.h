@@ -40,6 +40,7 @@ private:
     int         _mediasize;
     unsigned int       _mediatimestamp;
     unsigned long long _srctimestamp;
+    int         _codec;             // VMI_CODEC_xxx: codec of the media, see CFrameCodec
 
     // VIDEO
     int         _w;
@@ -63,6 +64,9 @@ private:
     unsigned long long _inputtimestamp;
     unsigned long long _outputtimestamp;
     char       _namedata[FRAME_NAME_LENGTH];
+    int        _lostpackets;        // nb of RTP packets lost by the receiver(s) of this frame
+    unsigned long long _lostmap;    // bit i is set if the i-th 1/64 of the media contains lost data
+    int        _rawmediasize;       // size of the media once decoded, if compressed
 
 public:
     CFrameHeaders() ;
@@ -114,6 +118,8 @@ public:
     void SetMediaTimestamp(unsigned int mediatimestamp) { _mediatimestamp = mediatimestamp; };
     unsigned long long  GetSrcTimestamp() { return _srctimestamp; };
     void SetSrcTimestamp(unsigned long long srctimestamp) { _srctimestamp = srctimestamp; };
+    int  GetCodec() { return _codec; };
+    void SetCodec(int codec) { _codec = codec; };
 
     // media video GET/SET
     int  GetW() { return _w; };
@@ -154,6 +160,12 @@ public:
     void SetOutputTimestamp(unsigned long long timestamp) { _outputtimestamp = timestamp; };
     const char* GetName() { return (const char*)_namedata; };
     void SetName(const char* name);
+    int  GetLostPackets() { return _lostpackets; };
+    void SetLostPackets(int lostpackets) { _lostpackets = lostpackets; };
+    unsigned long long GetLostMap() { return _lostmap; };
+    void SetLostMap(unsigned long long lostmap) { _lostmap = lostmap; };
+    int  GetRawMediaSize() { return _rawmediasize; };
+    void SetRawMediaSize(int rawmediasize) { _rawmediasize = rawmediasize; };
 };
 
 #endif //_FRAMEHEADER_H
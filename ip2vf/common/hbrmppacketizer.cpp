@@ -3,8 +3,6 @@
 #include <cstring>
 #include <iostream>
 #include <cmath>
-#include <chrono>
-#include <thread>       // std::this_thread
 
 #include "common.h"
 #include "error.h"
@@ -28,6 +26,8 @@ CHBRMPPacketizer::CHBRMPPacketizer(int mtu) : CRTPPacketizer(mtu){
     _seq = 0;
     _hbrmpTimestamp = 0;
     _frameCount = 0;
+    _batch.init(RTP_HEADERS_LENGTH + HBRMP_HEADERS_LENGTH);
+    _batch.setPacing(500);
 }
 
 void CHBRMPPacketizer::setProfile(CSMPTPProfile*  profile) {
@@ -45,33 +45,38 @@ int CHBRMPPacketizer::send(UDP* sock, char* buffer, int buffersize) {
 
     //LOG_INFO("rtp packet size=%d, hbrmp packet size=%d, payload size=%d", _RTPPacketSize, _HBRMPPacketSize, _HBRMPPayloadSize);
 
-    if (sock && sock->isValid())
+    if ((sock && sock->isValid()) || _batch.isCapturing())
     {
-        CRTPFrame rtpFrame((unsigned char*)_RTPframe, _RTPPacketSize);
-        CHBRMPFrame hbrmpFrame((unsigned char*)_RTPframe + RTP_HEADERS_LENGTH, _RTPPacketSize - RTP_HEADERS_LENGTH);
+        CRTPFrame rtpFrame;
+        CHBRMPFrame hbrmpFrame;
         hbrmpFrame.initFixedHBRMPValuesFromProfile(&_profile);
 
-        int bEndOfFrame = false;
         unsigned int remainingLen = buffersize;
-        unsigned int sentLen = 0;
-        unsigned int packetSentNb = 0;
         unsigned int timestamp_ref = _hbrmpTimestamp;
         unsigned int payloadSent = 0;
-        unsigned int oldPayloadSent = 0;
-        unsigned int oldPixelSent = 0;
-        unsigned int nbPacketToSkip = 0;
         char* p = buffer;
-        char* packetPayloadPtr = _RTPframe + RTP_HEADERS_LENGTH + HBRMP_HEADERS_LENGTH;
 
+        // Schedule of the packets (pacing engine, launch time): the stream is constant bit rate,
+        // each packet is sent at the time of its HBRMP timestamp in the frame period
+        double framePeriod = (_profile.getFramerate() > 0 ? 1000000000.0 / _profile.getFramerate() : 0);
+        double wordsPerFrame = (double)buffersize * 8.0 / 10.0;
+        long long frameStart = _batch.beginFrame((buffersize + _HBRMPPayloadSize - 1) / _HBRMPPayloadSize, framePeriod, 1.0);
         while (remainingLen>0) {
 
-            int result, len, marker = 0;
+            int marker = 0;
             int oldTimestamp = _hbrmpTimestamp;
-            oldPayloadSent = payloadSent;
 
-            // First, copy payload on the packet
+            // Send the batch when all its packets are used
+            if (_batch.isFull() && _batch.flush(sock) != VMI_E_OK) {
+                LOG_ERROR("error writing to socket, RTP packet #%d, frame #%d, remaining=%d", _seq, _frameCount, remainingLen);
+                _batch.sync();
+                return VMI_E_FAILED_TO_SND_SOCKET;
+            }
+
+            // First, reference the payload of the packet, no copy
             int payloadLen = MIN(remainingLen, (unsigned)_HBRMPPayloadSize);
-            memcpy(packetPayloadPtr, p, payloadLen);
+            unsigned char* headers = (unsigned char*)_batch.addPacket(RTP_HEADERS_LENGTH + HBRMP_HEADERS_LENGTH);
+            _batch.addPayload(p, payloadLen);
             remainingLen -= payloadLen;
             p += payloadLen;
             if (remainingLen == 0)
@@ -81,32 +86,17 @@ int CHBRMPPacketizer::send(UDP* sock, char* buffer, int buffersize) {
             if (payloadLen < _HBRMPPayloadSize)
             {
                 LOG("padding payload=%d", _HBRMPPayloadSize - payloadLen);
-                memset( packetPayloadPtr + payloadLen, 0, _HBRMPPayloadSize - payloadLen);
+                _batch.addPadding(_HBRMPPayloadSize - payloadLen);
             }
 
             // Write correct headers for this packet
             _seq = (_seq + 1) % 65536;
+            rtpFrame.setBuffer(headers, RTP_HEADERS_LENGTH);
             rtpFrame.writeHeader(_seq, marker, _payloadtype);
+            hbrmpFrame.setBuffer(headers + RTP_HEADERS_LENGTH, HBRMP_HEADERS_LENGTH);
             hbrmpFrame.writeHeader(_frameCount, _hbrmpTimestamp);
-
-            // Then send UDP packet
-            len = _RTPPacketSize;
-            result = sock->writeSocket((char*)_RTPframe, &len);
-            if (result != -1)
-            {
-                LOG("write (size=%d) to socket, result=%d, RTP packet #%d, frame #%d, payloadlen=%d, remaining=%d",
-                    len, result, rtpFrame._seq, _frameCount, payloadLen,
-                    remainingLen);
-                sentLen += result;
-            }
-            else
-            {
-                LOG_ERROR("error writing (size=%d) to socket, result=%d, RTP packet #%d, frame #%d, payloadlen=%d, remaining=%d",
-                    len, result, rtpFrame._seq, _frameCount, payloadLen,
-                    remainingLen);
-                //ret = -1;
-            }
-            packetSentNb++;
+            if (framePeriod > 0)
+                _batch.setPacketTime(frameStart + (long long)((_hbrmpTimestamp - timestamp_ref) * framePeriod / wordsPerFrame));
 
             // Calculate next timestamp
             payloadSent += payloadLen;
@@ -119,13 +109,14 @@ int CHBRMPPacketizer::send(UDP* sock, char* buffer, int buffersize) {
             if (_hbrmpTimestamp < (unsigned)oldTimestamp)
                 LOG_INFO("_hbrmpTimestamp loop=%lu/%lu", _hbrmpTimestamp,
                     oldTimestamp);
-            oldPixelSent = pixelSent;
+        }
 
-            if (packetSentNb % 500 == 0) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            }
+        // Then send the remaining UDP packets
+        if (_batch.flush(sock) != VMI_E_OK || _batch.sync() != VMI_E_OK) {
+            LOG_ERROR("error writing to socket, RTP packet #%d, frame #%d", _seq, _frameCount);
+            return VMI_E_FAILED_TO_SND_SOCKET;
         }
         _frameCount = (_frameCount + 1) % 256;
     }
     return VMI_E_OK;
-}
\ No newline at end of file
+}
@@ -124,11 +124,27 @@ int revertToDefaultConsoleMode() {
 
 #endif  // _WIN32
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "log.h"
+#include "ringqueue.h"
 
 #ifndef MIN
 #define MIN(a, b)       (a<b?a:b)
 #endif
+#ifndef MAX
+#define MAX(a, b)       (a>b?a:b)
+#endif
+
+#define LOG_RECORD_SIZE         512     /* max size of a record in the rings, longer ones are written at once */
+#define LOG_LINE_SIZE           4096    /* max size of a record */
+#define LOG_RING_RECORDS        128     /* records per thread, a power of two */
+#define LOG_FLUSH_PERIOD_US     20000   /* max time a record waits in its ring */
 
 
 LogLevel g_logLevel = LOG_LEVEL_VERBOSE;
@@ -143,52 +159,369 @@ LogLevel getLogLevel() {
     return g_logLevel;
 }
 
+/**********************************************************************************************
+*
+* CLogSink
+*
+* Asynchronous writer of the logs: each thread formats its records in a ring of its own, with
+* no lock and no system call, and a writer thread drains the rings to stderr every
+* LOG_FLUSH_PERIOD_US, or when a ring is half full. The records of a pass are written in the
+* order they were logged. When the ring of a thread is full, its records are dropped and
+* counted. The errors and warnings are not delayed: the logging thread writes the records of
+* its own ring itself, the error or warning last, in one write before the call returns. The
+* rings of the other threads are left to the writer thread.
+*
+* VMI_LOG_ASYNC=0 in the environment writes the records at once, from the logging thread.
+*
+***********************************************************************************************/
+
+struct LogRecord {
+    unsigned long long  seq;                /* order of the record, all threads included */
+    int                 len;
+    char                text[LOG_RECORD_SIZE];
+};
+
+struct LogRing {
+    alignas(RINGQUEUE_CACHELINE) std::atomic<unsigned int> head;    /* next record to write, by the thread */
+    alignas(RINGQUEUE_CACHELINE) std::atomic<unsigned int> tail;    /* next record to read, by the writer */
+    std::atomic<unsigned long long> dropped;    /* records dropped, ring full */
+    unsigned long long  reported;           /* dropped records already reported by the writer */
+    std::atomic<bool>   closed;             /* thread exited */
+    std::mutex          consumer;           /* held while the records are written: writer thread, or the thread itself */
+    std::vector<char>   out;                /* records written by the thread itself */
+    LogRecord           records[LOG_RING_RECORDS];
+
+    LogRing() : head(0), tail(0), dropped(0), reported(0), closed(false) {};
+};
+
+/* State of the logging thread */
+struct LogThread {
+    unsigned int        pid;
+    unsigned int        tid;
+    std::shared_ptr<LogRing> ring;          /* NULL if the records are written at once */
+
+    LogThread();
+    ~LogThread();
+};
+
+class CLogSink
+{
+    std::atomic<bool>   _async;
+    std::atomic<unsigned long long> _seq;
+    std::mutex          _mutex;             /* protects _rings */
+    std::vector<std::shared_ptr<LogRing>> _rings;
+    std::mutex          _drainMutex;        /* one drain at a time: writer thread, closeLog() or exit */
+    std::vector<LogRecord*> _pending;
+    std::vector<char>   _out;
+    CRingEvent          _event;
+    std::atomic<bool>   _urgent;
+    std::atomic<bool>   _stop;
+    std::thread         _th_writer;
+    std::once_flag      _started;
+
+    void _writer_thread();
+
+public:
+    CLogSink();
+
+    std::shared_ptr<LogRing> attach();
+    void wake();
+    void drain();
+    void flush(LogRing& ring);
+    void stop();
+    unsigned long long next() { return _seq.fetch_add(1, std::memory_order_relaxed); };
+    bool isAsync() { return _async.load(std::memory_order_relaxed); };
+};
+
+/* Never destroyed: threads may log until the end of the process */
+static CLogSink& log_sink()
+{
+    static CLogSink* sink = new CLogSink();
+    return *sink;
+}
+
+static void log_at_exit()
+{
+    log_sink().stop();
+}
+
+CLogSink::CLogSink()
+    : _seq(0), _urgent(false), _stop(false)
+{
+    const char* env = getenv("VMI_LOG_ASYNC");
+    _async = !(env != NULL && strcmp(env, "0") == 0);
+}
+
+/*!
+* \fn attach
+* \brief create the ring of the calling thread, and start the writer thread with the first one
+*
+* \return the ring, NULL if the records are written at once
+*/
+std::shared_ptr<LogRing> CLogSink::attach()
+{
+    if (!isAsync())
+        return nullptr;
+    std::call_once(_started, [this] {
+        _th_writer = std::thread([this] { _writer_thread(); });
+        atexit(log_at_exit);
+    });
+    std::shared_ptr<LogRing> ring = std::make_shared<LogRing>();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _rings.push_back(ring);
+    return ring;
+}
+
+void CLogSink::wake()
+{
+    _urgent.store(true, std::memory_order_relaxed);
+    _event.notify();
+}
+
+void CLogSink::_writer_thread()
+{
+    while (!_stop.load(std::memory_order_acquire)) {
+        _event.wait([this] { return _urgent.load(std::memory_order_relaxed) || _stop.load(std::memory_order_relaxed); }, LOG_FLUSH_PERIOD_US);
+        _urgent.store(false, std::memory_order_relaxed);
+        drain();
+    }
+}
+
+/*!
+* \fn drain
+* \brief write the records of all the rings, in the order they were logged
+*/
+void CLogSink::drain()
+{
+    std::lock_guard<std::mutex> drainLock(_drainMutex);
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        rings = _rings;
+    }
+
+    _pending.clear();
+    _out.clear();
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(rings.size());
+    std::vector<unsigned int> heads(rings.size());
+    std::vector<bool> closed(rings.size());
+    for (size_t i = 0; i < rings.size(); i++) {
+        LogRing& ring = *rings[i];
+        locks.emplace_back(ring.consumer);
+        closed[i] = ring.closed.load(std::memory_order_acquire);
+        heads[i] = ring.head.load(std::memory_order_acquire);
+        for (unsigned int n = ring.tail.load(std::memory_order_relaxed); n != heads[i]; n++)
+            _pending.push_back(&ring.records[n & (LOG_RING_RECORDS - 1)]);
+        unsigned long long dropped = ring.dropped.load(std::memory_order_relaxed);
+        if (dropped != ring.reported) {
+            char line[128];
+            int len = snprintf(line, sizeof(line), "%5x:%5x: +w+ CLogSink::drain(): %llu log records dropped, ring of the thread full\n",
+                GETPID, 0, dropped - ring.reported);
+            _out.insert(_out.end(), line, line + MIN(len, (int)sizeof(line) - 1));
+            ring.reported = dropped;
+        }
+    }
+    std::sort(_pending.begin(), _pending.end(), [](const LogRecord* a, const LogRecord* b) { return a->seq < b->seq; });
+    for (const LogRecord* record : _pending)
+        _out.insert(_out.end(), record->text, record->text + record->len);
+    if (!_out.empty()) {
+        fwrite(_out.data(), 1, _out.size(), stderr);
+        fflush(stderr);
+    }
+
+    // Free the records, and forget the rings of the threads that exited
+    for (size_t i = 0; i < rings.size(); i++)
+        rings[i]->tail.store(heads[i], std::memory_order_release);
+    locks.clear();
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i < rings.size(); i++) {
+        if (closed[i])
+            _rings.erase(std::remove(_rings.begin(), _rings.end(), rings[i]), _rings.end());
+    }
+}
+
+/*!
+* \fn flush
+* \brief write the records of a ring in one write, from the thread that owns it, without waiting
+*        for the records of the other threads
+*
+* \param ring ring of the calling thread
+*/
+void CLogSink::flush(LogRing& ring)
+{
+    std::lock_guard<std::mutex> lock(ring.consumer);
+    unsigned int head = ring.head.load(std::memory_order_relaxed);
+    ring.out.clear();
+    for (unsigned int n = ring.tail.load(std::memory_order_relaxed); n != head; n++) {
+        const LogRecord& record = ring.records[n & (LOG_RING_RECORDS - 1)];
+        ring.out.insert(ring.out.end(), record.text, record.text + record.len);
+    }
+    if (!ring.out.empty()) {
+        fwrite(ring.out.data(), 1, ring.out.size(), stderr);
+        fflush(stderr);
+    }
+    ring.tail.store(head, std::memory_order_release);
+}
+
+/*!
+* \fn stop
+* \brief write the remaining records and stop the writer thread. The next records are written
+*        at once
+*/
+void CLogSink::stop()
+{
+    _async = false;
+    _stop.store(true, std::memory_order_release);
+    _event.notify();
+    if (_th_writer.joinable() && _th_writer.get_id() != std::this_thread::get_id())
+        _th_writer.join();
+    drain();
+}
+
+LogThread::LogThread()
+{
+    pid = (unsigned int)GETPID;
+    tid = (unsigned int)GETTID;
+    ring = log_sink().attach();
+}
+
+LogThread::~LogThread()
+{
+    if (ring)
+        ring->closed.store(true, std::memory_order_release);
+}
+
+static LogThread& log_thread()
+{
+    static thread_local LogThread t;
+    return t;
+}
+
 void closeLog() {
+    log_sink().stop();
 #ifdef _WIN32
 	revertToDefaultConsoleMode();
 #endif	//_WIN32
 }
 
+/*!
+* \fn log_vrecord
+* \brief format a record: pid, tid, tag, method and message, and hand it to the sink
+*
+* \param tag type of the record
+* \param color color of the record, 0 if none
+* \param urgent write the record before returning (errors, warnings)
+* \param method method logging the record, NULL if the message is the whole record
+* \param message printf format of the message
+* \param args arguments of the format
+*/
+static void log_vrecord(const char* tag, int color, bool urgent, const LogMethod* method, const char* message, va_list args)
+{
+    LogThread& t = log_thread();
+    LogRing* ring = (t.ring && log_sink().isAsync() ? t.ring.get() : NULL);
+    LogRecord* record = NULL;
+    unsigned int head = 0;
+    if (ring) {
+        head = ring->head.load(std::memory_order_relaxed);
+        if (urgent && head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_RECORDS)
+            log_sink().flush(*ring);
+        if (head - ring->tail.load(std::memory_order_acquire) < LOG_RING_RECORDS)
+            record = &ring->records[head & (LOG_RING_RECORDS - 1)];
+        else if (!urgent) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    // Room kept for the color reset and the end of line
+    const int reserved = (int)sizeof(DISPFORMAT_RESET) + 1;
+    char line[LOG_LINE_SIZE];
+    va_list copy;
+    va_copy(copy, args);
+    char* dest = (record ? record->text : line);
+    int size = (record ? LOG_RECORD_SIZE : LOG_LINE_SIZE) - reserved;
+    int len = 0;
+    for (;;) {
+        len = 0;
+        if (method != NULL) {
+#ifdef _SUPPORT_COLOR
+            if (color != 0)
+                len = snprintf(dest, size, DISPFORMAT_START "%5x:%5x: %s %.*s(): ", color, t.pid, t.tid, tag, method->len, method->name);
+            else
+#endif  //_SUPPORT_COLOR
+                len = snprintf(dest, size, "%5x:%5x: %s %.*s(): ", t.pid, t.tid, tag, method->len, method->name);
+            len = MIN(MAX(len, 0), size - 1);
+        }
+        int msg = vsnprintf(dest + len, size - len, message, copy);
+        va_end(copy);
+        if (msg < 0)
+            msg = 0;
+        if (record == NULL || len + msg < size) {
+            len = MIN(len + msg, size - 1);
+            break;
+        }
+        // Too long for the ring: formatted again and written at once
+        record = NULL;
+        dest = line;
+        size = LOG_LINE_SIZE - reserved;
+        va_copy(copy, args);
+    }
+#ifdef _SUPPORT_COLOR
+    if (method != NULL && color != 0) {
+        memcpy(dest + len, DISPFORMAT_RESET, sizeof(DISPFORMAT_RESET) - 1);
+        len += (int)sizeof(DISPFORMAT_RESET) - 1;
+    }
+#endif  //_SUPPORT_COLOR
+    if (len == 0)
+        return;
+    if (dest[len - 1] != '\n')
+        dest[len++] = '\n';
+
+    if (record == NULL) {
+        // Written at once: the records of the thread still in its ring are written before
+        if (ring != NULL)
+            log_sink().flush(*ring);
+        fwrite(dest, 1, len, stderr);
+        return;
+    }
+    record->len = len;
+    record->seq = log_sink().next();
+    ring->head.store(head + 1, std::memory_order_release);
+    if (urgent)
+        log_sink().flush(*ring);
+    else if (head + 1 - ring->tail.load(std::memory_order_relaxed) == LOG_RING_RECORDS / 2)
+        log_sink().wake();
+}
+
 void platform_log(const char* message, ...)
 {
-    char dest[4096];
     va_list argptr;
     va_start(argptr, message);
-    VSNPRINTF(dest, message, argptr);
+    log_vrecord(NULL, 0, false, NULL, message, argptr);
     va_end(argptr);
-    int size = (int)strlen(dest);
-    if( size > 0)
-    {
-        if ( (dest[size - 1] != '\n') && (size < sizeof(dest)/sizeof(char)) )
-            STRCAT(dest, "\n");
-        fprintf(stderr, "%s", dest);
-    }
 }
 
 
 
 
-void internal_LOG(std::string method, const char* message, ...)
+void internal_LOG(LogMethod method, const char* message, ...)
 {
     if( g_logLevel<LOG_LEVEL_VERBOSE )
         return;
-    char dest[4096];
     va_list argptr;
     va_start(argptr, message);
-    VSNPRINTF(dest, message, argptr);
+    log_vrecord("-v-", 0, false, &method, message, argptr);
     va_end(argptr);
-    platform_log("%5x:%5x: -v- %s: %s", GETPID, (unsigned long)GETTID, method.c_str(), dest);
 }
-void internal_LOG_INFO(std::string method, const char* message, ...)
+void internal_LOG_INFO(LogMethod method, const char* message, ...)
 {
     if( g_logLevel<LOG_LEVEL_INFO )
         return;
-    char dest[4096];
     va_list argptr;
     va_start(argptr, message);
-    VSNPRINTF(dest, message, argptr);
+    log_vrecord("-i-", 0, false, &method, message, argptr);
     va_end(argptr);
-    platform_log("%5x:%5x: -i- %s: %s", GETPID, (unsigned int)GETTID, method.c_str(), dest);
 
 /*#ifdef _EXTERNAL_LOG_SUPPORT
     char dest2[1500];
@@ -198,51 +531,36 @@ void internal_LOG_INFO(std::string method, const char* message, ...)
 #endif // _EXTERNAL_LOG_SUPPORT*/
     //WIN32_HOTFIX_FLUSH_OUTPUT();
 }
-void internal_LOG_COLOR(std::string method, LogColor color, const char* message, ...)
+void internal_LOG_COLOR(LogMethod method, LogColor color, const char* message, ...)
 {
     if (g_logLevel<LOG_LEVEL_INFO)
         return;
-    char dest[4096];
     va_list argptr;
     va_start(argptr, message);
-    VSNPRINTF(dest, message, argptr);
+    log_vrecord("-i-", color, false, &method, message, argptr);
     va_end(argptr);
-#ifdef _SUPPORT_COLOR
-    platform_log(DISPFORMAT_START "%5x:%5x: -i- %s: %s" DISPFORMAT_RESET, color, GETPID, (unsigned int)GETTID, method.c_str(), dest);
-#else   //_SUPPORT_COLOR
-    platform_log("%5x:%5x: *E* %s: %s", GETPID, (unsigned int)GETTID, method.c_str(), dest);
-#endif  //_SUPPORT_COLOR
     WIN32_HOTFIX_FLUSH_OUTPUT();
 }
-void internal_LOG_WARNING(std::string method, const char* message, ...)
+void internal_LOG_WARNING(LogMethod method, const char* message, ...)
 {
     if( g_logLevel<LOG_LEVEL_WARNING )
         return;
-    char dest[4096];
     va_list argptr;
     va_start(argptr, message);
-    VSNPRINTF(dest, message, argptr);
+    log_vrecord("+w+", 0, true, &method, message, argptr);
     va_end(argptr);
-    platform_log("%5x:%5x: +w+ %s: %s", GETPID, (unsigned int)GETTID, method.c_str(), dest);
     WIN32_HOTFIX_FLUSH_OUTPUT();
 }
 
-void internal_LOG_ERROR(std::string method, const char* message, ...)
+void internal_LOG_ERROR(LogMethod method, const char* message, ...)
 {
     if (g_logLevel < LOG_LEVEL_ERROR)
         return;
-    char dest[4096];
     va_list argptr;
     va_start(argptr, message);
-    VSNPRINTF(dest, message, argptr);
+    log_vrecord("*E*", LOG_COLOR_RED, true, &method, message, argptr);
     va_end(argptr);
 
-#ifdef _SUPPORT_COLOR
-    platform_log(DISPFORMAT_START "%5x:%5x: *E* %s: %s" DISPFORMAT_RESET, LOG_COLOR_RED, GETPID, (unsigned int)GETTID, method.c_str(), dest);
-#else   //_SUPPORT_COLOR
-    platform_log("%5x:%5x: *E* %s: %s", GETPID, (unsigned int)GETTID, method.c_str(), dest);
-#endif  //_SUPPORT_COLOR
-
 /*#ifdef _EXTERNAL_LOG_SUPPORT
     char dest2[1500];
     const char* module_name = (libvMI_get_module_name(0) == NULL ? g_module_not_defined : libvMI_get_module_name(0));
@@ -253,7 +571,7 @@ void internal_LOG_ERROR(std::string method, const char* message, ...)
 	WIN32_HOTFIX_FLUSH_OUTPUT();
 }
 #define NB_ELEMENTS_BY_LINE	16
-void internal_LOG_DUMP(std::string method, const char* buffer, int size)
+void internal_LOG_DUMP(LogMethod method, const char* buffer, int size)
 {
     if( g_logLevel<LOG_LEVEL_ERROR)
         return;
@@ -293,7 +611,7 @@ void internal_LOG_DUMP(std::string method, const char* buffer, int size)
         }
     }
 }
-void internal_LOG_DUMP10BITS(std::string method, const char* buffer, int size)
+void internal_LOG_DUMP10BITS(LogMethod method, const char* buffer, int size)
 {
     if (g_logLevel<LOG_LEVEL_INFO)
         return;
@@ -39,43 +39,89 @@ enum LogLevel {
 #define __PRETTY_FUNCTION__ __FUNCSIG__
 #endif
 
-inline std::string methodName(const std::string& prettyFunction)
+/*!
+* \struct LogMethod
+* \brief name of the method of a log record: "Class::method" in the __PRETTY_FUNCTION__ string
+*/
+struct LogMethod {
+    const char* name;
+    int         len;
+};
+
+// VS2015 (v140 toolset) supports only the C++11 constexpr functions, without loops: the method
+// name is then found at run time, when the record is logged
+#if !defined(_MSC_VER) || _MSC_VER >= 1910
+#define LOG_CONSTEXPR   constexpr
+#else
+#define LOG_CONSTEXPR
+#endif
+
+/*!
+* \fn methodName
+* \brief find the method name in a __PRETTY_FUNCTION__ string. Evaluated at compile time by the
+*        LOG macros (except with VS2015): no string is built when a record is logged
+*
+* \param prettyFunction __PRETTY_FUNCTION__ of the method
+* \return position and length of the name
+*/
+inline LOG_CONSTEXPR LogMethod methodName(const char* prettyFunction)
 {
-    size_t begin, end;
-    size_t colons = prettyFunction.find("::");
-    if (colons == std::string::npos) {
-        begin = prettyFunction.find(" ") + 1;
-        end = prettyFunction.rfind("(") - begin;
+    int size = 0;
+    while (prettyFunction[size] != '\0')
+        size++;
+    int colons = size;
+    for (int i = 0; i + 1 < size; i++) {
+        if (prettyFunction[i] == ':' && prettyFunction[i + 1] == ':') {
+            colons = i;
+            break;
+        }
     }
-    else {
-        begin = prettyFunction.substr(0, colons).rfind(" ") + 1;
-        end = prettyFunction.rfind("(") - begin;
+    // Skip the return type: the name starts after the first space, or after the last one
+    // before the scope if any
+    int begin = 0;
+    for (int i = 0; i < colons; i++) {
+        if (prettyFunction[i] == ' ') {
+            begin = i + 1;
+            if (colons == size)
+                break;
+        }
     }
-
-    return prettyFunction.substr(begin, end) + "()";
+    int end = size;
+    for (int i = size - 1; i >= begin; i--) {
+        if (prettyFunction[i] == '(') {
+            end = i;
+            break;
+        }
+    }
+    return LogMethod{ prettyFunction + begin, end - begin };
 }
 #define __METHOD_NAME__ methodName(__PRETTY_FUNCTION__)
 
-LogLevel getLogLevel();
-
-void setLogLevel(LogLevel level);
-void closeLog();
-
-VMILIBRARY_API_LOG void internal_LOG(std::string method, const char* message, ...);
-VMILIBRARY_API_LOG void internal_LOG_INFO(std::string method, const char* message, ...);
-VMILIBRARY_API_LOG void internal_LOG_COLOR(std::string method, LogColor color, const char* message, ...);
-VMILIBRARY_API_LOG void internal_LOG_WARNING(std::string method, const char* message, ...);
-VMILIBRARY_API_LOG void internal_LOG_ERROR(std::string method, const char* message, ...);
-VMILIBRARY_API_LOG void internal_LOG_DUMP(std::string method, const char* buffer, int size);
-VMILIBRARY_API_LOG void internal_LOG_DUMP10BITS(std::string method, const char* buffer, int size);
-
-#define LOG(msg, ...)           internal_LOG(__METHOD_NAME__, msg, ##__VA_ARGS__)
-#define LOG_INFO(msg, ...)      internal_LOG_INFO(__METHOD_NAME__, msg, ##__VA_ARGS__)
-#define LOG_COLOR(color, msg, ...)     internal_LOG_COLOR(__METHOD_NAME__, color, msg, ##__VA_ARGS__)
-#define LOG_WARNING(msg, ...)   internal_LOG_WARNING(__METHOD_NAME__, msg, ##__VA_ARGS__)
-#define LOG_ERROR(msg, ...)     internal_LOG_ERROR(__METHOD_NAME__, msg, ##__VA_ARGS__)
-#define LOG_DUMP(buffer, size)  internal_LOG_DUMP(__METHOD_NAME__, buffer, size)
-#define LOG_DUMP10BITS(buffer, size)   internal_LOG_DUMP10BITS(__METHOD_NAME__, buffer, size)
+extern VMILIBRARY_API_LOG LogLevel g_logLevel;
+
+VMILIBRARY_API_LOG LogLevel getLogLevel();
+VMILIBRARY_API_LOG void setLogLevel(LogLevel level);
+VMILIBRARY_API_LOG void closeLog();
+
+VMILIBRARY_API_LOG void internal_LOG(LogMethod method, const char* message, ...);
+VMILIBRARY_API_LOG void internal_LOG_INFO(LogMethod method, const char* message, ...);
+VMILIBRARY_API_LOG void internal_LOG_COLOR(LogMethod method, LogColor color, const char* message, ...);
+VMILIBRARY_API_LOG void internal_LOG_WARNING(LogMethod method, const char* message, ...);
+VMILIBRARY_API_LOG void internal_LOG_ERROR(LogMethod method, const char* message, ...);
+VMILIBRARY_API_LOG void internal_LOG_DUMP(LogMethod method, const char* buffer, int size);
+VMILIBRARY_API_LOG void internal_LOG_DUMP10BITS(LogMethod method, const char* buffer, int size);
+
+// The level is checked before the arguments are evaluated: a disabled log costs a load and a
+// branch
+#define LOG_IF_LEVEL(level, function, ...)  do { if (g_logLevel >= (level)) { LOG_CONSTEXPR LogMethod _logMethod = __METHOD_NAME__; function(_logMethod, __VA_ARGS__); } } while (0)
+
+#define LOG(msg, ...)           LOG_IF_LEVEL(LOG_LEVEL_VERBOSE, internal_LOG, msg, ##__VA_ARGS__)
+#define LOG_INFO(msg, ...)      LOG_IF_LEVEL(LOG_LEVEL_INFO, internal_LOG_INFO, msg, ##__VA_ARGS__)
+#define LOG_COLOR(color, msg, ...)     LOG_IF_LEVEL(LOG_LEVEL_INFO, internal_LOG_COLOR, color, msg, ##__VA_ARGS__)
+#define LOG_WARNING(msg, ...)   LOG_IF_LEVEL(LOG_LEVEL_WARNING, internal_LOG_WARNING, msg, ##__VA_ARGS__)
+#define LOG_ERROR(msg, ...)     LOG_IF_LEVEL(LOG_LEVEL_ERROR, internal_LOG_ERROR, msg, ##__VA_ARGS__)
+#define LOG_DUMP(buffer, size)  LOG_IF_LEVEL(LOG_LEVEL_ERROR, internal_LOG_DUMP, buffer, size)
+#define LOG_DUMP10BITS(buffer, size)   LOG_IF_LEVEL(LOG_LEVEL_INFO, internal_LOG_DUMP10BITS, buffer, size)
 
 /////////////////////////////////////////
 // http://stackoverflow.com/questions/2670816/how-can-i-use-the-compile-time-constant-line-in-a-string
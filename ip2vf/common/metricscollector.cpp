@@ -59,6 +59,42 @@ void MetricsCollector::setFrameCounter(unsigned int frames, int pinId)
         }
     }
 }
+void MetricsCollector::setRxStats(const vMIRxStats& stats, int pinId)
+{
+    for (auto && pinInfo : this->_pinsVec)
+    {
+        if (pinInfo._id == pinId)
+        {
+            pinInfo._rxStats = stats;
+            pinInfo._hasRxStats = true;
+            return;
+        }
+    }
+}
+void MetricsCollector::setTxStats(const vMITxStats& stats, int pinId)
+{
+    for (auto && pinInfo : this->_pinsVec)
+    {
+        if (pinInfo._id == pinId)
+        {
+            pinInfo._txStats = stats;
+            pinInfo._hasTxStats = true;
+            return;
+        }
+    }
+}
+void MetricsCollector::setSPSStats(const vMISPSStats& stats, int pinId)
+{
+    for (auto && pinInfo : this->_pinsVec)
+    {
+        if (pinInfo._id == pinId)
+        {
+            pinInfo._spsStats = stats;
+            pinInfo._hasSPSStats = true;
+            return;
+        }
+    }
+}
 void MetricsCollector::setStaticInfo(int id, std::string &name, int mtn_port)
 {
     _id = id;
@@ -116,6 +152,75 @@ void MetricsCollector::tick()
         res << (pi._direction == DIRECTION_INPUT ? "i" : "o") << pi._id << ": " << DISPFORMAT_BEGIN << tools::to_string_with_precision(pi._fps, 2) << DISPFORMAT_CLOSE << ", ";
     }
     LOG_INFO(res.str().c_str());
+
+    // Packet loss counters: lost, reordered, duplicated, late packets, dropped and repaired frames
+    std::ostringstream rx;
+    _frame->setType("vmirxloss");
+    for (auto && pi : _pinsVec)
+    {
+        if (!pi._hasRxStats)
+            continue;
+        std::string ti = (pi._direction == DIRECTION_INPUT ? "i" : "o") + std::to_string(pi._id);
+        _frame->setTypeInstance(ti.c_str());
+        unsigned long long values[6] = { pi._rxStats.lostPackets, pi._rxStats.reorderedPackets, pi._rxStats.duplicatedPackets,
+            pi._rxStats.latePackets, pi._rxStats.droppedFrames, pi._rxStats.repairedFrames };
+        _frame->addRecordn(COLLECTD_DATACODE_COUNTER, (void *)values, 6);
+        if (pi._rxStats.lostPackets + pi._rxStats.reorderedPackets + pi._rxStats.droppedFrames > 0)
+            rx << ti << ": lost=" << pi._rxStats.lostPackets << ", reordered=" << pi._rxStats.reorderedPackets
+               << ", dropped=" << pi._rxStats.droppedFrames << ", repaired=" << pi._rxStats.repairedFrames << "; ";
+    }
+    if (!rx.str().empty())
+        LOG_INFO("%s: RX: %s", this->_name, rx.str().c_str());
+
+    // Output pipeline: queue depths, and average time of each stage since the last report, in µs
+    std::ostringstream tx;
+    _frame->setType("vmitxpipeline");
+    for (auto && pi : _pinsVec)
+    {
+        if (!pi._hasTxStats)
+            continue;
+        std::string ti = (pi._direction == DIRECTION_INPUT ? "i" : "o") + std::to_string(pi._id);
+        _frame->setTypeInstance(ti.c_str());
+        unsigned long long frames = pi._txStats.frames - pi._txStatsLast.frames;
+        double n = (double)(frames > 0 ? frames : 1);
+        double values[5] = { (double)pi._txStats.queueDepth, (double)pi._txStats.ringDepth,
+            (pi._txStats.prepareTime - pi._txStatsLast.prepareTime) / n,
+            (pi._txStats.waitTime - pi._txStatsLast.waitTime) / n,
+            (pi._txStats.transmitTime - pi._txStatsLast.transmitTime) / n };
+        _frame->addRecordn(COLLECTD_DATACODE_GAUGE, (void *)values, 5);
+        tx << ti << ": queue=" << pi._txStats.queueDepth << ", ring=" << pi._txStats.ringDepth
+           << ", prepare=" << (long long)values[2] << "us, wait=" << (long long)values[3]
+           << "us, transmit=" << (long long)values[4] << "us; ";
+        pi._txStatsLast = pi._txStats;
+    }
+    if (!tx.str().empty())
+        LOG_INFO("%s: TX: %s", this->_name, tx.str().c_str());
+
+    // SMPTE ST 2022-7: for each leg, packets received, lost, and recovered from the other leg, then
+    // packets lost on both legs
+    std::ostringstream sps;
+    _frame->setType("vmisps");
+    for (auto && pi : _pinsVec)
+    {
+        if (!pi._hasSPSStats)
+            continue;
+        std::string ti = (pi._direction == DIRECTION_INPUT ? "i" : "o") + std::to_string(pi._id);
+        _frame->setTypeInstance(ti.c_str());
+        unsigned long long values[3 * SPS_NB_LEGS + 1];
+        sps << ti << ": ";
+        for (int i = 0; i < SPS_NB_LEGS; i++) {
+            values[3 * i] = pi._spsStats.legs[i].packets;
+            values[3 * i + 1] = pi._spsStats.legs[i].lostPackets;
+            values[3 * i + 2] = pi._spsStats.legs[i].recoveredPackets;
+            sps << "leg" << i << " lost=" << pi._spsStats.legs[i].lostPackets << " recovered=" << pi._spsStats.legs[i].recoveredPackets << ", ";
+        }
+        values[3 * SPS_NB_LEGS] = pi._spsStats.lostPackets;
+        sps << "lost=" << pi._spsStats.lostPackets << "; ";
+        _frame->addRecordn(COLLECTD_DATACODE_COUNTER, (void *)values, 3 * SPS_NB_LEGS + 1);
+    }
+    if (!sps.str().empty())
+        LOG_INFO("%s: 2022-7: %s", this->_name, sps.str().c_str());
+
     if (_collectdSocket.isValid())
     {
         int len = _frame->getLen();
@@ -4,6 +4,7 @@
 #include "moduleconfiguration.h"    // For MAX_CONFIG_STRING_LENGTH
 #include "collectdframe.h"
 #include "tcp_basic.h"
+#include "vmiframe.h"               // For vMIRxStats, vMITxStats, vMISPSStats
 #include <mutex>
 enum PinDirection {
     DIRECTION_INPUT = 0,
@@ -17,6 +18,13 @@ struct PinInfo {
     int          _vidfrmsize;   // Frame size for this pin
     double       _fps;
     unsigned int  _frames;
+    vMIRxStats   _rxStats;      // Packet loss counters, for the input pins which provide them
+    bool         _hasRxStats;
+    vMITxStats   _txStats;      // Output pipeline counters, for the output pins
+    vMITxStats   _txStatsLast;  // Counters of the previous report, to compute the average times
+    bool         _hasTxStats;
+    vMISPSStats  _spsStats;     // SMPTE ST 2022-7 counters, for the input pins receiving two legs
+    bool         _hasSPSStats;
 
     PinInfo() {
         _id = -1;
@@ -25,6 +33,13 @@ struct PinInfo {
         _vidfrmsize = 0;
         _fps = 0.0f;
         _frames = 0;
+        std::memset(&_rxStats, 0, sizeof(_rxStats));
+        _hasRxStats = false;
+        std::memset(&_txStats, 0, sizeof(_txStats));
+        std::memset(&_txStatsLast, 0, sizeof(_txStatsLast));
+        _hasTxStats = false;
+        std::memset(&_spsStats, 0, sizeof(_spsStats));
+        _hasSPSStats = false;
     };
 };
 
@@ -43,6 +58,9 @@ public:
     // To set stats (change each frame)
     void setFPS(double fps, int pinId);
     void setFrameCounter(unsigned int frames, int pinId);
+    void setRxStats(const vMIRxStats& stats, int pinId);
+    void setTxStats(const vMITxStats& stats, int pinId);
+    void setSPSStats(const vMISPSStats& stats, int pinId);
 
     // Send periodic data to supervisor
     void tick();
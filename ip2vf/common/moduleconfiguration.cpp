@@ -43,11 +43,14 @@
 tPinName g_pinsNameArray[] = {
     { PIN_TYPE_TCP,        "tcp" },
     { PIN_TYPE_SHMEM,      "shmem" },
+    { PIN_TYPE_SHMEM_RING, "shmem_ring" },
     { PIN_TYPE_FILE,       "file" },
     { PIN_TYPE_DEVNULL,    "devnull" },
     { PIN_TYPE_RTP,        "rtp" },
     { PIN_TYPE_SMPTE,      "smpte" },
     { PIN_TYPE_TR03,       "tr03" },
+    { PIN_TYPE_ST2110,     "st2110" },
+    { PIN_TYPE_FANOUT,     "fanout" },
     { PIN_TYPE_TCP_THUMB,  "thumbnails" },
     { PIN_TYPE_RAWX264,    "x264" },
     { PIN_TYPE_AES67,      "aes67"}
@@ -9,6 +9,7 @@
 #include "common.h"
 #include "tcp_basic.h"
 #include "rtpframe.h"
+#include "udpbatchsender.h"
 #include "pins/st2022/smpteprofile.h"
 
 
@@ -23,13 +24,18 @@ class CUDPPacketizer
 protected:
     int     _mtu;
     int     _UDPPacketSize;
+    CUDPBatchSender _batch;     /* batched transmit engine */
+    double  _framePeriod;       /* in ns, to spread the packets of a frame with a pacer, 0 if unknown */
 
 public:
-    CUDPPacketizer(int mtu = 1500) : _mtu(mtu) {};
+    CUDPPacketizer(int mtu = 1500) : _mtu(mtu), _framePeriod(0) {};
     virtual ~CUDPPacketizer() {};
 
 public:
     virtual int send(UDP* sock, char* buffer, int buffersize) = 0;
+    void setPacer(CTxPacer* pacer) { _batch.setPacer(pacer); };
+    void setFramePeriod(double ns) { _framePeriod = ns; };
+    void setCapture(CUDPPacketList* list) { _batch.setCapture(list); };    /* build the packets in list, send() needs no socket */
 };
 
 /**********************************************************************************************
@@ -37,10 +43,9 @@ public:
 * CRTPPacketizer
 *
 ***********************************************************************************************/
-class CRTPPacketizer : CUDPPacketizer
+class CRTPPacketizer : protected CUDPPacketizer
 {
 protected:
-    char    _RTPframe[RTP_MAX_FRAME_LENGTH];
     int     _RTPPacketSize;
     int     _RTPPayloadSize;
     int     _seq;
@@ -51,20 +56,21 @@ public:
     ~CRTPPacketizer() {};
 
 public:
+    using CUDPPacketizer::setPacer;
+    using CUDPPacketizer::setFramePeriod;
+    using CUDPPacketizer::setCapture;
     void setPayloadType(int payloadtype) { _payloadtype = payloadtype ; };
     int  send(UDP* sock, char* buffer, int buffersize);
 };
 
 /**********************************************************************************************
 *
-* CRTPPacketizer
+* CRTPmmsgPacketizer
 *
 ***********************************************************************************************/
-#define MMSGPACKETIZER_NB_SEGMENTS   64
 class CRTPmmsgPacketizer : CUDPPacketizer
 {
 protected:
-    char*   _RTPframe[MMSGPACKETIZER_NB_SEGMENTS];
     int     _RTPPacketSize;
     int     _RTPPayloadSize;
     int     _seq;
@@ -72,7 +78,7 @@ protected:
 
 public:
     CRTPmmsgPacketizer(int mtu = 1500);
-    ~CRTPmmsgPacketizer();
+    ~CRTPmmsgPacketizer() {};
 
 public:
     void setPayloadType(int payloadtype) { _payloadtype = payloadtype; };
@@ -100,6 +106,8 @@ public:
     ~CHBRMPPacketizer() {};
 
 public:
+    using CRTPPacketizer::setPacer;
+    using CRTPPacketizer::setCapture;
     void setProfile(CSMPTPProfile* profile);
     int  send(UDP* sock, char* buffer, int buffersize);
 };
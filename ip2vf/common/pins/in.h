@@ -11,18 +11,24 @@
 
 #include <pins/st2022/smpteframe.h>
 #include <pins/st2022/datasource.h>
+#include <pins/st2110/st2110frame.h>
 #include "rtpframe.h"
 #include "common.h"
 #include "tcp_basic.h"
 #include "frameheaders.h"
+#include "framecodec.h"
 #include "framecounter.h"
 #include "moduleconfiguration.h"
 #include <pins/pinfactory.h>
 #include <configurable.h>
 #include "vmiframe.h"
+#include "shmring.h"
+#include "ringqueue.h"
 
 #define PACKET_SIZE 1428
 
+#define INRTP_DEFAULT_REORDER_WINDOW    32      /* packets of the next frame received before declaring the missing ones lost */
+
 /**********************************************************************************************
 *
 * CIn
@@ -56,6 +62,8 @@ public:
 
     virtual void start() {};                 /* Start the pin (will start the stream processing) */
     virtual void stop() {};                  /* Stop the pin */
+    virtual const vMIRxStats* getRxStats() { return NULL; };   /* packet loss counters, NULL if not relevant for the pin */
+    virtual const vMISPSStats* getSPSStats() { return NULL; }; /* SMPTE ST 2022-7 counters, NULL if not relevant for the pin */
 public:
     /*
      * Interface to implement for each kind of pin
@@ -106,6 +114,17 @@ public:
     const char*   _ip;          /* ip (for client socket) */
     const char*   _mcastgroup;  /* mcast group to join for multicast stream */
     int     _port;              /* port to use (client or server socket)*/
+    int     _rxBatch;           /* max nb of packets received per syscall, <=1 for one packet at a time */
+    int     _reorderWindow;     /* nb of packets of the next frame to receive before declaring missing packets lost */
+    int     _maxLost;           /* max nb of lost packets to deliver a frame anyway, 0 to drop incomplete frames */
+    bool    _conceal;           /* on lost packets, repeat the previous frame data instead of zeros */
+    CvMIRxContext _rxContext;   /* frame reassembly state and loss counters */
+    int     _nbWorkers;         /* nb of workers of the module worker pool, -1 for default */
+    std::string _workersCpus;   /* cores to pin the workers on, like "2;3;8-11" */
+    CFrameCodec _decoder;       /* decoder of the compressed frames */
+    std::vector<unsigned char> _codedMedia; /* compressed media of the frame being decoded */
+
+    int  _decompress(CvMIFrame* frame);
 public:
     CInRTP(CModuleConfiguration* pMainCfg, int nIndex);
     virtual ~CInRTP();
@@ -114,6 +133,7 @@ public:
     void reset();
     virtual void start();
     virtual void stop();
+    virtual const vMIRxStats* getRxStats() { return &_rxContext._stats; };
 };
 
 /**********************************************************************************************
@@ -152,6 +172,31 @@ public:
     void stop();
 };
 
+/**********************************************************************************************
+*
+* CInMemRing
+*
+* vMI Input pin to receive vMI frames from a ring of frame slots in shared memory. With zerocopy,
+* received frames reference the slots directly, and are given back to the ring on release.
+*
+***********************************************************************************************/
+class CInMemRing : public CIn
+{
+public:
+    std::shared_ptr<CShmRing> _ring;    /* ring of frame slots, kept alive by the frames that reference it */
+    int    _shm_key;        /* key of the shared memory segment */
+    int    _zerocopy;       /* 1 to reference the slots without copy, 0 to copy the frames */
+    bool   _bStop;          /* stop flag */
+public:
+    CInMemRing(CModuleConfiguration* pMainCfg, int nIndex);
+    virtual ~CInMemRing();
+public:
+    int  read(CvMIFrame* frame);
+    void reset() {};
+    void start();
+    void stop();
+};
+
 /**********************************************************************************************
 *
 * CInFile
@@ -192,6 +237,9 @@ struct SmpteFrameBuffer {
     CSMPTPFrame   _frame;
     std::mutex    _lock;
 };
+#define INSMPTE_SCATTER_PACKETS     64      /* packets received per readScatter() */
+#define INSMPTE_SCATTER_HEADER_SIZE 64      /* room for the RTP+HBRMP headers of a packet */
+
 class CInSMPTE : public CIn
 {
 private:
@@ -200,10 +248,12 @@ private:
     SmpteFrameBuffer* _currentFrame;    /* pointer to the SMPTE frame currently processed by vMI */
     bool            _firstFrame;        /* first frame flag */
     int             _fmt;               /* wanted bit per pixel components on provided vMI frame (8 or 10) */
-    CQueue<int>     _q;                 /* queue of index of SmpteFrameBuffer */
+    CMPSCRing<int>  _q;                 /* queue of index of SmpteFrameBuffer, the oldest dropped if not read in time */
     std::thread     _t;                 /* separate thread for CSMPTETFrame accretion */
     int             _nbSMPTEFrameToQueue;
     int             _onlyvideo;         /* demux only video flag */
+    int             _nbWorkers;         /* nb of workers of the module worker pool, -1 for default */
+    std::string     _workersCpus;       /* cores to pin the workers on, like "2;3;8-11" */
     SMPTE_STANDARD_SUITE _streamType;   /* SMPTE type detected on input. SMPTE_2022_6 or SMPTE_2110_20 */
 
 public:
@@ -217,6 +267,49 @@ public:
     void reset() {};
     void start();
     void stop();
+    virtual const vMISPSStats* getSPSStats() { return _source ? _source->getSPSStats() : NULL; };
+};
+
+/**********************************************************************************************
+*
+* CInST2110
+*
+* vMI Input pin to receive SMPTE ST 2110-20 video (RFC 4175, 4:2:2 8/10/12 bits). The pixel
+* groups are copied from the receive ring straight to their place in the vMI frame.
+*
+***********************************************************************************************/
+class CInST2110 : public CIn
+{
+private:
+    UDP*        _udpSock;           /* UDP socket to rcv data */
+    const char* _interface;         /* network interface to rcv data */
+    const char* _ip;                /* ip of the network interface */
+    const char* _mcastgroup;        /* mcast group to join for multicast stream */
+    int         _port;
+    int         _rxBatch;           /* max nb of packets received per syscall */
+    int         _w;
+    int         _h;
+    int         _fmt;               /* bits per component: 8, 10 or 12 */
+    bool        _interlaced;
+    CST2110FrameAssembler _assembler;
+    CFrameHeaders _fh;              /* headers of the provided vMI frames */
+    std::vector<unsigned char> _pending;    /* first packet of the next frame, received while completing the current one */
+    int         _pendingLen;
+    int         _frameNb;
+    unsigned int _lastTimestamp;    /* RTP timestamp of the last frame, to detect the framerate */
+    vMIRxStats  _rxStats;
+
+    void _detect_framerate(unsigned int timestamp);
+
+public:
+    CInST2110(CModuleConfiguration* pMainCfg, int nIndex);
+    virtual ~CInST2110();
+public:
+    int  read(CvMIFrame* frame);
+    void reset() {};
+    void start();
+    void stop();
+    virtual const vMIRxStats* getRxStats() { return &_rxStats; };
 };
 
 
@@ -88,7 +88,9 @@ int CInTCP::read(CvMIFrame* frame)
                 LOG_ERROR("errors when try to get vMI frame...");
             return VMI_E_INVALID_FRAME;
         }
-        else if (_firstFrame) {
+        // A frame in the socket buffer: received without waiting for the sender
+        _tcpSock.setBufferSize(0, frame->getFrameSize());
+        if (_firstFrame) {
             LOG_INFO("Dump received IP2vf headers:");
             CFrameHeaders* headers = frame->getMediaHeaders();
             headers->DumpHeaders();
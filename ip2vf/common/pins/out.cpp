@@ -28,6 +28,22 @@ COut::COut(CModuleConfiguration* pMainCfg, int nIndex)
     _name           = std::string(pMainCfg->_name) + std::string("[") + std::to_string(_nIndex) + std::string("]");
 }
 
+/*!
+* \fn _get_frame_period
+* \brief frame period of a video frame, from its frame rate
+*
+* \param headers headers of the frame
+* \return frame period in ns, 0 if unknown
+*/
+double COut::_get_frame_period(CFrameHeaders* headers)
+{
+    for (int i = 0; i < g_FRATE_len; i++) {
+        if (g_FRATE[i].code == headers->GetFramerateCode() && g_FRATE[i].frame_rate_in_hz > 0)
+            return 1000000000.0 / g_FRATE[i].frame_rate_in_hz;
+    }
+    return 0;
+}
+
 TransportType COut::getTransportType() {
     if (MEMORY_TYPE(_nType))
         return TRANSPORT_TYPE_MEMORY;
@@ -5,20 +5,32 @@
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include <pins/st2022/smpteframe.h>
+#include <pins/st2110/st2110frame.h>
+#include <pins/st2110/st2110scheduler.h>
 #include "common.h"
 #include "tcp_basic.h"
+#include "udpbatchsender.h"
 #include "frameheaders.h"
+#include "framecodec.h"
 #include "framecounter.h"
 #include "rtpframe.h"
 #include "moduleconfiguration.h"
 #include "vmiframe.h"
+#include "shmring.h"
 #include "vmistreamer.h"
 #include "packetizer.h"
+#include "txpacer.h"
+#include "thumbnailscaler.h"
+#include "ringqueue.h"
 
 /**********************************************************************************************
 *
@@ -37,6 +49,8 @@ protected:
     MEDIAFORMAT _mediaformat;   /* Media format for the output stream */
     PinConfiguration* _pConfig; /* Pin configuration */
 
+    static double _get_frame_period(CFrameHeaders* headers);
+
 public:
     COut(CModuleConfiguration* pMainCfg, int nIndex);
     virtual ~COut(){};
@@ -54,23 +68,48 @@ public:
      */
     virtual int  send(CvMIFrame* frame) = 0;
     virtual bool isConnected() = 0;
+
+    /*
+     * Prepare stage of the output pipeline (see CvMIOutput): prepare() of a frame is called on
+     * another thread than send(), before send() of the same frame, and may run while send() of
+     * the previous frame is in progress. It's called after send() of the frame COUT_STAGES
+     * frames before has returned: a pin keeps COUT_STAGES buffers of prepared frames.
+     */
+    virtual int  prepare(CvMIFrame* frame) { return VMI_E_OK; };
 };
 
 /**********************************************************************************************
 *
 * COutTCP
 *
-* vMI output pin to propagate a vMI stream with a TCP connection
+* vMI output pin to propagate a vMI stream with a TCP connection. Each frame is sent with one
+* sendmsg() of its headers and media. With zerocopy=1, it's sent with MSG_ZEROCOPY: the pin keeps
+* a reference on the frame until the kernel has sent it, up to 'inflight' frames.
 *
 ***********************************************************************************************/
 class COutTCP : public COut
 {
+    /* Frame sent with MSG_ZEROCOPY, referenced until the kernel doesn't use its memory anymore */
+    struct InFlight {
+        libvMI_frame_handle handle;     /* LIBVMI_INVALID_HANDLE if the frame is not in the frame list */
+        unsigned int firstId;           /* id of its first zero copy send */
+        int          nbIds;             /* nb of its zero copy sends */
+        int          pendingIds;        /* nb of its zero copy sends not completed */
+    };
+
     TCP  _tcpSock;          /* TCP object used to send vMI frames */
     bool _isListen;         /* listen flag */
     int  _flags;
     int  _port;             /* port to use (client or server socket) */
     const char* _ip;        /* ip (for client socket) */
     const char* _interface; /* ip of the network interface for server socket */
+    bool _zeroCopy;         /* send with MSG_ZEROCOPY */
+    int  _maxInFlight;      /* max nb of frames sent with MSG_ZEROCOPY and not completed */
+    std::deque<InFlight> _inFlight;
+
+    int  _reap_completions(int timeoutMs);
+    int  _wait_in_flight(int maxInFlight);
+    void _release_in_flight();
 public:
     COutTCP(CModuleConfiguration* pMainCfg, int nIndex);
     ~COutTCP();
@@ -97,12 +136,33 @@ class COutRTP : public COut
     const char* _interface; /* ip of the network interface to rcv data (for server socket) */
     const char* _mcastgroup;/* mcast group to join for multicast stream */
     int _port;              /* port to use (client or server socket)*/
+    int _pacerCore;         /* core of the pacing engine, -1 to send each frame at once */
+    bool _txTime;           /* launch time mode, if the egress interface has an ETF qdisc */
+    const char* _codecName; /* compression of the video frames: "none" or "dpcm" */
+    int _nbSlices;          /* slices of a compressed frame, coded in parallel */
+    int _nbWorkers;         /* nb of workers of the module worker pool, -1 for default */
+    std::string _workersCpus; /* cores to pin the workers on, like "2;3;8-11" */
+
+    int _codecId;           /* VMI_CODEC_xxx */
+    CFrameCodec _encoder;
+    struct {
+        std::vector<unsigned char> buffer;  /* headers and compressed media */
+        int size;                           /* 0 to send the frame as is */
+        int frameNumber;                    /* frame compressed in the slot */
+    } _coded[COUT_STAGES];                  /* frames compressed by prepare(), for send() */
+    std::atomic<unsigned int> _prepareIndex;
+    unsigned int _sendIndex;
+    unsigned long long _rawBytes;           /* media of the compressed frames, before and after */
+    unsigned long long _codedBytes;
 
     CRTPPacketizer _packetizer; /* kind of packetiser to use */
+
+    int _compress(CvMIFrame* frame, int slot);
 public:
     COutRTP(CModuleConfiguration* pMainCfg, int nIndex);
     ~COutRTP();
 public:
+    int  prepare(CvMIFrame* frame);
     int  send(CvMIFrame* frame);
     bool isConnected();
 };
@@ -138,6 +198,27 @@ public:
     bool isConnected();
 };
 
+/**********************************************************************************************
+*
+* COutMemRing
+*
+* vMI output pin to propagate a vMI stream with a ring of frame slots in shared memory
+*
+***********************************************************************************************/
+class COutMemRing : public COut
+{
+public:
+    std::shared_ptr<CShmRing> _ring;    /* ring of frame slots, re-created if a frame doesn't fit in a slot */
+    int    _shm_key;        /* key of the shared memory segment */
+    int    _nbSlots;        /* number of frame slots of the ring */
+public:
+    COutMemRing(CModuleConfiguration* pMainCfg, int nIndex);
+    ~COutMemRing();
+public:
+    int  send(CvMIFrame* frame);
+    bool isConnected();
+};
+
 /**********************************************************************************************
 *
 * COutDevNull
@@ -158,17 +239,29 @@ public:
 *
 * COutThumbSocket
 *
+* Output pin sending thumbnails of the video over TCP, at a limited rate. The thumbnail is built
+* on the output thread (see CThumbnailScaler), the connection and the transmission are done by
+* a sender thread: a slow or missing viewer never blocks the output thread. Triple buffering:
+* the output thread fills a free buffer and replaces the pending one, not yet taken by the
+* sender, with it.
+*
 ***********************************************************************************************/
+#define THUMB_NB_BUFFERS    3
+
 class COutThumbSocket : public COut, public CFrameCounter
 {
-    TCP    _tcpSock;
+    TCP    _tcpSock;                /* used by the sender thread only */
     bool   _isListen;
     double _last_time;
     float  _frame_rate;
-    unsigned char* _rgb_buffer;
-    int    _rgb_buffer_len;
-    int    _frame_w;
-    int    _frame_h;
+    CThumbnailScaler _scaler;
+    std::vector<unsigned char> _buffers[THUMB_NB_BUFFERS];     /* headers + thumbnail */
+    int    _pending;                /* buffer waiting for the sender, -1 if none */
+    int    _sending;                /* buffer being sent, -1 if none */
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::thread _th_send;
+    bool   _bExit;
 
     const char* _ip;
     const char* _interface;
@@ -176,6 +269,9 @@ class COutThumbSocket : public COut, public CFrameCounter
     int _depth;
     int _ratio;
     int _fps;
+
+    void _send_thread();
+    int  _open_socket();
 public:
     COutThumbSocket(CModuleConfiguration* pMainCfg, int nIndex);
     ~COutThumbSocket();
@@ -203,12 +299,15 @@ class COutSMPTE: public COut
     bool _useDeltacast;
     const char* _smptefmt;
     SMPTE_STANDARD_SUITE _standard;
+    int _pacerCore;         /* core of the pacing engine, -1 to send each frame at once */
+    bool _txTime;           /* launch time mode, if the egress interface has an ETF qdisc */
 
 public:
     COutSMPTE(CModuleConfiguration* pMainCfg, int nIndex);
     ~COutSMPTE();
 
 public:
+    int prepare(CvMIFrame* frame);
     int send(CvMIFrame* frame);
     bool isConnected();
 };
@@ -256,11 +355,13 @@ class COutTR03 : public COut
     int  _linepayloadsize; // full line size in bytes + headers
     unsigned int  _seq;
     unsigned int  _frameCount;
-    unsigned char _RTPframe[RTP_MAX_FRAME_LENGTH];
+    CUDPBatchSender _batch; /* batched transmit engine, packets reference the scanlines */
     const char* _ip;
     const char * _interface;
     const char * _mcastgroup;
     int _port;
+    int _pacerCore;         /* core of the pacing engine, -1 to send each frame at once */
+    bool _txTime;           /* launch time mode, if the egress interface has an ETF qdisc */
 
 public:
     COutTR03(CModuleConfiguration* pMainCfg, int nIndex);
@@ -270,5 +371,108 @@ public:
     bool isConnected();
 };
 
+/**********************************************************************************************
+*
+* COutST2110
+*
+* vMI output pin to send a SMPTE ST 2110-20 video stream, paced following ST 2110-21
+*
+***********************************************************************************************/
+class COutST2110 : public COut
+{
+    UDP*        _udpSock;
+    bool        _isMulticast;
+    const char* _ip;
+    const char* _interface;
+    const char* _mcastgroup;
+    int         _port;
+    int         _mtu;
+    int         _payloadType;
+    const char* _senderType;            /* ST 2110-21 sender type: "N" (narrow) or "W" (wide) */
+    bool        _linear;                /* linear timing, instead of gapped */
+    int         _burst;                 /* nb of packets sent at once, 0 for auto */
+    int         _core;                  /* core to run the sender on, -1 if not pinned */
+    int         _spin;                  /* busy-wait before a packet, in us */
+    int         _statsPeriod;           /* period of the pacing statistics logs, in seconds (0: none) */
+    int         _pacerCore;             /* core of the pacing engine, -1 to pace the packets on the sender */
+    bool        _txTime;                /* launch time mode, if the egress interface has an ETF qdisc */
+    CTxPacer*   _pacer;
+    CST2110FramePacketizer _packetizer;
+    CST2110Scheduler _scheduler;
+    CUDPBatchSender _batch;             /* packets of a burst, referencing the frame */
+    std::string _format;                /* format of the stream, to detect changes */
+    bool        _bConfigured;
+    bool        _bCorePinned;
+    long long   _lastStats;             /* time of the last statistics log */
+
+    int  _configure(CFrameHeaders* headers);
+
+public:
+    COutST2110(CModuleConfiguration* pMainCfg, int nIndex);
+    ~COutST2110();
+public:
+    int  send(CvMIFrame* frame);
+    bool isConnected();
+};
+
+/**********************************************************************************************
+*
+* COutFanout
+*
+* vMI output pin to send the same stream to several destinations (unicast or multicast): each
+* frame is packetized once, in the format of the rtp or smpte (ST 2022-6) pins, in a packet list
+* shared by the destinations. Each destination has its own socket, schedule (or launch times)
+* and thread, fed by a queue of 'queue' frames: a destination which can't keep up loses its
+* oldest frames, without delaying the other ones, and one which fails is opened again on the
+* next frames.
+*
+***********************************************************************************************/
+#define FANOUT_DEFAULT_QUEUE        2       /* frames queued per destination */
+#define FANOUT_REOPEN_MS            1000    /* min time between two opens of the socket of a destination */
+#define FANOUT_WARNING_MS           1000    /* min time between two warnings of a destination */
+
+class COutFanout : public COut
+{
+    /* A destination of the stream */
+    struct Destination {
+        std::string     ip;
+        int             port;
+        UDP*            sock;                   /* used by the thread of the destination only */
+        CUDPBatchSender batch;                  /* schedule of the destination */
+        CSPSCRing<std::shared_ptr<CUDPPacketList> > queue;     /* frames to send, the oldest dropped if full */
+        std::thread     thread;
+        std::atomic<bool> bConnected;
+        std::atomic<unsigned long long> sent;   /* frames sent */
+        std::atomic<unsigned long long> errors; /* frames which failed to be sent */
+        long long       lastOpen;               /* time of the last open of the socket, in ms */
+        long long       lastWarning;            /* time of the last warning of dropped frames, in ms */
+    };
+
+    const char* _dest;                  /* destinations: "<ip>[:<port>];<ip>[:<port>];..." */
+    int         _port;                  /* port of the destinations which have none */
+    const char* _ip;                    /* local address, for the multicast destinations */
+    const char* _interface;
+    const char* _format;                /* "rtp" or "smpte" */
+    int         _queueSize;
+    int         _pacerCore;             /* core of the pacing engine, -1 to send each frame at once */
+    bool        _txTime;                /* launch time mode, if the egress interface has an ETF qdisc */
+    bool        _bSmpte;
+    CRTPPacketizer _packetizer;         /* rtp format */
+    CBasevMIStreamer* _streamer;        /* smpte format: SMPTE framing and packetizer */
+    std::vector<std::shared_ptr<CUDPPacketList> > _lists;      /* packet lists, reused once the destinations sent them */
+    std::vector<std::unique_ptr<Destination> > _dests;
+
+    std::shared_ptr<CUDPPacketList> _get_list();
+    int  _open(Destination* d);
+    void _dest_thread(Destination* d);
+
+public:
+    COutFanout(CModuleConfiguration* pMainCfg, int nIndex);
+    ~COutFanout();
+public:
+    int  prepare(CvMIFrame* frame);
+    int  send(CvMIFrame* frame);
+    bool isConnected();
+};
 
 #endif //_OUT_H
@@ -0,0 +1,253 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <pins/pins.h>
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "tcp_basic.h"
+#include "vmistreamer.h"
+
+using namespace std;
+
+/**********************************************************************************************
+*
+* COutFanout
+*
+***********************************************************************************************/
+
+COutFanout::COutFanout(CModuleConfiguration* pMainCfg, int nIndex) : COut(pMainCfg, nIndex)
+{
+    LOG("%s: --> <-- ", _name.c_str());
+    _nType = PIN_TYPE_FANOUT;
+    PROPERTY_REGISTER_MANDATORY("dest", _dest, "");
+    PROPERTY_REGISTER_OPTIONAL("port", _port, -1);
+    PROPERTY_REGISTER_OPTIONAL("ip", _ip, "");
+    PROPERTY_REGISTER_OPTIONAL("interface", _interface, "");
+    PROPERTY_REGISTER_OPTIONAL("format", _format, "rtp");
+    PROPERTY_REGISTER_OPTIONAL("queue", _queueSize, FANOUT_DEFAULT_QUEUE);
+    PROPERTY_REGISTER_OPTIONAL("pacer", _pacerCore, -1);
+    PROPERTY_REGISTER_OPTIONAL("txtime", _txTime, false);
+    _streamer = NULL;
+    _bSmpte = (strcmp(_format, "smpte") == 0);
+    if (!_bSmpte && strcmp(_format, "rtp") != 0)
+        LOG_ERROR("%s: invalid format '%s', available formats are 'rtp' and 'smpte'", _name.c_str(), _format);
+    if (_bSmpte)
+        _streamer = new CvMIStreamerCisco2022_6("", "", 0, _pConfig, _interface);
+    if (_queueSize < 1)
+        _queueSize = 1;
+
+    // Destinations: "<ip>[:<port>]" or "[<ipv6>][:<port>]", separated by ';'. An IPv6 address
+    // without brackets has no port: its last colon is part of the address
+    CTxPacer* pacer = (_pacerCore >= 0 ? CTxPacer::getInstance(_pacerCore) : NULL);
+    std::vector<std::string> tokens = tools::split(std::string(_dest), ';');
+    for (std::string& token : tokens) {
+        if (token.empty())
+            continue;
+        std::unique_ptr<Destination> d(new Destination());
+        std::string port;
+        if (token[0] == '[') {
+            size_t bracket = token.find(']');
+            if (bracket == std::string::npos || (bracket + 1 < token.size() && token[bracket + 1] != ':')) {
+                LOG_ERROR("%s: invalid destination '%s', expected '[<ipv6>]:<port>'", _name.c_str(), token.c_str());
+                continue;
+            }
+            d->ip = token.substr(1, bracket - 1);
+            if (bracket + 1 < token.size())
+                port = token.substr(bracket + 2);
+        }
+        else {
+            size_t colon = token.find(':');
+            bool ipv6 = (colon != std::string::npos && token.find(':', colon + 1) != std::string::npos);
+            d->ip = (colon == std::string::npos || ipv6 ? token : token.substr(0, colon));
+            if (colon != std::string::npos && !ipv6)
+                port = token.substr(colon + 1);
+        }
+        d->port = (port.empty() ? _port : atoi(port.c_str()));
+        if (d->ip.empty() || d->port <= 0) {
+            LOG_ERROR("%s: no address or no port for the destination '%s'", _name.c_str(), token.c_str());
+            continue;
+        }
+        d->sock = new UDP();
+        d->sock->enableTxTime(_txTime);
+        d->batch.init(0);
+        d->batch.setPacing(500);
+        d->batch.setPacer(pacer);
+        d->queue.init(_queueSize, RING_OVERFLOW_DROP_OLDEST);
+        d->bConnected = false;
+        d->sent = 0;
+        d->errors = 0;
+        d->lastOpen = 0;
+        d->lastWarning = 0;
+        _dests.push_back(std::move(d));
+    }
+    if (_dests.empty())
+        LOG_ERROR("%s: no valid destination in '%s'", _name.c_str(), _dest);
+    for (std::unique_ptr<Destination>& d : _dests) {
+        LOG_INFO("%s: destination [%s]:%d", _name.c_str(), d->ip.c_str(), d->port);
+        d->thread = std::thread(&COutFanout::_dest_thread, this, d.get());
+    }
+}
+
+COutFanout::~COutFanout()
+{
+    for (std::unique_ptr<Destination>& d : _dests)
+        d->queue.push(std::shared_ptr<CUDPPacketList>());
+    for (std::unique_ptr<Destination>& d : _dests) {
+        if (d->thread.joinable())
+            d->thread.join();
+        RingQueueStats stats;
+        d->queue.getStats(&stats);
+        LOG_INFO("%s: %s:%d: %llu frames sent, %llu dropped, %llu failed", _name.c_str(), d->ip.c_str(), d->port,
+            d->sent.load(), stats.dropped, d->errors.load());
+        d->sock->closeSocket();
+        delete d->sock;
+    }
+    if (_streamer)
+        delete _streamer;
+}
+
+/*!
+* \fn _get_list
+* \brief give a packet list no destination uses anymore, a new one if there is none
+*
+* \return the packet list
+*/
+std::shared_ptr<CUDPPacketList> COutFanout::_get_list()
+{
+    for (std::shared_ptr<CUDPPacketList>& list : _lists) {
+        if (list.use_count() == 1) {
+            // Pairs with the release of the last destination which sent it
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return list;
+        }
+    }
+    _lists.push_back(std::make_shared<CUDPPacketList>());
+    return _lists.back();
+}
+
+/*!
+* \fn _open
+* \brief open the socket of a destination, once per FANOUT_REOPEN_MS at most
+*
+* \param d the destination
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int COutFanout::_open(Destination* d)
+{
+    long long now = tools::getCurrentTimeInMilliS();
+    if (d->lastOpen != 0 && now - d->lastOpen < FANOUT_REOPEN_MS)
+        return VMI_E_FAILED_TO_OPEN_SOCKET;
+    d->lastOpen = now;
+
+    // The local address is the source of the multicast destinations only: the unicast ones
+    // share the port
+    bool multicast = (atoi(d->ip.c_str()) >= 224 && atoi(d->ip.c_str()) <= 239) || strncmp(d->ip.c_str(), "ff", 2) == 0;
+    int result = d->sock->openSocket(d->ip.c_str(), (multicast && _ip[0] != '\0' ? _ip : NULL), d->port, false, _interface);
+    if (result != E_OK) {
+        LOG_ERROR("%s: can't create UDP socket on [%s]:%d on interface '%s'",
+            _name.c_str(), d->ip.c_str(), d->port, _interface[0] == '\0' ? "<default>" : _interface);
+        d->sock->closeSocket();
+        return VMI_E_FAILED_TO_OPEN_SOCKET;
+    }
+    LOG_INFO("%s: Ok to create UDP socket on [%s]:%d on interface '%s'",
+        _name.c_str(), d->ip.c_str(), d->port, _interface[0] == '\0' ? "<default>" : _interface);
+    d->bConnected = true;
+    return VMI_E_OK;
+}
+
+/*!
+* \fn _dest_thread
+* \brief thread of a destination: send the packet lists of its queue, with its own schedule
+*
+* \param d the destination
+*/
+void COutFanout::_dest_thread(Destination* d)
+{
+    while (true) {
+        std::shared_ptr<CUDPPacketList> list = d->queue.pop();
+        if (!list)
+            break;
+        if (!d->sock->isValid() && _open(d) != VMI_E_OK)
+            continue;
+        if (list->send(&d->batch, d->sock) != VMI_E_OK) {
+            LOG_ERROR("%s: failed to send a frame to %s:%d, the socket is opened again", _name.c_str(), d->ip.c_str(), d->port);
+            d->errors++;
+            d->bConnected = false;
+            d->sock->closeSocket();
+            continue;
+        }
+        d->sent++;
+    }
+}
+
+/*!
+* \fn prepare
+* \brief smpte format: insert the content of the frame in the SMPTE frame being prepared
+*
+* \param frame frame to prepare
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int COutFanout::prepare(CvMIFrame* frame)
+{
+    if (frame == NULL || frame->getFrameBuffer() == NULL)
+        return VMI_E_INVALID_FRAME;
+    if (_streamer)
+        return _streamer->prepare(frame);
+    return VMI_E_OK;
+}
+
+int COutFanout::send(CvMIFrame* frame)
+{
+    if (_dests.empty())
+        return -1;
+
+    // Packetize the frame once, in a list shared by the destinations
+    std::shared_ptr<CUDPPacketList> list = _get_list();
+    list->clear();
+    int result;
+    if (_streamer) {
+        _streamer->setCapture(list.get());
+        result = _streamer->send(frame);
+    }
+    else {
+        _packetizer.setCapture(list.get());
+        _packetizer.setFramePeriod(_get_frame_period(frame->getMediaHeaders()));
+        result = _packetizer.send(NULL, (char*)frame->getFrameBuffer(), frame->getFrameSize());
+    }
+    if (result != VMI_E_OK) {
+        LOG_ERROR("%s: failed to packetize the frame", _name.c_str());
+        return -1;
+    }
+    if (list->getNbPackets() == 0)
+        return 0;       // no SMPTE frame completed by this frame
+
+    // Queue it on each destination: a late one loses its oldest frame
+    long long now = 0;
+    for (std::unique_ptr<Destination>& d : _dests) {
+        if (d->queue.push(list) != RING_PUSHED_DROP_OLDEST)
+            continue;
+        if (now == 0)
+            now = tools::getCurrentTimeInMilliS();
+        if (now - d->lastWarning >= FANOUT_WARNING_MS) {
+            RingQueueStats stats;
+            d->queue.getStats(&stats);
+            LOG_WARNING("%s: %s:%d can't keep up, %llu frames dropped", _name.c_str(), d->ip.c_str(), d->port, stats.dropped);
+            d->lastWarning = now;
+        }
+    }
+    return 0;
+}
+
+bool COutFanout::isConnected()
+{
+    for (std::unique_ptr<Destination>& d : _dests) {
+        if (d->bConnected)
+            return true;
+    }
+    return false;
+}
+
+PIN_REGISTER(COutFanout, "fanout");
@@ -2,6 +2,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <pins/pinfactory.h>
 #include "common.h"
 #include "log.h"
@@ -9,8 +11,13 @@
 #include "tcp_basic.h"
 #include "out.h"
 #include "configurable.h"
+#include "libvMI_int.h"
 using namespace std;
 
+#define TCP_ZEROCOPY_DEFAULT_IN_FLIGHT  2       /* frames sent with MSG_ZEROCOPY and not completed */
+#define TCP_ZEROCOPY_TIMEOUT_MS         5000    /* max wait for the completion of a frame */
+#define TCP_ZEROCOPY_COMPLETIONS        64      /* completions read at once */
+
 /**********************************************************************************************
 *
 * COutSocket
@@ -23,12 +30,79 @@ COutTCP::COutTCP(CModuleConfiguration* pMainCfg, int nIndex) : COut(pMainCfg, nI
     PROPERTY_REGISTER_OPTIONAL("ip", _ip, "");
     PROPERTY_REGISTER_MANDATORY("port", _port, -1);
     PROPERTY_REGISTER_OPTIONAL("interface", _interface, "");
+    PROPERTY_REGISTER_OPTIONAL("zerocopy", _zeroCopy, false);
+    PROPERTY_REGISTER_OPTIONAL("inflight", _maxInFlight, TCP_ZEROCOPY_DEFAULT_IN_FLIGHT);
     _isListen   = (_ip[0]=='\0');
+    if (_maxInFlight < 1)
+        _maxInFlight = 1;
+    if (_zeroCopy)
+        _tcpSock.enableZeroCopy();
 }
 
 COutTCP::~COutTCP() {
 
+    // Let the kernel send the frames in flight before their release
+    _wait_in_flight(0);
     _tcpSock.closeSocket();
+    _release_in_flight();
+}
+
+/*!
+* \fn _reap_completions
+* \brief read the zero copy completions, and release the frames completely sent
+*
+* \param timeoutMs time to wait for a completion, 0 to return at once
+* \return nb of completions read
+*/
+int COutTCP::_reap_completions(int timeoutMs) {
+
+    unsigned int first[TCP_ZEROCOPY_COMPLETIONS], last[TCP_ZEROCOPY_COMPLETIONS];
+    int count = _tcpSock.readZeroCopyCompletions(first, last, TCP_ZEROCOPY_COMPLETIONS, timeoutMs);
+    for (int i = 0; i < count; i++) {
+        for (InFlight& f : _inFlight) {
+            // Part of the range [first, last] of ids of the frame, the ids wrap around
+            int lo = std::max((int)(first[i] - f.firstId), 0);
+            int hi = std::min((int)(last[i] - f.firstId), f.nbIds - 1);
+            if (hi >= lo)
+                f.pendingIds -= hi - lo + 1;
+        }
+    }
+    while (!_inFlight.empty() && _inFlight.front().pendingIds <= 0) {
+        if (_inFlight.front().handle != LIBVMI_INVALID_HANDLE)
+            libvmi_frame_release(_inFlight.front().handle);
+        _inFlight.pop_front();
+    }
+    return count;
+}
+
+/*!
+* \fn _wait_in_flight
+* \brief wait until there are maxInFlight frames in flight at most
+*
+* \param maxInFlight nb of frames
+* \return VMI_E_OK if Ok, VMI_E_ERROR if the completions didn't come
+*/
+int COutTCP::_wait_in_flight(int maxInFlight) {
+
+    auto start = std::chrono::steady_clock::now();
+    _reap_completions(0);
+    while ((int)_inFlight.size() > maxInFlight && _tcpSock.isValid()) {
+        if (_reap_completions(100) == 0 &&
+            std::chrono::steady_clock::now() - start > std::chrono::milliseconds(TCP_ZEROCOPY_TIMEOUT_MS)) {
+            LOG_ERROR("%s: no completion of the zero copy sends for %d ms", _name.c_str(), TCP_ZEROCOPY_TIMEOUT_MS);
+            return VMI_E_ERROR;
+        }
+    }
+    return VMI_E_OK;
+}
+
+void COutTCP::_release_in_flight() {
+
+    for (InFlight& f : _inFlight) {
+        if (f.handle != LIBVMI_INVALID_HANDLE)
+            libvmi_frame_release(f.handle);
+    }
+    _inFlight.clear();
 }
 
 int COutTCP::send(CvMIFrame* frame) {
@@ -58,12 +132,34 @@ int COutTCP::send(CvMIFrame* frame) {
     //
     if (_tcpSock.isValid()) {
 
-        int result = frame->sendToTCP(&_tcpSock);
+        // A frame in the socket buffer: sent without waiting for the application
+        _tcpSock.setBufferSize(frame->getFrameSize() * (_zeroCopy ? _maxInFlight : 1), 0);
+        if (_tcpSock.isZeroCopy() && _wait_in_flight(_maxInFlight - 1) != VMI_E_OK)
+            _tcpSock.closeSocket();
+
+        unsigned int firstId = 0;
+        int nbIds = 0;
+        int result = (_tcpSock.isValid() ? frame->sendToTCP(&_tcpSock, &firstId, &nbIds) : VMI_E_FAILED_TO_SND_SOCKET);
+        if (nbIds > 0) {
+            // Keep the frame until the kernel has sent it, or wait for it if it can't be referenced
+            InFlight f;
+            f.handle = libvMI_frame_get_handle(frame);
+            if (f.handle != LIBVMI_INVALID_HANDLE && libvmi_frame_addref(f.handle) < 0)
+                f.handle = LIBVMI_INVALID_HANDLE;
+            f.firstId = firstId;
+            f.nbIds = nbIds;
+            f.pendingIds = nbIds;
+            _inFlight.push_back(f);
+            if (f.handle == LIBVMI_INVALID_HANDLE)
+                _wait_in_flight(0);
+        }
         if (result != VMI_E_OK) {
             LOG_ERROR("%s: error when send frame", _name.c_str());
             _tcpSock.closeSocket();
             ret = -1;
         }
+        if (!_tcpSock.isValid())
+            _release_in_flight();
     }
 
     return ret;
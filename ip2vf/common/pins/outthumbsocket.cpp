@@ -2,13 +2,13 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <chrono>
 
 #include "common.h"
 #include "log.h"
 #include "tools.h"
 #include "tcp_basic.h"
 #include "out.h"
-#include "yuv.h"
 #include <pins/pinfactory.h>
 #include "configurable.h"
 
@@ -32,53 +32,92 @@ COutThumbSocket::COutThumbSocket(CModuleConfiguration* pMainCfg, int nIndex) : C
     _isListen = (_ip[0] == '\0');
     _last_time = 0.0f;
     _frame_rate = 1.0f / (float)_fps;
-    _rgb_buffer = NULL;
+    _pending = -1;
+    _sending = -1;
+    _bExit = false;
 
     if (_depth < 3 || _depth>4) {
         LOG_ERROR("%s: ***ERROR*** invalid output pixel depth=%d. Must be 3 (rgb) or 4 (argb)", _name.c_str(), _depth);
     }
 
+    _th_send = std::thread([this] { _send_thread(); });
 }
 
 COutThumbSocket::~COutThumbSocket()
 {
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _bExit = true;
+    }
+    _cv.notify_all();
+    // Unlock any blocking accept() or writeSocket() of the sender thread
     _tcpSock.closeSocket();
-    if (_rgb_buffer != NULL)
-        delete[] _rgb_buffer;
+    if (_th_send.joinable())
+        _th_send.join();
 }
-/*
-void convertYUV8ToRGB(unsigned char* src, int src_w, int src_h, unsigned char* dest, int factor, int depth) {
-    LOG("-->");
-    int dst_w = src_w / factor;
-    int dst_h = src_h / factor;
-    int nDstFullLine = dst_w * depth;
-    int nSrcFullLine = src_w * 2;
-    //LOG_INFO("factor=%d, dst_w=%d, dst_h=%d, nDstFullLine=%d, depth=%d", factor, dst_w, dst_h, nDstFullLine, depth);
-    for (int y = 0; y < dst_h; y += 1)
-        for (int x = 0; x < dst_w; x += 1) {
-            unsigned char* out = dest + y * nDstFullLine + x * depth;
-            unsigned char* in = src + y * factor * nSrcFullLine + x * factor * 2;
-            YCbCr2RGBA((char*)out, (char*)in, 1);
-        }
-    LOG("<--");
+
+/*!
+* \fn _open_socket
+* \brief open the listening or connected TCP socket of the pin
+*
+* \return E_OK if Ok, error code otherwise
+*/
+int COutThumbSocket::_open_socket()
+{
+    int result;
+    if (_isListen)
+        result = _tcpSock.openSocket((char*)C_INADDR_ANY, _port, _interface);
+    else
+        result = _tcpSock.openSocket(_ip, _port, _interface);
+    if (result != E_OK)
+        LOG("%s: can't create %s TCP socket on [%s]:%d on interface '%s'",
+            _name.c_str(), (_isListen ? "listening" : "connected"), (_isListen ? "NULL" : _ip), _port, _interface[0] == '\0' ? "<default>" : _interface);
+    else
+        LOG_INFO("%s: Ok to create %s TCP socket on [%s]:%d on interface '%s'",
+            _name.c_str(), (_isListen ? "listening" : "connected"), (_isListen ? "NULL" : _ip), _port, _interface[0] == '\0' ? "<default>" : _interface);
+    return result;
 }
 
-void convertRGBAToRGB(unsigned char* src, int src_w, int src_h, unsigned char* dest, int factor, int depth) {
-    LOG_INFO("-->");
-    int dst_w = src_w / factor;
-    int dst_h = src_h / factor;
-    int nDstFullLine = dst_w * depth;
-    int nSrcFullLine = src_w * 4;
-    //LOG_INFO("nFactorW=%d, nFactorH=%d, nRGBFullLine=%d, nYUV8FullLine=%d", nFactorW, nFactorH, nRGBFullLine, nYUV8FullLine);
-    for (int y = 0; y < dst_h; y += 1)
-        for (int x = 0; x < dst_w; x += 1) {
-            unsigned char* out = dest + y * nDstFullLine + x * depth;
-            unsigned char* in = src + y * factor * nSrcFullLine + x * factor * 4;
-            memcpy(out, in, depth);
+/*!
+* \fn _send_thread
+* \brief connect, then send the thumbnails given by send() until the pin is deleted
+*/
+void COutThumbSocket::_send_thread()
+{
+    LOG_INFO("%s: -->", _name.c_str());
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (!_bExit) {
+        if (!_tcpSock.isValid()) {
+            lock.unlock();
+            int result = _open_socket();
+            lock.lock();
+            if (result != E_OK) {
+                // Retry at the thumbnails rate
+                _cv.wait_for(lock, std::chrono::duration<float>(_frame_rate), [this] { return _bExit; });
+            }
+            continue;
         }
-    LOG_INFO("<--");
+
+        _cv.wait(lock, [this] { return _bExit || _pending != -1; });
+        if (_bExit)
+            break;
+        _sending = _pending;
+        _pending = -1;
+        lock.unlock();
+
+        std::vector<unsigned char>& buffer = _buffers[_sending];
+        int len = (int)buffer.size();
+        int result = _tcpSock.writeSocket((char*)buffer.data(), &len);
+        LOG("%s: write %d/%d bytes to '%s:%d', result=%d", _name.c_str(), len, (int)buffer.size(), _ip, _port, result);
+        if (result != E_OK || len == 0)
+            _tcpSock.closeSocket();
+
+        lock.lock();
+        _sending = -1;
+    }
+    LOG_INFO("%s: <--", _name.c_str());
 }
-*/
+
 int COutThumbSocket::send(CvMIFrame* frame)
 {
     if (frame == NULL) {
@@ -89,7 +128,6 @@ int COutThumbSocket::send(CvMIFrame* frame)
     unsigned char* buffer = frame->getFrameBuffer();
 
     LOG("%s: --> <--", _name.c_str());
-    int result = E_OK;
     int ret = 0;
 
     if (buffer == NULL) {
@@ -97,89 +135,72 @@ int COutThumbSocket::send(CvMIFrame* frame)
         return ret;
     }
 
-    //
-    // Manage the connection
-    //
     if (!_tcpSock.isValid()) {
-        if (_isListen)
-            result = _tcpSock.openSocket((char*)C_INADDR_ANY, _port, _interface);
-        else
-            result = _tcpSock.openSocket(_ip, _port, _interface);
-        if (result != E_OK)
-            LOG("%s: can't create %s TCP socket on [%s]:%d on interface '%s'",
-                _name.c_str(), (_isListen ? "listening" : "connected"), (_isListen ? "NULL" : _ip), _port, _interface[0] == '\0' ? "<default>" : _interface);
-        else
-            LOG_INFO("%s: Ok to create %s TCP socket on [%s]:%d on interface '%s'",
-                _name.c_str(), (_isListen ? "listening" : "connected"), (_isListen ? "NULL" : _ip), _port, _interface[0] == '\0' ? "<default>" : _interface);
+        LOG("%s: ***ERROR*** can't send frame, socket not connected", _name.c_str());
+        return -1;
     }
 
-    //
-    // Manage data
-    //
-    if (_tcpSock.isValid()) {
-        double currentTime = tools::getCurrentTimeInS();
-        if ((currentTime - _last_time) > _frame_rate)
-        {
-            // Get Headers to identify the internal sampling format
-            CFrameHeaders* headers = frame->getMediaHeaders();
-            if (_firstFrame) {
-                LOG_INFO("dump headers:");
-                headers->DumpHeaders();
-                _firstFrame = false;
-            }
-            SAMPLINGFMT fmt = headers->GetSamplingFmt();
-            int depth = headers->GetDepth();
-            _frame_w = headers->GetW();
-            _frame_h = headers->GetH();
-            if (_frame_w > 4096 || _frame_h > 4096) {
-                LOG_ERROR("unsupported format readed from internal headers: w=%d, h=%d", _frame_w, _frame_h);
-                ret = -1;
-            }
-            else {
-                int offset = CFrameHeaders::GetHeadersLength();
-                if (_frame_w == 0 || _frame_h == 0) {
-                    LOG_ERROR("improper parameters read from ip2vf headers... frame_w=%d, frame_h=%d", _frame_w, _frame_h);
-                    LOG_ERROR("abort!");
-                    exit(0);
-                }
-                LOG("Conversion from %dx%d to %dx%d, fmt=%d to RGB(A) %d bytes", _frame_w, _frame_h, (_frame_w / _ratio), (_frame_h / _ratio), fmt, _depth);
-                if (_rgb_buffer == NULL) {
-                    int mediasize = (_frame_w / _ratio) * (_frame_h / _ratio) * _depth;
-                    _rgb_buffer_len = mediasize + offset;
-                    LOG_INFO("%s: allocate buffer of %d bytes for thumbnails+headers", _name.c_str(), _rgb_buffer_len);
-                    _rgb_buffer = new unsigned char[_rgb_buffer_len];  // rgb buffer size + headers length
-                    CFrameHeaders fh;
-                    fh.CopyHeaders(headers);
-                    fh.SetW(_frame_w / _ratio);
-                    fh.SetH(_frame_h / _ratio);
-                    fh.SetMediaSize(mediasize);
-                    fh.SetMediaFormat(MEDIAFORMAT::VIDEO);
-                    fh.SetSamplingFmt(_depth == 3 ? SAMPLINGFMT::BGR : SAMPLINGFMT::BGRA);
-                    fh.WriteHeaders(_rgb_buffer, 0);
-                }
-                // Extract RGB thumbnail
-                if (fmt == SAMPLINGFMT::YCbCr_4_2_2 && depth == 8)
-                    tools::convertYUV8ToRGB(frame->getMediaBuffer(), _frame_w, _frame_h, _rgb_buffer + offset, _ratio, _depth);
-                else if (fmt == SAMPLINGFMT::RGBA)
-                    tools::convertRGBAToRGB(frame->getMediaBuffer(), _frame_w, _frame_h, _rgb_buffer + offset, _ratio, _depth);
-                else
-                    LOG_ERROR("Conversion not supported: fmt=%d %dbits to RGB(A) bytes (from %dx%d to %dx%d)", fmt, _depth, _frame_w, _frame_h, (_frame_w / _ratio), (_frame_h / _ratio));
-                // Send it
-                int len = _rgb_buffer_len;
-                result = _tcpSock.writeSocket((char*)_rgb_buffer, &len);
-                LOG("%s: write %d/%d bytes to '%s:%d', result=%d", _name.c_str(), len, frame->getFrameSize(), _ip, _port, result);
-                if (result != E_OK || len == 0) {
-                    _tcpSock.closeSocket();
-                    ret = -1;
-                }
-            }
-            _last_time = currentTime;
+    double currentTime = tools::getCurrentTimeInS();
+    if ((currentTime - _last_time) <= _frame_rate)
+        return ret;
+    _last_time = currentTime;
+
+    // Get Headers to identify the internal sampling format
+    CFrameHeaders* headers = frame->getMediaHeaders();
+    if (_firstFrame) {
+        LOG_INFO("dump headers:");
+        headers->DumpHeaders();
+        _firstFrame = false;
+    }
+    SAMPLINGFMT fmt = headers->GetSamplingFmt();
+    int depth = headers->GetDepth();
+    COLORIMETRY colorimetry = headers->GetColorimetry();
+    int frame_w = headers->GetW();
+    int frame_h = headers->GetH();
+    if (frame_w > 4096 || frame_h > 4096 || frame_w == 0 || frame_h == 0) {
+        LOG_ERROR("unsupported format readed from internal headers: w=%d, h=%d", frame_w, frame_h);
+        return -1;
+    }
+    if (!_scaler.isConfigured(frame_w, frame_h, fmt, depth, colorimetry)) {
+        if (_scaler.configure(frame_w, frame_h, fmt, depth, colorimetry, _ratio, _depth) != VMI_E_OK) {
+            LOG_ERROR("Conversion not supported: fmt=%d %dbits to RGB(A) %d bytes (from %dx%d, ratio %d)", fmt, depth, _depth, frame_w, frame_h, _ratio);
+            return -1;
         }
     }
-    else {
-        LOG("%s: ***ERROR*** can't send frame, socket not connected", _name.c_str());
-        ret = -1;
+
+    // Fill a buffer which is neither pending nor being sent
+    int index = 0;
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        while (index == _pending || index == _sending)
+            index++;
+    }
+    std::vector<unsigned char>& thumb = _buffers[index];
+    int offset = CFrameHeaders::GetHeadersLength();
+    int mediasize = _scaler.getSize();
+    if ((int)thumb.size() != mediasize + offset) {
+        LOG_INFO("%s: allocate buffer of %d bytes for thumbnails+headers", _name.c_str(), mediasize + offset);
+        thumb.resize(mediasize + offset);
+    }
+    CFrameHeaders fh;
+    fh.CopyHeaders(headers);
+    fh.SetW(_scaler.getWidth());
+    fh.SetH(_scaler.getHeight());
+    fh.SetMediaSize(mediasize);
+    fh.SetMediaFormat(MEDIAFORMAT::VIDEO);
+    fh.SetSamplingFmt(_depth == 3 ? SAMPLINGFMT::BGR : SAMPLINGFMT::BGRA);
+    fh.WriteHeaders(thumb.data(), 0);
+
+    LOG("Conversion from %dx%d to %dx%d, fmt=%d to RGB(A) %d bytes", frame_w, frame_h, _scaler.getWidth(), _scaler.getHeight(), fmt, _depth);
+    if (_scaler.process(frame->getMediaBuffer(), frame->getMediaSize(), thumb.data() + offset) != VMI_E_OK)
+        return -1;
+
+    // Give it to the sender thread, in place of the previous one if not taken yet
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _pending = index;
     }
+    _cv.notify_one();
 
     return ret;
 }
@@ -1,6 +1,8 @@
 #ifndef _PktTS_H
 #define _PktTS_H
 
+#include "queue.h"
+
 typedef long long Time;
 
 typedef struct pktTSaggr pktTSaggr;
@@ -34,6 +36,9 @@ public:
 
     virtual int openSocket(const char*, const char*, int, bool, const char* = 0);
     virtual int readSocket(char*, int*);
+    virtual int enableBatchReceive(int = UDP_RXRING_DEFAULT_PACKETS, bool = false){
+        return E_OK;                /* per-packet timestamps and probe hooks */
+    };
     virtual void pktTSctl(int, unsigned int = 0, Time = 0);
 
     PinConfiguration* getConfiguration(void){
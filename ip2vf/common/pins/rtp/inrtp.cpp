@@ -9,6 +9,7 @@
 #include "tools.h"
 #include "tcp_basic.h"
 #include "rtpframe.h"
+#include "workerpool.h"
 
 using namespace std;
 
@@ -30,7 +31,16 @@ CInRTP::CInRTP(CModuleConfiguration* pMainCfg, int nIndex) : CIn(pMainCfg, nInde
     PROPERTY_REGISTER_OPTIONAL("mcastgroup", _mcastgroup, "");
     PROPERTY_REGISTER_OPTIONAL("interface", _interface,"");
     PROPERTY_REGISTER_OPTIONAL("ip", _ip, "");
+    PROPERTY_REGISTER_OPTIONAL("rxbatch", _rxBatch, UDP_RXRING_DEFAULT_PACKETS);
+    PROPERTY_REGISTER_OPTIONAL("reorderwindow", _reorderWindow, INRTP_DEFAULT_REORDER_WINDOW);
+    PROPERTY_REGISTER_OPTIONAL("maxlost", _maxLost, 0);
+    PROPERTY_REGISTER_OPTIONAL("conceal", _conceal, false);
+    PROPERTY_REGISTER_OPTIONAL("workers", _nbWorkers, -1);
+    PROPERTY_REGISTER_OPTIONAL("workerscpus", _workersCpus, "");
     _waitForNextFrame = true;
+    _rxContext._reorderWindow = MAX(_reorderWindow, 0);
+    _rxContext._maxLost = MAX(_maxLost, 0);
+    _rxContext._conceal = _conceal;
 #ifdef USE_NETMAP
     if(strncmp(_interface, "netmap-", 7) == 0)
         _udpSock = new Netmap();
@@ -40,6 +50,7 @@ CInRTP::CInRTP(CModuleConfiguration* pMainCfg, int nIndex) : CIn(pMainCfg, nInde
         if((_udpSock = pktTSconstruct(_pConfig)) == 0)              /* PktTS hook */
 #endif
             _udpSock = new UDP();
+    _udpSock->enableBatchReceive(_rxBatch);
 }
 
 CInRTP::~CInRTP() 
@@ -52,6 +63,49 @@ void CInRTP::reset()
 {
 }
 
+/*!
+* \fn _decompress
+* \brief replace the compressed media of a frame by the decoded media, and its headers by the
+*        headers of the uncompressed frame
+*
+* \param frame frame to decompress
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CInRTP::_decompress(CvMIFrame* frame)
+{
+    CFrameHeaders* fh = frame->getMediaHeaders();
+    if (fh->GetCodec() != VMI_CODEC_DPCM) {
+        LOG_ERROR("%s: frame #%d compressed with an unknown codec (%d)", _name.c_str(), fh->GetFrameNumber(), fh->GetCodec());
+        return VMI_E_NOT_SUPPORTED;
+    }
+    if (!_decoder.isConfigured(fh->GetW(), fh->GetH(), fh->GetSamplingFmt(), fh->GetDepth())) {
+        // First compressed frame: the workers are needed from now on
+        CWorkerPool::getInstance()->configure(_nbWorkers, _workersCpus);
+        if (_decoder.configure(fh->GetW(), fh->GetH(), fh->GetSamplingFmt(), fh->GetDepth(), FRAMECODEC_DEFAULT_SLICES) != VMI_E_OK) {
+            LOG_ERROR("%s: can't decode %dx%d frames, format %d, %d bits", _name.c_str(),
+                fh->GetW(), fh->GetH(), (int)fh->GetSamplingFmt(), fh->GetDepth());
+            return VMI_E_NOT_SUPPORTED;
+        }
+    }
+    int rawSize = fh->GetRawMediaSize();
+    if (rawSize != _decoder.getMediaSize()) {
+        LOG_ERROR("%s: frame #%d: media of %d bytes instead of %d", _name.c_str(), fh->GetFrameNumber(), rawSize, _decoder.getMediaSize());
+        return VMI_E_INVALID_FRAME;
+    }
+
+    // The frame buffer receives the decoded media: the compressed one is kept aside, and the
+    // headers are copied as the frame is created again from them
+    int codedSize = frame->getMediaSize();
+    _codedMedia.assign(frame->getMediaBuffer(), frame->getMediaBuffer() + codedSize);
+    CFrameHeaders headers;
+    headers.CopyHeaders(fh);
+    headers.SetCodec(VMI_CODEC_NONE);
+    headers.SetMediaSize(rawSize);
+    headers.SetRawMediaSize(0);
+    frame->createFrameFromHeaders(&headers);
+    return _decoder.decode(_codedMedia.data(), codedSize, frame->getMediaBuffer(), rawSize);
+}
+
 int CInRTP::read(CvMIFrame* frame)
 {
     LOG("%s: --> <--", _name.c_str());
@@ -79,6 +133,7 @@ int CInRTP::read(CvMIFrame* frame)
 
         // It's a new connection... must wait for next frame to allow frame alignement
         _waitForNextFrame = true;
+        _rxContext.reset();
     }
 
     //
@@ -93,10 +148,9 @@ int CInRTP::read(CvMIFrame* frame)
             LOG_INFO("%s: wait for next frame...", _name.c_str());
             int len, result;
             bool bEndOfFrame = false;
-            char packet[RTP_MAX_FRAME_LENGTH];
+            char* packet;
             while (!bEndOfFrame) {
-                len = RTP_MAX_FRAME_LENGTH;
-                result = _udpSock->readSocket((char*)packet, &len);
+                result = _udpSock->readPacket(&packet, &len);
                 if( !_bStarted )
                     return VMI_E_CONNECTION_CLOSED;
                 if (result < 0) {
@@ -112,6 +166,7 @@ int CInRTP::read(CvMIFrame* frame)
                 CRTPFrame frame((unsigned char*)packet, len);
                 if (frame.isEndOfFrame()) {
                     bEndOfFrame = true;
+                    _rxContext.setNextSeq(frame._seq + 1);
                 }
             }
             _waitForNextFrame = false;
@@ -119,19 +174,37 @@ int CInRTP::read(CvMIFrame* frame)
 
         // Create a new vMI frame from the udp input connection
         try {
-            int result = frame->createFrameFromUDP(_udpSock, _nModuleId);
+            unsigned long long repaired = _rxContext._stats.repairedFrames;
+            int result = frame->createFrameFromUDP(_udpSock, _nModuleId, &_rxContext);
             if (result != VMI_E_OK) {
                 if (result == VMI_E_FAILED_TO_RCV_SOCKET || result == VMI_E_CONNECTION_CLOSED)
                     // Not really an error...
                     _udpSock->closeSocket();
-                else
+                else {
                     LOG_ERROR("errors when trying to get vMI frame...");
-                _waitForNextFrame = true;
+                    _rxContext._stats.droppedFrames++;
+                }
+                // No need to wait if the start of the next frame is known (frame dropped because of lost packets)
+                _waitForNextFrame = !_rxContext.isSync();
                 return VMI_E_INVALID_FRAME;
             }
+            if (frame->getMediaHeaders()->GetCodec() != VMI_CODEC_NONE) {
+                // A lost packet breaks the decoding of its slice and of the rest of the frame
+                if (_rxContext._stats.repairedFrames != repaired)
+                    result = VMI_E_INVALID_FRAME;
+                else
+                    result = _decompress(frame);
+                if (result != VMI_E_OK) {
+                    LOG_ERROR("%s: failed to decode the compressed frame, skip it", _name.c_str());
+                    _rxContext._stats.droppedFrames++;
+                    return VMI_E_INVALID_FRAME;
+                }
+            }
         }
         catch (...) {
             LOG_ERROR("Major error when trying to create vMI frame from RTP content... seems data is corrupted. skip this frame!");
+            _rxContext._stats.droppedFrames++;
+            _rxContext.reset();
             _waitForNextFrame = true;
             return VMI_E_INVALID_FRAME;
         }
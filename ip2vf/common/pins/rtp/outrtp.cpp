@@ -9,6 +9,7 @@
 #include "tools.h"
 #include "rtpframe.h"
 #include "tcp_basic.h"
+#include "workerpool.h"
 
 using namespace std;
 
@@ -27,7 +28,32 @@ COutRTP::COutRTP(CModuleConfiguration* pMainCfg, int nIndex) : COut(pMainCfg, nI
     PROPERTY_REGISTER_OPTIONAL("interface", _interface, "");
     PROPERTY_REGISTER_OPTIONAL("mtu", _mtu, 1500);
     PROPERTY_REGISTER_OPTIONAL("mcastgroup", _mcastgroup, "");
+    PROPERTY_REGISTER_OPTIONAL("pacer", _pacerCore, -1);
+    PROPERTY_REGISTER_OPTIONAL("txtime", _txTime, false);
+    PROPERTY_REGISTER_OPTIONAL("codec", _codecName, "none");
+    PROPERTY_REGISTER_OPTIONAL("slices", _nbSlices, FRAMECODEC_DEFAULT_SLICES);
+    PROPERTY_REGISTER_OPTIONAL("workers", _nbWorkers, -1);
+    PROPERTY_REGISTER_OPTIONAL("workerscpus", _workersCpus, "");
     _isMulticast       = !!_mcastgroup[0];
+    _codecId = VMI_CODEC_NONE;
+    if (strcmp(_codecName, "dpcm") == 0)
+        _codecId = VMI_CODEC_DPCM;
+    else if (strcmp(_codecName, "none") != 0)
+        LOG_ERROR("%s: invalid codec '%s', available codecs are 'none' and 'dpcm'", _name.c_str(), _codecName);
+    if (_codecId != VMI_CODEC_NONE) {
+        LOG_INFO("%s: video frames compressed with '%s', %d slices", _name.c_str(), _codecName, _nbSlices);
+        CWorkerPool::getInstance()->configure(_nbWorkers, _workersCpus);
+    }
+    for (int i = 0; i < COUT_STAGES; i++) {
+        _coded[i].size = 0;
+        _coded[i].frameNumber = -1;
+    }
+    _prepareIndex = 0;
+    _sendIndex = 0;
+    _rawBytes = 0;
+    _codedBytes = 0;
+    if (_pacerCore >= 0)
+        _packetizer.setPacer(CTxPacer::getInstance(_pacerCore));
     if( _mtu > RTP_MAX_FRAME_LENGTH ) {
         // TODO: issue
     }
@@ -36,20 +62,122 @@ COutRTP::COutRTP(CModuleConfiguration* pMainCfg, int nIndex) : COut(pMainCfg, nI
 #else
     _udpSock = new UDP();
 #endif
+    _udpSock->enableTxTime(_txTime);
 }
 
 COutRTP::~COutRTP() 
 {
+    if (_codedBytes > 0)
+        LOG_INFO("%s: compression ratio %.2f", _name.c_str(), (double)_rawBytes / _codedBytes);
     _udpSock->closeSocket();
     delete _udpSock;
 }
 
+/*!
+* \fn _compress
+* \brief compress the media of a video frame in a slot of _coded: the headers of the frame, with
+*        the codec and the compressed media size, then the compressed media
+*
+* \param frame frame to compress
+* \param slot slot of _coded, its size is 0 to send the frame as is
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int COutRTP::_compress(CvMIFrame* frame, int slot)
+{
+    CFrameHeaders* fh = frame->getMediaHeaders();
+    _coded[slot].size = 0;
+    _coded[slot].frameNumber = fh->GetFrameNumber();
+    if (fh->GetMediaFormat() != MEDIAFORMAT::VIDEO || fh->GetCodec() != VMI_CODEC_NONE)
+        return VMI_E_OK;
+
+    int mediaSize = frame->getMediaSize();
+    if (!_encoder.isConfigured(fh->GetW(), fh->GetH(), fh->GetSamplingFmt(), fh->GetDepth())) {
+        if (_encoder.configure(fh->GetW(), fh->GetH(), fh->GetSamplingFmt(), fh->GetDepth(), _nbSlices) != VMI_E_OK) {
+            LOG_WARNING("%s: can't compress %dx%d frames, format %d, %d bits: sent uncompressed", _name.c_str(),
+                fh->GetW(), fh->GetH(), (int)fh->GetSamplingFmt(), fh->GetDepth());
+            _codecId = VMI_CODEC_NONE;
+            return VMI_E_OK;
+        }
+    }
+    if (_encoder.getMediaSize() != mediaSize) {
+        LOG_WARNING("%s: media of %d bytes instead of %d, frames sent uncompressed", _name.c_str(), mediaSize, _encoder.getMediaSize());
+        _codecId = VMI_CODEC_NONE;
+        return VMI_E_OK;
+    }
+
+    int headersLength = CFrameHeaders::GetHeadersLength();
+    std::vector<unsigned char>& buffer = _coded[slot].buffer;
+    if ((int)buffer.size() < headersLength + _encoder.getMaxCodedSize())
+        buffer.resize(headersLength + _encoder.getMaxCodedSize());
+    int codedSize = 0;
+    int result = _encoder.encode(frame->getMediaBuffer(), mediaSize, buffer.data() + headersLength,
+        (int)buffer.size() - headersLength, &codedSize);
+    if (result != VMI_E_OK)
+        return result;
+    if (codedSize >= mediaSize)
+        return VMI_E_OK;    // doesn't compress: sent as is
+
+    CFrameHeaders headers;
+    headers.CopyHeaders(fh);
+    headers.SetCodec(_codecId);
+    headers.SetRawMediaSize(mediaSize);
+    headers.SetMediaSize(codedSize);
+    headers.WriteHeaders(buffer.data());
+    _coded[slot].size = headersLength + codedSize;
+    _rawBytes += mediaSize;
+    _codedBytes += codedSize;
+    return VMI_E_OK;
+}
+
+/*!
+* \fn prepare
+* \brief get the headers and the media of the frame in a single buffer, before send() (copy of a
+*        frame referencing an external buffer, e.g. a slot of a shared memory ring), or compress
+*        it if a codec is set
+*
+* \param frame frame to prepare
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int COutRTP::prepare(CvMIFrame* frame) {
+
+    if (frame == NULL)
+        return VMI_E_INVALID_FRAME;
+    if (_codecId == VMI_CODEC_NONE)
+        return (frame->getFrameBuffer() == NULL ? VMI_E_INVALID_FRAME : VMI_E_OK);
+
+    // The compressed frame is a copy: no need to get the frame in a single buffer
+    unsigned int index = _prepareIndex.load(std::memory_order_relaxed);
+    int result = _compress(frame, index % COUT_STAGES);
+    _prepareIndex.store(index + 1, std::memory_order_release);
+    return result;
+}
+
 int COutRTP::send(CvMIFrame* frame) {
 
     //LOG_INFO("%s: --> <--  buffer=0x%x", _name.c_str(), buffer);
     int result = E_OK;
     int ret = 0;
 
+    // Frame compressed by prepare(), if it was called (not when the pin is used directly). Its
+    // slot is consumed even if the frame can't be sent, to stay in step with prepare().
+    int codedSize = 0;
+    unsigned char* coded = NULL;
+    if (_sendIndex != _prepareIndex.load(std::memory_order_acquire)) {
+        int slot = _sendIndex++ % COUT_STAGES;
+        if (_coded[slot].frameNumber != frame->getMediaHeaders()->GetFrameNumber()) {
+            LOG_ERROR("%s: frame #%d compressed for frame #%d, sent uncompressed", _name.c_str(),
+                _coded[slot].frameNumber, frame->getMediaHeaders()->GetFrameNumber());
+        }
+        else if (_coded[slot].size > 0) {
+            codedSize = _coded[slot].size;
+            coded = _coded[slot].buffer.data();
+        }
+    }
+    else if (_codecId != VMI_CODEC_NONE && _compress(frame, 0) == VMI_E_OK && _coded[0].size > 0) {
+        codedSize = _coded[0].size;
+        coded = _coded[0].buffer.data();
+    }
+
     //
     // Manage the connection
     //
@@ -77,7 +205,12 @@ int COutRTP::send(CvMIFrame* frame) {
         frame->get_header(VIDEO_WIDTH, (void*)&p2);
         frame->get_header(VIDEO_HEIGHT, (void*)&p3);
 #endif
-        int result = _packetizer.send(_udpSock, (char*)frame->getFrameBuffer(), frame->getFrameSize());
+        _packetizer.setFramePeriod(_get_frame_period(frame->getMediaHeaders()));
+        int result;
+        if (codedSize > 0)
+            result = _packetizer.send(_udpSock, (char*)coded, codedSize);
+        else
+            result = _packetizer.send(_udpSock, (char*)frame->getFrameBuffer(), frame->getFrameSize());
         if (result != VMI_E_OK) {
             ret = -1;
         }
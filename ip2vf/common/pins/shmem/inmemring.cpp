@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#ifdef _WIN32
+#define _WINSOCKAPI_
+#include <windows.h>
+#endif
+
+#include <pins/pins.h>
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "shmring.h"
+
+using namespace std;
+
+#define SHMRING_READ_TIMEOUT_MS     100     /* max time blocked on the ring, to check the stop flag */
+#define SHMRING_OPEN_RETRY_MS       500     /* delay between two tries to open the ring */
+
+/**********************************************************************************************
+*
+* CInMemRing
+*
+***********************************************************************************************/
+
+CInMemRing::CInMemRing(CModuleConfiguration* pMainCfg, int nIndex)
+    : CIn(pMainCfg, nIndex)
+{
+    LOG("%s: -->", _name.c_str());
+
+    _nType      = PIN_TYPE_SHMEM_RING;
+    _firstFrame = true;
+    _bStop      = false;
+
+    PROPERTY_REGISTER_MANDATORY("control",  _shm_key,  -1);
+    PROPERTY_REGISTER_OPTIONAL( "zerocopy", _zerocopy, 1);
+
+    if (_shm_key <= 0) {
+        LOG_ERROR("%s: ***ERROR*** invalid parameter: control=%d. aborting", _name.c_str(), _shm_key);
+        exit(1);
+    }
+
+    LOG("%s: <--", _name.c_str());
+}
+
+CInMemRing::~CInMemRing()
+{
+    // The ring is detached when the last frame that reference it is released
+    _ring.reset();
+}
+
+/*!
+* \fn read
+* \brief Wait for the next vMI frame on the shared memory ring
+*
+* \param frame vMI frame to fill
+* \return VMI_E_OK if success
+*/
+int CInMemRing::read(CvMIFrame* frame)
+{
+    if (frame == NULL)
+        return VMI_E_INVALID_PARAMETER;
+
+    while (!_bStop) {
+
+        //
+        // Manage the ring: open it, or switch on the new one if the producer re-created it
+        //
+
+        if (!_ring || _ring->isClosed()) {
+            std::shared_ptr<CShmRing> ring = std::make_shared<CShmRing>();
+            if (ring->open(_shm_key) != VMI_E_OK) {
+                _ring.reset();
+                std::this_thread::sleep_for(std::chrono::milliseconds(SHMRING_OPEN_RETRY_MS));
+                continue;
+            }
+            LOG_INFO("%s: Ok to open shmem ring with key=%d (zerocopy=%d)", _name.c_str(), _shm_key, _zerocopy);
+            _ring = ring;
+        }
+
+        //
+        // Manage the data
+        //
+
+        int result = _ring->read(frame, _nModuleId, (_zerocopy == 1), SHMRING_READ_TIMEOUT_MS);
+        if (result == VMI_E_RING_TIMEOUT || result == VMI_E_RING_NOT_READY)
+            continue;
+        if (result == VMI_E_OK && _firstFrame) {
+            LOG_INFO("Dump received IP2vf headers:");
+            CFrameHeaders* headers = frame->getMediaHeaders();
+            headers->DumpHeaders();
+            _firstFrame = false;
+        }
+        return result;
+    }
+
+    return VMI_E_CONNECTION_CLOSED;
+}
+
+void CInMemRing::start()
+{
+    LOG("%s: -->", _name.c_str());
+
+    _bStop = false;
+    CIn::start();
+
+    LOG("%s: <--", _name.c_str());
+}
+
+void CInMemRing::stop()
+{
+    // read() check the stop flag at least each SHMRING_READ_TIMEOUT_MS
+    _bStop = true;
+    CIn::stop();
+}
+
+PIN_REGISTER(CInMemRing, "shmem_ring");
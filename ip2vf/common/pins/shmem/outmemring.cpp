@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#ifdef _WIN32
+#define _WINSOCKAPI_
+#include <windows.h>
+#endif
+
+#include <pins/pins.h>
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "shmring.h"
+
+using namespace std;
+
+/**********************************************************************************************
+*
+* COutMemRing
+*
+***********************************************************************************************/
+
+COutMemRing::COutMemRing(CModuleConfiguration* pMainCfg, int nIndex)
+    : COut(pMainCfg, nIndex)
+{
+    LOG("%s: -->", _name.c_str());
+
+    _nType      = PIN_TYPE_SHMEM_RING;
+    _firstFrame = true;
+
+    // Keep parameters
+    PROPERTY_REGISTER_MANDATORY("control", _shm_key, -1);
+    PROPERTY_REGISTER_OPTIONAL( "slots",   _nbSlots, SHMRING_DEFAULT_SLOTS);
+
+    if (_shm_key <= 0 || _nbSlots <= 0 || _nbSlots > SHMRING_MAX_SLOTS) {
+        LOG_ERROR("%s: ***ERROR*** invalid parameter: control=%d, slots=%d. aborting", _name.c_str(), _shm_key, _nbSlots);
+        exit(1);
+    }
+
+    LOG("%s: <--", _name.c_str());
+}
+
+COutMemRing::~COutMemRing()
+{
+    LOG("%s: -->", _name.c_str());
+
+    // Consumers keep their own attachment to the segment until their frames are released
+    _ring.reset();
+
+    LOG("%s: <--", _name.c_str());
+}
+
+/*!
+* \fn send
+* \brief Publish a vMI frame on the shared memory ring
+*
+* \param frame vMI frame to send
+* \return E_OK if success
+*/
+int COutMemRing::send(CvMIFrame* frame)
+{
+    LOG("%s: --> frame=0x%x, size=%d", _name.c_str(), frame, (frame ? frame->getFrameSize() : -1));
+
+    if (frame == NULL)
+        return E_ERROR;
+
+    //
+    // Manage the ring, if needed
+    //
+
+    if (!_ring || frame->getFrameSize() > _ring->getSlotSize()) {
+
+        // Closing the previous ring tells the consumers to switch on the new one
+        _ring.reset();
+        std::shared_ptr<CShmRing> ring = std::make_shared<CShmRing>();
+        LOG_INFO("%s: create shmem ring with key=%d, %d slots of %d bytes", _name.c_str(), _shm_key, _nbSlots, frame->getFrameSize());
+        if (ring->create(_shm_key, _nbSlots, frame->getFrameSize()) != VMI_E_OK) {
+            LOG_ERROR("%s: ***ERROR*** failed to create shmem ring with key=%d", _name.c_str(), _shm_key);
+            return E_ERROR;
+        }
+        _ring = ring;
+    }
+
+    if (_firstFrame) {
+        LOG_INFO("Dump output IP2vf headers:");
+        CFrameHeaders* headers = frame->getMediaHeaders();
+        headers->DumpHeaders();
+        _firstFrame = false;
+    }
+
+    //
+    // Propagate data
+    //
+
+    int result = _ring->write(frame);
+    if (result == VMI_E_RING_SLOT_BUSY) {
+        // The consumers still use all the slots: drop this frame rather than wait for them
+        LOG("%s: all the slots busy, drop the frame", _name.c_str());
+        return E_ERROR;
+    }
+    else if (result != VMI_E_OK) {
+        LOG_ERROR("%s: ***ERROR*** failed to write frame on shmem ring, result=%d", _name.c_str(), result);
+        return E_ERROR;
+    }
+
+    LOG("%s: <-- ", _name.c_str());
+    return E_OK;
+}
+
+bool COutMemRing::isConnected()
+{
+    return (_ring && _ring->isValid());
+}
+
+PIN_REGISTER(COutMemRing, "shmem_ring");
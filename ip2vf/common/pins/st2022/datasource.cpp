@@ -12,6 +12,7 @@
 #include "log.h"
 #include "tools.h"
 #include "datasource.h"
+#include "rtpframe.h"
 #include "moduleconfiguration.h"
 #include "configurable.h"
 using namespace std;
@@ -19,6 +20,30 @@ using namespace std;
 CDMUXDataSource::CDMUXDataSource() : _pConfig(nullptr), _type(DataSourceType::TYPE_SOCKET){
 }
 
+/*!
+* \fn readScatter
+* \brief read one packet, then copy its headers and its payload at their destination
+*
+* \param packets destinations of the packets, only the first one is used
+* \param nbPackets nb of packets to receive at most
+* \return nb of packets received (1), or read() result if <= 0
+*/
+int CDMUXDataSource::readScatter(UDPScatter* packets, int nbPackets)
+{
+    char packet[RTP_MAX_FRAME_LENGTH];
+    if (nbPackets <= 0)
+        return 0;
+    int len = read(packet, sizeof(packet));
+    if (len <= 0)
+        return len;
+    memcpy(packets[0].header, packet, MIN(len, packets[0].headerLen));
+    if (len > packets[0].headerLen && packets[0].payloadLen > 0)
+        memcpy(packets[0].payload, packet + packets[0].headerLen, MIN(len - packets[0].headerLen, packets[0].payloadLen));
+    packets[0].len = len;
+    packets[0].timestamp = 0;
+    return 1;
+}
+
 CDMUXDataSource* CDMUXDataSource::create(PinConfiguration *pconfig)
 {
     CDMUXDataSource* source = NULL;
@@ -49,6 +74,8 @@ CDMUXDataSource* CDMUXDataSource::create(PinConfiguration *pconfig)
     else if (dsPin._port > -1 && dsPin._dpdk > -1)
         source = new CDPDKDataSource();
 #endif // _USE_LIBEGEL
+    else if (dsPin._filename != NULL && (tools::endsWith(dsPin._filename, ".pcap") || tools::endsWith(dsPin._filename, ".pcapng")))
+        source = new CPcapDataSource();
     else if (dsPin._filename != NULL && strlen(dsPin._filename) > 0)
         source = new CFileDataSource();
     else if (dsPin._port > -1 && dsPin._port2 > -1)
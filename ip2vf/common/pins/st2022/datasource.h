@@ -6,10 +6,18 @@
 #include <mutex>
 #include <chrono>
 
-#include "queue.h"
+#include "ringqueue.h"
 #include "circularbuffer.h"
 #include "tcp_basic.h"
 #include "moduleconfiguration.h"
+#include "vmiframe.h"
+
+/* Packet handed out without copy by a burst capable source (see readBurst) */
+struct DataSourcePacket {
+    const char* data;       /* RTP packet, headers included. Valid until releaseBurst() */
+    int         len;        /* size of the packet */
+    void*       handle;     /* buffer of the packet, private to the source */
+};
 
 enum DataSourceType {
     TYPE_UNDEFINED = -1,  // No type
@@ -55,6 +63,21 @@ public:
     virtual int  read(char* buffer, int size) = 0;
     virtual void waitForNextFrame() = 0;
     virtual void close() = 0;
+
+    // Receive packets with their payload at its final place (see UDP::readScatter). By default, one
+    // packet is read then copied
+    virtual int  readScatter(UDPScatter* packets, int nbPackets);
+
+    // Framerate of the stream, for the sources which have to pace it (files)
+    virtual void setFrameRate(float fps) {};
+
+    // Receive a burst of packets left in the source buffers (no copy), to be given back with
+    // releaseBurst() once processed. Only for the sources where isBurstCapable()
+    virtual bool isBurstCapable() { return false; };
+    virtual int  readBurst(DataSourcePacket* packets, int nbPackets) { return VMI_E_NOT_SUPPORTED; };
+    virtual void releaseBurst(DataSourcePacket* packets, int nbPackets) {};
+    // Counters of the legs of a SMPTE ST 2022-7 source, NULL for the other sources
+    virtual const vMISPSStats* getSPSStats() { return NULL; };
 };
 
 /**********************************************************************************************
@@ -80,7 +103,7 @@ public:
 
 public:
 
-    void setFrameRate(float fps);
+    virtual void setFrameRate(float fps);
 
     void init(PinConfiguration *pconfig);
     int  read(char* buffer, int size);
@@ -114,7 +137,7 @@ public:
 
 public:
 
-    void setFrameRate(float fps);
+    virtual void setFrameRate(float fps);
 
     void init(PinConfiguration *pconfig);
     int  read(char* buffer, int size);
@@ -122,6 +145,82 @@ public:
     void close();
 };
 
+/**********************************************************************************************
+*
+* CPcapDataSource: class for pcap/pcapng capture file source
+*
+* The file is memory mapped and its records are parsed (Ethernet with VLAN tags, Linux cooked,
+* raw IP or loopback link, IPv4/IPv6, UDP), so the UDP payloads of the selected flow are handed
+* out without copy. The replay follows the capture timestamps of each packet, scaled by "speed"
+* (1 for real time, N for N times faster, 0 for max speed).
+*
+***********************************************************************************************/
+
+#define PCAP_MAX_INTERFACES     32      /* max nb of pcapng interfaces */
+
+class CPcapDataSource : public CDMUXDataSource
+{
+protected:
+    struct Interface {
+        int         linkType;           /* LINKTYPE_xxx of the captured packets */
+        long long   tsUnitsPerSec;      /* timestamp resolution, 10^-n only */
+        bool        tsPow2;             /* resolution is 2^-n instead of 10^-n */
+        int         tsExponent;         /* n */
+    };
+
+    const char*     _filename;
+    float           _speed;             /* replay speed: 1 for real time, 0 for max speed */
+    int             _dstPort;           /* UDP dst port filter, -1 for any */
+    const char*     _dstIp;             /* IPv4/IPv6 dst address (multicast group) filter, "" for any */
+    bool            _loop;              /* restart at the beginning of the file at EOF */
+
+    unsigned char   _filterAddr[16];
+    int             _filterAddrLen;     /* 0 (no filter), 4 or 16 */
+
+    unsigned char*  _map;               /* file mapping */
+    long long       _mapSize;
+#ifdef _WIN32
+    HANDLE          _hFile;
+    HANDLE          _hMapping;
+#endif
+    bool            _pcapng;
+    bool            _swapped;           /* file byte order differs from the host one */
+    long long       _firstRecord;       /* offset of the first record */
+    long long       _cursor;            /* offset of the next record */
+    Interface       _interfaces[PCAP_MAX_INTERFACES];
+    int             _nbInterfaces;
+    long long       _lastTs;            /* timestamp of the last pcapng packet, for the blocks without timestamp */
+
+    bool            _bPaced;            /* _startTs/_startTime are valid */
+    long long       _startTs;           /* capture timestamp (ns) of the first replayed packet */
+    std::chrono::steady_clock::time_point _startTime;
+
+    unsigned int _u32(const unsigned char* p);
+    unsigned short _u16(const unsigned char* p);
+    bool _map_file();
+    void _unmap_file();
+    bool _parse_file_header();
+    bool _next_record(const unsigned char** data, int* caplen, int* iface, long long* ts);
+    int  _extract_udp_payload(const unsigned char* data, int caplen, int linkType, const unsigned char** payload);
+    void _pace(long long ts);
+
+public:
+    CPcapDataSource();
+    virtual ~CPcapDataSource();
+
+public:
+    void init(PinConfiguration *pconfig);
+    int  read(char* buffer, int size);
+    int  readScatter(UDPScatter* packets, int nbPackets);
+    void waitForNextFrame();
+    void close();
+
+    bool isBurstCapable() { return true; };
+    int  readBurst(DataSourcePacket* packets, int nbPackets);
+
+    int  nextPacket(const char** packet, long long* timestamp = NULL);
+};
+
 /**********************************************************************************************
 *
 * CRTPDataSource: class for network RTP source base
@@ -133,6 +232,7 @@ class CRTPDataSource : public CDMUXDataSource
 protected:
     UDP*        _udpSock;
     int         _port;
+    int         _rxBatch;       /* max nb of packets received per syscall */
     const char* _zmqip;
     const char* _ip;
     bool        _firstPacket;
@@ -148,6 +248,7 @@ public:
 
     void init(PinConfiguration *pconfig);
     int  read(char* buffer, int size);
+    int  readScatter(UDPScatter* packets, int nbPackets);
     void waitForNextFrame();
     void close();
 };
@@ -157,6 +258,10 @@ public:
 *
 * CDPDKDataSource: class for network RTP source base
 *
+* Receive with libegel (DPDK). The packets of a burst are handed out by readBurst() without
+* copy, their mbufs being given back by releaseBurst(). With "busypoll", an empty burst returns
+* immediately instead of sleeping.
+*
 ***********************************************************************************************/
 
 class CDPDKDataSource : public CDMUXDataSource
@@ -167,7 +272,8 @@ protected:
     int         _libegel_slot_handle;
     void**      _libegel_pkts;
     int         _libegel_pkts_nb;
-    int         _libegel_pkts_ptr;
+    int         _libegel_pkts_ptr;      /* nb of packets of the current burst not handed out yet */
+    bool        _busyPoll;              /* never sleep when no packet is available */
     int         _port;
     //const char* _zmqip;
     const char* _eal_config;
@@ -180,6 +286,9 @@ protected:
 
     const char* _filename;  // For stub only 
 
+    bool _init_slot();
+    void _free_pending_pkts();
+
 public:
     CDPDKDataSource();
     virtual ~CDPDKDataSource();
@@ -189,6 +298,10 @@ public:
     int  read(char* buffer, int size);
     void waitForNextFrame();
     void close();
+
+    bool isBurstCapable() { return true; };
+    int  readBurst(DataSourcePacket* packets, int nbPackets);
+    void releaseBurst(DataSourcePacket* packets, int nbPackets);
 };
 #endif // _USE_LIBEGEL
 
@@ -196,47 +309,55 @@ public:
 *
 * CSPSRTPDataSource: class for network "Seamless Protection Switching" RTP source base
 *
+* SMPTE ST 2022-7 receiver: each leg is received in its own sequence indexed ring, and each
+* packet is taken, in sequence order, from whichever leg has it. A packet missing on all the
+* legs is given up once all the online legs have received later packets, or "skewwindow" µs
+* after the first one did.
+*
 ***********************************************************************************************/
 
-#define DMUX_2022_7_NB_SOURCES  2
+#define DMUX_2022_7_NB_SOURCES  SPS_NB_LEGS
 struct SingleSource {
     CCircularRcvBuffer _in;
-    std::chrono::system_clock::time_point _lastRcvEvent;
+    std::chrono::steady_clock::time_point _lastRcvEvent;
+    unsigned long long _lastPackets;    /* nb of packets received at _lastRcvEvent */
     bool _isOnline;
 };
 class CSPSRTPDataSource : public CDMUXDataSource
 {
 protected:
     SingleSource   _src[DMUX_2022_7_NB_SOURCES];
-    SingleSource*  _master;
-    SingleSource*  _secondary;
     bool        _bInit;
-    CQueue<int> _q;
-    int         _nextSeq;
-    int         _lastSeq;
-    int         _nPacketsLost;
+    CRingEvent  _event;         /* notified on each packet received on a leg */
+    int         _nextSeq;       /* seq of the next packet to deliver, -1 if not synchronized yet */
+    bool        _bPassed;       /* a leg has received packets after _nextSeq, but not _nextSeq */
+    std::chrono::steady_clock::time_point _passedTime;     /* since when */
+    std::chrono::steady_clock::time_point _lastDelivery;   /* last packet delivered or given up */
+    vMISPSStats _stats;
     int         _port;
     int         _port2;
+    int         _rxBatch;       /* max nb of packets received per syscall */
+    int         _skewWindow;    /* max wait for a packet missing on all the legs, once one has received later ones, in µs */
     const char *_mcastgroup;
     const char *_mcastgroup2;
     const char *_ip;
     const char *_ip2;
     double      _offline_threshold_in_s;
 
-    void _switch_sources();
+    unsigned long long _update_sources();
+    bool _is_passed(int source);
 
 public:
     CSPSRTPDataSource();
     virtual ~CSPSRTPDataSource();
 
-//private:
-//    void* _rcv_thread(CCircularRcvBuffer* buffer, int index);
-
 public:
     void init(PinConfiguration *pconfig);
     int  read(char* buffer, int size);
     void waitForNextFrame();
     void close();
+
+    const vMISPSStats* getSPSStats() { return &_stats; };
 };
 
 /**********************************************************************************************
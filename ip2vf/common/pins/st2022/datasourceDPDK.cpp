@@ -1,6 +1,9 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <chrono>
+#include <thread>
 
 #include "common.h"
 #include "log.h"
@@ -47,7 +50,9 @@ CDPDKDataSource::CDPDKDataSource()
 	_firstPacket(true),
 	_libegel_slot_handle(INVALID_SLOT_HANDLE),
 	_libegel_pkts(NULL),
-	_libegel_pkts_nb(0) {
+	_libegel_pkts_nb(0),
+	_libegel_pkts_ptr(0),
+	_busyPoll(false) {
 
 	_samplesize = RTP_PACKET_SIZE;  // by default, will be refresh 
 	_type = DataSourceType::TYPE_DPDK;
@@ -74,6 +79,7 @@ void CDPDKDataSource::init(PinConfiguration *pconfig) {
 	PROPERTY_REGISTER_MANDATORY("pci", _pci_device, "");
 	PROPERTY_REGISTER_MANDATORY("nbpkts", _nbpkts, 0);
 	PROPERTY_REGISTER_OPTIONAL("eal", _eal_config, "");
+	PROPERTY_REGISTER_OPTIONAL("busypoll", _busyPoll, false);
 	if (_port == -1) {
 		LOG_ERROR("Invalid configuration. Exit. (port=%d)", _port);
 	}
@@ -91,6 +97,7 @@ void CDPDKDataSource::init(PinConfiguration *pconfig) {
 	LOG_INFO(" - sending IP='%s'", _ip);
 	LOG_INFO(" - PCI device='%s'", _pci_device);
 	LOG_INFO(" - EAL config='%s'", s.c_str());
+	LOG_INFO(" - busy poll=%d", _busyPoll);
 
 	_libegel_pkts = new void*[_nbpkts];
 
@@ -108,69 +115,126 @@ void CDPDKDataSource::waitForNextFrame()
 	// Do nothing for this source
 }
 
-int CDPDKDataSource::read(char* buffer, int size)
+bool CDPDKDataSource::_init_slot()
 {
-	int result = -1;
-
-	if (!_slot_init) {
-
-		// Get a new slot from libegel
-		/*_libegel_slot_handle = libegel_new_slot();
-		if (_libegel_slot_handle == INVALID_SLOT_HANDLE) {
-			LOG_ERROR("libegel_new_slot return INVALID_SLOT_HANDLE. Can't configurate libegel...");
-			return -1;
-		}*/
-
-		// Configure the slot
-		struct eg_slot_config def_slot_config;
-		def_slot_config.iface_pci_addr = _pci_device;
-		inet_aton(_ip, (struct in_addr*)&def_slot_config.iface_ip_addr);
-		inet_aton(_mcastgroup, (struct in_addr*)&def_slot_config.mcast_group);
-		def_slot_config.udp_port = htons(_port);
-
-		_libegel_slot_handle = libegel_config_slot(&def_slot_config);
-		LOG_INFO("libegel_config_slot returns %d\n", _libegel_slot_handle);
+	if (_slot_init)
+		return true;
+
+	// Get a new slot from libegel
+	/*_libegel_slot_handle = libegel_new_slot();
+	if (_libegel_slot_handle == INVALID_SLOT_HANDLE) {
+		LOG_ERROR("libegel_new_slot return INVALID_SLOT_HANDLE. Can't configurate libegel...");
+		return false;
+	}*/
+
+	// Configure the slot
+	struct eg_slot_config def_slot_config;
+	def_slot_config.iface_pci_addr = _pci_device;
+	inet_aton(_ip, (struct in_addr*)&def_slot_config.iface_ip_addr);
+	inet_aton(_mcastgroup, (struct in_addr*)&def_slot_config.mcast_group);
+	def_slot_config.udp_port = htons(_port);
+
+	_libegel_slot_handle = libegel_config_slot(&def_slot_config);
+	LOG_INFO("libegel_config_slot returns %d\n", _libegel_slot_handle);
+
+	_libegel_pkts_ptr = 0;
+	_libegel_pkts_nb = 0;
+
+	_slot_init = true;
+	LOG_INFO("init slot ok");
+	return true;
+}
 
-		_libegel_pkts_ptr = 0;
-		_libegel_pkts_nb = 0;
+/*!
+* \fn _free_pending_pkts
+* \brief give back to libegel the packets of the current burst not handed out yet
+*/
+void CDPDKDataSource::_free_pending_pkts()
+{
+	for (int i = _libegel_pkts_nb - _libegel_pkts_ptr; i < _libegel_pkts_nb; i++)
+		libegel_free_pkt(_libegel_slot_handle, _libegel_pkts[i]);
+	_libegel_pkts_ptr = 0;
+	_libegel_pkts_nb = 0;
+}
 
-		_slot_init = true;
-		LOG_INFO("init slot ok");
+/*!
+* \fn readBurst
+* \brief hand out the next packets of the current burst, or of a new one, without copy. The
+*        packets stay in their mbufs until releaseBurst().
+*
+* \param packets array receiving the packets
+* \param nbPackets nb of packets to get at most
+* \return nb of packets, or VMI_E_PACKET_LOST if no packet is available
+*/
+int CDPDKDataSource::readBurst(DataSourcePacket* packets, int nbPackets)
+{
+	std::unique_lock<std::mutex> lock(_cs);
+	if (!_init_slot())
+		return -1;
+
+	// Get a new array of packets, if no more packets available.
+	if (_libegel_pkts_ptr == 0) {
+		_libegel_pkts_nb = libegel_rx_pkts_burst(_libegel_slot_handle, _libegel_pkts, _nbpkts);
+		_libegel_pkts_ptr = _libegel_pkts_nb;
+		if (_libegel_pkts_nb == 0) {
+			lock.unlock();
+			if (!_busyPoll)
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			return VMI_E_PACKET_LOST;
+		}
 	}
 
-	if (_slot_init) {
+	int n = MIN(nbPackets, _libegel_pkts_ptr);
+	void** pkts = _libegel_pkts + (_libegel_pkts_nb - _libegel_pkts_ptr);
+	for (int i = 0; i < n; i++) {
+		packets[i].data = (const char*)libegel_get_udp_payload(_libegel_slot_handle, pkts[i]);
+		packets[i].len = libegel_get_udp_payload_len(_libegel_slot_handle, pkts[i]);
+		packets[i].handle = pkts[i];
+	}
+	_libegel_pkts_ptr -= n;
+	return n;
+}
 
-		// Get a new array of packets, if no more packets available.
-		if (_libegel_pkts_ptr == 0) {
-			_libegel_pkts_nb = libegel_rx_pkts_burst(_libegel_slot_handle, _libegel_pkts, _nbpkts);
-			_libegel_pkts_ptr = _libegel_pkts_nb;
-			if (_libegel_pkts_nb == 0) {
-				LOG_ERROR("libegel_rx_pkts_burst return %d", _libegel_pkts_nb);
-				std::this_thread::sleep_for(std::chrono::microseconds(100));
-				return VMI_E_PACKET_LOST;
-			}
-		}
+/*!
+* \fn releaseBurst
+* \brief give back to libegel the mbufs of packets handed out by readBurst()
+*
+* \param packets packets to release
+* \param nbPackets nb of packets
+*/
+void CDPDKDataSource::releaseBurst(DataSourcePacket* packets, int nbPackets)
+{
+	std::unique_lock<std::mutex> lock(_cs);
+	if (!_slot_init)
+		return;
+	for (int i = 0; i < nbPackets; i++)
+		libegel_free_pkt(_libegel_slot_handle, packets[i].handle);
+}
 
-		// Get data from next available packets
-		if (_libegel_pkts_ptr > 0) {
-			int index = _libegel_pkts_nb - _libegel_pkts_ptr;
-			int payload_len = libegel_get_udp_payload_len(_libegel_slot_handle, _libegel_pkts[index]);
-			uint8_t* ptr = libegel_get_udp_payload(_libegel_slot_handle, _libegel_pkts[index]);
-			memcpy(buffer, (const char*)ptr, payload_len);
-			libegel_free_pkt(_libegel_slot_handle, _libegel_pkts[index]);
-			_libegel_pkts_ptr--;
-			result = payload_len;
-			//LOG("read %d, wanted size=%d", result, size);
-		}
+int CDPDKDataSource::read(char* buffer, int size)
+{
+	DataSourcePacket packet;
+	int result = readBurst(&packet, 1);
+	if (result <= 0)
+		return result;
+
+	int payload_len = packet.len;
+	if (payload_len > size) {
+		LOG_WARNING("Size is lower than packet size (request=%d, packet=%d)", size, payload_len);
+		payload_len = size;
 	}
-	return result;
+	memcpy(buffer, packet.data, payload_len);
+	releaseBurst(&packet, 1);
+	//LOG("read %d, wanted size=%d", result, size);
+	return payload_len;
 }
 
 void CDPDKDataSource::close()
 {
 	LOG_INFO("-->");
-	// TODO: free any unused packet from a "working" burst
+	std::unique_lock<std::mutex> lock(_cs);
 	if (_slot_init) {
+		_free_pending_pkts();
 		libegel_delete_slot(_libegel_slot_handle);
 		_libegel_slot_handle = INVALID_SLOT_HANDLE;
 		_slot_init = false;
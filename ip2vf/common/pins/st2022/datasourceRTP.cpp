@@ -38,6 +38,7 @@ void CRTPDataSource::init(PinConfiguration *pconfig)
     PROPERTY_REGISTER_MANDATORY("port", _port, -1);
     PROPERTY_REGISTER_OPTIONAL("mcastgroup", _zmqip, "");
     PROPERTY_REGISTER_OPTIONAL("ip", _ip, "");
+    PROPERTY_REGISTER_OPTIONAL("rxbatch", _rxBatch, UDP_RXRING_DEFAULT_PACKETS);
     if (_port == -1) {
         LOG_ERROR("Invalid configuration. Exit. (port=%d)", _port);
     }
@@ -49,6 +50,7 @@ void CRTPDataSource::init(PinConfiguration *pconfig)
         if((_udpSock = pktTSconstruct(_pConfig)) == 0)          /* PktTS hook */
 #endif
             _udpSock = new UDP();
+    _udpSock->enableBatchReceive(_rxBatch);
 
     if (_udpSock && !_udpSock->isValid())
         result = _udpSock->openSocket(_zmqip, _ip, _port, true);
@@ -85,6 +87,22 @@ int CRTPDataSource::read(char* buffer, int size)
     return result;
 }
 
+int CRTPDataSource::readScatter(UDPScatter* packets, int nbPackets)
+{
+    int result = -1;
+
+    if (_udpSock && _udpSock->isValid()) {
+        result = _udpSock->readScatter(packets, nbPackets);
+        if (result>0 && _firstPacket) {
+            _samplesize = packets[0].len;
+            LOG_INFO("Detect sample size=%d", _samplesize);
+            _firstPacket = false;
+        }
+    }
+
+    return result;
+}
+
 void CRTPDataSource::close()
 {
     LOG_INFO("-->");
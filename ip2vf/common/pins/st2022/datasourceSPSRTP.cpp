@@ -1,8 +1,10 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <cmath>
-#include <algorithm>    // for std::fill_n
+#include <algorithm>
 #include <signal.h>
 
 #include "common.h"
@@ -15,20 +17,23 @@
 
 using namespace std;
 
-#define DEFAULT_PACKET_NB       30000
+#define DEFAULT_PACKET_NB       32768   // per leg, a power of two dividing the seq range
 #define DEFAULT_THRESHOLD_IN_S  0.02
+#define DEFAULT_SKEW_WINDOW_US  10000
 
 CSPSRTPDataSource::CSPSRTPDataSource()
-    : CDMUXDataSource() 
+    : CDMUXDataSource()
 {
     _bInit              = false;
     _closed             = true;
     _pConfig            = nullptr;
     _nextSeq            = -1;
+    _bPassed            = false;
     _type               = DataSourceType::TYPE_SMPTE_2022_7;
-    _nPacketsLost       = 0;
-    _samplesize         = RTP_PACKET_SIZE;  // by default, will be refresh 
+    _samplesize         = RTP_PACKET_SIZE;  // by default, will be refresh
+    _skewWindow         = DEFAULT_SKEW_WINDOW_US;
     _offline_threshold_in_s = DEFAULT_THRESHOLD_IN_S;
+    std::memset(&_stats, 0, sizeof(_stats));
 }
 
 CSPSRTPDataSource::~CSPSRTPDataSource() {
@@ -47,26 +52,24 @@ void CSPSRTPDataSource::init(PinConfiguration *pconfig) {
     PROPERTY_REGISTER_OPTIONAL("ip", _ip, "");
     PROPERTY_REGISTER_OPTIONAL("mcastgroup2", _mcastgroup2, _mcastgroup);
     PROPERTY_REGISTER_OPTIONAL("ip2", _ip2, _ip);
+    PROPERTY_REGISTER_OPTIONAL("rxbatch", _rxBatch, UDP_RXRING_DEFAULT_PACKETS);
+    PROPERTY_REGISTER_OPTIONAL("skewwindow", _skewWindow, DEFAULT_SKEW_WINDOW_US);
     _bInit = false;
 
-    // This allow to setup a network RTP stream 
-    LOG_INFO("Data stream from port '%d' and '%d' ", _port, _port2);
-
-
-    // Determine main and secundary streams. Main stream is the one with the latest packets. It will assure
-    // that when a packet missed on the main stream, the corresponding packet has been already received on
-    // the secundary stream
-    _src[0]._in.init(&_q, _mcastgroup, _ip, _port, DEFAULT_PACKET_NB, 0);
-    _src[0]._isOnline = true;
-    _src[0]._lastRcvEvent = std::chrono::system_clock::now();
-    _master = &_src[0];
-    _master->_in.setMaster(true);
-
-    _src[1]._in.init(&_q, _mcastgroup2, _ip2, _port2, DEFAULT_PACKET_NB, 1);
-    _src[1]._isOnline = true;
-    _src[1]._lastRcvEvent = std::chrono::system_clock::now();
-    _secondary = &_src[1];
-    _secondary->_in.setMaster(false);
+    // This allow to setup a network RTP stream
+    LOG_INFO("Data stream from port '%d' and '%d', skew window %d us", _port, _port2, _skewWindow);
+
+    std::memset(&_stats, 0, sizeof(_stats));
+    _nextSeq = -1;
+    _bPassed = false;
+    _lastDelivery = std::chrono::steady_clock::now();
+    _src[0]._in.init(&_event, _mcastgroup, _ip, _port, DEFAULT_PACKET_NB, 0, _rxBatch);
+    _src[1]._in.init(&_event, _mcastgroup2, _ip2, _port2, DEFAULT_PACKET_NB, 1, _rxBatch);
+    for (int i = 0; i < DMUX_2022_7_NB_SOURCES; i++) {
+        _src[i]._isOnline = true;
+        _src[i]._lastPackets = 0;
+        _src[i]._lastRcvEvent = _lastDelivery;
+    }
 
     _closed = false;
     _bInit = true;
@@ -78,134 +81,135 @@ void CSPSRTPDataSource::waitForNextFrame() {
     // Do nothing for this source
 }
 
-void CSPSRTPDataSource::_switch_sources() {
+/*!
+* \fn _update_sources
+* \brief update the online state and the packet counters of the legs
+*
+* \return total nb of packets received on the legs
+*/
+unsigned long long CSPSRTPDataSource::_update_sources() {
+
+    auto now = std::chrono::steady_clock::now();
+    unsigned long long total = 0;
+    for (int i = 0; i < DMUX_2022_7_NB_SOURCES; i++) {
+        SingleSource& src = _src[i];
+        unsigned long long packets = src._in.getPacketCount();
+        if (packets != src._lastPackets) {
+            src._lastPackets = packets;
+            src._lastRcvEvent = now;
+            if (!src._isOnline)
+                LOG_INFO("Source [%d] is now online", i);
+            src._isOnline = true;
+        }
+        else if (src._isOnline && std::chrono::duration<double>(now - src._lastRcvEvent).count() > _offline_threshold_in_s) {
+            LOG_INFO("Source [%d] is offline", i);
+            src._isOnline = false;
+        }
+        // The packets lost on the leg, except those lost on all the legs, have been taken from another one
+        unsigned long long lost = src._in.getLostCount();
+        _stats.legs[i].packets = packets;
+        _stats.legs[i].lostPackets = lost;
+        _stats.legs[i].recoveredPackets = (lost > _stats.lostPackets ? lost - _stats.lostPackets : 0);
+        total += packets;
+    }
+    return total;
+}
 
-    LOG_INFO("Switch source [%d] <--> [%d]", _master->_in.getIndex(), _secondary->_in.getIndex());
-    SingleSource* temp = _master;
-    _master = _secondary;
-    _secondary = temp;
-    _master->_in.setMaster(true);
-    _secondary->_in.setMaster(false);
+/*!
+* \fn _is_passed
+* \brief check if a leg has received packets after the next one to deliver
+*
+* \param source index of the leg
+* \return true if the leg is past _nextSeq
+*/
+bool CSPSRTPDataSource::_is_passed(int source) {
+
+    int last = _src[source]._in.getLastRecvSeq();
+    return last != -1 && (int16_t)(last - _nextSeq) > 0;
 }
 
 int CSPSRTPDataSource::read(char* buffer, int size) {
 
-    int result = VMI_E_OK;
-    int len = size;
-
-    //LOG_INFO("-->, _closed=%d, _bInit=%d", _closed, _bInit);
-
     if (!_bInit)
         return VMI_E_ERROR;
 
-    if (!_closed) {
-
-        //static int count = 0;
-        //if ((++count) % 10000 == 0) LOG_INFO("%d events, queue size=%d", count, _q.size());
-
-        // If we lost packets on main, try to find it on secundary 
-        if (_nPacketsLost>0) {
-            //LOG_INFO("--> _nPacketsLost=%d", _nPacketsLost);
-            if (_secondary->_isOnline) {
-                //LOG_INFO("sec is online, try to read #%d", _nextSeq);
-                result = _secondary->_in.searchFor(_nextSeq, buffer, size);
-                if (result == -1) {
-                    LOG_ERROR("can't find missing packet #%d on secondary (nbPacketLost=%d, queue size=%d)", _nextSeq, _nPacketsLost, _q.size());
-                    _nPacketsLost = 0;
-                    _nextSeq = -1;
-                    return VMI_E_ERROR;
-                }
-                else {
-                    LOG("Ok to keep packet%d (nbPacketLost=%d, queue size=%d)", _nextSeq, _nPacketsLost, _q.size());
-                    _nPacketsLost--;
-                    if (_nextSeq == _lastSeq) {
-                        LOG_INFO("_nextSeq == _lastSeq");
-                        _nPacketsLost = 0;
-                    }
-                    _nextSeq = (_nextSeq + 1) % 65536;
-                    result = size;
-                }
-                return result;
-            }
-            return VMI_E_ERROR;
+    while (!_closed) {
+
+        unsigned long long packets = _update_sources();
+        auto now = std::chrono::steady_clock::now();
+        long long timeout = (long long)(_offline_threshold_in_s * 1000000);
+
+        // Start with the latest packet received
+        if (_nextSeq == -1) {
+            for (int i = 0; i < DMUX_2022_7_NB_SOURCES && _nextSeq == -1; i++)
+                _nextSeq = _src[i]._in.getLastRecvSeq();
+            _bPassed = false;
+            _lastDelivery = now;
         }
 
-        // Wait for any rcv events from sources
-        int event = _q.pop();
-
-        // detect exit condition
-        if (event == -1 || _closed)
-            return VMI_E_ERROR;
-
-        // Keep the source index and the rtp seq number
-        int seq = event & 0xFFFF;
-        int source = event >> 16;
-        //LOG_INFO("[%d]--> receive packet=%d, size of queue=%d", source, seq, _q.size());
-
-        // If errors...
-        if (seq == -1)
-            return VMI_E_ERROR;
-        if( source <0 || source >1 )
-            return VMI_E_ERROR;
-
-        // Manage online state of "current" source (the one that produce the event)
-        _src[source]._lastRcvEvent = std::chrono::system_clock::now();
-        if( !_src[source]._isOnline )
-            LOG_INFO("Source [%d] is now online", source);
-        _src[source]._isOnline = true;
-
-        // Offline sources detection
-        auto now = std::chrono::system_clock::now();
-        bool bSwitchOccured = false;
-        for (int i = 0; i < DMUX_2022_7_NB_SOURCES; i++) {
-            std::chrono::duration<double> diff = now - _src[i]._lastRcvEvent;
-            if (_src[i]._isOnline && diff.count() > _offline_threshold_in_s) {
-                LOG_INFO("Source [%d] is offline", i);
-                _src[i]._isOnline = false;
-                if (i == _master->_in.getIndex()) {
-                    // The offline source is the master source... switch between main and secundary
-                    LOG_INFO("Switch source [%d] <--> [%d]", _master->_in.getIndex(), _secondary->_in.getIndex());
-                    _switch_sources();
-                    bSwitchOccured = true;
+        if (_nextSeq != -1) {
+            // The wanted packet, from the first leg which has it
+            int len = -1, source = -1;
+            for (int i = 0; i < DMUX_2022_7_NB_SOURCES && source == -1; i++) {
+                len = _src[i]._in.read(_nextSeq, buffer, size);
+                if (len > 0)
+                    source = i;
+            }
+            if (source != -1) {
+                _samplesize = _src[source]._in.getSampleSize();
+                _nextSeq = (_nextSeq + 1) & 0xFFFF;
+                _bPassed = false;
+                _lastDelivery = now;
+                return len;
+            }
+
+            // Missing on all the legs: give it up once all the online legs are past it, or after
+            // the skew window
+            int nbOnline = 0, nbPassed = 0;
+            bool bStalled = false;
+            for (int i = 0; i < DMUX_2022_7_NB_SOURCES; i++) {
+                if (!_src[i]._isOnline)
+                    continue;
+                nbOnline++;
+                if (_is_passed(i))
+                    nbPassed++;
+                if (std::chrono::duration<double>(_src[i]._lastRcvEvent - _lastDelivery).count() > _offline_threshold_in_s)
+                    bStalled = true;
+            }
+            if (nbPassed > 0) {
+                if (!_bPassed) {
+                    _bPassed = true;
+                    _passedTime = now;
                 }
+                long long waited = std::chrono::duration_cast<std::chrono::microseconds>(now - _passedTime).count();
+                if (nbPassed == nbOnline || waited >= _skewWindow) {
+                    _stats.lostPackets++;
+                    LOG("packet #%d lost on all the sources", _nextSeq);
+                    _nextSeq = (_nextSeq + 1) & 0xFFFF;
+                    _bPassed = false;
+                    _lastDelivery = now;
+                    return VMI_E_PACKET_LOST;
+                }
+                timeout = _skewWindow - waited;
+            }
+            else if (bStalled) {
+                // Packets still received, but none after the wanted one: the sequence has been restarted
+                LOG_INFO("no packet #%d on the online sources, resync", _nextSeq);
+                _nextSeq = -1;
+                return VMI_E_PACKET_LOST;
             }
         }
-        if (bSwitchOccured) {
-            _nextSeq = -1;
-            return VMI_E_ERROR;
-        }
-
-        // At this state, if the source is the secundary, nothing to do
-        if (source != _master->_in.getIndex())
-            return VMI_E_NOT_PRIMARY_SRC;
 
-        if (_nextSeq == -1) {
-            _nextSeq = seq;
-            _nPacketsLost = 0;
-        }
-        _lastSeq = seq;
-        if (_nextSeq != _lastSeq) {
-            _nPacketsLost = (_lastSeq - _nextSeq) > 0 ? (_lastSeq - _nextSeq) : (65536 - _nextSeq + _lastSeq);
-            _nPacketsLost++; 
-            LOG_ERROR("recv packet#%d, expected #%d, diff=%d (queue size=%d)", _lastSeq, _nextSeq, _nPacketsLost, _q.size());
-            return VMI_E_PACKET_LOST;
-        }
-        int len = size;
-        result = _master->_in.read(_nextSeq, buffer, size);
-        if (result == -1) {
-            LOG_ERROR("result=%d, len=%d, size=%d (queue size=%d)", result, len, size, _q.size());
-            return VMI_E_ERROR;
-        }
-        else {
-            //LOG_INFO("--> receive packet=%d, read=%d, size of queue=%d", seq, _nextSeq, _q.size());
-            _nextSeq = (_nextSeq + 1) % 65536;
-            result = size;
-            _samplesize = _master->_in.getSampleSize();
-        }
+        // Wait for the next packet on any leg
+        _event.wait([&] {
+            unsigned long long n = 0;
+            for (int i = 0; i < DMUX_2022_7_NB_SOURCES; i++)
+                n += _src[i]._in.getPacketCount();
+            return _closed || n != packets;
+        }, timeout);
     }
 
-    //LOG_INFO("<--");
-    return result;
+    return VMI_E_ERROR;
 }
 
 void CSPSRTPDataSource::close() {
@@ -213,13 +217,16 @@ void CSPSRTPDataSource::close() {
     LOG_INFO("-->");
 
     _closed = true;
+    _event.notify();
 
     for (int i = 0; i < DMUX_2022_7_NB_SOURCES; i++)
         _src[i]._in.close();
-
-    // unblock the queue
-    _q.push(-1);
+    _update_sources();
+    for (int i = 0; i < DMUX_2022_7_NB_SOURCES; i++) {
+        LOG_INFO("Source [%d]: %llu packets, %llu lost, %llu recovered from the other source", i,
+            _stats.legs[i].packets, _stats.legs[i].lostPackets, _stats.legs[i].recoveredPackets);
+    }
+    LOG_INFO("%llu packets lost on all the sources", _stats.lostPackets);
 
     LOG_INFO("<--");
 }
-
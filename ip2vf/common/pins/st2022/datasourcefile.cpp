@@ -80,11 +80,11 @@ void CFileDataSource::init(PinConfiguration *pconfig)
     _f.read(rtp_packet, RTP_PACKET_SIZE);
     if (_f.good()) {
         CRTPFrame frame((unsigned char*)rtp_packet, RTP_PACKET_SIZE);
-        CHBRMPFrame* hbrmp = frame.getHBRMPFrame();
-        if (hbrmp->getClockFrequency() == 0)
+        CHBRMPFrame hbrmp;
+        frame.getHBRMPFrame(hbrmp);
+        if (hbrmp.getClockFrequency() == 0)
             _samplesize -= 4;
         LOG_INFO("Sample size is %d", _samplesize);
-        delete hbrmp;
         _f.clear();
         _f.seekg(_fileOffset, ios::beg); 
     }
@@ -0,0 +1,682 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>      // strerror
+#include <string>
+#include <thread>       // std::this_thread
+#ifdef _WIN32
+#include <winsock2.h>
+#include <Ws2tcpip.h>
+#else
+#include <sys/types.h>  // open
+#include <sys/stat.h>   // fstat
+#include <sys/mman.h>   // mmap
+#include <fcntl.h>      // open
+#include <unistd.h>     // close
+#include <arpa/inet.h>  // inet_pton
+#endif
+
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "datasource.h"
+#include "moduleconfiguration.h"
+#include "configurable.h"
+#include "rtpframe.h"
+using namespace std;
+
+#define PCAP_MAGIC_US           0xa1b2c3d4
+#define PCAP_MAGIC_NS           0xa1b23c4d
+#define PCAPNG_BLOCK_SHB        0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB        0x00000001
+#define PCAPNG_BLOCK_PB         0x00000002      /* obsolete packet block */
+#define PCAPNG_BLOCK_SPB        0x00000003
+#define PCAPNG_BLOCK_EPB        0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_BYTE_ORDER_SWAPPED 0x4D3C2B1A
+#define PCAPNG_OPT_IF_TSRESOL   9
+
+#define LINKTYPE_NULL           0
+#define LINKTYPE_ETHERNET       1
+#define LINKTYPE_RAW_OLD        12
+#define LINKTYPE_RAW            101
+#define LINKTYPE_LOOP           108
+#define LINKTYPE_LINUX_SLL      113
+#define LINKTYPE_IPV4           228
+#define LINKTYPE_IPV6           229
+#define LINKTYPE_LINUX_SLL2     276
+
+#define PCAP_MAX_RECORD_SIZE    262144
+#define PCAP_EOF_WAIT_MS        100     /* wait at the end of the file, when not looping */
+
+static inline unsigned short get16be(const unsigned char* p) { return (unsigned short)((p[0] << 8) | p[1]); }
+
+CPcapDataSource::CPcapDataSource()
+    : CDMUXDataSource() {
+
+    _filename = NULL;
+    _speed = 1.0f;
+    _dstPort = -1;
+    _dstIp = NULL;
+    _loop = true;
+    _filterAddrLen = 0;
+    _map = NULL;
+    _mapSize = 0;
+#ifdef _WIN32
+    _hFile = INVALID_HANDLE_VALUE;
+    _hMapping = NULL;
+#endif
+    _pcapng = false;
+    _swapped = false;
+    _firstRecord = 0;
+    _cursor = 0;
+    _nbInterfaces = 0;
+    _bPaced = false;
+    _startTs = 0;
+    _lastTs = 0;
+    _closed = false;
+    _samplesize = RTP_PACKET_SIZE;  // by default, will be refresh
+    _type = DataSourceType::TYPE_FILE;
+}
+
+CPcapDataSource::~CPcapDataSource() {
+
+    _unmap_file();
+}
+
+void CPcapDataSource::init(PinConfiguration *pconfig) {
+
+    if (_map != NULL)
+        return;
+
+    _pConfig = pconfig;
+    PROPERTY_REGISTER_MANDATORY("filename", _filename, "");
+    // Basic verification
+    if (_filename == NULL || strlen(_filename) == 0) {
+        LOG_ERROR("***ERROR*** bad filename format");
+        exit(1);
+    }
+    PROPERTY_REGISTER_OPTIONAL("speed", _speed, 1.0f);
+    PROPERTY_REGISTER_OPTIONAL("dstport", _dstPort, -1);
+    PROPERTY_REGISTER_OPTIONAL("dstip", _dstIp, "");
+    PROPERTY_REGISTER_OPTIONAL("loop", _loop, true);
+
+    if (_dstIp != NULL && _dstIp[0] != '\0') {
+        if (inet_pton(AF_INET, _dstIp, _filterAddr) == 1)
+            _filterAddrLen = 4;
+        else if (inet_pton(AF_INET6, _dstIp, _filterAddr) == 1)
+            _filterAddrLen = 16;
+        else
+            LOG_ERROR("invalid dst ip '%s', ignore it", _dstIp);
+    }
+
+    if (!_map_file() || !_parse_file_header()) {
+        LOG_ERROR("***ERROR*** can't open '%s' as a pcap/pcapng file", _filename);
+        exit(1);
+    }
+    LOG_INFO("replay %s file '%s' (%lld bytes), speed=%.2f, filter dst=%s:%d", (_pcapng ? "pcapng" : "pcap"), _filename, _mapSize,
+        _speed, (_filterAddrLen > 0 ? _dstIp : "*"), _dstPort);
+
+    // Get the first packet of the flow, to get the sample size
+    const char* packet;
+    bool loop = _loop;
+    _loop = false;
+    float speed = _speed;
+    _speed = 0.0f;
+    int len = nextPacket(&packet);
+    _loop = loop;
+    _speed = speed;
+    if (len > 0) {
+        _samplesize = len;
+        LOG_INFO("Sample size is %d", _samplesize);
+    }
+    else
+        LOG_ERROR("no packet matching the filter in '%s'", _filename);
+    _cursor = _firstRecord;
+    _bPaced = false;
+}
+
+bool CPcapDataSource::_map_file() {
+
+#ifdef _WIN32
+    _hFile = CreateFileA(_filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (_hFile == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_hFile, &size) || size.QuadPart == 0)
+        return false;
+    _mapSize = size.QuadPart;
+    _hMapping = CreateFileMappingA(_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (_hMapping == NULL)
+        return false;
+    _map = (unsigned char*)MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0);
+    return _map != NULL;
+#else
+    int fd = open(_filename, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("can't open '%s': %s", _filename, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("can't map '%s': %s", _filename, strerror(errno));
+        return false;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    _map = (unsigned char*)map;
+    _mapSize = st.st_size;
+    return true;
+#endif
+}
+
+void CPcapDataSource::_unmap_file() {
+
+#ifdef _WIN32
+    if (_map != NULL)
+        UnmapViewOfFile(_map);
+    if (_hMapping != NULL)
+        CloseHandle(_hMapping);
+    if (_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(_hFile);
+    _hMapping = NULL;
+    _hFile = INVALID_HANDLE_VALUE;
+#else
+    if (_map != NULL)
+        munmap(_map, (size_t)_mapSize);
+#endif
+    _map = NULL;
+    _mapSize = 0;
+}
+
+unsigned int CPcapDataSource::_u32(const unsigned char* p) {
+
+    unsigned int v;
+    memcpy(&v, p, 4);
+    if (_swapped)
+        v = ((v & 0xff) << 24) | ((v & 0xff00) << 8) | ((v >> 8) & 0xff00) | (v >> 24);
+    return v;
+}
+
+unsigned short CPcapDataSource::_u16(const unsigned char* p) {
+
+    unsigned short v;
+    memcpy(&v, p, 2);
+    if (_swapped)
+        v = (unsigned short)((v << 8) | (v >> 8));
+    return v;
+}
+
+bool CPcapDataSource::_parse_file_header() {
+
+    if (_mapSize < PCAP_FILE_HEADER_SIZE)
+        return false;
+
+    unsigned int magic;
+    memcpy(&magic, _map, 4);
+    if (magic == PCAPNG_BLOCK_SHB) {
+        // Byte order, interfaces... are given by the blocks of each section
+        _pcapng = true;
+        _firstRecord = 0;
+    }
+    else {
+        _pcapng = false;
+        _swapped = false;
+        if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+            _swapped = true;
+            magic = _u32(_map);
+            if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS)
+                return false;
+        }
+        _interfaces[0].linkType = (int)(_u32(_map + 20) & 0x0FFFFFFF);
+        _interfaces[0].tsPow2 = false;
+        _interfaces[0].tsExponent = (magic == PCAP_MAGIC_NS ? 9 : 6);
+        _interfaces[0].tsUnitsPerSec = (magic == PCAP_MAGIC_NS ? 1000000000LL : 1000000LL);
+        _nbInterfaces = 1;
+        _firstRecord = PCAP_FILE_HEADER_SIZE;
+    }
+    _cursor = _firstRecord;
+    return true;
+}
+
+/*!
+* \fn _next_record
+* \brief get the next packet record of the file
+*
+* \param data pointer to the captured data of the packet
+* \param caplen size of the captured data
+* \param iface interface index of the packet
+* \param ts capture timestamp of the packet, in ns
+* \return false at the end of the file, or on a corrupted record
+*/
+bool CPcapDataSource::_next_record(const unsigned char** data, int* caplen, int* iface, long long* ts) {
+
+    while (_cursor < _mapSize) {
+        const unsigned char* p = _map + _cursor;
+        long long left = _mapSize - _cursor;
+
+        if (!_pcapng) {
+            if (left < 16)
+                return false;
+            unsigned int len = _u32(p + 8);
+            if (len > PCAP_MAX_RECORD_SIZE || (long long)len > left - 16) {
+                LOG_ERROR("corrupted pcap record at offset %lld", _cursor);
+                return false;
+            }
+            long long frac = _u32(p + 4);
+            *ts = (long long)_u32(p) * 1000000000LL + (_interfaces[0].tsExponent == 9 ? frac : frac * 1000);
+            *data = p + 16;
+            *caplen = (int)len;
+            *iface = 0;
+            _cursor += 16 + len;
+            return true;
+        }
+
+        // pcapng block
+        if (left < 12)
+            return false;
+        unsigned int type;
+        memcpy(&type, p, 4);
+        if (type == PCAPNG_BLOCK_SHB) {
+            // New section: byte order and interfaces
+            unsigned int bom;
+            memcpy(&bom, p + 8, 4);
+            if (bom == PCAPNG_BYTE_ORDER_MAGIC)
+                _swapped = false;
+            else if (bom == PCAPNG_BYTE_ORDER_SWAPPED)
+                _swapped = true;
+            else {
+                LOG_ERROR("invalid pcapng section at offset %lld", _cursor);
+                return false;
+            }
+            _nbInterfaces = 0;
+        }
+        else
+            type = _u32(p);
+        unsigned int blockLen = _u32(p + 4);
+        if (blockLen < 12 || (blockLen & 3) != 0 || (long long)blockLen > left) {
+            LOG_ERROR("corrupted pcapng block at offset %lld", _cursor);
+            return false;
+        }
+        _cursor += blockLen;
+
+        if (type == PCAPNG_BLOCK_IDB && blockLen >= 20) {
+            if (_nbInterfaces >= PCAP_MAX_INTERFACES) {
+                LOG_ERROR("too many interfaces in pcapng file, ignore the next ones");
+                continue;
+            }
+            Interface& itf = _interfaces[_nbInterfaces++];
+            itf.linkType = _u16(p + 8);
+            itf.tsPow2 = false;
+            itf.tsExponent = 6;
+            itf.tsUnitsPerSec = 1000000LL;
+            // Options: if_tsresol
+            const unsigned char* opt = p + 16;
+            const unsigned char* end = p + blockLen - 4;
+            while (opt + 4 <= end) {
+                unsigned short code = _u16(opt);
+                unsigned short optLen = _u16(opt + 2);
+                if (code == 0 || opt + 4 + optLen > end)
+                    break;
+                if (code == PCAPNG_OPT_IF_TSRESOL && optLen >= 1) {
+                    itf.tsPow2 = (opt[4] & 0x80) != 0;
+                    itf.tsExponent = opt[4] & 0x7F;
+                    // Beyond, the units don't fit in 64 bits
+                    int maxExponent = (itf.tsPow2 ? 63 : 18);
+                    if (itf.tsExponent > maxExponent) {
+                        LOG_ERROR("unsupported pcapng timestamp resolution %s-%d, use %s-%d", itf.tsPow2 ? "2^" : "10^",
+                            itf.tsExponent, itf.tsPow2 ? "2^" : "10^", maxExponent);
+                        itf.tsExponent = maxExponent;
+                    }
+                    itf.tsUnitsPerSec = 1;
+                    for (int i = 0; !itf.tsPow2 && i < itf.tsExponent; i++)
+                        itf.tsUnitsPerSec *= 10;
+                }
+                opt += 4 + ((optLen + 3) & ~3);
+            }
+            continue;
+        }
+
+        unsigned long long units = 0;
+        bool hasTs = true;
+        if (type == PCAPNG_BLOCK_EPB && blockLen >= 32) {
+            *iface = (int)_u32(p + 8);
+            units = ((unsigned long long)_u32(p + 12) << 32) | _u32(p + 16);
+            *caplen = (int)_u32(p + 20);
+            *data = p + 28;
+        }
+        else if (type == PCAPNG_BLOCK_PB && blockLen >= 32) {
+            *iface = _u16(p + 8);
+            units = ((unsigned long long)_u32(p + 12) << 32) | _u32(p + 16);
+            *caplen = (int)_u32(p + 20);
+            *data = p + 28;
+        }
+        else if (type == PCAPNG_BLOCK_SPB && blockLen >= 16) {
+            // No timestamp: sent with the previous packet
+            *iface = 0;
+            *ts = _lastTs;
+            *caplen = MIN((int)_u32(p + 8), (int)blockLen - 16);
+            *data = p + 12;
+            hasTs = false;
+        }
+        else
+            // Other blocks (statistics, name resolution...) are ignored
+            continue;
+
+        if (*iface < 0 || *iface >= _nbInterfaces || *caplen < 0 || *data + *caplen > p + blockLen) {
+            LOG_ERROR("invalid pcapng packet block at offset %lld", _cursor - blockLen);
+            continue;
+        }
+        if (hasTs) {
+            const Interface& itf = _interfaces[*iface];
+            if (itf.tsPow2) {
+                // The fraction of second is reduced to 34 bits, so that its product by 10^9 fits in 64 bits
+                unsigned long long frac = units & ((1ULL << itf.tsExponent) - 1);
+                int shift = MIN(itf.tsExponent, 34);
+                *ts = (long long)(units >> itf.tsExponent) * 1000000000LL
+                    + (long long)(((frac >> (itf.tsExponent - shift)) * 1000000000ULL) >> shift);
+            }
+            else if (itf.tsExponent <= 9)
+                *ts = (long long)units * (1000000000LL / itf.tsUnitsPerSec);
+            else
+                *ts = (long long)(units / (unsigned long long)(itf.tsUnitsPerSec / 1000000000LL));
+        }
+        _lastTs = *ts;
+        return true;
+    }
+    return false;
+}
+
+/*!
+* \fn _extract_udp_payload
+* \brief parse the link, IP and UDP headers of a captured packet, and apply the flow filter
+*
+* \param data captured data
+* \param caplen size of the captured data
+* \param linkType link type of the capture interface
+* \param payload pointer to the UDP payload
+* \return size of the UDP payload, -1 if the packet is not a (complete) UDP packet of the flow
+*/
+int CPcapDataSource::_extract_udp_payload(const unsigned char* data, int caplen, int linkType, const unsigned char** payload) {
+
+    int off = 0;
+    int proto = 0;      /* ethertype of the network layer */
+
+    switch (linkType) {
+    case LINKTYPE_ETHERNET:
+        if (caplen < 14)
+            return -1;
+        proto = get16be(data + 12);
+        off = 14;
+        // VLAN tags, possibly stacked (QinQ)
+        while ((proto == 0x8100 || proto == 0x88A8 || proto == 0x9100) && off + 4 <= caplen) {
+            proto = get16be(data + off + 2);
+            off += 4;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if (caplen < 16)
+            return -1;
+        proto = get16be(data + 14);
+        off = 16;
+        break;
+    case LINKTYPE_LINUX_SLL2:
+        if (caplen < 20)
+            return -1;
+        proto = get16be(data);
+        off = 20;
+        break;
+    case LINKTYPE_NULL:
+    case LINKTYPE_LOOP:
+    case LINKTYPE_RAW:
+    case LINKTYPE_RAW_OLD:
+    case LINKTYPE_IPV4:
+    case LINKTYPE_IPV6:
+        // The IP version is given by the IP header itself
+        off = (linkType == LINKTYPE_NULL || linkType == LINKTYPE_LOOP) ? 4 : 0;
+        if (caplen <= off)
+            return -1;
+        proto = ((data[off] >> 4) == 6) ? 0x86DD : 0x0800;
+        break;
+    default:
+        return -1;
+    }
+
+    const unsigned char* dst;
+    int dstLen;
+    if (proto == 0x0800) {
+        const unsigned char* ip = data + off;
+        if (caplen < off + 20 || (ip[0] >> 4) != 4)
+            return -1;
+        int ihl = (ip[0] & 0x0F) * 4;
+        // Fragments can't be replayed
+        if (ip[9] != IPPROTO_UDP || ihl < 20 || (get16be(ip + 6) & 0x3FFF) != 0)
+            return -1;
+        dst = ip + 16;
+        dstLen = 4;
+        off += ihl;
+    }
+    else if (proto == 0x86DD) {
+        const unsigned char* ip = data + off;
+        if (caplen < off + 40 || (ip[0] >> 4) != 6)
+            return -1;
+        int next = ip[6];
+        dst = ip + 24;
+        dstLen = 16;
+        off += 40;
+        // Skip extension headers: hop-by-hop, routing, destination options
+        while ((next == 0 || next == 43 || next == 60) && off + 8 <= caplen) {
+            next = data[off];
+            off += (data[off + 1] + 1) * 8;
+        }
+        if (next != IPPROTO_UDP)
+            return -1;
+    }
+    else
+        return -1;
+
+    if (caplen < off + 8)
+        return -1;
+    const unsigned char* udp = data + off;
+    int udpLen = get16be(udp + 4);
+    if (udpLen < 8)
+        return -1;
+    if (_dstPort >= 0 && get16be(udp + 2) != _dstPort)
+        return -1;
+    if (_filterAddrLen > 0 && (_filterAddrLen != dstLen || memcmp(dst, _filterAddr, dstLen) != 0))
+        return -1;
+    // The payload must be fully captured (snaplen)
+    if (off + udpLen > caplen)
+        return -1;
+    *payload = udp + 8;
+    return udpLen - 8;
+}
+
+/*!
+* \fn _pace
+* \brief wait for the time of a packet: its capture time relative to the first packet, scaled by
+*        the replay speed. The wait is a sleep, then a spin for the last microseconds.
+*
+* \param ts capture timestamp of the packet, in ns
+*/
+void CPcapDataSource::_pace(long long ts) {
+
+    if (_speed <= 0.0f)
+        return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (!_bPaced || ts < _startTs) {
+        _bPaced = true;
+        _startTs = ts;
+        _startTime = now;
+        return;
+    }
+    std::chrono::steady_clock::time_point due = _startTime + std::chrono::nanoseconds((long long)((double)(ts - _startTs) / _speed));
+    if (now - due > std::chrono::seconds(1)) {
+        // Too much in late... try to resync again
+        LOG_INFO("Too much in late... resync. (in late of %.02f seconds)", std::chrono::duration<double>(now - due).count());
+        _startTs = ts;
+        _startTime = now;
+        return;
+    }
+    if (due - now > std::chrono::seconds(10)) {
+        // Gap in the capture: don't wait for it
+        LOG_INFO("gap of %.02f seconds in the capture, skip it", std::chrono::duration<double>(due - now).count());
+        _startTs = ts;
+        _startTime = now;
+        return;
+    }
+    if (due - now > std::chrono::microseconds(200))
+        std::this_thread::sleep_for(due - now - std::chrono::microseconds(100));
+    while (std::chrono::steady_clock::now() < due)
+        std::this_thread::yield();
+}
+
+/*!
+* \fn nextPacket
+* \brief get the UDP payload of the next packet of the flow, without copy. The replay is paced on
+*        the capture timestamps.
+*
+* \param packet pointer to the UDP payload, valid until the source is destroyed
+* \param timestamp capture timestamp of the packet in ns, if not NULL
+* \return size of the UDP payload, 0 at the end of the file when not looping, or -1 if closed
+*/
+int CPcapDataSource::nextPacket(const char** packet, long long* timestamp) {
+
+    if (_map == NULL || _closed)
+        return -1;
+
+    const unsigned char* data;
+    int caplen, iface;
+    long long ts = 0;
+    bool bRestarted = false;
+    while (true) {
+        if (!_next_record(&data, &caplen, &iface, &ts)) {
+            // End of the file (or corrupted record)
+            if (!_loop || bRestarted)
+                return 0;
+            LOG_INFO("looping in file...");
+            _cursor = _firstRecord;
+            _bPaced = false;
+            bRestarted = true;
+            continue;
+        }
+        const unsigned char* payload;
+        int len = _extract_udp_payload(data, caplen, _interfaces[iface].linkType, &payload);
+        if (len < 0)
+            continue;
+        _pace(ts);
+        *packet = (const char*)payload;
+        if (timestamp)
+            *timestamp = ts;
+        return len;
+    }
+}
+
+int CPcapDataSource::read(char* buffer, int size) {
+
+    std::unique_lock<std::mutex> lock(_cs);
+    const char* packet;
+    int len = nextPacket(&packet);
+    if (len == 0) {
+        // Not looping: nothing more to read
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(PCAP_EOF_WAIT_MS));
+        return VMI_E_PACKET_LOST;
+    }
+    if (len < 0)
+        return -1;
+    if (len > size) {
+        LOG_WARNING("Size is lower than packet size (request=%d, packet=%d)", size, len);
+        len = size;
+    }
+    memcpy(buffer, packet, len);
+    return len;
+}
+
+/*!
+* \fn readScatter
+* \brief copy the next packets of the flow, straight from the file mapping, to their destination.
+*        When the replay is paced, one packet is returned at a time.
+*
+* \param packets destinations of the packets
+* \param nbPackets nb of packets to get at most
+* \return nb of packets, or VMI_E_PACKET_LOST at the end of the file when not looping
+*/
+int CPcapDataSource::readScatter(UDPScatter* packets, int nbPackets) {
+
+    std::unique_lock<std::mutex> lock(_cs);
+    if (_speed > 0.0f)
+        nbPackets = MIN(nbPackets, 1);
+    int n = 0;
+    for (; n < nbPackets; n++) {
+        const char* packet;
+        int len = nextPacket(&packet, &packets[n].timestamp);
+        if (len <= 0) {
+            if (n > 0)
+                break;
+            if (len < 0)
+                return -1;
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(PCAP_EOF_WAIT_MS));
+            return VMI_E_PACKET_LOST;
+        }
+        UDPScatter& s = packets[n];
+        int headerLen = MIN(len, s.headerLen);
+        memcpy(s.header, packet, headerLen);
+        if (len > headerLen && s.payload != NULL)
+            memcpy(s.payload, packet + headerLen, MIN(len - headerLen, s.payloadLen));
+        s.len = len;
+    }
+    return n;
+}
+
+/*!
+* \fn readBurst
+* \brief hand out the next packets of the flow, pointing into the file mapping. When the replay
+*        is paced, one packet is returned at a time.
+*
+* \param packets array receiving the packets
+* \param nbPackets nb of packets to get at most
+* \return nb of packets, or VMI_E_PACKET_LOST at the end of the file when not looping
+*/
+int CPcapDataSource::readBurst(DataSourcePacket* packets, int nbPackets) {
+
+    std::unique_lock<std::mutex> lock(_cs);
+    if (_speed > 0.0f)
+        nbPackets = MIN(nbPackets, 1);
+    int n = 0;
+    for (; n < nbPackets; n++) {
+        int len = nextPacket(&packets[n].data);
+        if (len <= 0) {
+            if (n > 0)
+                break;
+            if (len < 0)
+                return -1;
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(PCAP_EOF_WAIT_MS));
+            return VMI_E_PACKET_LOST;
+        }
+        packets[n].len = len;
+        packets[n].handle = NULL;
+    }
+    return n;
+}
+
+void CPcapDataSource::waitForNextFrame() {
+
+    // The replay is paced per packet
+}
+
+void CPcapDataSource::close() {
+
+    LOG("-->");
+    // The mapping is kept until the destruction, for the packets handed out by readBurst()
+    std::unique_lock<std::mutex> lock(_cs);
+    _closed = true;
+    LOG("<--");
+}
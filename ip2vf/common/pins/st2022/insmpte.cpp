@@ -14,6 +14,7 @@
 #include "tools.h"
 #include "rtpframe.h"
 #include "datasource.h"
+#include "workerpool.h"
 
 using namespace std;
 
@@ -41,13 +42,19 @@ CInSMPTE::CInSMPTE(CModuleConfiguration* pMainCfg, int nIndex) : CIn(pMainCfg, n
     PROPERTY_REGISTER_OPTIONAL("fmt", _fmt, 10);
     PROPERTY_REGISTER_OPTIONAL("queuesize", _nbSMPTEFrameToQueue, MAX_NB_SMPTE_FRAME);
     PROPERTY_REGISTER_OPTIONAL("onlyvideo", _onlyvideo, 0);
+    PROPERTY_REGISTER_OPTIONAL("workers", _nbWorkers, -1);
+    PROPERTY_REGISTER_OPTIONAL("workerscpus", _workersCpus, "");
 
     LOG_INFO("Nb SMPTE Frame to queue=%d", _nbSMPTEFrameToQueue);
+    _q.init(_nbSMPTEFrameToQueue, RING_OVERFLOW_DROP_OLDEST);
     LOG_INFO("Output bits format=%d bits", _fmt);
 
     if (_onlyvideo == 1) 
         LOG_INFO("Warning: VIDEO ONLY MODE");
 
+    // Workers shared by the per-frame parallel processing (SMPTE 425M level B demux, ...)
+    CWorkerPool::getInstance()->configure(_nbWorkers, _workersCpus);
+
     // Detect and init the source from the PIN configuration
     _source = CDMUXDataSource::create(_pConfig);
 
@@ -80,6 +87,13 @@ int CInSMPTE::_rcv_process() {
     int             lastSeq = -1, result = 0;
     int             frameCounter = 0;
     int             sampleSize = RTP_PACKET_SIZE;
+    int             headerLen = 0;          /* RTP+HBRMP headers length, to receive the payloads in place */
+    int             payloadLen = 0;
+    UDPScatter      scatter[INSMPTE_SCATTER_PACKETS];
+    unsigned char   headers[INSMPTE_SCATTER_PACKETS][INSMPTE_SCATTER_HEADER_SIZE];
+    DataSourcePacket burst[INSMPTE_SCATTER_PACKETS];
+    int             burstPos = 0, burstNb = 0;  /* packets of the current burst, the next frame can start in it */
+    int             scatterPos = 0, scatterNb = 0;  /* packets of the last scatter read, the next frame can start in it */
 
     //Blocking all other signals
 #ifndef WIN32
@@ -115,10 +129,17 @@ int CInSMPTE::_rcv_process() {
 			if (rtp._pt == 98) {
 				_streamType = SMPTE_2022_6;
 				LOG_INFO("%s: detect SMPTE_2022_6 standard suite", _name.c_str());
+				CHBRMPFrame hbrmp;
+				rtp.getHBRMPFrame(hbrmp);
+				headerLen = RTP_HEADERS_LENGTH + hbrmp._headerlen;
+				payloadLen = hbrmp.getPayloadLen();
+				if (headerLen > INSMPTE_SCATTER_HEADER_SIZE || payloadLen <= 0)
+					headerLen = payloadLen = 0;
 			}
 			else if (rtp._pt == 96) {
 				_streamType = SMPTE_2110_20;
 				LOG_INFO("%s: detect SMPTE_2110_20 standard suite", _name.c_str());
+				LOG_WARNING("%s: SMPTE 2110-20 streams are received by the 'st2110' input pin", _name.c_str());
 			}
 			else {
 
@@ -136,11 +157,39 @@ int CInSMPTE::_rcv_process() {
         pktTSctl = static_cast<CRTPDataSource*>(_source);
 #endif
 
+    bool bBurst = _source->isBurstCapable();
+    LOG_INFO("%s: %s receive", _name.c_str(), bBurst ? "zero-copy burst" : "scatter");
+
+    SmpteFrameBuffer* pFrame = NULL;
+    // Process a received RTP packet, its payload being at payload if received apart from the headers
+    auto addPacket = [&](unsigned char* packet, int len, const unsigned char* payload) {
+        if (len != sampleSize)
+            LOG_ERROR("%s: incorrect packet size, size=%d, wanted=%d", _name.c_str(), len, sampleSize);
+
+        CRTPFrame frame(packet, len);
+
+        //LOG_INFO("read=%d, frame._seq=%d", len, frame._seq);
+
+        // As soon as possible, prevent duplicated packet
+        if (lastSeq == frame._seq)
+            return;
+        lastSeq = frame._seq;
+
+        pFrame->_frame.addRTPPacket(&frame, payload);
+
+#ifdef HAVE_PROBE
+        if(pktTSctl != 0 && mediatimestamp == 0){       /* PktTS hook */
+            if((mediatimestamp = pFrame->_frame.getTimestamp()) != 0)
+                pktTSctl->pktTSctl(1, mediatimestamp);
+        }
+#endif
+    };
+
     while (_bStarted) {
 
         _source->waitForNextFrame();
 
-        SmpteFrameBuffer* pFrame = _smpteFrameArray[framePointer];
+        pFrame = _smpteFrameArray[framePointer];
         std::lock_guard<std::mutex> lock(pFrame->_lock);
         //LOG_INFO("%s: start to receive a SMPTE frame on buffer %d", pin->_name.c_str(), framePointer);
         pFrame->_frame.initNewFrame();
@@ -149,40 +198,78 @@ int CInSMPTE::_rcv_process() {
         mediatimestamp = 0;                                     /* PktTS hook */
         while (!pFrame->_frame.isComplete()) {
 
-            // First, keep the full RTP frame from the current UDP packet
-            result = _source->read((char*)rtp_packet, sampleSize);
-
-            // Detect stop
-            if (!_bStarted)
-                break;
-
-            if (result <= 0) {
-                if (result == VMI_E_NOT_PRIMARY_SRC || result == VMI_E_PACKET_LOST)
-                    // Not really an error, continue to accumulate packets for this frame
-                    continue;
-                // Otherwise, break to lost this frame
-                break;
-            }
-            else if (result != sampleSize)
-                LOG_ERROR("%s: incorrect packet size, size=%d, wanted=%d", _name.c_str(), result, sampleSize);
-
-            CRTPFrame frame(rtp_packet, result);
-
-            //LOG_INFO("read=%d, frame._seq=%d", result, frame._seq);
-
-            // As soon as possible, prevent duplicated packet
-            if (lastSeq == frame._seq)
+            // Burst capable source: the packets are processed straight from the source buffers, and
+            // given back all together once the burst is consumed
+            if (bBurst) {
+                if (burstPos == burstNb) {
+                    _source->releaseBurst(burst, burstNb);
+                    burstPos = burstNb = 0;
+                    result = _source->readBurst(burst, INSMPTE_SCATTER_PACKETS);
+                    if (!_bStarted)
+                        break;
+                    if (result <= 0) {
+                        if (result == VMI_E_NOT_PRIMARY_SRC || result == VMI_E_PACKET_LOST)
+                            continue;
+                        break;
+                    }
+                    burstNb = result;
+                }
+                while (burstPos < burstNb && !pFrame->_frame.isComplete()) {
+                    DataSourcePacket& packet = burst[burstPos++];
+                    addPacket((unsigned char*)packet.data, packet.len, NULL);
+                }
                 continue;
-            lastSeq = frame._seq;
+            }
 
-            pFrame->_frame.addRTPPacket(&frame);
+            // Once the frame size is known, the payloads of the next packets are received directly at
+            // their place in the frame, no more than the frame needs. Otherwise, the full RTP frame is
+            // received from the current UDP packet. The packets read after the end of the frame are kept
+            // for the next one: their payloads are moved from where they were received to the next frame
+            if (scatterPos == scatterNb) {
+                int room, nb = 0;
+                unsigned char* writer = pFrame->_frame.getWritePointer(&room);
+                if (writer != NULL && payloadLen > 0) {
+                    for (; nb < INSMPTE_SCATTER_PACKETS && (nb + 1) * payloadLen <= room; nb++) {
+                        scatter[nb].header = (char*)headers[nb];
+                        scatter[nb].headerLen = headerLen;
+                        scatter[nb].payload = (char*)writer + nb * payloadLen;
+                        scatter[nb].payloadLen = payloadLen;
+                    }
+                }
+                if (nb == 0) {
+                    scatter[0].header = (char*)rtp_packet;
+                    scatter[0].headerLen = sampleSize;
+                    scatter[0].payload = NULL;
+                    scatter[0].payloadLen = 0;
+                    nb = 1;
+                }
+                scatterPos = scatterNb = 0;
+                result = _source->readScatter(scatter, nb);
+
+                // Detect stop
+                if (!_bStarted)
+                    break;
+
+                if (result <= 0) {
+                    if (result == VMI_E_NOT_PRIMARY_SRC || result == VMI_E_PACKET_LOST)
+                        // Not really an error, continue to accumulate packets for this frame
+                        continue;
+                    // Otherwise, break to lost this frame
+                    break;
+                }
+                scatterNb = result;
+            }
 
-#ifdef HAVE_PROBE
-            if(pktTSctl != 0 && mediatimestamp == 0){           /* PktTS hook */
-                if((mediatimestamp = pFrame->_frame.getTimestamp()) != 0)
-                    pktTSctl->pktTSctl(1, mediatimestamp);
+            while (scatterPos < scatterNb && !pFrame->_frame.isComplete()) {
+                UDPScatter& packet = scatter[scatterPos++];
+                if (packet.len > packet.headerLen + packet.payloadLen || (packet.payload != NULL && packet.len != headerLen + payloadLen)) {
+                    // Partially received, the frame will be dropped as for a lost packet
+                    if (packet.len != sampleSize)
+                        LOG_ERROR("%s: incorrect packet size, size=%d, wanted=%d", _name.c_str(), packet.len, sampleSize);
+                    continue;
+                }
+                addPacket((unsigned char*)packet.header, packet.len, (unsigned char*)packet.payload);
             }
-#endif
         }
 #ifdef HAVE_PROBE
         if(pktTSctl != 0 && mediatimestamp != 0)                /* PktTS hook */
@@ -203,6 +290,7 @@ int CInSMPTE::_rcv_process() {
         _q.push(framePointer);
         framePointer = (framePointer + 1) % queueSize;
     }
+    _source->releaseBurst(burst, burstNb);
 
     LOG_INFO("%s: <--", _name.c_str());
     return 0;
@@ -234,8 +322,7 @@ SmpteFrameBuffer* CInSMPTE::_get_next_frame() {
         _firstFrame = false;
         float fps = pFrame->_frame.getProfile()->getFramerate();
         LOG_INFO("%s: Use framerate defined in profile: %.2f", _name.c_str(), fps);
-        if (_source->getType() == DataSourceType::TYPE_FILE)
-            (static_cast<CFileDataSource*>(_source))->setFrameRate(fps);
+        _source->setFrameRate(fps);
     }
 
     return pFrame;
@@ -317,6 +404,10 @@ void CInSMPTE::stop()
     _q.push(-1);    // In case of, to unblock blocking pop
 	if(_t.joinable())
 		_t.join();
+    RingQueueStats stats;
+    _q.getStats(&stats);
+    if (stats.dropped > 0)
+        LOG_INFO("%s: %llu SMPTE frames dropped, not read in time (queue of %d frames)", _name.c_str(), stats.dropped, stats.capacity);
     LOG("%s: stop thread <-- ", _name.c_str());
 
     if (_source)
@@ -40,6 +40,8 @@ COutSMPTE::COutSMPTE(CModuleConfiguration* pMainCfg, int nIndex) :
     PROPERTY_REGISTER_OPTIONAL( "mcastgroup", _mcastgroup, "");
     PROPERTY_REGISTER_OPTIONAL( "dcast",      _useDeltacast, false);
     PROPERTY_REGISTER_OPTIONAL( "fmt",        _smptefmt, OUTSMPTE_STANDARD_2022_6);
+    PROPERTY_REGISTER_OPTIONAL( "pacer",      _pacerCore, -1);
+    PROPERTY_REGISTER_OPTIONAL( "txtime",     _txTime, false);
 
     streamer = NULL;
 
@@ -67,9 +69,15 @@ COutSMPTE::~COutSMPTE() {
         delete streamer;
 }
 
-int COutSMPTE::send(CvMIFrame* frame) {
-
-    int result = VMI_E_OK;
+/*!
+* \fn prepare
+* \brief create the streamer on the first frame, and build the SMPTE frame (framing, CRC) of the
+*        vMI frame, before send()
+*
+* \param frame frame to prepare
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int COutSMPTE::prepare(CvMIFrame* frame) {
 
     if (!streamer) {
         if ((_standard == SMPTE_2022_6) && _useDeltacast)
@@ -78,8 +86,21 @@ int COutSMPTE::send(CvMIFrame* frame) {
             streamer = new CvMIStreamerCisco2022_6(_ip, _mcastgroup, _port, _pConfig, _interface);
         else if((_standard == SMPTE_2110_20) && _useDeltacast)
             throw std::runtime_error("not supported");
+        if (streamer && _pacerCore >= 0)
+            streamer->setPacer(CTxPacer::getInstance(_pacerCore));
+        if (streamer)
+            streamer->setTxTime(_txTime);
     }
 
+    if (streamer)
+        return streamer->prepare(frame);
+    return VMI_E_OK;
+}
+
+int COutSMPTE::send(CvMIFrame* frame) {
+
+    int result = VMI_E_OK;
+
     if (streamer) {
         result = streamer->send(frame);
     }
@@ -1,5 +1,7 @@
 #include <cstdio>
 #include <cstring>
+#include <cstdint>
+#include <mutex>
 
 #include "common.h"
 #include "log.h"
@@ -13,7 +15,13 @@ using namespace std;
 
 #define get18lsb(reg)         (_crc & 0x0003FFFF)
 
-static unsigned int* crc18_lookup_table = NULL;
+/*
+* crc18_lookup_table[0] is the CRC of one 10 bits word. crc18_lookup_table[k] is the CRC of
+* one word followed by k zero words: the CRC is linear, so 4 consecutive words are processed
+* with 4 independent lookups (slice-by-4).
+*/
+static unsigned int crc18_lookup_table[4][1024];
+static std::once_flag crc18_lookup_table_flag;
 
 /*!
 * \fn precomputeTable
@@ -23,7 +31,6 @@ static unsigned int* crc18_lookup_table = NULL;
 static void
 precomputeTable()
 {
-    crc18_lookup_table = (unsigned int*)malloc(1024 * sizeof(int));
     for (int j = 0; j < 1024; j++)
     {
         int _crc = 0;
@@ -43,15 +50,19 @@ precomputeTable()
             _crc = (_crc & ~(0x1 << 12)) | (newC12 << 12);
             word10bits >>= 1;
         }
-        crc18_lookup_table[j] = _crc;
+        crc18_lookup_table[0][j] = _crc;
     }
+    for (int k = 1; k < 4; k++)
+        for (int j = 0; j < 1024; j++) {
+            unsigned int crc = crc18_lookup_table[k - 1][j];
+            crc18_lookup_table[k][j] = (crc >> 10) ^ crc18_lookup_table[0][crc & 0x3FF];
+        }
 }
 
 CSMPTPCrc::CSMPTPCrc()
 {
     reset();
-    if (!crc18_lookup_table)
-        precomputeTable();
+    std::call_once(crc18_lookup_table_flag, precomputeTable);
 }
 
 CSMPTPCrc::~CSMPTPCrc()
@@ -78,7 +89,7 @@ CSMPTPCrc::reset()
 inline void
 CSMPTPCrc::compute_crc18_word(unsigned int word10bits)
 {
-    _crc = (_crc >> 10) ^ crc18_lookup_table[word10bits ^ (_crc & 0x3FF)];
+    _crc = (_crc >> 10) ^ crc18_lookup_table[0][word10bits ^ (_crc & 0x3FF)];
 }
 
 /*!
@@ -105,6 +116,55 @@ CSMPTPCrc::compute_crc18_scanline(unsigned char* buffer,
     return (unsigned int)get18lsb(_crc);
 }
 
+/*!
+* \fn compute_crc18_4words
+* \brief add 4 consecutive 10bits words on a CRC, with one lookup per word (slice-by-4)
+*
+* \param crc current CRC value
+* \param w0..w3 10bits words, in order
+* \return the new CRC value
+*/
+static inline unsigned int
+compute_crc18_4words(unsigned int crc, unsigned int w0, unsigned int w1, unsigned int w2, unsigned int w3)
+{
+    // The 18 bits of the CRC are added to the 2 first words
+    return crc18_lookup_table[3][(w0 ^ crc) & 0x3FF] ^ crc18_lookup_table[2][(w1 ^ (crc >> 10)) & 0x3FF] ^
+           crc18_lookup_table[1][w2] ^ crc18_lookup_table[0][w3];
+}
+
+/*!
+* \fn compute_crc18_interleaved
+* \brief compute in one pass the CRC of the two interleaved channels of a scanline (Cb/Cr words
+*        on even positions, Y words on odd positions), directly on the packed 10bits words
+*
+* \param buffer pointer to the first word, on a 5 bytes group boundary
+* \param nbWordsPerChannel number of 10 bits words to compute for each channel
+* \param crc0 CRC of the even words (chrominance)
+* \param crc1 CRC of the odd words (luminance)
+*/
+void
+CSMPTPCrc::compute_crc18_interleaved(unsigned char* buffer, unsigned int nbWordsPerChannel, CSMPTPCrc& crc0, CSMPTPCrc& crc1)
+{
+    unsigned int c = 0, y = 0;
+    const unsigned char* in = buffer;
+    unsigned int nbGroupPairs = nbWordsPerChannel / 4;
+
+    // 10 bytes give 4 words of each channel: C0 Y0 C1 Y1 | C2 Y2 C3 Y3
+    for (unsigned int i = 0; i < nbGroupPairs; i++) {
+        uint64_t g1 = ((uint64_t)in[0] << 32) | ((uint64_t)in[1] << 24) | ((uint64_t)in[2] << 16) | ((uint64_t)in[3] << 8) | (uint64_t)in[4];
+        uint64_t g2 = ((uint64_t)in[5] << 32) | ((uint64_t)in[6] << 24) | ((uint64_t)in[7] << 16) | ((uint64_t)in[8] << 8) | (uint64_t)in[9];
+        c = compute_crc18_4words(c, (unsigned int)(g1 >> 30), (unsigned int)(g1 >> 10) & 0x3FF, (unsigned int)(g2 >> 30), (unsigned int)(g2 >> 10) & 0x3FF);
+        y = compute_crc18_4words(y, (unsigned int)(g1 >> 20) & 0x3FF, (unsigned int)g1 & 0x3FF, (unsigned int)(g2 >> 20) & 0x3FF, (unsigned int)g2 & 0x3FF);
+        in += 10;
+    }
+    crc0._crc = c;
+    crc1._crc = y;
+    for (unsigned int i = nbGroupPairs * 4; i < nbWordsPerChannel; i++) {
+        crc0.compute_crc18_word(tools::get10bitsWord(buffer, i * 2));
+        crc1.compute_crc18_word(tools::get10bitsWord(buffer, i * 2 + 1));
+    }
+}
+
 /*!
 * \fn getCRC0
 * \brief calculate the first word of the SMPTE crc as define in st0292-1-2012.pdf, page 6
@@ -23,6 +23,7 @@ public:
 public:
     void         compute_crc18_word(unsigned int word10bits);
     unsigned int compute_crc18_scanline(unsigned char* buffer, unsigned int nbWords10bits, int nStartPos, int nStep);
+    static void  compute_crc18_interleaved(unsigned char* buffer, unsigned int nbWordsPerChannel, CSMPTPCrc& crc0, CSMPTPCrc& crc1);
     void         reset();
     unsigned int getCRC0();
     unsigned int getCRC1();
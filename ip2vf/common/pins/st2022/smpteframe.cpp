@@ -5,7 +5,7 @@
 #include "yuv.h"        // for conversion
 #include <fstream>      // for file saving
 #include <iostream>     // for file saving
-#include <thread>
+#include <algorithm>
 
 #include <pins/st2022/hbrmpframe.h>
 #include "rtpframe.h"
@@ -14,12 +14,13 @@
 #include "smpteframe.h"
 #include "smptecrc.h"
 #include "tools.h"
+#include "workerpool.h"
 #include "audiopacket.h"
 
 using namespace std;
 
 #define SMPTE_MEDIA_PACKET_SIZE   1375
-#define COMPUTE_CRC_FLAG          false     // Flag to enabled/disabled the CRC computation when create a SMPTE frame (remux feature) 
+#define COMPUTE_CRC_FLAG          false     // Default of the CRC computation when create a SMPTE frame (remux feature), see setComputeCRC() 
 
                         
 int EAV_DoubleChannel[6] = { 0x3ff, 0x3ff, 0x000, 0x000, 0x000, 0x000 };
@@ -46,9 +47,12 @@ CSMPTPFrame::CSMPTPFrame() {
     _bFrameComplete     = false;
     _bIncludeAudio      = false;
     _bVideoOnly         = false;
+    _bComputeCRC        = COMPUTE_CRC_FLAG;
     _nPadding           = 0;
     _timestamp          = 0;
     _formatDetected     = false;
+    _nbAvailableBuffers = 0;
+    _nextAvailableBuffer = 0;
 
     _audioFmt           = INTERLACED_MODE::NOT_DEFINED;
 }
@@ -123,13 +127,33 @@ void CSMPTPFrame::abortCurrentFrame() {
     _waitForNextFrame = true;
 }
 
+/*!
+* \fn getWritePointer
+* \brief return where the payload of the next packet goes in the frame, to receive it directly there
+*
+* \param room nb of bytes available from this location until the end of the frame
+* \return location of the next payload, NULL if the payloads can't be received in place yet (frame
+*         size not known, or waiting for the next frame)
+*/
+unsigned char* CSMPTPFrame::getWritePointer(int* room) {
+
+    if (_firstFrame || _waitForNextFrame || _writer == NULL) {
+        *room = 0;
+        return NULL;
+    }
+    *room = _completeframelen - (int)(_writer - _frame);
+    return _writer;
+}
+
 /*!
 * \fn addRTPPacket
 * \brief process a new received RTP packet, part of the current frame
 *
 * \param pPacket pointer to the RTP packet
+* \param payload location of the payload when received apart from the headers (see getWritePointer),
+*        NULL if it follows the headers in the packet
 */
-void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket) {
+void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket, const unsigned char* payload) {
 
     // Verify packet type validity
     if (pPacket->_pt != 98) {
@@ -161,50 +185,53 @@ void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket) {
     }
 
     // Access to HBRMP content
-    CHBRMPFrame* hbrmp = pPacket->getHBRMPFrame();
+    CHBRMPFrame hbrmp;
+    pPacket->getHBRMPFrame(hbrmp);
     //LOG_INFO("rtp timestamp=%lu", pPacket->_timestamp);
-    //LOG_INFO("hbrmp timestamp=%lu", hbrmp->_cf);
+    //LOG_INFO("hbrmp timestamp=%lu", hbrmp._cf);
     if (_firstPacket) {
         //LOG_INFO("receive first packet");
         //pPacket->dumpHeader();
-        //hbrmp->dumpHeader();
+        //hbrmp.dumpHeader();
         // If SMPTE profile is not set, try to detect it from hbrmp headers :
         // see 7289943.pdf documentation, "Transport of High Bit Rate Media Signals over IP Network (HBRMT)"
         if (_profile.getStandard() == SMPTE_NOT_DEFINED)
-            _profile.initProfileFromHBRMP(hbrmp);
+            _profile.initProfileFromHBRMP(&hbrmp);
         if (_profile.getStandard() == SMPTE_NOT_DEFINED) {
             LOG_ERROR("Error: This SMPTE format is not supported. Abort!");
             LOG_INFO("Abort.");
             exit(0);
         }
 
-        //LOG_DUMP10BITS((const char*)hbrmp->getPayload(), 32);
-        //LOG_INFO("timestanmp=%lu", hbrmp->_timestamp);
+        //LOG_DUMP10BITS((const char*)hbrmp.getPayload(), 32);
+        //LOG_INFO("timestanmp=%lu", hbrmp._timestamp);
         // Keep hbrmptimestamp from the first packet (will be overwritten)
-        _timestamp = hbrmp->getTimestamp();                     /* PktTS hook */
+        _timestamp = hbrmp.getTimestamp();                     /* PktTS hook */
         _firstPacket = false;
     }
-    if (_lastFc < 0) _lastFc = hbrmp->getFrameCounter();
-    if (_lastFc != hbrmp->getFrameCounter()) {
-        _lastFc = hbrmp->getFrameCounter();
+    if (_lastFc < 0) _lastFc = hbrmp.getFrameCounter();
+    if (_lastFc != hbrmp.getFrameCounter()) {
+        _lastFc = hbrmp.getFrameCounter();
     }
-    _actualframelen += hbrmp->getPayloadLen();
+    _actualframelen += hbrmp.getPayloadLen();
     _nbPacket++;
 
     // Add payload content to the current frame
     if (!_firstFrame && _writer != 0) {
-        if (((int)(_writer - _frame) + hbrmp->getPayloadLen()) > _completeframelen) {
+        if (((int)(_writer - _frame) + hbrmp.getPayloadLen()) > _completeframelen) {
             LOG_INFO("ERROR BUFFER OVERFLOW: used size=%d/%d, _actualframelen=%d, to write=%d", 
-                (_writer - _frame), _completeframelen, _actualframelen, hbrmp->getPayloadLen());
+                (_writer - _frame), _completeframelen, _actualframelen, hbrmp.getPayloadLen());
             _waitForNextFrame = true;
-            delete hbrmp;
             _reset();
             return;
         }
         else {
             //LOG_INFO("_writer############>");
-            memcpy(_writer, hbrmp->getPayload(), hbrmp->getPayloadLen());
-            _writer += hbrmp->getPayloadLen();
+            // Nothing to copy if the payload has been received at its place
+            const unsigned char* src = (payload != NULL ? payload : hbrmp.getPayload());
+            if (src != _writer)
+                memmove(_writer, src, hbrmp.getPayloadLen());
+            _writer += hbrmp.getPayloadLen();
         }
     }
 
@@ -214,8 +241,8 @@ void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket) {
         //LOG_INFO("Frame #%d, _nbPacket=%d, _actualframelen=%d", _frameCounter, _nbPacket, _actualframelen);
 
         // Keep hbrmptimestamp from last packet
-        _timestamp = hbrmp->getTimestamp();
-        _frameCounter = hbrmp->getFrameCounter();
+        _timestamp = hbrmp.getTimestamp();
+        _frameCounter = hbrmp.getFrameCounter();
 
         if (_firstFrame) {
             LOG_INFO("First frame initialisation --------->");
@@ -228,7 +255,6 @@ void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket) {
                 LOG_ERROR("... We received %d bytes", _actualframelen);
                 LOG_ERROR("... Profile [%s] say that frame length is %d bytes", _profile.getProfileName().c_str(), _profile.getTransportFrameSize());
                 abortCurrentFrame();
-                delete hbrmp;
                 return;
             }
             _nPadding = _actualframelen - _profile.getTransportFrameSize();
@@ -240,7 +266,6 @@ void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket) {
                 // we can have buffer overflow...
                 LOG_ERROR("Stream format validation failed. Abort!");
                 abortCurrentFrame();
-                delete hbrmp;
                 return;
             }
             LOG_INFO("First frame initialisation <---------");
@@ -251,28 +276,29 @@ void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket) {
             // The current frame seems valid, size is correct
            _bFrameComplete = true;
             //_frameCounter++;
-            _qAvailableBuffers.clear();
+            _nbAvailableBuffers = 0;
+            _nextAvailableBuffer = 0;
             switch (_profile.getStandard())
             {
             case SMPTE_STANDARD::SMPTE_292M:
             case SMPTE_STANDARD::SMPTE_425MlvlA:
             case SMPTE_STANDARD::SMPTE_259M:
-                _qAvailableBuffers.push_front(VIDEO_BUFFER_0);
+                _availableBuffers[_nbAvailableBuffers++] = VIDEO_BUFFER_0;
                 if (!_bVideoOnly) {
-                    _qAvailableBuffers.push_front(AUDIO_BUFFER_0);
-                    _qAvailableBuffers.push_front(ANC_BUFFER_0);
+                    _availableBuffers[_nbAvailableBuffers++] = AUDIO_BUFFER_0;
+                    _availableBuffers[_nbAvailableBuffers++] = ANC_BUFFER_0;
                 }
                 break;
             case SMPTE_STANDARD::SMPTE_425MlvlBDL:
-                _qAvailableBuffers.push_front(VIDEO_BUFFER_1);
+                _availableBuffers[_nbAvailableBuffers++] = VIDEO_BUFFER_1;
                 if (!_bVideoOnly) {
-                    _qAvailableBuffers.push_front(AUDIO_BUFFER_1);
-                    _qAvailableBuffers.push_front(ANC_BUFFER_1);
+                    _availableBuffers[_nbAvailableBuffers++] = AUDIO_BUFFER_1;
+                    _availableBuffers[_nbAvailableBuffers++] = ANC_BUFFER_1;
                 }
-                _qAvailableBuffers.push_front(VIDEO_BUFFER_2);
+                _availableBuffers[_nbAvailableBuffers++] = VIDEO_BUFFER_2;
                 if (!_bVideoOnly) {
-                    _qAvailableBuffers.push_front(AUDIO_BUFFER_2);
-                    _qAvailableBuffers.push_front(ANC_BUFFER_2);
+                    _availableBuffers[_nbAvailableBuffers++] = AUDIO_BUFFER_2;
+                    _availableBuffers[_nbAvailableBuffers++] = ANC_BUFFER_2;
                 }
                 _isDemultiplexed = false;
                 break;
@@ -288,8 +314,6 @@ void CSMPTPFrame::addRTPPacket(CRTPFrame* pPacket) {
         }
         _nbPacket = 0;
     }
-
-    delete hbrmp;
 }
 
 /*!
@@ -632,37 +656,36 @@ int  CSMPTPFrame::_extractSMPTEVideoContent(char* pOutputBuffer, int sizeOfOutpu
 
 /*!
 * \fn _demux_process
-* \brief job that demux a part of a SMPTE424M frame
+* \brief job that demux a part of a SMPTE425M level B dual link frame. Words are processed by
+*        pairs of 40 bits groups: 10 input bytes (8 words) give 5 bytes (4 words) for each
+*        link, so output bytes are written directly without read-modify-write.
 *
 * \param frame CSMPTPFrame object
-* \param in offset on the input buffer
-* \param out offset on the output buffer
-* \param count nb of 10bits words to process
+* \param first index of the first pair of 40 bits groups to process
+* \param count nb of pairs of 40 bits groups to process
 * \return 
 */
-void CSMPTPFrame::_demux_process(CSMPTPFrame* frame, int in, int out, int count) {
+void CSMPTPFrame::_demux_process(CSMPTPFrame* frame, int first, int count) {
 
-    int w[4];
-    unsigned char* src = frame->_frame;
-    unsigned char* dest1 = frame->_halfframe1;
-    unsigned char* dest2 = frame->_halfframe2;
-    //LOG_INFO("####### into workers thread [%d], in=%d, out=%d, nbToPrcoceed=%d", index, in, out, nbToPrcoceed);
+    const unsigned char* src = frame->_frame + first * 10;
+    unsigned char* dest1 = frame->_halfframe1 + first * 5;
+    unsigned char* dest2 = frame->_halfframe2 + first * 5;
     for (int i = 0; i < count; i++) {
-        w[0] = ((src[in + 0]) << 2) + ((src[in + 1] & 0b11000000) >> 6);
-        w[1] = ((src[in + 1] & 0b00111111) << 4) + ((src[in + 2] & 0b11110000) >> 4);
-        w[2] = ((src[in + 2] & 0b00001111) << 6) + ((src[in + 3] & 0b11111100) >> 2);
-        w[3] = ((src[in + 3] & 0b00000011) << 8) + ((src[in + 4]));
-
-        in += 5;
-        tools::set10bitsWord(dest1, out, w[0]);
-        tools::set10bitsWord(dest1, out + 1, w[1]);
-        tools::set10bitsWord(dest2, out, w[2]);
-        tools::set10bitsWord(dest2, out + 1, w[3]);
-        out += 2;
+        // Each 40 bits group contains 4 words: the two first for link 1, the two last for link 2
+        uint64_t g1 = ((uint64_t)src[0] << 32) | ((uint64_t)src[1] << 24) | ((uint64_t)src[2] << 16) | ((uint64_t)src[3] << 8) | (uint64_t)src[4];
+        uint64_t g2 = ((uint64_t)src[5] << 32) | ((uint64_t)src[6] << 24) | ((uint64_t)src[7] << 16) | ((uint64_t)src[8] << 8) | (uint64_t)src[9];
+        uint64_t l1 = ((g1 >> 20) << 20) | (g2 >> 20);
+        uint64_t l2 = ((g1 & 0xFFFFF) << 20) | (g2 & 0xFFFFF);
+        dest1[0] = (unsigned char)(l1 >> 32); dest1[1] = (unsigned char)(l1 >> 24); dest1[2] = (unsigned char)(l1 >> 16); dest1[3] = (unsigned char)(l1 >> 8); dest1[4] = (unsigned char)l1;
+        dest2[0] = (unsigned char)(l2 >> 32); dest2[1] = (unsigned char)(l2 >> 24); dest2[2] = (unsigned char)(l2 >> 16); dest2[3] = (unsigned char)(l2 >> 8); dest2[4] = (unsigned char)l2;
+        src += 10;
+        dest1 += 5;
+        dest2 += 5;
     }
 }
 
-#define USE_THREADS_POOL
+#define DEMUX_JOB_SIZE  16384   // nb of pairs of 40 bits groups per job of the worker pool
+#define CRC_JOB_LINES   64      // nb of scanlines per CRC job of the worker pool
 /*!
 * \fn _demuxSMPTE424MFrame
 * \brief demux the current frame, if it's a SMPTE425M Dual link frame, on two SMPTE292M frame
@@ -689,44 +712,30 @@ int CSMPTPFrame::_demuxSMPTE425MBDLFrame() {
         LOG_INFO("_halfframe2=0x%x, size=%d, nb words 10 bits=%d", _halfframe2, nHalfFrameSize, nbWords10bits);
     }
 
-    //LOG_INFO("_completeframelen=%d, _activeframelen=%d", _completeframelen, _activeframelen);
-
     //LOG_INFO("Extract new SMPTE frame");
-    long long t1 = tools::getCurrentTimeInMilliS();
-#ifdef USE_THREADS_POOL
-    int nbThread = 10;
-    for (int i = 0; i < nbThread; i++) {
-        int nbWordsToProcess = nbWords10bits / nbThread;
-        int in = i * nbWordsToProcess * 5 / 2;
-        int out = i * nbWordsToProcess * 2 / 2;
-        _workers.push_back(std::thread(_demux_process, this, in, out, nbWordsToProcess / 2));
-    }
-    for (std::thread &t : _workers) {
-        if (t.joinable()) {
-            t.join();
-        }
-    }
-    _workers.clear();
-#else
-    int in = 0; int out = 0, w[4];
-    //LOG_DUMP10BITS((const char*)_frame, 16);
-    while (out < nbWords10bits) {
-        // Read 4 10bits words, the two first seems to contain first frame, the two last for last frame
-
+    // Each link receive 4 words (5 bytes) per pair of input 40 bits groups
+    int nbPairs = nbWords10bits / 4;
+    int nbJobs = (nbPairs + DEMUX_JOB_SIZE - 1) / DEMUX_JOB_SIZE;
+    CWorkerPool::getInstance()->parallelFor(nbJobs, [=](int job) {
+        int first = job * DEMUX_JOB_SIZE;
+        _demux_process(this, first, std::min(DEMUX_JOB_SIZE, nbPairs - first));
+    });
+
+    // Remaining words, if the half frame is not a multiple of 4 words
+    int in = nbPairs * 10;
+    for (int out = nbPairs * 4; out + 1 < nbWords10bits; out += 2) {
+        int w[4];
         w[0] = ((_frame[in + 0]) << 2) + ((_frame[in + 1] & 0b11000000) >> 6);
         w[1] = ((_frame[in + 1] & 0b00111111) << 4) + ((_frame[in + 2] & 0b11110000) >> 4);
         w[2] = ((_frame[in + 2] & 0b00001111) << 6) + ((_frame[in + 3] & 0b11111100) >> 2);
         w[3] = ((_frame[in + 3] & 0b00000011) << 8) + ((_frame[in + 4]));
-
         in += 5;
         tools::set10bitsWord(_halfframe1, out, w[0]);
         tools::set10bitsWord(_halfframe1, out + 1, w[1]);
-        out += 2;
+        tools::set10bitsWord(_halfframe2, out, w[2]);
+        tools::set10bitsWord(_halfframe2, out + 1, w[3]);
     }
-#endif
     _isDemultiplexed = true;
-    long long t2 = tools::getCurrentTimeInMilliS();
-    //LOG_INFO("Process take %d ms", (int)(t2 - t1));
 
     return VMI_E_OK;
 }
@@ -926,7 +935,7 @@ void CSMPTPFrame::insertVideoContentToSMPTEFrame(char* buffer)
     }
 
     // Now new video content is inserted, need to compute again CRC
-    if ( COMPUTE_CRC_FLAG )
+    if ( _bComputeCRC )
         _computeCRC();
 
     //_analyse();
@@ -934,22 +943,24 @@ void CSMPTPFrame::insertVideoContentToSMPTEFrame(char* buffer)
 
 //(see st0292-1-2012.pdf, p6)
 void CSMPTPFrame::_computeCRC() {
-    CSMPTPCrc crcC;
-    CSMPTPCrc crcY;
-    unsigned char* p;
-
-    for (int i = 0; i < _profile.getScanlinesNb(); i++) {
-        //
-        // Calculate CRC for the current scanline, both for Luminance and Chrominance
-        //
-        p = (unsigned char*)_frame + i*_profile.getScanlineSize();
-        crcC.compute_crc18_scanline(p + _profile.getXOffset(), _profile.getActiveWidth() + 6, 0, 2);
-        crcY.compute_crc18_scanline(p + _profile.getXOffset(), _profile.getActiveWidth() + 6, 1, 2);
-        //
-        // Then insert the CRC after EAV+LN of the next scanline, except for last line
-        //
-        //LOG_INFO("line=%d,6              %x %x %x %x", i, crcC.getCRC0(), crcC.getCRC1(), crcY.getCRC0(), crcY.getCRC1());
-        if (i < _profile.getScanlinesNb() - 1) {
+    int nbLines = _profile.getScanlinesNb() - 1;
+    int nbJobs = (nbLines + CRC_JOB_LINES - 1) / CRC_JOB_LINES;
+
+    // The CRC of a line covers its active part, and the EAV+LN at the beginning of the next line.
+    // It is inserted just after, so lines can be processed in parallel.
+    CWorkerPool::getInstance()->parallelFor(nbJobs, [=](int job) {
+        CSMPTPCrc crcC;
+        CSMPTPCrc crcY;
+        int last = std::min(nbLines, (job + 1) * CRC_JOB_LINES);
+        for (int i = job * CRC_JOB_LINES; i < last; i++) {
+            //
+            // Calculate CRC for the current scanline, both for Luminance and Chrominance
+            //
+            unsigned char* p = (unsigned char*)_frame + i*_profile.getScanlineSize();
+            CSMPTPCrc::compute_crc18_interleaved(p + _profile.getXOffset(), _profile.getActiveWidth() + 6, crcC, crcY);
+            //
+            // Then insert the CRC after EAV+LN of the next scanline, except for last line
+            //
             p = (unsigned char*)_frame + (i + 1)*_profile.getScanlineSize();
             int j = 12;
             tools::set10bitsWord(p, j++, crcC.getCRC0());
@@ -957,7 +968,7 @@ void CSMPTPFrame::_computeCRC() {
             tools::set10bitsWord(p, j++, crcC.getCRC1());
             tools::set10bitsWord(p, j++, crcY.getCRC1());
         }
-    }
+    });
 }
 
 /*!
@@ -1310,11 +1321,8 @@ void CSMPTPFrame::compareSMPTEFrame(const char* filename1, const char* filename2
 */
 SMPTEFRAME_BUFFERS CSMPTPFrame::getNextAvailableMediaBuffer() {
 
-    if (_qAvailableBuffers.size() > 0) {
-        SMPTEFRAME_BUFFERS ret(std::move(_qAvailableBuffers.back()));
-        _qAvailableBuffers.pop_back();
-        return ret;
-    }
+    if (_nextAvailableBuffer < _nbAvailableBuffers)
+        return _availableBuffers[_nextAvailableBuffer++];
     return BUFFER_NONE;
 }
 
@@ -4,7 +4,6 @@
 #define SMPTE_PACKET_LENGTH    1376   // in case of Jumbo frames
 
 #include <vector>
-#include <thread>
 
 #include "smpteprofile.h"
 #include "queue.h"
@@ -46,6 +45,7 @@ private:
     bool    _bFrameComplete;
     bool    _bIncludeAudio;
     bool    _bVideoOnly;
+    bool    _bComputeCRC;        // compute and insert the line CRCs when new video content is inserted
     int     _nPadding;
     unsigned int    _timestamp;
     INTERLACED_MODE _audioFmt;
@@ -56,7 +56,6 @@ private:
     bool           _isDemultiplexed;
     unsigned char* _halfframe1;
     unsigned char* _halfframe2;
-    std::vector<std::thread> _workers;
 
 public:
     CSMPTPFrame();
@@ -65,7 +64,8 @@ public:
 public:
     void initNewFrame();
     void resetFrame();
-    void addRTPPacket(CRTPFrame* pPacket);
+    void addRTPPacket(CRTPFrame* pPacket, const unsigned char* payload = NULL);
+    unsigned char* getWritePointer(int* room);
     void abortCurrentFrame();
     void insertAudioContentToSMPTEFrame(unsigned char* buffer, int size);
     void insertVideoContentToSMPTEFrame(char* buffer);
@@ -102,6 +102,9 @@ public:
     void setVideoOnlyMode(bool flag) {
         _bVideoOnly = flag;
     }
+    void setComputeCRC(bool flag) {
+        _bComputeCRC = flag;
+    }
     int     getFrameWidth()  { return _profile.getActiveWidth();      };
     int     getFrameHeight() { return _profile.getActiveHeight();     };
     int     getFrameDepth()  { return _profile.getFrameDepth();       };
@@ -116,8 +119,10 @@ public:
     void    compareSMPTEFrame(const char* filename1, const char* filename2);
     void    loadFromFile(const char* filename);
 
-    std::deque<SMPTEFRAME_BUFFERS>     _qAvailableBuffers;
-    int     getNbOfMediaBuffer() { return (int)_qAvailableBuffers.size();  };
+    SMPTEFRAME_BUFFERS _availableBuffers[6];   // media buffers of the complete frame, in extraction order
+    int     _nbAvailableBuffers;
+    int     _nextAvailableBuffer;
+    int     getNbOfMediaBuffer() { return _nbAvailableBuffers - _nextAvailableBuffer;  };
     SMPTEFRAME_BUFFERS getNextAvailableMediaBuffer();
     static MEDIAFORMAT getMediaBufferType(SMPTEFRAME_BUFFERS buffer);
     int  extractMediaContent(SMPTEFRAME_BUFFERS buffer, char* pOutputBuffer, int sizeOfOutputBuffer);
@@ -140,7 +145,7 @@ private:
     void _computeCRC();
     int  _getXYZ(bool isEAV, int lineIdx);
 
-    static void _demux_process(CSMPTPFrame* frame, int in, int out, int count);
+    static void _demux_process(CSMPTPFrame* frame, int first, int count);
 };
 
 #endif //_SMPTEFRAME_H
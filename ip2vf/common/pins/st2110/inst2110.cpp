@@ -0,0 +1,188 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+#include <pins/pins.h>
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "tcp_basic.h"
+#include "rtpframe.h"
+
+using namespace std;
+
+/**********************************************************************************************
+*
+* CInST2110
+*
+***********************************************************************************************/
+
+CInST2110::CInST2110(CModuleConfiguration* pMainCfg, int nIndex) : CIn(pMainCfg, nIndex)
+{
+    LOG_INFO("%s: --> <--", _name.c_str());
+    _nType = PIN_TYPE_ST2110;
+    _bStarted = false;
+    _pendingLen = 0;
+    _frameNb = 0;
+    _lastTimestamp = 0;
+    memset(&_rxStats, 0, sizeof(_rxStats));
+    PROPERTY_REGISTER_MANDATORY("port", _port, -1);
+    PROPERTY_REGISTER_OPTIONAL("mcastgroup", _mcastgroup, "");
+    PROPERTY_REGISTER_OPTIONAL("interface", _interface, "");
+    PROPERTY_REGISTER_OPTIONAL("ip", _ip, "");
+    PROPERTY_REGISTER_OPTIONAL("rxbatch", _rxBatch, UDP_RXRING_DEFAULT_PACKETS);
+    PROPERTY_REGISTER_OPTIONAL("w", _w, 1920);
+    PROPERTY_REGISTER_OPTIONAL("h", _h, 1080);
+    PROPERTY_REGISTER_OPTIONAL("fmt", _fmt, 10);
+    PROPERTY_REGISTER_OPTIONAL("interlaced", _interlaced, false);
+
+    if (_assembler.init(_w, _h, _fmt, _interlaced) != VMI_E_OK) {
+        LOG_ERROR("%s: invalid configuration (w=%d, h=%d, fmt=%d). Exit.", _name.c_str(), _w, _h, _fmt);
+        exit(0);
+    }
+    _pending.resize(RTP_MAX_FRAME_LENGTH);
+
+    // Init Internal format header
+    _fh.SetModuleId(_nModuleId);
+    _fh.InitVideoHeadersFromTR03(_w, _h, SAMPLINGFMT::YCbCr_4_2_2, _fmt, _interlaced);
+    _fh.SetMediaSize(_assembler.getFrameSize());
+
+#ifdef USE_NETMAP
+    if (strncmp(_interface, "netmap-", 7) == 0)
+        _udpSock = new Netmap();
+    else
+#endif
+        _udpSock = new UDP();
+    _udpSock->enableBatchReceive(_rxBatch);
+}
+
+CInST2110::~CInST2110()
+{
+    _udpSock->closeSocket();
+    delete _udpSock;
+}
+
+/*!
+* \fn _detect_framerate
+* \brief set the framerate of the headers from the RTP timestamps (90 kHz) of consecutive frames
+*
+* \param timestamp RTP timestamp of the frame
+*/
+void CInST2110::_detect_framerate(unsigned int timestamp)
+{
+    unsigned int delta = timestamp - _lastTimestamp;
+    _lastTimestamp = timestamp;
+    if (_frameNb == 0 || delta == 0)
+        return;
+
+    float fps = 90000.0f / delta;
+    int best = -1;
+    for (int i = 0; i < g_FRATE_len; i++) {
+        if (best == -1 || fabs(g_FRATE[i].frame_rate_in_hz - fps) < fabs(g_FRATE[best].frame_rate_in_hz - fps))
+            best = i;
+    }
+    // Ignore the deltas of lost frames
+    if (best == -1 || fabs(g_FRATE[best].frame_rate_in_hz - fps) > g_FRATE[best].frame_rate_in_hz * 0.005f)
+        return;
+    if (_fh.GetFramerateCode() != g_FRATE[best].code) {
+        LOG_INFO("%s: detect framerate %.2f fps", _name.c_str(), g_FRATE[best].frame_rate_in_hz);
+        _fh.SetFramerateCode(g_FRATE[best].code);
+    }
+}
+
+int CInST2110::read(CvMIFrame* frame)
+{
+    LOG("%s: --> <--", _name.c_str());
+
+    //
+    // Manage the connection
+    //
+
+    if (!_udpSock->isValid()) {
+        int result = _udpSock->openSocket(_mcastgroup, _ip, _port, true, _interface);
+        if (result != E_OK) {
+            LOG_ERROR("%s: can't create listening UDP socket on [%s]:%d on interface '%s'",
+                _name.c_str(), _mcastgroup, _port, _interface[0] == '\0' ? "<default>" : _interface);
+            return VMI_E_FAILED_TO_OPEN_SOCKET;
+        }
+        LOG_INFO("%s: ok to create listening UDP socket on [%s]:%d on interface '%s'",
+            _name.c_str(), _mcastgroup, _port, _interface[0] == '\0' ? "<default>" : _interface);
+        _pendingLen = 0;
+    }
+
+    //
+    // Manage recv of data: the pixel groups are placed directly in the vMI frame
+    //
+
+    frame->createFrameFromHeaders(&_fh);
+    _assembler.beginFrame(frame->getMediaBuffer(), frame->getMediaSize());
+
+    while (_bStarted) {
+        const unsigned char* packet;
+        int len, result;
+        if (_pendingLen > 0) {
+            packet = _pending.data();
+            len = _pendingLen;
+            _pendingLen = 0;
+        }
+        else {
+            char* p;
+            result = _udpSock->readPacket(&p, &len);
+            if (!_bStarted)
+                break;
+            if (result <= 0) {
+                LOG_ERROR("%s: error when read RTP frame: size readed=%d, result=%d", _name.c_str(), len, result);
+                _udpSock->closeSocket();
+                return VMI_E_FAILED_TO_RCV_SOCKET;
+            }
+            packet = (const unsigned char*)p;
+        }
+
+        result = _assembler.addPacket(packet, len);
+        if (result == ST2110_PACKET_NEXT_FRAME) {
+            // The end of the current frame was lost: keep the packet for the next one
+            memcpy(_pending.data(), packet, len);
+            _pendingLen = len;
+        }
+        else if (result != ST2110_PACKET_END_OF_FRAME)
+            continue;
+
+        const ST2110RxStats* stats = _assembler.getStats();
+        _rxStats.lostPackets = stats->lostPackets;
+        if (!_assembler.isComplete()) {
+            // Incomplete frame (lost packets, or the first frame received): drop it
+            _rxStats.droppedFrames++;
+            LOG("%s: drop incomplete frame, timestamp=%u", _name.c_str(), _assembler.getTimestamp());
+            _assembler.beginFrame(frame->getMediaBuffer(), frame->getMediaSize());
+            continue;
+        }
+
+        _detect_framerate(_assembler.getTimestamp());
+        _fh.SetMediaTimestamp(_assembler.getTimestamp());
+        _fh.WriteHeaders(frame->getFrameBuffer(), _frameNb++);
+        frame->refreshHeaders();
+        return VMI_E_OK;
+    }
+    return VMI_E_CONNECTION_CLOSED;
+}
+
+void CInST2110::start()
+{
+    LOG("%s: -->", _name.c_str());
+    _bStarted = true;
+    LOG("%s: <--", _name.c_str());
+}
+
+void CInST2110::stop()
+{
+    LOG("%s: -->", _name.c_str());
+    _bStarted = false;
+    if (_udpSock && _udpSock->isValid())
+        _udpSock->closeSocket();
+    CIn::stop();
+    LOG("%s: <--", _name.c_str());
+}
+
+PIN_REGISTER(CInST2110, "st2110");
@@ -0,0 +1,217 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <pins/pins.h>
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "tcp_basic.h"
+#include "rtpframe.h"
+
+using namespace std;
+
+/**********************************************************************************************
+*
+* COutST2110
+*
+***********************************************************************************************/
+
+COutST2110::COutST2110(CModuleConfiguration* pMainCfg, int nIndex) : COut(pMainCfg, nIndex)
+{
+    LOG("%s: --> <-- ", _name.c_str());
+    _nType = PIN_TYPE_ST2110;
+    _bConfigured = false;
+    _bCorePinned = false;
+    _lastStats = 0;
+    PROPERTY_REGISTER_MANDATORY("ip", _ip, "");
+    PROPERTY_REGISTER_MANDATORY("port", _port, -1);
+    PROPERTY_REGISTER_OPTIONAL("mtu", _mtu, 1500);
+    PROPERTY_REGISTER_OPTIONAL("interface", _interface, "");
+    PROPERTY_REGISTER_OPTIONAL("mcastgroup", _mcastgroup, "");
+    PROPERTY_REGISTER_OPTIONAL("pt", _payloadType, ST2110_PAYLOAD_TYPE);
+    PROPERTY_REGISTER_OPTIONAL("type", _senderType, "N");
+    PROPERTY_REGISTER_OPTIONAL("linear", _linear, false);
+    PROPERTY_REGISTER_OPTIONAL("burst", _burst, 0);
+    PROPERTY_REGISTER_OPTIONAL("core", _core, -1);
+    PROPERTY_REGISTER_OPTIONAL("spin", _spin, ST2110_DEFAULT_SPIN_US);
+    PROPERTY_REGISTER_OPTIONAL("stats", _statsPeriod, 10);
+    PROPERTY_REGISTER_OPTIONAL("pacer", _pacerCore, -1);
+    PROPERTY_REGISTER_OPTIONAL("txtime", _txTime, false);
+    _isMulticast = !!_mcastgroup[0];
+    _packetizer.setPayloadType(_payloadType);
+    _scheduler.setSpin(_spin);
+    _batch.init(CST2110FramePacketizer::getMaxHeaderSize());
+    _pacer = (_pacerCore >= 0 ? CTxPacer::getInstance(_pacerCore) : NULL);
+    _batch.setPacer(_pacer);
+#ifdef USE_NETMAP
+    _udpSock = (strncmp(_interface, "netmap-", 7) == 0) ? new Netmap() : new UDP();
+#else
+    _udpSock = new UDP();
+#endif
+    _udpSock->enableTxTime(_txTime);
+}
+
+COutST2110::~COutST2110()
+{
+    if (_udpSock) {
+        _udpSock->closeSocket();
+        delete _udpSock;
+    }
+}
+
+/*!
+* \fn _configure
+* \brief set the packetizer and the schedule for the format of the frame, if it changed
+*
+* \param headers headers of the frame to send
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int COutST2110::_configure(CFrameHeaders* headers)
+{
+    bool interlaced = (headers->GetFrameType() == FRAMETYPE::FIELD);
+    float fps = 0;
+    for (int i = 0; i < g_FRATE_len; i++) {
+        if (g_FRATE[i].code == headers->GetFramerateCode())
+            fps = g_FRATE[i].frame_rate_in_hz;
+    }
+    char format[128];
+    snprintf(format, sizeof(format), "%dx%d%s%.2f/%d", headers->GetW(), headers->GetH(), interlaced ? "i" : "p", fps, headers->GetDepth());
+    if (_bConfigured && _format == format)
+        return VMI_E_OK;
+
+    _bConfigured = false;
+    _format = format;
+    LOG_INFO("%s: new format %s", _name.c_str(), format);
+    if (headers->GetSamplingFmt() != SAMPLINGFMT::YCbCr_4_2_2) {
+        LOG_ERROR("%s: only 4:2:2 YCbCr is supported", _name.c_str());
+        return VMI_E_NOT_SUPPORTED;
+    }
+    int packetSize = _mtu - IP_HEADERS_LENGTH - UDP_HEADERS_LENGTH;
+    if (_mtu <= 1500)
+        packetSize = std::min(packetSize, ST2110_STANDARD_UDP_SIZE);
+    int result = _packetizer.init(headers->GetW(), headers->GetH(), headers->GetDepth(), interlaced, packetSize);
+    if (result != VMI_E_OK)
+        return result;
+    ST2110_SENDER_TYPE type = (_senderType[0] == 'W' || _senderType[0] == 'w' ? ST2110_SENDER_W : ST2110_SENDER_N);
+    result = _scheduler.init(type, _linear, fps, headers->GetH(), interlaced, _packetizer.getPacketsPerField(), _burst);
+    if (result != VMI_E_OK)
+        return result;
+    _bConfigured = true;
+    return VMI_E_OK;
+}
+
+int COutST2110::send(CvMIFrame* vmiFrame)
+{
+    const unsigned char* buffer = vmiFrame->getMediaBuffer();
+    int result = E_OK;
+    int ret = 0;
+
+    if (buffer == NULL || vmiFrame->getMediaHeaders()->GetMediaFormat() != MEDIAFORMAT::VIDEO)
+        return ret;
+    if (_configure(vmiFrame->getMediaHeaders()) != VMI_E_OK)
+        return -1;
+    if (vmiFrame->getMediaSize() < _packetizer.getFrameSize()) {
+        LOG_ERROR("%s: frame too small (%d bytes, need %d)", _name.c_str(), vmiFrame->getMediaSize(), _packetizer.getFrameSize());
+        return -1;
+    }
+
+    //
+    // Manage the connection
+    //
+    if (!_udpSock->isValid()) {
+        if (_isMulticast)
+            result = _udpSock->openSocket(_mcastgroup, _ip, _port, false, _interface);
+        else
+            result = _udpSock->openSocket((char*)_ip, NULL, _port, false, _interface);
+        if (result != E_OK) {
+            LOG_ERROR("%s: can't create %s UDP socket on [%s]:%d on interface '%s'",
+                _name.c_str(), (_isMulticast ? "listening" : "connected"), (_isMulticast ? "NULL" : _ip), _port, _interface[0] == '\0' ? "<default>" : _interface);
+            return -1;
+        }
+        LOG_INFO("%s: Ok to create %s UDP socket on [%s]:%d on interface '%s'",
+            _name.c_str(), (_isMulticast ? "listening" : "connected"), (_isMulticast ? "NULL" : _ip), _port, _interface[0] == '\0' ? "<default>" : _interface);
+    }
+
+    // The sender waits for each packet: run it on its own core
+    if (!_bCorePinned && _core >= 0) {
+        _bCorePinned = true;
+        if (CTxPacer::setThreadCore(_core))
+            LOG_INFO("%s: sender running on core %d", _name.c_str(), _core);
+        else
+            LOG_ERROR("%s: can't run the sender on core %d", _name.c_str(), _core);
+    }
+
+    //
+    // With a pacing engine or in launch time mode, each packet is sent with its time: queue the
+    // packets of the frame, and wait until they are sent (pacing engine only, the kernel copies
+    // the packets in launch time mode)
+    //
+    _scheduler.nextFrame();
+    bool bTimed = (_pacer != NULL || _udpSock->isTxTime());
+    if (bTimed) {
+        for (int field = 0; field < _packetizer.getNbFields(); field++) {
+            _packetizer.beginField(buffer, field, _scheduler.getRtpTimestamp(field));
+            while (!_packetizer.isEndOfField()) {
+                if (_batch.isFull() && _batch.flush(_udpSock) != VMI_E_OK)
+                    ret = -1;
+                int index = _packetizer.getPacketIndex();
+                _packetizer.addPacket(&_batch);
+                _batch.setPacketTime(_scheduler.getPacketTime(field, index));
+            }
+        }
+        if (_batch.flush(_udpSock) != VMI_E_OK || _batch.sync() != VMI_E_OK) {
+            LOG_ERROR("%s: error write to socket", _name.c_str());
+            ret = -1;
+        }
+    }
+
+    //
+    // Otherwise, send the packets of each field, by bursts, at the time of the first packet of
+    // the burst
+    //
+    for (int field = 0; !bTimed && field < _packetizer.getNbFields(); field++) {
+        _packetizer.beginField(buffer, field, _scheduler.getRtpTimestamp(field));
+        bool bFirst = true;
+        while (!_packetizer.isEndOfField()) {
+            int index = _packetizer.getPacketIndex();
+            int nbPackets = 0;
+            while (nbPackets < _scheduler.getBurst() && !_packetizer.isEndOfField()) {
+                _packetizer.addPacket(&_batch);
+                nbPackets++;
+            }
+            long long deadline = _scheduler.getPacketTime(field, index);
+            long long t = _scheduler.waitUntil(deadline);
+            if (_batch.flush(_udpSock) != VMI_E_OK) {
+                LOG_ERROR("%s: error write to socket, packet #%d of field %d", _name.c_str(), index, field);
+                ret = -1;
+            }
+            _scheduler.release(deadline, t, nbPackets, bFirst);
+            bFirst = false;
+        }
+    }
+
+    // Pacing statistics
+    if (_statsPeriod > 0) {
+        long long t = CTxPacer::now();
+        if (_lastStats == 0)
+            _lastStats = t;
+        else if (t - _lastStats >= _statsPeriod * 1000000000LL) {
+            if (_pacer != NULL && !_udpSock->isTxTime())
+                _pacer->dumpStats(_name.c_str());
+            else
+                _scheduler.dumpStats(_name.c_str());
+            _lastStats = t;
+        }
+    }
+    return ret;
+}
+
+bool COutST2110::isConnected()
+{
+    return _udpSock->isValid();
+}
+
+PIN_REGISTER(COutST2110, "st2110");
@@ -0,0 +1,411 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>     // std::min
+#include <bitset>
+
+#include "common.h"
+#include "log.h"
+#include "rtpframe.h"
+#include "st2110frame.h"
+
+/*!
+* \fn _get_pgroup
+* \brief get the pixel group of a 4:2:2 YCbCr format, and check the frame size
+*
+* \param width width of the frame, in pixels
+* \param height height of the frame (both fields), in lines
+* \param depth bits per component: 8, 10 or 12
+* \param interlaced true if the frame is sent as two fields
+* \param pgroupSize size of a pixel group, in bytes
+* \param pgroupPixels nb of pixels of a pixel group
+* \return VMI_E_OK if Ok, VMI_E_NOT_SUPPORTED otherwise
+*/
+static int _get_pgroup(int width, int height, int depth, bool interlaced, int* pgroupSize, int* pgroupPixels)
+{
+    // 4:2:2: a pixel group is 2 pixels (Cb, Y0, Cr, Y1)
+    *pgroupPixels = 2;
+    switch (depth) {
+    case 8:  *pgroupSize = 4; break;
+    case 10: *pgroupSize = 5; break;
+    case 12: *pgroupSize = 6; break;
+    default:
+        LOG_ERROR("unsupported depth: %d bits", depth);
+        return VMI_E_NOT_SUPPORTED;
+    }
+    if (width <= 0 || height <= 0 || width % *pgroupPixels != 0 || (interlaced && height % 2 != 0)) {
+        LOG_ERROR("unsupported frame size: %dx%d%s", width, height, interlaced ? "i" : "p");
+        return VMI_E_NOT_SUPPORTED;
+    }
+    return VMI_E_OK;
+}
+
+/**********************************************************************************************
+*
+* CST2110FrameAssembler
+*
+***********************************************************************************************/
+
+CST2110FrameAssembler::CST2110FrameAssembler()
+{
+    _width = 0;
+    _height = 0;
+    _pgroupSize = 0;
+    _pgroupPixels = 0;
+    _lineSize = 0;
+    _interlaced = false;
+    _frame = NULL;
+    _frameSize = 0;
+    _bStarted = false;
+    _timestamp = 0;
+    _fieldTimestamp = 0;
+    _receivedBytes = 0;
+    _placedWordsPerLine = 0;
+    _bSecondField = false;
+    _bSync = false;
+    _lastSeq = 0;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/*!
+* \fn init
+* \brief set the format of the stream (4:2:2 YCbCr only)
+*
+* \param width width of the frame, in pixels
+* \param height height of the frame (both fields), in lines
+* \param depth bits per component: 8, 10 or 12
+* \param interlaced true if the frame is sent as two fields
+* \return VMI_E_OK if Ok, VMI_E_NOT_SUPPORTED otherwise
+*/
+int CST2110FrameAssembler::init(int width, int height, int depth, bool interlaced)
+{
+    if (_get_pgroup(width, height, depth, interlaced, &_pgroupSize, &_pgroupPixels) != VMI_E_OK)
+        return VMI_E_NOT_SUPPORTED;
+    _width = width;
+    _height = height;
+    _interlaced = interlaced;
+    _lineSize = width / _pgroupPixels * _pgroupSize;
+    _placedWordsPerLine = (width / _pgroupPixels + 63) / 64;
+    _placed.assign(_placedWordsPerLine * height, 0);
+    LOG_INFO("%dx%d%s, %d bits 4:2:2, pgroup=%d bytes, line=%d bytes", _width, _height, _interlaced ? "i" : "p", depth, _pgroupSize, _lineSize);
+    return VMI_E_OK;
+}
+
+/*!
+* \fn beginFrame
+* \brief start a new frame. The next packets are placed in buffer.
+*
+* \param buffer destination of the frame
+* \param size size of buffer, at least getFrameSize()
+*/
+void CST2110FrameAssembler::beginFrame(unsigned char* buffer, int size)
+{
+    if (buffer != NULL && size < getFrameSize()) {
+        LOG_ERROR("frame buffer too small (%d bytes, need %d bytes)", size, getFrameSize());
+        buffer = NULL;
+    }
+    _frame = buffer;
+    _frameSize = (buffer != NULL ? getFrameSize() : 0);
+    _bStarted = false;
+    _receivedBytes = 0;
+    _bSecondField = false;
+    std::fill(_placed.begin(), _placed.end(), 0);
+}
+
+/*!
+* \fn _place
+* \brief mark the pixel groups of a sample row data as placed in the current frame
+*
+* \param line index of the line in the frame
+* \param offset offset of the first pixel group in the line, in bytes
+* \param length size of the sample row data, a multiple of the pixel group size
+* \return nb of bytes not placed before, 0 for a duplicate
+*/
+int CST2110FrameAssembler::_place(int line, int offset, int length)
+{
+    unsigned long long* bits = &_placed[line * _placedWordsPerLine];
+    int first = offset / _pgroupSize;
+    int last = first + length / _pgroupSize;
+    int count = 0;
+    for (int i = first; i < last; ) {
+        int shift = i & 63;
+        int n = std::min(64 - shift, last - i);
+        unsigned long long mask = (n == 64 ? ~0ULL : ((1ULL << n) - 1) << shift);
+        count += (int)std::bitset<64>(mask & ~bits[i >> 6]).count();
+        bits[i >> 6] |= mask;
+        i += n;
+    }
+    return count * _pgroupSize;
+}
+
+/*!
+* \fn addPacket
+* \brief parse a RTP packet and copy its sample row data at their place in the current frame
+*
+* \param packet RTP packet
+* \param len size of the packet
+* \return ST2110_PACKET_OK, ST2110_PACKET_END_OF_FRAME after the last packet of the frame,
+*         ST2110_PACKET_NEXT_FRAME if the packet starts the next frame (it must be given again
+*         after beginFrame()), or ST2110_PACKET_ERROR
+*/
+int CST2110FrameAssembler::addPacket(const unsigned char* packet, int len)
+{
+    const unsigned char* end = packet + len;
+
+    // RTP headers
+    if (len < RTP_HEADERS_LENGTH || (packet[0] >> 6) != 2) {
+        _stats.invalidPackets++;
+        return ST2110_PACKET_ERROR;
+    }
+    int headerLen = RTP_HEADERS_LENGTH + 4 * (packet[0] & 0x0F);
+    if ((packet[0] & 0x10) && headerLen + 4 <= len)
+        headerLen += 4 + 4 * ((packet[headerLen + 2] << 8) | packet[headerLen + 3]);
+    if (packet[0] & 0x20)
+        end -= packet[len - 1];
+    const unsigned char* p = packet + headerLen;
+    if (p + ST2110_EXT_SEQ_LENGTH + ST2110_SRD_HEADER_LENGTH > end || (packet[1] & 0x7F) < ST2110_PAYLOAD_TYPE) {
+        _stats.invalidPackets++;
+        return ST2110_PACKET_ERROR;
+    }
+    bool marker = ((packet[1] & 0x80) != 0);
+    unsigned int seq = (p[0] << 24) | (p[1] << 16) | (packet[2] << 8) | packet[3];
+    unsigned int timestamp = ((unsigned int)packet[4] << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+    p += ST2110_EXT_SEQ_LENGTH;
+
+    // Sample row data headers, the continuation bit telling if another one follows
+    SRD srd[ST2110_MAX_SRD_PER_PACKET];
+    int nbSrd = 0;
+    bool bContinue = true;
+    bool bSecondField = false;
+    while (bContinue) {
+        if (p + ST2110_SRD_HEADER_LENGTH > end || nbSrd == ST2110_MAX_SRD_PER_PACKET) {
+            _stats.invalidPackets++;
+            return ST2110_PACKET_ERROR;
+        }
+        int field = p[2] >> 7;
+        int line = ((p[2] & 0x7F) << 8) | p[3];
+        int offset = ((p[4] & 0x7F) << 8) | p[5];
+        srd[nbSrd].length = (p[0] << 8) | p[1];
+        srd[nbSrd].line = (_interlaced ? line * 2 + field : line);
+        srd[nbSrd].offset = (offset % _pgroupPixels == 0 ? offset / _pgroupPixels * _pgroupSize : -1);
+        if (nbSrd == 0)
+            bSecondField = (field != 0);
+        bContinue = ((p[4] & 0x80) != 0);
+        nbSrd++;
+        p += ST2110_SRD_HEADER_LENGTH;
+    }
+
+    // Duplicated packets, and late packets of a previous frame, are ignored
+    unsigned int gap = seq - _lastSeq;
+    if (_bSync && (gap == 0 || (gap >= 0x80000000 && (!_bStarted || timestamp != _fieldTimestamp))))
+        return ST2110_PACKET_OK;
+
+    // Each field of an interlaced frame has its own timestamp: a new timestamp is the next frame,
+    // unless the second field starts
+    if (_bStarted && timestamp != _fieldTimestamp) {
+        if (!_interlaced || _bSecondField || !bSecondField)
+            return ST2110_PACKET_NEXT_FRAME;
+        _fieldTimestamp = timestamp;
+    }
+    if (!_bStarted) {
+        _bStarted = true;
+        _timestamp = timestamp;
+        _fieldTimestamp = timestamp;
+    }
+
+    // Sequence continuity. Reordered packets are placed anyway, the frame being complete once all
+    // its pixel groups are received
+    _stats.packets++;
+    if (!_bSync || gap < 0x80000000) {
+        if (_bSync)
+            _stats.lostPackets += gap - 1;
+        _bSync = true;
+        _lastSeq = seq;
+    }
+
+    // Pixel groups
+    for (int i = 0; i < nbSrd; i++) {
+        int length = srd[i].length;
+        if (p + length > end) {
+            _stats.invalidPackets++;
+            break;
+        }
+        if (_frame == NULL || srd[i].line >= _height || srd[i].offset < 0 || srd[i].offset + length > _lineSize || length % _pgroupSize != 0) {
+            _stats.invalidPackets++;
+        }
+        else {
+            memcpy(_frame + srd[i].line * _lineSize + srd[i].offset, p, length);
+            _receivedBytes += _place(srd[i].line, srd[i].offset, length);
+            _stats.srds++;
+        }
+        p += length;
+    }
+    if (bSecondField)
+        _bSecondField = true;
+
+    if (marker && (!_interlaced || _bSecondField)) {
+        if (isComplete())
+            _stats.completeFrames++;
+        else
+            _stats.incompleteFrames++;
+        return ST2110_PACKET_END_OF_FRAME;
+    }
+    return ST2110_PACKET_OK;
+}
+
+/**********************************************************************************************
+*
+* CST2110FramePacketizer
+*
+***********************************************************************************************/
+
+CST2110FramePacketizer::CST2110FramePacketizer()
+{
+    _width = 0;
+    _height = 0;
+    _pgroupSize = 0;
+    _pgroupPixels = 0;
+    _lineSize = 0;
+    _interlaced = false;
+    _fieldLines = 0;
+    _payloadSize = 0;
+    _packetsPerField = 0;
+    _payloadType = ST2110_PAYLOAD_TYPE;
+    _ssrc = 0;
+    _seq = 0;
+    _frame = NULL;
+    _field = 0;
+    _timestamp = 0;
+    _line = 0;
+    _offset = 0;
+    _packet = 0;
+}
+
+/*!
+* \fn init
+* \brief set the format of the stream (4:2:2 YCbCr only) and the size of the packets
+*
+* \param width width of the frame, in pixels
+* \param height height of the frame (both fields), in lines
+* \param depth bits per component: 8, 10 or 12
+* \param interlaced true if the frame is sent as two fields
+* \param packetSize max size of a RTP packet, headers included
+* \return VMI_E_OK if Ok, VMI_E_NOT_SUPPORTED otherwise
+*/
+int CST2110FramePacketizer::init(int width, int height, int depth, bool interlaced, int packetSize)
+{
+    if (_get_pgroup(width, height, depth, interlaced, &_pgroupSize, &_pgroupPixels) != VMI_E_OK)
+        return VMI_E_NOT_SUPPORTED;
+    _width = width;
+    _height = height;
+    _interlaced = interlaced;
+    _lineSize = width / _pgroupPixels * _pgroupSize;
+    _fieldLines = (interlaced ? height / 2 : height);
+
+    // Same size for all the packets (but the last one of a field): whole pixel groups, and never
+    // more than a line so that a packet has at most 2 sample row data
+    _payloadSize = std::min(packetSize - getMaxHeaderSize(), _lineSize) / _pgroupSize * _pgroupSize;
+    if (_payloadSize <= 0) {
+        LOG_ERROR("packet size too small: %d bytes", packetSize);
+        return VMI_E_NOT_SUPPORTED;
+    }
+    _packetsPerField = (_fieldLines * _lineSize + _payloadSize - 1) / _payloadSize;
+    _ssrc = (unsigned int)rand();
+    LOG_INFO("%dx%d%s, %d bits 4:2:2, payload=%d bytes, %d packets per field", _width, _height, _interlaced ? "i" : "p",
+        depth, _payloadSize, _packetsPerField);
+    return VMI_E_OK;
+}
+
+/*!
+* \fn beginField
+* \brief start to send a field (or the frame, if progressive)
+*
+* \param frame frame to send, in the vMI layout: getFrameSize() bytes
+* \param field 0, or 1 for the second field of an interlaced frame
+* \param timestamp RTP timestamp of the field
+*/
+void CST2110FramePacketizer::beginField(const unsigned char* frame, int field, unsigned int timestamp)
+{
+    _frame = frame;
+    _field = field;
+    _timestamp = timestamp;
+    _line = 0;
+    _offset = 0;
+    _packet = 0;
+}
+
+/*!
+* \fn addPacket
+* \brief add the next packet of the field on the batch. The batch must not be full.
+*
+* \param batch batch of packets to send, initialized with getMaxHeaderSize()
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CST2110FramePacketizer::addPacket(CUDPBatchSender* batch)
+{
+    if (isEndOfField())
+        return VMI_E_INVALID_PARAMETER;
+
+    // Sample row data of the packet: the end of a line, and the beginning of the next one
+    struct {
+        int line;
+        int offset;
+        int length;
+    } srd[2];
+    int nbSrd = 0;
+    int rest = _payloadSize;
+    while (rest > 0 && !isEndOfField()) {
+        int length = std::min(rest, _lineSize - _offset);
+        srd[nbSrd].line = _line;
+        srd[nbSrd].offset = _offset;
+        srd[nbSrd].length = length;
+        nbSrd++;
+        rest -= length;
+        _offset += length;
+        if (_offset == _lineSize) {
+            _line++;
+            _offset = 0;
+        }
+    }
+    bool marker = isEndOfField();
+
+    // RTP headers and extended sequence number
+    int headerLen = RTP_HEADERS_LENGTH + ST2110_EXT_SEQ_LENGTH + nbSrd * ST2110_SRD_HEADER_LENGTH;
+    unsigned char* p = (unsigned char*)batch->addPacket(headerLen);
+    if (p == NULL)
+        return VMI_E_ERROR;
+    p[0] = (2 << 6);
+    p[1] = (unsigned char)((marker ? 0x80 : 0) | (_payloadType & 0x7F));
+    p[2] = (unsigned char)(_seq >> 8);
+    p[3] = (unsigned char)_seq;
+    p[4] = (unsigned char)(_timestamp >> 24);
+    p[5] = (unsigned char)(_timestamp >> 16);
+    p[6] = (unsigned char)(_timestamp >> 8);
+    p[7] = (unsigned char)_timestamp;
+    p[8] = (unsigned char)(_ssrc >> 24);
+    p[9] = (unsigned char)(_ssrc >> 16);
+    p[10] = (unsigned char)(_ssrc >> 8);
+    p[11] = (unsigned char)_ssrc;
+    p[12] = (unsigned char)(_seq >> 24);
+    p[13] = (unsigned char)(_seq >> 16);
+    p += RTP_HEADERS_LENGTH + ST2110_EXT_SEQ_LENGTH;
+
+    // Sample row data headers, then the pixel groups, referenced in the frame
+    for (int i = 0; i < nbSrd; i++) {
+        int offset = srd[i].offset / _pgroupSize * _pgroupPixels;
+        p[0] = (unsigned char)(srd[i].length >> 8);
+        p[1] = (unsigned char)srd[i].length;
+        p[2] = (unsigned char)((_field << 7) | ((srd[i].line >> 8) & 0x7F));
+        p[3] = (unsigned char)srd[i].line;
+        p[4] = (unsigned char)((i + 1 < nbSrd ? 0x80 : 0) | ((offset >> 8) & 0x7F));
+        p[5] = (unsigned char)offset;
+        p += ST2110_SRD_HEADER_LENGTH;
+    }
+    for (int i = 0; i < nbSrd; i++) {
+        int line = (_interlaced ? srd[i].line * 2 + _field : srd[i].line);
+        batch->addPayload((const char*)_frame + (size_t)line * _lineSize + srd[i].offset, srd[i].length);
+    }
+    _seq++;
+    _packet++;
+    return VMI_E_OK;
+}
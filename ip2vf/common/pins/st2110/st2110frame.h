@@ -0,0 +1,144 @@
+#ifndef _ST2110FRAME_H
+#define _ST2110FRAME_H
+
+#include <vector>
+
+#include "common.h"
+#include "rtpframe.h"
+#include "udpbatchsender.h"
+
+#define ST2110_PAYLOAD_TYPE         96      /* dynamic payload type used for the video streams */
+#define ST2110_EXT_SEQ_LENGTH       2       /* extended sequence number, after the RTP headers */
+#define ST2110_SRD_HEADER_LENGTH    6       /* sample row data header */
+#define ST2110_MAX_SRD_PER_PACKET   32      /* sample row data headers per packet */
+#define ST2110_STANDARD_UDP_SIZE    1460    /* max UDP payload, unless the network supports jumbo frames */
+
+/* Result of CST2110FrameAssembler::addPacket */
+enum ST2110_PACKET_RESULT {
+    ST2110_PACKET_ERROR = -1,       /* not a valid RFC 4175 packet, ignored */
+    ST2110_PACKET_OK = 0,           /* packet placed in the frame */
+    ST2110_PACKET_END_OF_FRAME,     /* last packet of the frame (marker bit) */
+    ST2110_PACKET_NEXT_FRAME,       /* first packet of the next frame, not processed: end the current frame first */
+};
+
+/* Reception counters of a CST2110FrameAssembler */
+struct ST2110RxStats {
+    unsigned long long packets;
+    unsigned long long srds;            /* sample row data placed */
+    unsigned long long lostPackets;     /* gaps in the extended sequence numbers */
+    unsigned long long invalidPackets;  /* packets or sample row data out of the frame, ignored */
+    unsigned long long completeFrames;
+    unsigned long long incompleteFrames;
+};
+
+/**********************************************************************************************
+*
+* CST2110FrameAssembler
+*
+* SMPTE ST 2110-20 (RFC 4175) receive engine. The sample row data headers of a packet are
+* parsed in one pass into a fixed array, then the pixel groups are copied straight to their
+* place in the destination frame (one copy from the receive buffer, no allocation). The
+* destination frame is the active video, line after line, each line being width/pgroup pixel
+* groups: it's the vMI video layout for the supported 4:2:2 formats. The pixel groups already
+* placed are tracked in a bitmap, so that duplicated packets are not counted twice.
+*
+***********************************************************************************************/
+
+class CST2110FrameAssembler
+{
+    struct SRD {
+        int     length;             /* size of the sample row data */
+        int     line;               /* index of the line in the frame (fields interleaved) */
+        int     offset;             /* offset of the first pixel group in the line, in bytes */
+    };
+
+    int             _width;
+    int             _height;
+    int             _pgroupSize;        /* size of a pixel group, in bytes */
+    int             _pgroupPixels;      /* nb of pixels of a pixel group */
+    int             _lineSize;          /* size of a line, in bytes */
+    bool            _interlaced;
+
+    unsigned char*  _frame;             /* destination frame */
+    int             _frameSize;
+    bool            _bStarted;          /* a packet of the current frame was received */
+    unsigned int    _timestamp;         /* RTP timestamp of the current frame */
+    unsigned int    _fieldTimestamp;    /* RTP timestamp of the current field, if interlaced */
+    int             _receivedBytes;     /* bytes placed in the current frame, each pixel group once */
+    std::vector<unsigned long long> _placed;    /* bitmap of the pixel groups placed in the current frame */
+    int             _placedWordsPerLine;
+    bool            _bSecondField;      /* the last sample row data was on the second field */
+    bool            _bSync;             /* _lastSeq is valid */
+    unsigned int    _lastSeq;           /* last extended sequence number */
+    ST2110RxStats   _stats;
+
+    int  _place(int line, int offset, int length);
+
+public:
+    CST2110FrameAssembler();
+    ~CST2110FrameAssembler() {};
+
+    int  init(int width, int height, int depth, bool interlaced);
+    void beginFrame(unsigned char* buffer, int size);
+    void resync() { _bSync = false; };     /* forget the sequence numbers, e.g. the stream restarts */
+    int  addPacket(const unsigned char* packet, int len);
+
+    bool isComplete() { return _frameSize > 0 && _receivedBytes == _frameSize; };
+    unsigned int getTimestamp() { return _timestamp; };
+    int  getFrameSize() { return _lineSize * _height; };
+    int  getPgroupSize() { return _pgroupSize; };
+    const ST2110RxStats* getStats() { return &_stats; };
+};
+
+/**********************************************************************************************
+*
+* CST2110FramePacketizer
+*
+* SMPTE ST 2110-20 (RFC 4175) transmit side: a frame in the vMI 4:2:2 layout is cut, field after
+* field, in packets of the same size (general packing mode, a packet continuing on the next line
+* with a second sample row data header). The packets are built in a CUDPBatchSender, the pixel
+* groups being referenced in the frame buffer, without copy. The nb of packets per field being
+* constant, the packets can be scheduled before the frame is cut (see CST2110Scheduler).
+*
+***********************************************************************************************/
+
+class CST2110FramePacketizer
+{
+    int             _width;
+    int             _height;
+    int             _pgroupSize;        /* size of a pixel group, in bytes */
+    int             _pgroupPixels;      /* nb of pixels of a pixel group */
+    int             _lineSize;          /* size of a line, in bytes */
+    bool            _interlaced;
+    int             _fieldLines;        /* nb of lines of a field */
+    int             _payloadSize;       /* pixel bytes of a packet, the last one of a field being shorter */
+    int             _packetsPerField;
+    int             _payloadType;
+    unsigned int    _ssrc;
+    unsigned int    _seq;               /* extended sequence number of the next packet */
+
+    const unsigned char* _frame;        /* frame being sent */
+    int             _field;             /* current field: 0, or 1 for the second field of an interlaced frame */
+    unsigned int    _timestamp;         /* RTP timestamp of the current field */
+    int             _line;              /* next line to send, in the field */
+    int             _offset;            /* next byte to send, in the line */
+    int             _packet;            /* index of the next packet, in the field */
+
+public:
+    CST2110FramePacketizer();
+    ~CST2110FramePacketizer() {};
+
+    int  init(int width, int height, int depth, bool interlaced, int packetSize);
+    void setPayloadType(int payloadType) { _payloadType = payloadType; };
+    void beginField(const unsigned char* frame, int field, unsigned int timestamp);
+    int  addPacket(CUDPBatchSender* batch);
+
+    bool isEndOfField() { return _line >= _fieldLines; };
+    int  getPacketIndex() { return _packet; };
+    int  getPacketsPerField() { return _packetsPerField; };
+    int  getNbFields() { return _interlaced ? 2 : 1; };
+    int  getFrameSize() { return _lineSize * _height; };
+    static int getMaxHeaderSize() { return RTP_HEADERS_LENGTH + ST2110_EXT_SEQ_LENGTH + 2 * ST2110_SRD_HEADER_LENGTH; };
+};
+
+#endif //_ST2110FRAME_H
@@ -0,0 +1,238 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "common.h"
+#include "log.h"
+#include "txpacer.h"
+#include "st2110scheduler.h"
+
+#define NS_PER_SECOND   1000000000LL
+
+/**********************************************************************************************
+*
+* CST2110Scheduler
+*
+***********************************************************************************************/
+
+CST2110Scheduler::CST2110Scheduler()
+{
+    _num = 25;
+    _den = 1;
+    _interlaced = false;
+    _packetsPerField = 0;
+    _tFrame = 0;
+    _trs = 0;
+    _trOffset = 0;
+    _cmax = 0;
+    _vrxFull = 0;
+    _burst = 1;
+    _spin = (long long)ST2110_DEFAULT_SPIN_US * 1000;
+    _index = 0;
+    _epoch = 0;
+    _lastRelease = 0;
+    _lastNbPackets = 0;
+    resetStats();
+}
+
+/*!
+* \fn init
+* \brief compute the transmit schedule of a stream (ST 2110-21 TRS, TROFFSET, CMAX and VRX_FULL)
+*
+* \param type sender type, narrow or wide
+* \param linear true for linear timing (the packets use the whole frame period), false for gapped
+* \param fps frame rate. 59.94, 29.97, ... are 60000/1001, 30000/1001, ...
+* \param height height of the frame (both fields), in lines
+* \param interlaced true if the frame is sent as two fields
+* \param packetsPerField nb of packets of a field (of the frame, if progressive)
+* \param burst nb of packets released at once, 0 for the default (half of CMAX)
+* \return VMI_E_OK if Ok, VMI_E_INVALID_PARAMETER otherwise
+*/
+int CST2110Scheduler::init(ST2110_SENDER_TYPE type, bool linear, float fps, int height, bool interlaced, int packetsPerField, int burst)
+{
+    if (fps <= 0 || packetsPerField <= 0) {
+        LOG_ERROR("invalid stream: %.2f fps, %d packets per field", fps, packetsPerField);
+        return VMI_E_INVALID_PARAMETER;
+    }
+    int rate = (int)std::lround(fps);
+    _num = (std::fabs(fps - rate) > 0.01f ? rate * 1000 : rate);
+    _den = (std::fabs(fps - rate) > 0.01f ? 1001 : 1);
+    _interlaced = interlaced;
+    _packetsPerField = packetsPerField;
+    _tFrame = (double)NS_PER_SECOND * _den / _num;
+
+    // Active lines ratio and offset of the first packet (in lines) of the standard formats
+    int totalLines = 0;
+    int troLines = 0;
+    switch (height) {
+    case 486:  totalLines = 525;  break;
+    case 576:  totalLines = 625;  break;
+    case 720:  totalLines = 750;  troLines = 28; break;
+    case 1080: totalLines = 1125; troLines = (interlaced ? 22 : 43); break;
+    case 2160: totalLines = 2250; troLines = 86; break;
+    default: break;
+    }
+    double ractive = (totalLines > 0 ? (double)height / totalLines : 1.0);
+    if (linear) {
+        ractive = 1.0;
+        troLines = 0;
+    }
+    double tField = (interlaced ? _tFrame / 2 : _tFrame);
+    _trs = tField * ractive / packetsPerField;
+    _trOffset = (totalLines > 0 ? troLines * _tFrame / totalLines : 0);
+
+    // Network compatibility and virtual receiver buffer models
+    double nbPackets = (double)packetsPerField * (interlaced ? 2 : 1);
+    double tFrameSeconds = _tFrame / NS_PER_SECOND;
+    if (type == ST2110_SENDER_N) {
+        _cmax = std::max(4, (int)(nbPackets / (43200 * ractive * tFrameSeconds)));
+        _vrxFull = std::max(8, (int)(nbPackets / (27000 * tFrameSeconds)));
+    }
+    else {
+        _cmax = std::max(16, (int)(nbPackets / (21600 * tFrameSeconds)));
+        _vrxFull = std::max(720, (int)(nbPackets / (300 * tFrameSeconds)));
+    }
+
+    // A burst makes the packets early: stay below CMAX
+    _burst = (burst > 0 ? burst : _cmax / 2);
+    _burst = std::max(1, std::min(std::min(_burst, _cmax), UDPBATCH_MAX_PACKETS));
+    if (burst > _burst)
+        LOG_WARNING("burst of %d packets above CMAX, use %d", burst, _burst);
+
+    LOG_INFO("type %s%s, %d/%d fps, %d packets per %s, TRS=%.0f ns, TROFFSET=%.0f ns, CMAX=%d, VRX_FULL=%d, burst=%d packets",
+        type == ST2110_SENDER_N ? "N" : "W", linear ? "L" : "", _num, _den, packetsPerField, interlaced ? "field" : "frame",
+        _trs, _trOffset, _cmax, _vrxFull, _burst);
+    _index = 0;
+    _epoch = 0;
+    return VMI_E_OK;
+}
+
+long long CST2110Scheduler::_frame_start(long long index)
+{
+    // index x den / num seconds, without overflow
+    long long q = index / _num;
+    long long r = index % _num;
+    return q * _den * NS_PER_SECOND + r * _den * NS_PER_SECOND / _num;
+}
+
+/*!
+* \fn nextFrame
+* \brief start the next frame: the next frame period, or the first one still on time if the
+*        frame is late
+*
+* \return start of the frame, in ns
+*/
+long long CST2110Scheduler::nextFrame()
+{
+    long long t = CTxPacer::now();
+    _lastRelease = 0;
+    _stats.frames++;
+    if (_epoch != 0 && _frame_start(_index + 1) + (long long)_trOffset >= t) {
+        _index++;
+        _epoch = _frame_start(_index);
+        return _epoch;
+    }
+
+    // First frame, or late frame: first frame period still on time
+    long long first = (long long)std::floor(((double)t - _trOffset) * _num / ((double)_den * NS_PER_SECOND));
+    while (_frame_start(first) + (long long)_trOffset < t)
+        first++;
+    if (_epoch != 0)
+        _stats.skippedFrames += first - _index - 1;
+    _index = first;
+    _epoch = _frame_start(_index);
+    return _epoch;
+}
+
+/*!
+* \fn getRtpTimestamp
+* \brief RTP timestamp (90 kHz) of a field of the current frame
+*
+* \param field 0, or 1 for the second field of an interlaced frame
+* \return timestamp
+*/
+unsigned int CST2110Scheduler::getRtpTimestamp(int field)
+{
+    long long start = _epoch + (long long)(field * _tFrame / 2);
+    return (unsigned int)((start / 100000) * 9 + (start % 100000) * 9 / 100000);
+}
+
+/*!
+* \fn getPacketTime
+* \brief time to send a packet of the current frame
+*
+* \param field 0, or 1 for the second field of an interlaced frame
+* \param packet index of the packet in the field
+* \return nb of ns since the epoch
+*/
+long long CST2110Scheduler::getPacketTime(int field, int packet)
+{
+    return _epoch + (long long)(field * _tFrame / 2 + _trOffset + packet * _trs);
+}
+
+/*!
+* \fn waitUntil
+* \brief sleep until shortly before deadline, then busy-wait
+*
+* \param deadline nb of ns since the epoch
+* \return time at the end of the wait
+*/
+long long CST2110Scheduler::waitUntil(long long deadline)
+{
+    return CTxPacer::waitUntil(deadline, _spin);
+}
+
+/*!
+* \fn release
+* \brief account for packets sent
+*
+* \param deadline scheduled time of the first packet
+* \param time time of the release
+* \param nbPackets nb of packets released
+* \param bFirst true for the first packets of a field: no gap with the previous release
+*/
+void CST2110Scheduler::release(long long deadline, long long time, int nbPackets, bool bFirst)
+{
+    _stats.releases++;
+    _stats.packets += nbPackets;
+    double lateness = (double)(time - deadline);
+    _stats.latenessSum += lateness;
+    _stats.latenessMax = std::max(_stats.latenessMax, lateness);
+    if (lateness > _trs)
+        _stats.lateReleases++;
+    if (!bFirst && _lastNbPackets > 0) {
+        double ipg = (double)(time - _lastRelease) / _lastNbPackets;
+        _stats.nbIpg++;
+        _stats.ipgSum += ipg;
+        _stats.ipgSum2 += ipg * ipg;
+        _stats.ipgMin = (_stats.nbIpg == 1 ? ipg : std::min(_stats.ipgMin, ipg));
+        _stats.ipgMax = std::max(_stats.ipgMax, ipg);
+    }
+    _lastRelease = time;
+    _lastNbPackets = nbPackets;
+}
+
+void CST2110Scheduler::resetStats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/*!
+* \fn dumpStats
+* \brief log the achieved inter-packet gaps against the target (TRS) and reset the stats
+*
+* \param name name of the pin
+*/
+void CST2110Scheduler::dumpStats(const char* name)
+{
+    double n = (double)std::max(1ULL, _stats.nbIpg);
+    double mean = _stats.ipgSum / n;
+    double stddev = std::sqrt(std::max(0.0, _stats.ipgSum2 / n - mean * mean));
+    LOG_INFO("%s: %llu frames, %llu packets, %llu skipped frames. IPG target=%.0f ns, achieved mean=%.0f ns, stddev=%.0f ns, "
+        "min=%.0f ns, max=%.0f ns. Release lateness mean=%.0f ns, max=%.0f ns, %llu late releases",
+        name, _stats.frames, _stats.packets, _stats.skippedFrames, _trs, mean, stddev, _stats.ipgMin, _stats.ipgMax,
+        _stats.latenessSum / std::max(1ULL, _stats.releases), _stats.latenessMax, _stats.lateReleases);
+    resetStats();
+}
@@ -0,0 +1,85 @@
+#ifndef _ST2110SCHEDULER_H
+#define _ST2110SCHEDULER_H
+
+#include "common.h"
+
+#define ST2110_DEFAULT_SPIN_US      20      /* busy-wait the last µs before a packet, sleep before */
+
+/* Sender type of SMPTE ST 2110-21 */
+enum ST2110_SENDER_TYPE {
+    ST2110_SENDER_N = 0,            /* narrow: the packets are close to their schedule */
+    ST2110_SENDER_W,                /* wide: bigger bursts are allowed (software senders) */
+};
+
+/* Transmit statistics of a CST2110Scheduler. The inter-packet gap (IPG) is the time between two
+   releases of packets, divided by the nb of packets of the first release. */
+struct ST2110TxStats {
+    unsigned long long frames;
+    unsigned long long packets;
+    unsigned long long releases;        /* nb of times packets were sent */
+    unsigned long long skippedFrames;   /* frame periods skipped, the frame being ready too late */
+    unsigned long long lateReleases;    /* releases later than one TRS after their schedule */
+    unsigned long long nbIpg;           /* nb of inter-packet gaps measured */
+    double  ipgSum;                     /* sum of the inter-packet gaps, in ns */
+    double  ipgSum2;                    /* sum of the squares of the inter-packet gaps */
+    double  ipgMin;
+    double  ipgMax;
+    double  latenessSum;                /* sum of the release times minus the schedule, in ns */
+    double  latenessMax;
+};
+
+/**********************************************************************************************
+*
+* CST2110Scheduler
+*
+* SMPTE ST 2110-21 transmit schedule of a video stream. The frame periods are aligned on the
+* epoch (CLOCK_TAI), and the packets of a frame are spread evenly on the active video period
+* (gapped mode) or on the whole frame period (linear mode): the packet n of a field is sent
+* at TRO + n x TRS after the start of the field. To save system calls, the packets are released
+* by bursts below the CMAX limit of the sender type, at the time of the first packet of the
+* burst. The wait is a sleep until shortly before the release time, then a busy-wait (see
+* CTxPacer::waitUntil()).
+*
+***********************************************************************************************/
+
+class CST2110Scheduler
+{
+    int             _num;               /* frame rate, as num/den frames per second */
+    int             _den;
+    bool            _interlaced;
+    int             _packetsPerField;
+    double          _tFrame;            /* frame period, in ns */
+    double          _trs;               /* time between two packets, in ns */
+    double          _trOffset;          /* time between the start of a field and its first packet, in ns */
+    int             _cmax;              /* max burst of the network compatibility model, in packets */
+    int             _vrxFull;           /* size of the virtual receiver buffer, in packets */
+    int             _burst;             /* nb of packets released at once */
+    long long       _spin;              /* busy-wait duration, in ns */
+    long long       _index;             /* index of the current frame period since the epoch */
+    long long       _epoch;             /* start of the current frame, in ns */
+    long long       _lastRelease;       /* time of the last release, 0 at the start of a field */
+    int             _lastNbPackets;     /* nb of packets of the last release */
+    ST2110TxStats   _stats;
+
+    long long _frame_start(long long index);
+
+public:
+    CST2110Scheduler();
+    ~CST2110Scheduler() {};
+
+    int  init(ST2110_SENDER_TYPE type, bool linear, float fps, int height, bool interlaced, int packetsPerField, int burst = 0);
+    void setSpin(int us) { _spin = (long long)us * 1000; };
+    int  getBurst() { return _burst; };
+
+    long long nextFrame();
+    unsigned int getRtpTimestamp(int field);
+    long long getPacketTime(int field, int packet);
+    long long waitUntil(long long deadline);
+    void release(long long deadline, long long time, int nbPackets, bool bFirst);
+
+    const ST2110TxStats* getStats() { return &_stats; };
+    void resetStats();
+    void dumpStats(const char* name);
+};
+
+#endif //_ST2110SCHEDULER_H
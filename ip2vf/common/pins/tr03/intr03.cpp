@@ -22,6 +22,7 @@ CInTR03::CInTR03(CModuleConfiguration* pMainCfg, int nIndex) :
     PROPERTY_REGISTER_OPTIONAL("mcastgroup", _zmqip, "");
     PROPERTY_REGISTER_OPTIONAL("ip", _ip, "");
     PROPERTY_REGISTER_OPTIONAL("interface", _interface, "");
+    PROPERTY_REGISTER_OPTIONAL("rxbatch", _rxBatch, UDP_RXRING_DEFAULT_PACKETS);
 #ifdef USE_NETMAP
     _udpSock =
             (strncmp(_interface, "netmap-", 7) == 0) ?
@@ -29,6 +30,7 @@ CInTR03::CInTR03(CModuleConfiguration* pMainCfg, int nIndex) :
 #else
     _udpSock = new UDP();
 #endif
+    _udpSock->enableBatchReceive(_rxBatch);
 
     /**********************************************************
      if (_pConfig->_fmt == 1)
@@ -102,17 +104,19 @@ int CInTR03::read(CvMIFrame* vmiFrame)
         while (!doneParsingFrame)
         {
             int len, result;
+            char* packet;
 
-            // First, keep the full RTP frame from the current UDP packet
-            len = RTP_MAX_FRAME_LENGTH;
-            result = _udpSock->readSocket((char*) _RTPframe, &len);
-            if (result == -1)
+            // First, get the full RTP frame from the current UDP packet
+            result = _udpSock->readPacket(&packet, &len);
+            if (result <= 0)
             {
                 LOG_ERROR(
                         "%s: error when read RTP frame: size readed=%d, result=%d",
                         _name.c_str(), len, result);
+                _udpSock->closeSocket();
+                return VMI_E_FAILED_TO_RCV_SOCKET;
             }
-            CRTPFrame frame(_RTPframe, len);
+            CRTPFrame frame((unsigned char*)packet, len);
 
             LOG("%s: read=%d, frame._seq=%d", _name.c_str(), result, frame._seq);
             // As soon as possible, prevent duplicate packet
@@ -36,9 +36,9 @@ public:
     bool _isListen;
     int _lastSeq;
     int _frameNb;
-    unsigned char _RTPframe[RTP_MAX_FRAME_LENGTH];
 
     int _port;
+    int _rxBatch;
     int _w;
     int _h;
     int _fmt;
@@ -33,6 +33,8 @@ COutTR03::COutTR03(CModuleConfiguration* pMainCfg, int nIndex) : COut(pMainCfg,
     //PROPERTY_REGISTER_OPTIONAL("fmt", _depth, 20);
     PROPERTY_REGISTER_OPTIONAL("interface", _interface, "");
     PROPERTY_REGISTER_OPTIONAL("mcastgroup", _mcastgroup, "");
+    PROPERTY_REGISTER_OPTIONAL("pacer", _pacerCore, -1);
+    PROPERTY_REGISTER_OPTIONAL("txtime", _txTime, false);
     _isMulticast = !!_mcastgroup[0];
     //_linesize       = _w * _depth / 8;
     //_linepayloadsize = _linesize + TRO3_LINE_HEADERS_LENGTH;
@@ -46,11 +48,15 @@ COutTR03::COutTR03(CModuleConfiguration* pMainCfg, int nIndex) : COut(pMainCfg,
     if( _mtu > RTP_MAX_FRAME_LENGTH ) {
         // TODO: issue
     }
+    _batch.init(_RTPPacketSize);
+    if (_pacerCore >= 0)
+        _batch.setPacer(CTxPacer::getInstance(_pacerCore));
 #ifdef USE_NETMAP
     _udpSock = (strncmp(_interface, "netmap-", 7) == 0) ? new Netmap() : new UDP();
 #else
     _udpSock = new UDP();
 #endif
+    _udpSock->enableTxTime(_txTime);
 }
 
 COutTR03::~COutTR03()
@@ -100,26 +106,45 @@ int COutTR03::send(CvMIFrame* vmiFrame)
         _linepayloadsize = _linesize + TRO3_LINE_HEADERS_LENGTH;
         _pgroup = tools::getPPCM(headers->GetDepth(), 8);
 
-        // Create frames (RTP and TR03) that will be used to transfer this video frame
-        CRTPFrame frame(_RTPframe, _RTPPacketSize);
-        CTR03Frame* pTR03frame = frame.getTR03Frame();
-        pTR03frame->setFormat(headers->GetW(), headers->GetH(), headers->GetDepth() / 8);
+        // Frames (RTP and TR03) used to write the headers of each packet in the batch
+        CRTPFrame frame;
+        CTR03Frame tr03frame;
+        tr03frame.setFormat(headers->GetW(), headers->GetH(), headers->GetDepth() / 8);
+
+        // Schedule of the packets (pacing engine, launch time): each packet is sent at the time
+        // of its first scanline data in the frame, spread on most of the frame period
+        double framePeriod = _get_frame_period(headers);
+        double frameSize = (double)headers->GetH() * _linesize;
+        int nbPackets = (int)(((long long)headers->GetH() * _linepayloadsize + _payloadSize - 1) / _payloadSize);
+        long long frameStart = _batch.beginFrame(nbPackets, framePeriod);
 
         // Iterate to each scanline to encapsulate on TR03 packet
-        int bEndOfFrame = false;
         int lineNo = 0;
         int scanlinerest = 0;
         int scanlinetoprocess = headers->GetH();
         while (scanlinetoprocess > 0) {
-            int len, marker = 0;
+            int marker = 0;
 
-            // Prepare this TR03 frame (analyse how much scanlines or part of scanlines can be stored on this packet)
-            // This step is needed to prevent lot of memcpy
-            scanlinerest = pTR03frame->prepare(scanlinerest, _linesize, scanlinetoprocess);
+            // Send the batch when all its packets are used
+            if (_batch.isFull() && _batch.flush(_udpSock) != VMI_E_OK) {
+                LOG_ERROR("%s: error write to socket, RTP packet #%d, frame #%d, scanlinetoprocess=%d",
+                    _name.c_str(), _seq, _frameCount, scanlinetoprocess);
+                ret = -1;
+            }
 
-            // Add scanline on the packet
-            for (int i = 0; i < pTR03frame->getScanLineNb(); i++) {
-                bool isComplete = pTR03frame->addScanLine(p, lineNo, _linesize);
+            // Prepare this TR03 frame (analyse how much scanlines or part of scanlines can be stored on this packet)
+            unsigned char* packet = (unsigned char*)_batch.getNextHeader();
+            frame.setBuffer(packet, _RTPPacketSize);
+            tr03frame.setBuffer(packet + RTP_HEADERS_LENGTH, _RTPPacketSize - RTP_HEADERS_LENGTH);
+            scanlinerest = tr03frame.prepare(scanlinerest, _linesize, scanlinetoprocess);
+
+            // Add scanline headers on the packet. The data of the scanlines of a packet is
+            // contiguous on the frame buffer, and is sent without copy.
+            const unsigned char* payload = p + tr03frame._scanlines[0].dataoffset;
+            int payloadLen = 0;
+            for (int i = 0; i < tr03frame.getScanLineNb(); i++) {
+                payloadLen += tr03frame._scanlines[i].datalen;
+                bool isComplete = tr03frame.addScanLineHeader(lineNo);
                 if (isComplete) {
                     scanlinetoprocess--;
                     lineNo++;
@@ -127,30 +152,31 @@ int COutTR03::send(CvMIFrame* vmiFrame)
                 }
             }
 
-            // write RTP packet header. Not that the TR03 headers part has been updated when addScanLine
+            // write RTP packet header. Not that the TR03 headers part has been updated when addScanLineHeader
             if (scanlinetoprocess == 0)
                 marker = 1;
-            pTR03frame->writeHeader(_seq);
+            tr03frame.writeHeader(_seq);
             frame.writeHeader(_seq, marker, 98);
-            //pTR03frame->dumpHeader();
-
-            // Send the packet
-            len = _RTPPacketSize;
-            result = _udpSock->writeSocket((char*)_RTPframe, &len);
-            if (result != -1) {
-                LOG("%s: write (size=%d) to socket, result=%d, RTP packet #%d, frame #%d, scanlinetoprocess=%d",
-                    _name.c_str(), len, result, frame._seq, _frameCount, scanlinetoprocess);
-            }
-            else {
-                LOG_ERROR("%s: error write (size=%d) to socket, result=%d, RTP packet #%d, frame #%d, scanlinetoprocess=%d",
-                    _name.c_str(), len, result, frame._seq, _frameCount, scanlinetoprocess);
-                ret = -1;
-            }
+            //tr03frame.dumpHeader();
+
+            // Add the packet on the batch
+            int headerLen = RTP_HEADERS_LENGTH + TRO3_HEADERS_LENGTH + TRO3_LINE_HEADERS_LENGTH * tr03frame.getScanLineNb();
+            _batch.addPacket(headerLen);
+            if (framePeriod > 0)
+                _batch.setPacketTime(frameStart + (long long)((payload - (unsigned char*)buffer) * framePeriod * UDPBATCH_PACING_RATIO / frameSize));
+            _batch.addPayload((const char*)payload, payloadLen);
+            _batch.addPadding(_RTPPacketSize - headerLen - payloadLen);
 
             // Update the packet seq number
             _seq = (_seq+1) % MAX_UNSIGNED_INT32;
         }
 
+        // Send the remaining packets, and wait until they are sent before releasing the frame
+        if (_batch.flush(_udpSock) != VMI_E_OK || _batch.sync() != VMI_E_OK) {
+            LOG_ERROR("%s: error write to socket, RTP packet #%d, frame #%d", _name.c_str(), _seq, _frameCount);
+            ret = -1;
+        }
+
         _frameCount++;
     }
 
@@ -115,15 +115,29 @@ bool CTR03Frame::addScanLine(const unsigned char* linedata, int lineNo, int size
 
     LOG("Add line %d (offset=%d, len=%d, rest=%d)", lineNo, _scanlines[_line].dataoffset, _scanlines[_line].datalen, _scanlines[_line].rest);
 
+    // Copy the correct scanline data at the correct place on the packet
+    memcpy(_payload + _scanlines[_line].packoffset, linedata + _scanlines[_line].dataoffset, _scanlines[_line].datalen);
+
+    return addScanLineHeader(lineNo);
+}
+
+/*
+Add only the TR03 headers of the next scanline of the packet, when the data is sent from the
+scanline buffer without copy. Note that this packet must be previously "prepared".
+*/
+bool CTR03Frame::addScanLineHeader(int lineNo)
+{
+    if (_line >= _scanlines.size()) {
+        LOG_ERROR("exceed scan line (add no%d, avail=%d)", _line, _scanlines.size());
+        return 0;
+    }
+
     bool bLastLineInPacket = (_line == (_scanlines.size() - 1));
     bool bLineIsCompleted = (_scanlines[_line].rest == 0);
 
     // Set the current line nb
     _scanlines[_line].lineNo = lineNo;
 
-    // Copy the correct scanline data at the correct place on the packet
-    memcpy(_payload + _scanlines[_line].packoffset, linedata + _scanlines[_line].dataoffset, _scanlines[_line].datalen);
-
     // Set correct headers
     int headerOffset = TRO3_HEADERS_LENGTH + _line*TRO3_LINE_HEADERS_LENGTH;
     _frame[headerOffset]    = (_scanlines[_line].datalen >> 8) & 0b11111111;
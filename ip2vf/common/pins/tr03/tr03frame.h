@@ -59,6 +59,7 @@ public:
         return (int)_scanlines.size();
     };
     bool addScanLine(const unsigned char* linedata, int lineNo, int size);
+    bool addScanLineHeader(int lineNo);
     void dumpHeader();
     void readHeader() { 
         extractData(); 
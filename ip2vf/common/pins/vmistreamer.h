@@ -5,6 +5,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <atomic>
 
 #include "common.h"
 #include "tcp_basic.h"
@@ -54,8 +55,12 @@ public:
 
 public:
     // Interface to implement
+    virtual int  prepare(CvMIFrame* frame) { return VMI_E_OK; };   /* see COut::prepare() */
     virtual int  send(CvMIFrame* frame) = 0;
     virtual bool isConnected() = 0;
+    virtual void setPacer(CTxPacer* pacer) {};
+    virtual void setTxTime(bool enable) {};
+    virtual void setCapture(CUDPPacketList* list) {};         /* build the packets in list instead of sending them */
 
 };
 
@@ -83,8 +88,11 @@ protected:
     unsigned int _hbrmpTimestamp;
     bool    _firstvMIFrame;
     bool    _firstCompletedFrame;
-    struct tFrameStruc _frame;
+    struct tFrameStruc _frames[COUT_STAGES];    /* SMPTE frames: one being prepared while the previous one is sent */
+    std::atomic<unsigned int> _prepareIndex;    /* nb of video frames prepared */
+    unsigned int _sendIndex;                    /* nb of video frames sent */
     int     _curFrameNb;
+    CUDPPacketList* _capture;                   /* list the packets are built in, NULL to send them */
 
 public:
     CvMIStreamerCisco2022_6(const char* ip, const char* mcastgroup, int port, PinConfiguration *pconfig, const char* ifname = NULL);
@@ -92,8 +100,12 @@ public:
 
 public:
     // Interface to implement
+    int  prepare(CvMIFrame* frame);
     int  send(CvMIFrame* frame);
     bool isConnected();
+    void setPacer(CTxPacer* pacer) { _packetizer.setPacer(pacer); };
+    void setTxTime(bool enable) { _udpSock.enableTxTime(enable); };
+    void setCapture(CUDPPacketList* list) { _capture = list; _packetizer.setCapture(list); };
 };
 
 /**********************************************************************************************
@@ -127,6 +139,8 @@ public:
     // Interface to implement
     int  send(CvMIFrame* frame);
     bool isConnected();
+    void setPacer(CTxPacer* pacer) { _packetizer.setPacer(pacer); };
+    void setTxTime(bool enable) { _udpSock.enableTxTime(enable); };
 };
 
 
@@ -25,41 +25,36 @@ CvMIStreamerCisco2022_6::CvMIStreamerCisco2022_6(const char* ip, const char* mca
     _hbrmpTimestamp = 0;
     _firstvMIFrame = true;
     _firstCompletedFrame = false;
-    _frame.frame = new CSMPTPFrame();
+    for (int i = 0; i < COUT_STAGES; i++) {
+        _frames[i].frame = new CSMPTPFrame();
+        _frames[i].complete = false;
+    }
+    _prepareIndex = 0;
+    _sendIndex = 0;
     _curFrameNb = 0;
+    _capture = NULL;
 LOG_ERROR("ip=%s, mcast=%s, port=%d", ip, mcastgroup, port);
 }
 
 CvMIStreamerCisco2022_6::~CvMIStreamerCisco2022_6() {
 
-    delete _frame.frame;
+    for (int i = 0; i < COUT_STAGES; i++)
+        delete _frames[i].frame;
     if (_udpSock.isValid()) {
         _udpSock.closeSocket();
     }
 }
 
-int CvMIStreamerCisco2022_6::send(CvMIFrame* frame) {
-
-    // Manage the connection
-    if (!_udpSock.isValid())
-    {
-        const char* nic = _ifname;
-        int result = -1;
-        if (_isMulticast)
-        {
-            result = _udpSock.openSocket(_mcastgroup, _ip, _port, false, nic);
-        }
-        else
-        {
-            result = _udpSock.openSocket((char*)_ip, NULL, _port, false, nic);
-        }
-        if (result != E_OK)
-            LOG_ERROR("can't create %s main UDP socket on [%s]:%d on interface '%s'",
-                "connected", _ip, _port, nic[0] == '\0' ? "<default>" : nic);
-        else
-            LOG_INFO("Ok to create %s main UDP socket on [%s]:%d on interface '%s'",
-                "connected", _ip, _port, nic[0] == '\0' ? "<default>" : nic);
-    }
+/*!
+* \fn prepare
+* \brief insert the content of a vMI frame on the SMPTE frame being prepared: on the first video
+*        frame, init the SMPTE frames. A SMPTE frame is ready to be sent once its video is
+*        inserted (video as master: audio is inserted in the next video frame).
+*
+* \param frame vMI frame to insert
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CvMIStreamerCisco2022_6::prepare(CvMIFrame* frame) {
 
     // Verify data
     if (frame == NULL)
@@ -81,12 +76,14 @@ int CvMIStreamerCisco2022_6::send(CvMIFrame* frame) {
         headers->DumpHeaders();
         _firstvMIFrame = false;
         _firstCompletedFrame = true;
-        _frame.frame->initNewFrame();
-        //TODO: fix profile parsing, for now it's hardcoded
-        _frame.frame->setProfile("1080i59.94");
-        _frame.frame->prepareFrame();
-        _frame.frame->getProfile()->dumpProfile();
-        _packetizer.setProfile(_frame.frame->getProfile());
+        for (int i = 0; i < COUT_STAGES; i++) {
+            _frames[i].frame->initNewFrame();
+            //TODO: fix profile parsing, for now it's hardcoded
+            _frames[i].frame->setProfile("1080i59.94");
+            _frames[i].frame->prepareFrame();
+        }
+        _frames[0].frame->getProfile()->dumpProfile();
+        _packetizer.setProfile(_frames[0].frame->getProfile());
     }
     else if (_firstvMIFrame) {
         //  Nothing to do for Audio... Wait for first Video frame
@@ -94,18 +91,19 @@ int CvMIStreamerCisco2022_6::send(CvMIFrame* frame) {
     }
 
     // Current implementation is video as master
+    struct tFrameStruc& f = _frames[_prepareIndex.load(std::memory_order_relaxed) % COUT_STAGES];
     if (headers->GetMediaFormat() == MEDIAFORMAT::VIDEO)
     {
         _curFrameNb = _frameCount;
-        _frame.frame->setFrameNumber(_curFrameNb);
+        f.frame->setFrameNumber(_curFrameNb);
         _curFrameNb = headers->GetFrameNumber();
-        //_frame.frame->resetFrame();
-        _frame.frame->insertVideoContentToSMPTEFrame((char*)srcBuffer);
-        _packetizer.send(&_udpSock, (char*)_frame.frame->getBuffer(), _frame.frame->getBufferSize());
+        //f.frame->resetFrame();
+        f.frame->insertVideoContentToSMPTEFrame((char*)srcBuffer);
+        _prepareIndex.store(_prepareIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
     }
     else if (headers->GetMediaFormat() == MEDIAFORMAT::AUDIO)
     {
-        _frame.frame->insertAudioContentToSMPTEFrame(srcBuffer, headers->GetMediaSize());
+        f.frame->insertAudioContentToSMPTEFrame(srcBuffer, headers->GetMediaSize());
     }
     else {
         LOG_ERROR("vMI media format not supported (%d)", headers->GetMediaFormat());
@@ -114,6 +112,44 @@ int CvMIStreamerCisco2022_6::send(CvMIFrame* frame) {
     return VMI_E_OK;
 }
 
+int CvMIStreamerCisco2022_6::send(CvMIFrame* frame) {
+
+    // Manage the connection, none if the packets are captured
+    if (!_udpSock.isValid() && _capture == NULL)
+    {
+        const char* nic = _ifname;
+        int result = -1;
+        if (_isMulticast)
+        {
+            result = _udpSock.openSocket(_mcastgroup, _ip, _port, false, nic);
+        }
+        else
+        {
+            result = _udpSock.openSocket((char*)_ip, NULL, _port, false, nic);
+        }
+        if (result != E_OK)
+            LOG_ERROR("can't create %s main UDP socket on [%s]:%d on interface '%s'",
+                "connected", _ip, _port, nic[0] == '\0' ? "<default>" : nic);
+        else
+            LOG_INFO("Ok to create %s main UDP socket on [%s]:%d on interface '%s'",
+                "connected", _ip, _port, nic[0] == '\0' ? "<default>" : nic);
+    }
+
+    // Verify data
+    if (frame == NULL)
+        return VMI_E_INVALID_PARAMETER;
+
+    // Send the SMPTE frame prepared with this video frame, if any (see prepare())
+    if (frame->getMediaHeaders()->GetMediaFormat() == MEDIAFORMAT::VIDEO && _sendIndex != _prepareIndex.load(std::memory_order_acquire))
+    {
+        struct tFrameStruc& f = _frames[_sendIndex % COUT_STAGES];
+        _packetizer.send(&_udpSock, (char*)f.frame->getBuffer(), f.frame->getBufferSize());
+        _sendIndex++;
+    }
+
+    return VMI_E_OK;
+}
+
 bool CvMIStreamerCisco2022_6::isConnected() {
 
     return _udpSock.isValid();
@@ -0,0 +1,398 @@
+#ifndef _RINGQUEUE_H
+#define _RINGQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#endif
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>      // _mm_pause
+#define RINGQUEUE_CPU_RELAX()   _mm_pause()
+#else
+#define RINGQUEUE_CPU_RELAX()   std::this_thread::yield()
+#endif
+
+#define RINGQUEUE_SPIN          512     /* nb of tries of a blocking push()/pop() before it sleeps (multi-core only) */
+#define RINGQUEUE_CACHELINE     64
+
+/* What push() does when the queue is full */
+enum RingOverflowPolicy {
+    RING_OVERFLOW_BLOCK = 0,            /* wait for a free slot: back-pressure on the producers */
+    RING_OVERFLOW_DROP_OLDEST,          /* remove the oldest item to make room */
+    RING_OVERFLOW_DROP_NEWEST,          /* drop the pushed item */
+};
+
+/* Result of push() */
+enum RingPushResult {
+    RING_PUSHED = 0,
+    RING_PUSHED_DROP_OLDEST,            /* pushed, the oldest item was removed (RING_OVERFLOW_DROP_OLDEST) */
+    RING_DROPPED,                       /* not pushed, the queue is full (RING_OVERFLOW_DROP_NEWEST) */
+    RING_CLOSED,                        /* not pushed, the queue is closed */
+};
+
+/* Counters of a queue */
+struct RingQueueStats {
+    unsigned long long pushed;
+    unsigned long long popped;
+    unsigned long long dropped;         /* items dropped by the overflow policy */
+    int                occupancy;       /* items in the queue */
+    int                highWatermark;   /* max occupancy since the creation of the queue */
+    int                capacity;
+};
+
+/**********************************************************************************************
+*
+* CRingEvent
+*
+* Event count used by the queues to sleep until a condition, checked without lock, becomes
+* true: futex on Linux, mutex and condition variable otherwise. The low bit of the counter
+* flags sleeping threads: the first notify() clears it and wakes them, so the following ones,
+* until a thread sleeps again, make no system call.
+*
+***********************************************************************************************/
+class CRingEvent
+{
+    std::atomic<int>        _seq;
+#if !defined(__linux__)
+    std::mutex              _mutex;
+    std::condition_variable _condition;
+#endif
+
+public:
+    CRingEvent() { _seq = 0; };
+
+    /* Sleep until ready() returns true. notify() must be called after each change of its result */
+    template <typename F>
+    void wait(F ready) {
+        while (!wait(ready, -1))
+            ;
+    }
+
+    /* Same, for timeoutUs µs at most (-1: no limit). Return ready() */
+    template <typename F>
+    bool wait(F ready, long long timeoutUs) {
+        if (ready())
+            return true;
+        int key = _seq.fetch_or(1) | 1;
+        // Pairs with the fence of notify(): either we see the change, or notify() sees the flag
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready())
+            return true;
+#if defined(__linux__)
+        struct timespec timeout = { (time_t)(timeoutUs / 1000000), (long)(timeoutUs % 1000000) * 1000 };
+        syscall(SYS_futex, reinterpret_cast<int*>(&_seq), FUTEX_WAIT_PRIVATE, key, timeoutUs < 0 ? NULL : &timeout, NULL, 0);
+#else
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (timeoutUs < 0)
+            _condition.wait(lock, [&] { return _seq.load() != key; });
+        else
+            _condition.wait_for(lock, std::chrono::microseconds(timeoutUs), [&] { return _seq.load() != key; });
+#endif
+        return ready();
+    }
+
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int key = _seq.load(std::memory_order_relaxed);
+        if ((key & 1) == 0)
+            return;
+        // Clear the flag, if not done by a concurrent notify()
+        if (!_seq.compare_exchange_strong(key, key + 1))
+            return;
+#if defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<int*>(&_seq), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+        }
+        _condition.notify_all();
+#endif
+    }
+};
+
+/**********************************************************************************************
+*
+* CRingQueue
+*
+* Bounded queue between one or several producer threads (MultiProducer) and one consumer
+* thread, on a ring of cells stamped with a sequence number: a cell is free for the push of
+* index n when its sequence is n, and holds the item of index n when it's n + 1. The
+* producers and the consumer only share the cells, the push and pop indexes being on separate
+* cache lines. tryPush()/tryPop() never block; push()/pop() spin a little, then sleep on a
+* CRingEvent. When the queue is full, push() follows the overflow policy of the queue.
+*
+* close() makes the pushes fail and wakes the blocked producers, the items already in the queue
+* can still be popped: the consumer drains them before the queue is opened again.
+*
+* The capacity is rounded up to a power of two. With RING_OVERFLOW_DROP_OLDEST, the producers
+* remove the oldest items themselves: with several producers, a push() may remove more than
+* one item, only the last one being returned.
+*
+* Use the CSPSCRing and CMPSCRing aliases.
+*
+***********************************************************************************************/
+template <typename T, bool MultiProducer>
+class CRingQueue
+{
+    struct Cell {
+        std::atomic<size_t> seq;
+        T                   value;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t                  _mask;
+    RingOverflowPolicy      _policy;
+    char                    _pad0[RINGQUEUE_CACHELINE];
+    std::atomic<size_t>     _tail;              /* index of the next push */
+    std::atomic<unsigned long long> _pushed;
+    std::atomic<unsigned long long> _dropped;
+    std::atomic<int>        _highWatermark;
+    char                    _pad1[RINGQUEUE_CACHELINE];
+    std::atomic<size_t>     _head;              /* index of the next pop */
+    std::atomic<unsigned long long> _popped;
+    char                    _pad2[RINGQUEUE_CACHELINE];
+    std::atomic<bool>       _closed;
+    CRingEvent              _notEmpty;
+    CRingEvent              _notFull;
+
+    /* Add to a counter written by the producers */
+    template <typename C>
+    void _add(std::atomic<C>& counter, C value) {
+        if (MultiProducer)
+            counter.fetch_add(value, std::memory_order_relaxed);
+        else
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    bool _enqueue(T const& value) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            intptr_t dif = (intptr_t)cell->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+            if (dif == 0) {
+                if (!MultiProducer) {
+                    _tail.store(pos + 1, std::memory_order_relaxed);
+                    break;
+                }
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false;       // full
+            else
+                pos = _tail.load(std::memory_order_relaxed);
+        }
+        cell->value = value;
+        cell->seq.store(pos + 1, std::memory_order_release);
+
+        // Occupancy, as seen by this producer
+        int occupancy = (int)(pos + 1 - _head.load(std::memory_order_relaxed));
+        int hwm = _highWatermark.load(std::memory_order_relaxed);
+        while (occupancy > hwm && !_highWatermark.compare_exchange_weak(hwm, occupancy, std::memory_order_relaxed))
+            ;
+        return true;
+    }
+
+    bool _dequeue(T& value) {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &_cells[pos & _mask];
+            intptr_t dif = (intptr_t)cell->seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                // The producers only pop the head to drop the oldest item
+                if (_policy != RING_OVERFLOW_DROP_OLDEST) {
+                    _head.store(pos + 1, std::memory_order_relaxed);
+                    break;
+                }
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false;       // empty
+            else
+                pos = _head.load(std::memory_order_relaxed);
+        }
+        value = std::move(cell->value);
+        cell->seq.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool _is_full() {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        return (intptr_t)_cells[pos & _mask].seq.load(std::memory_order_acquire) - (intptr_t)pos < 0;
+    }
+
+    bool _is_empty() {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        return (intptr_t)_cells[pos & _mask].seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1) < 0;
+    }
+
+    template <typename F>
+    void _wait(CRingEvent& event, F ready) {
+        // Spinning only helps if the other side runs meanwhile on another core
+        static const int spin = (std::thread::hardware_concurrency() > 1 ? RINGQUEUE_SPIN : 0);
+        for (int i = 0; i < spin; i++) {
+            if (ready())
+                return;
+            RINGQUEUE_CPU_RELAX();
+        }
+        event.wait(ready);
+    }
+
+public:
+    CRingQueue() {
+        _mask = 0;
+        _policy = RING_OVERFLOW_BLOCK;
+        _tail = 0;
+        _head = 0;
+        _pushed = 0;
+        _popped = 0;
+        _dropped = 0;
+        _highWatermark = 0;
+        _closed = false;
+    }
+    CRingQueue(size_t capacity, RingOverflowPolicy policy = RING_OVERFLOW_BLOCK) : CRingQueue() {
+        init(capacity, policy);
+    }
+
+    /*!
+    * \fn init
+    * \brief allocate the cells of the queue, before any push or pop
+    *
+    * \param capacity max nb of items in the queue, rounded up to a power of two
+    * \param policy what push() does when the queue is full
+    */
+    void init(size_t capacity, RingOverflowPolicy policy = RING_OVERFLOW_BLOCK) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        _cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++)
+            _cells[i].seq.store(i, std::memory_order_relaxed);
+        _mask = size - 1;
+        _policy = policy;
+        _tail = 0;
+        _head = 0;
+    }
+
+    int capacity() { return (int)(_mask + 1); };
+    RingOverflowPolicy getPolicy() { return _policy; };
+
+    int size() {
+        size_t head = _head.load(std::memory_order_acquire);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        return (tail > head ? (int)(tail - head) : 0);
+    }
+
+    bool tryPush(T const& value) {
+        if (_closed.load(std::memory_order_acquire) || !_enqueue(value))
+            return false;
+        _add(_pushed, 1ULL);
+        _notEmpty.notify();
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        if (!_dequeue(value))
+            return false;
+        _popped.store(_popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        _notFull.notify();
+        return true;
+    }
+
+    /*!
+    * \fn push
+    * \brief push an item, following the overflow policy of the queue if it's full
+    *
+    * \param value item to push
+    * \param evicted if not NULL, receives the item removed to make room (RING_OVERFLOW_DROP_OLDEST)
+    * \return RING_PUSHED, RING_PUSHED_DROP_OLDEST or RING_DROPPED
+    */
+    int push(T const& value, T* evicted = NULL) {
+        int result = RING_PUSHED;
+        while (!tryPush(value)) {
+            if (_closed.load(std::memory_order_acquire))
+                return RING_CLOSED;
+            if (_policy == RING_OVERFLOW_DROP_NEWEST) {
+                _add(_dropped, 1ULL);
+                return RING_DROPPED;
+            }
+            if (_policy == RING_OVERFLOW_DROP_OLDEST) {
+                T oldest;
+                if (_dequeue(oldest)) {
+                    _add(_dropped, 1ULL);
+                    if (evicted)
+                        *evicted = std::move(oldest);
+                    result = RING_PUSHED_DROP_OLDEST;
+                }
+                continue;
+            }
+            _wait(_notFull, [this] { return !_is_full() || _closed.load(std::memory_order_acquire); });
+        }
+        return result;
+    }
+
+    T pop() {
+        T value;
+        while (!tryPop(value))
+            _wait(_notEmpty, [this] { return !_is_empty(); });
+        return value;
+    }
+
+    /*!
+    * \fn pop
+    * \brief pop an item, waiting for one while the queue is open
+    *
+    * \param value receives the item
+    * \return true if an item was popped, false if the queue is closed and empty
+    */
+    bool pop(T& value) {
+        while (!tryPop(value)) {
+            if (_closed.load(std::memory_order_acquire))
+                return tryPop(value);
+            _wait(_notEmpty, [this] { return !_is_empty() || _closed.load(std::memory_order_acquire); });
+        }
+        return true;
+    }
+
+    /*!
+    * \fn close
+    * \brief make the pushes fail, and wake the producers and the consumer waiting on the queue
+    */
+    void close() {
+        _closed.store(true, std::memory_order_release);
+        _notFull.notify();
+        _notEmpty.notify();
+    }
+
+    /* Accept the pushes again, after close() */
+    void reopen() { _closed.store(false, std::memory_order_release); };
+    bool isClosed() { return _closed.load(std::memory_order_acquire); };
+
+    void getStats(RingQueueStats* stats) {
+        stats->pushed = _pushed.load(std::memory_order_relaxed);
+        stats->popped = _popped.load(std::memory_order_relaxed);
+        stats->dropped = _dropped.load(std::memory_order_relaxed);
+        stats->occupancy = size();
+        stats->highWatermark = _highWatermark.load(std::memory_order_relaxed);
+        stats->capacity = capacity();
+    }
+};
+
+template <typename T> using CSPSCRing = CRingQueue<T, false>;
+template <typename T> using CMPSCRing = CRingQueue<T, true>;
+
+#endif //_RINGQUEUE_H
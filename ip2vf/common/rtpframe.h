@@ -49,8 +49,10 @@ public:
         return _m==1; 
     };
 
-    CHBRMPFrame* getHBRMPFrame() {
-        return new CHBRMPFrame((_frame + RTP_HEADERS_LENGTH), _framelen- RTP_HEADERS_LENGTH);
+    // Parse in place the HBRMP headers of this packet: hbrmp references the packet buffer, nothing is allocated
+    void getHBRMPFrame(CHBRMPFrame& hbrmp) {
+        hbrmp.setBuffer((_frame + RTP_HEADERS_LENGTH), _framelen - RTP_HEADERS_LENGTH);
+        hbrmp.readHeader();
     };
     CTR03Frame* getTR03Frame() {
         return new CTR03Frame((_frame + RTP_HEADERS_LENGTH), _framelen - RTP_HEADERS_LENGTH);
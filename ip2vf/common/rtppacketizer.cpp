@@ -2,8 +2,6 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <chrono>
-#include <thread>       // std::this_thread
 
 #include "common.h"
 #include "error.h"
@@ -26,57 +24,53 @@ CRTPPacketizer::CRTPPacketizer(int mtu) : CUDPPacketizer(mtu) {
     _RTPPayloadSize = _RTPPacketSize - RTP_HEADERS_LENGTH;
     _seq = 0;
     _payloadtype = 98;
+    _batch.init(RTP_HEADERS_LENGTH);
+    _batch.setPacing(500);
 }
 
 int CRTPPacketizer::send(UDP* sock, char* buffer, int buffersize) {
 
-    if (sock && sock->isValid())
+    if ((sock && sock->isValid()) || _batch.isCapturing())
     {
-        CRTPFrame frame((unsigned char*)_RTPframe, _RTPPacketSize);
-        int bEndOfFrame = false;
+        CRTPFrame frame;
         int remainingLen = buffersize;
-        unsigned int packetSentNb = 0;
         char* p = buffer;
 
+        // Schedule of the packets (pacing engine, launch time): spread on the frame period
+        _batch.beginFrame((buffersize + _RTPPayloadSize - 1) / _RTPPayloadSize, _framePeriod);
         while (remainingLen>0) {
 
-            int len, result, marker = 0;
+            int marker = 0;
 
-            // First, construct the full RTP frame
+            // Send the batch when all its packets are used
+            if (_batch.isFull() && _batch.flush(sock) != VMI_E_OK) {
+                LOG_ERROR("error write to socket, RTP packet #%d, remaining=%d", _seq, remainingLen);
+                _batch.sync();
+                return VMI_E_FAILED_TO_SND_SOCKET;
+            }
+
+            // First, construct the RTP headers, the payload is not copied
             int payloadLen = MIN(remainingLen, _RTPPayloadSize);
-            memcpy(_RTPframe + RTP_HEADERS_LENGTH, p, payloadLen);
             remainingLen -= payloadLen;
-            p += payloadLen;
             if (remainingLen == 0)
                 marker = 1;
+            frame.setBuffer((unsigned char*)_batch.addPacket(RTP_HEADERS_LENGTH), RTP_HEADERS_LENGTH);
             frame.writeHeader(_seq, marker, _payloadtype);
             _seq = (_seq + 1) % 65536;
+            _batch.addPayload(p, payloadLen);
+            p += payloadLen;
             if (payloadLen < _RTPPayloadSize) {
                 LOG("padding payload=%d", _RTPPayloadSize - payloadLen);
-                ::memset(_RTPframe + RTP_HEADERS_LENGTH + payloadLen, 0, _RTPPayloadSize - payloadLen);
+                _batch.addPadding(_RTPPayloadSize - payloadLen);
             }
             //frame.dumpHeader((char*)_RTPframe);
+        }
 
-            // Then send UDP packet
-            len = _RTPPacketSize;
-            result = sock->writeSocket(_RTPframe, &len);
-            if (result != -1) {
-                LOG("write (size=%d) to socket, result=%d, RTP packet #%d, payloadlen=%d, remaining=%d",
-                    len, result, frame._seq, payloadLen, remainingLen);
-            }
-            else {
-                LOG_ERROR("error write (size=%d) to socket, result=%d, RTP packet #%d, payloadlen=%d, remaining=%d",
-                    len, result, frame._seq, payloadLen, remainingLen);
-                return VMI_E_FAILED_TO_SND_SOCKET;
-            }
-
-            // Micro pacing
-            packetSentNb++;
-            if (packetSentNb % 500 == 0) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            }
+        // Then send the remaining UDP packets
+        if (_batch.flush(sock) != VMI_E_OK || _batch.sync() != VMI_E_OK) {
+            LOG_ERROR("error write to socket, RTP packet #%d", _seq);
+            return VMI_E_FAILED_TO_SND_SOCKET;
         }
     }
     return VMI_E_OK;
 }
-
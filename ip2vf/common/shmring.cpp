@@ -0,0 +1,493 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <thread>
+#include <chrono>
+#ifndef _WIN32
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#define GETPID              getpid()
+#else
+#include <process.h>
+#define GETPID              _getpid()
+#endif
+
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "frameheaders.h"
+#include "shmring.h"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared memory ring needs lock-free atomic int");
+
+#define SHMRING_ALIGN(a)    (((a) + SHMRING_CACHELINE - 1) & ~(SHMRING_CACHELINE - 1))
+#define SHMRING_COOKIE(session, index)  ((((session) & 0xFFFF) * SHMRING_MAX_SLOTS) + (index))
+
+/* true if the process still exists */
+static bool _isProcessAlive(int pid) {
+
+#ifndef _WIN32
+    return (kill(pid, 0) == 0 || errno == EPERM);
+#else
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (process == NULL)
+        return (GetLastError() == ERROR_ACCESS_DENIED);
+    bool alive = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+    CloseHandle(process);
+    return alive;
+#endif
+}
+
+CShmRing::CShmRing()
+#ifdef _WIN32
+    : _shm_id(INVALID_HANDLE_VALUE)
+#else
+    : _shm_id(-1)
+#endif
+{
+    _shm_key      = -1;
+    _shm_data     = NULL;
+    _isProducer   = false;
+    _ctrl         = NULL;
+    _slots        = NULL;
+    _data         = NULL;
+    _readSeq      = 0;
+    _readSeqValid = false;
+    _sessionId    = 0LL;
+    _nbSessions   = 0;
+    _reader       = NULL;
+    _lastRecovery = 0LL;
+    _nbDropped    = 0;
+    _nbSkipped    = 0;
+    _nbLost       = 0;
+}
+
+CShmRing::~CShmRing() {
+
+    close();
+}
+
+/*!
+* \fn _wait
+* \brief Sleep until writeSeq is different from seq, or timeout. Can wakeup earlier (spurious wakeup, wakeup()).
+*
+* \param seq value of writeSeq seen by the caller
+* \param timeoutMs maximum time to wait, in milliseconds
+*/
+void CShmRing::_wait(unsigned int seq, int timeoutMs) {
+
+#ifndef _WIN32
+    struct timespec ts;
+    ts.tv_sec  = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+    // Not a private futex: the word is shared between processes
+    syscall(SYS_futex, reinterpret_cast<int*>(&_ctrl->writeSeq), FUTEX_WAIT, (int)seq, &ts, NULL, 0);
+#else
+    // No cross-process futex here, poll the sequence counter
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (_ctrl->writeSeq.load() == seq && std::chrono::steady_clock::now() < end)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+}
+
+/*!
+* \fn _wake
+* \brief Wakeup all the consumers sleeping on writeSeq
+*/
+void CShmRing::_wake() {
+
+#ifndef _WIN32
+    syscall(SYS_futex, reinterpret_cast<int*>(&_ctrl->writeSeq), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+/*!
+* \fn _attachReader
+* \brief Take a free reader record for this consumer. If there is none, the records of the dead consumers are
+* given back first. Without record, the references of this consumer can't be recovered if it dies.
+*/
+void CShmRing::_attachReader() {
+
+    int pid = GETPID;
+    for (int retry = 0; retry < 2; retry++) {
+        for (int i = 0; i < SHMRING_MAX_READERS; i++) {
+            int expected = 0;
+            if (_ctrl->readers[i].pid.compare_exchange_strong(expected, pid)) {
+                _reader = &_ctrl->readers[i];
+                for (int j = 0; j < SHMRING_MAX_SLOTS; j++)
+                    _reader->held[j].store(0);
+                return;
+            }
+        }
+        _recoverReaders();
+    }
+    LOG_INFO("no free reader record on shmem ring (key=%d)", _shm_key);
+    _reader = NULL;
+}
+
+/*!
+* \fn _detachReader
+* \brief Give back the references of this consumer that remain, and free its reader record
+*/
+void CShmRing::_detachReader() {
+
+    if (_reader == NULL)
+        return;
+    for (int i = 0; i < _ctrl->nbSlots; i++) {
+        int held = _reader->held[i].exchange(0);
+        if (held > 0)
+            _slots[i].readers.fetch_sub(held, std::memory_order_release);
+    }
+    _reader->pid.store(0);
+    _reader = NULL;
+}
+
+/*!
+* \fn _recoverReaders
+* \brief Give back the slot references of the consumers whose process doesn't exist anymore, and free their records
+*/
+void CShmRing::_recoverReaders() {
+
+    for (int i = 0; i < SHMRING_MAX_READERS; i++) {
+        ShmRingReader* reader = &_ctrl->readers[i];
+        int pid = reader->pid.load();
+        if (pid <= 0 || _isProcessAlive(pid))
+            continue;
+        // -1 while recovering: the record can't be taken by a consumer, nor recovered twice
+        if (!reader->pid.compare_exchange_strong(pid, -1))
+            continue;
+        int recovered = 0;
+        for (int j = 0; j < _ctrl->nbSlots; j++) {
+            int held = reader->held[j].exchange(0);
+            if (held > 0) {
+                _slots[j].readers.fetch_sub(held, std::memory_order_release);
+                recovered += held;
+            }
+        }
+        reader->pid.store(0);
+        LOG_INFO("shmem ring (key=%d): consumer %d doesn't exist anymore, %d slot references given back", _shm_key, pid, recovered);
+    }
+}
+
+/*!
+* \fn create
+* \brief Create the shared memory segment and initialize the ring (producer side)
+*
+* \param shmkey key of the shared memory segment
+* \param nbSlots number of frame slots, up to SHMRING_MAX_SLOTS
+* \param slotSize maximum size of a vMI frame (headers + media)
+* \return VMI_E_OK if success
+*/
+int CShmRing::create(int shmkey, int nbSlots, int slotSize) {
+
+    if (shmkey <= 0 || nbSlots <= 0 || nbSlots > SHMRING_MAX_SLOTS || slotSize <= 0)
+        return VMI_E_INVALID_PARAMETER;
+
+    close();
+
+    int alignedSlotSize = SHMRING_ALIGN(slotSize);
+    int dataOffset = SHMRING_ALIGN(sizeof(ShmRingControl)) + nbSlots * sizeof(ShmRingSlot);
+    int size = dataOffset + nbSlots * alignedSlotSize;
+
+    _shm_data = tools::createSHMSegment(size, shmkey, _shm_id);
+    if (_shm_data == NULL) {
+        // A segment with another size may remain from a previous session: delete it, then retry
+        char* old = tools::getSHMSegment(0, shmkey, _shm_id);
+        if (old != NULL) {
+            LOG_INFO("delete previous shmem segment with key=%d", shmkey);
+            ShmRingControl* oldCtrl = reinterpret_cast<ShmRingControl*>(old);
+            if (oldCtrl->magic == SHMRING_MAGIC)
+                oldCtrl->closed.store(1);
+            tools::deleteSHMSegment(old, _shm_id);
+        }
+        _shm_data = tools::createSHMSegment(size, shmkey, _shm_id);
+    }
+    if (_shm_data == NULL) {
+        LOG_ERROR("***ERROR*** failed to create shared memory ring of %d bytes, key=%d", size, shmkey);
+        return VMI_E_MEM_FAILED_TO_ALLOC;
+    }
+
+    _shm_key    = shmkey;
+    _isProducer = true;
+    _ctrl       = reinterpret_cast<ShmRingControl*>(_shm_data);
+    _slots      = reinterpret_cast<ShmRingSlot*>(_shm_data + SHMRING_ALIGN(sizeof(ShmRingControl)));
+    _data       = reinterpret_cast<unsigned char*>(_shm_data) + dataOffset;
+
+    // Magic is written last, when the ring is completely initialized
+    _ctrl->magic = 0;
+    _ctrl->version   = SHMRING_VERSION;
+    _ctrl->nbSlots   = nbSlots;
+    _ctrl->slotSize  = alignedSlotSize;
+    _ctrl->closed.store(0);
+    _ctrl->nbWaiters.store(0);
+    for (int i = 0; i < nbSlots; i++) {
+        _slots[i].seq.store(SHMRING_SLOT_WRITING);
+        _slots[i].readers.store(0);
+        _slots[i].frameSize = 0;
+    }
+    for (int i = 0; i < SHMRING_MAX_READERS; i++) {
+        _ctrl->readers[i].pid.store(0);
+        for (int j = 0; j < SHMRING_MAX_SLOTS; j++)
+            _ctrl->readers[i].held[j].store(0);
+    }
+    _ctrl->sessionId = tools::getCurrentTimeInMilliS();
+    _ctrl->writeSeq.store(0);
+    _sessionId = _ctrl->sessionId;
+    std::atomic_thread_fence(std::memory_order_release);
+    _ctrl->magic = SHMRING_MAGIC;
+
+    LOG_INFO("Ok to create shmem ring (key=%d) of %d slots of %d bytes", shmkey, nbSlots, alignedSlotSize);
+    return VMI_E_OK;
+}
+
+/*!
+* \fn write
+* \brief Copy a vMI frame on the next free slot of the ring, then notify consumers (producer side). The slots still
+* referenced by a consumer are skipped: their sequence numbers are not used, and they keep their frame.
+*
+* \param frame frame to publish
+* \return VMI_E_OK if success, VMI_E_RING_SLOT_BUSY if all the slots are referenced by consumers (frame dropped)
+*/
+int CShmRing::write(CvMIFrame* frame) {
+
+    if (_ctrl == NULL || !_isProducer)
+        return VMI_E_RING_NOT_READY;
+    if (frame == NULL)
+        return VMI_E_INVALID_PARAMETER;
+
+    int frameSize = frame->getFrameSize();
+    if (frameSize > _ctrl->slotSize)
+        return VMI_E_INVALID_PARAMETER;
+
+    unsigned int first = _ctrl->writeSeq.load(std::memory_order_relaxed);
+    for (unsigned int seq = first; seq != first + (unsigned int)_ctrl->nbSlots; seq++) {
+        int index = seq % _ctrl->nbSlots;
+        ShmRingSlot* slot = &_slots[index];
+
+        // Mark the slot before looking at its readers. A consumer increments readers before reading seq: one of the
+        // two sides always sees the other one.
+        unsigned int oldSeq = slot->seq.load(std::memory_order_relaxed);
+        slot->seq.store(SHMRING_SLOT_WRITING);
+        if (slot->readers.load() > 0) {
+            // The reference may belong to a consumer that died
+            long long now = tools::getCurrentTimeInMilliS();
+            if (now - _lastRecovery >= SHMRING_RECOVERY_MS) {
+                _lastRecovery = now;
+                _recoverReaders();
+            }
+        }
+        if (slot->readers.load() > 0) {
+            // Skip the slot: it keeps an older frame, the consumers know then that this sequence number is not used
+            slot->seq.store(oldSeq, std::memory_order_release);
+            _nbSkipped++;
+            continue;
+        }
+
+        int result = frame->copyFrameToMem(_data + (size_t)index * _ctrl->slotSize, frameSize);
+        if (result != VMI_E_OK) {
+            // Nothing has been copied, the previous frame of the slot is still valid
+            slot->seq.store(oldSeq, std::memory_order_release);
+            return result;
+        }
+        slot->frameSize = frameSize;
+        slot->seq.store(seq, std::memory_order_release);
+
+        // Publish, then wakeup the sleeping consumers
+        _ctrl->writeSeq.store(seq + 1);
+        if (_ctrl->nbWaiters.load() > 0)
+            _wake();
+
+        return VMI_E_OK;
+    }
+
+    _nbDropped++;
+    return VMI_E_RING_SLOT_BUSY;
+}
+
+/*!
+* \fn open
+* \brief Attach to an existing ring (consumer side)
+*
+* \param shmkey key of the shared memory segment
+* \return VMI_E_OK if success, VMI_E_RING_NOT_READY if the ring doesn't exists or is not initialized
+*/
+int CShmRing::open(int shmkey) {
+
+    close();
+
+    _shm_data = tools::getSHMSegment(0, shmkey, _shm_id);
+    if (_shm_data == NULL)
+        return VMI_E_RING_NOT_READY;
+
+    ShmRingControl* ctrl = reinterpret_cast<ShmRingControl*>(_shm_data);
+    if (ctrl->magic != SHMRING_MAGIC || ctrl->version != SHMRING_VERSION || ctrl->closed.load() != 0) {
+        LOG("shmem segment with key=%d is not a ready ring", shmkey);
+        tools::detachSHMSegment(_shm_data);
+        _shm_data = NULL;
+        return VMI_E_RING_NOT_READY;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    _shm_key      = shmkey;
+    _isProducer   = false;
+    _ctrl         = ctrl;
+    _slots        = reinterpret_cast<ShmRingSlot*>(_shm_data + SHMRING_ALIGN(sizeof(ShmRingControl)));
+    _data         = reinterpret_cast<unsigned char*>(_shm_data) + SHMRING_ALIGN(sizeof(ShmRingControl)) + _ctrl->nbSlots * sizeof(ShmRingSlot);
+    _sessionId    = _ctrl->sessionId;
+    _readSeqValid = false;
+    _attachReader();
+
+    LOG_INFO("Ok to open shmem ring (key=%d) of %d slots of %d bytes", shmkey, _ctrl->nbSlots, _ctrl->slotSize);
+    return VMI_E_OK;
+}
+
+/*!
+* \fn read
+* \brief Wait for the next frame of the ring, and give it to a vMI frame (consumer side). With zerocopy, the vMI frame
+* reference the slot until it is released, otherwise the content of the slot is copied.
+*
+* \param frame vMI frame to fill
+* \param moduleId id of the module that receive the frame
+* \param zerocopy true to reference the slot without copy
+* \param timeoutMs maximum time to wait for a frame, in milliseconds
+* \return VMI_E_OK if success, VMI_E_RING_TIMEOUT if no frame has been received (timeout or wakeup())
+*/
+int CShmRing::read(CvMIFrame* frame, int moduleId, bool zerocopy, int timeoutMs) {
+
+    if (_ctrl == NULL || _isProducer)
+        return VMI_E_RING_NOT_READY;
+    if (frame == NULL)
+        return VMI_E_INVALID_PARAMETER;
+
+    while (_ctrl->closed.load() == 0) {
+
+        if (_ctrl->sessionId != _sessionId) {
+            // The producer has initialized the ring again: its sequence numbers restart from 0
+            // and the reader records are free: the references of the previous session are not given back.
+            LOG_INFO("shmem ring (key=%d) created again by the producer", _shm_key);
+            std::lock_guard<std::mutex> lock(_sessionMutex);
+            _sessionId = _ctrl->sessionId;
+            _nbSessions++;
+            _attachReader();
+            _readSeq = 0;
+            _readSeqValid = true;
+        }
+
+        unsigned int writeSeq = _ctrl->writeSeq.load(std::memory_order_acquire);
+        if (!_readSeqValid) {
+            // Start with the next published frame
+            _readSeq = writeSeq;
+            _readSeqValid = true;
+        }
+
+        if (writeSeq == _readSeq) {
+            // Nothing new, sleep. nbWaiters is incremented before reading again writeSeq, the producer
+            // increments writeSeq before reading nbWaiters: a wakeup can't be lost.
+            _ctrl->nbWaiters.fetch_add(1);
+            if (_ctrl->writeSeq.load() == _readSeq && _ctrl->closed.load() == 0)
+                _wait(_readSeq, timeoutMs);
+            _ctrl->nbWaiters.fetch_sub(1);
+            if (_ctrl->writeSeq.load(std::memory_order_acquire) == _readSeq)
+                return VMI_E_RING_TIMEOUT;
+            continue;
+        }
+
+        if (writeSeq - _readSeq > (unsigned int)_ctrl->nbSlots) {
+            // We are too late, the frames we want have already been overwritten: go to the last one
+            _nbLost += (int)(writeSeq - 1 - _readSeq);
+            LOG("too late on ring (key=%d), skip %d frames", _shm_key, (int)(writeSeq - 1 - _readSeq));
+            _readSeq = writeSeq - 1;
+        }
+
+        unsigned int seq = _readSeq++;
+        int index = seq % _ctrl->nbSlots;
+        ShmRingSlot* slot = &_slots[index];
+        slot->readers.fetch_add(1);
+        unsigned int slotSeq = slot->seq.load();
+        if (slotSeq != seq) {
+            // The producer is overwriting this slot, or has skipped it because it was busy (it keeps an older frame)
+            slot->readers.fetch_sub(1);
+            if (slotSeq == SHMRING_SLOT_WRITING || (int)(seq - slotSeq) < 0)
+                _nbLost++;
+            continue;
+        }
+
+        unsigned char* buffer = _data + (size_t)index * _ctrl->slotSize;
+        int result;
+        if (zerocopy) {
+            result = frame->createFrameFromExternalMem(shared_from_this(), SHMRING_COOKIE(_nbSessions, index), buffer, slot->frameSize, moduleId);
+            if (result != VMI_E_OK)
+                slot->readers.fetch_sub(1, std::memory_order_release);
+            else if (_reader != NULL)
+                _reader->held[index].fetch_add(1);
+        }
+        else {
+            result = frame->createFrameFromMem(buffer, slot->frameSize, moduleId);
+            slot->readers.fetch_sub(1, std::memory_order_release);
+        }
+        return result;
+    }
+
+    return VMI_E_RING_NOT_READY;
+}
+
+/*!
+* \fn releaseBuffer
+* \brief Called when a vMI frame doesn't reference anymore the slot
+*
+* \param cookie index of the slot, tagged with the session it has been read in
+*/
+void CShmRing::releaseBuffer(int cookie) {
+
+    std::lock_guard<std::mutex> lock(_sessionMutex);
+    if (_slots == NULL || cookie < 0)
+        return;
+    int index = cookie % SHMRING_MAX_SLOTS;
+    if (cookie != SHMRING_COOKIE(_nbSessions, index))
+        return;     // Slot of a previous session, its readers have been reset by the producer
+    if (_reader != NULL)
+        _reader->held[index].fetch_sub(1);
+    _slots[index].readers.fetch_sub(1, std::memory_order_release);
+}
+
+/*!
+* \fn wakeup
+* \brief Wakeup the consumers waiting on the ring, for example to stop a pin
+*/
+void CShmRing::wakeup() {
+
+    if (_ctrl != NULL)
+        _wake();
+}
+
+void CShmRing::close() {
+
+    if (_shm_data == NULL)
+        return;
+
+    if (_isProducer) {
+        // Tell the consumers that this ring is no more used, they will open the next one
+        _ctrl->closed.store(1);
+        _wake();
+        if (_nbDropped > 0 || _nbSkipped > 0)
+            LOG_INFO("shmem ring (key=%d) closed, %d busy slots skipped, %d frames dropped because all the slots were busy", _shm_key, _nbSkipped, _nbDropped);
+        tools::deleteSHMSegment(_shm_data, _shm_id);
+    }
+    else {
+        if (_nbLost > 0)
+            LOG_INFO("shmem ring (key=%d) closed, %d frames lost", _shm_key, _nbLost);
+        if (_ctrl->sessionId == _sessionId)
+            _detachReader();
+        _reader = NULL;
+        tools::detachSHMSegment(_shm_data);
+    }
+    _shm_data = NULL;
+    _ctrl     = NULL;
+    _slots    = NULL;
+    _data     = NULL;
+}
@@ -0,0 +1,120 @@
+#ifndef _SHMRING_H
+#define _SHMRING_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "vmiframe.h"
+
+#define SHMRING_MAGIC           0x564D4952  /* 'VMIR' */
+#define SHMRING_VERSION         2
+#define SHMRING_CACHELINE       64
+#define SHMRING_SLOT_WRITING    0xFFFFFFFF  /* slot sequence value while the producer writes the slot */
+#define SHMRING_DEFAULT_SLOTS   4
+#define SHMRING_MAX_SLOTS       32
+#define SHMRING_MAX_READERS     16          /* consumers whose references are recovered if they die */
+#define SHMRING_RECOVERY_MS     1000        /* minimum delay between two searches of dead consumers */
+
+/*
+* Reader record of a consumer: the slots it references, given back by the producer if the process
+* of the consumer doesn't exist anymore.
+*/
+struct alignas(SHMRING_CACHELINE) ShmRingReader {
+    std::atomic<int> pid;               /* process of the consumer, 0 if the record is free */
+    std::atomic<int> held[SHMRING_MAX_SLOTS];   /* number of references of each slot */
+};
+
+/*
+* Control header of the ring, at the beginning of the shared memory segment.
+* Sequence counters and reader counters are lock-free atomics, shared between processes.
+*/
+struct ShmRingControl {
+    unsigned int     magic;             /* SHMRING_MAGIC when the ring is initialized */
+    unsigned int     version;           /* SHMRING_VERSION */
+    int              nbSlots;           /* number of frame slots */
+    int              slotSize;          /* size of a frame slot, in bytes */
+    long long        sessionId;         /* change each time the producer (re)create the ring */
+    std::atomic<int> closed;            /* set by the producer before deleting the segment */
+    alignas(SHMRING_CACHELINE) std::atomic<unsigned int> writeSeq;  /* number of published frames, also the futex word */
+    std::atomic<int> nbWaiters;         /* number of consumers sleeping on writeSeq */
+    ShmRingReader    readers[SHMRING_MAX_READERS];
+};
+
+/*
+* Descriptor of a frame slot
+*/
+struct alignas(SHMRING_CACHELINE) ShmRingSlot {
+    std::atomic<unsigned int> seq;      /* sequence number of the frame in the slot, SHMRING_SLOT_WRITING during write */
+    std::atomic<int> readers;           /* number of consumer frames that reference the slot */
+    int              frameSize;         /* size of the vMI frame (headers + media) in the slot */
+};
+
+/**********************************************************************************************
+*
+* CShmRing
+*
+* Single producer / multiple consumers ring of vMI frames in a shared memory segment. The
+* producer copy each frame once in a slot and publish it by incrementing writeSeq, consumers
+* sleep on writeSeq (futex) and reference the slot without copy. A slot is not overwritten as
+* long as a consumer frame reference it: the producer skip it and write the next free slot, the
+* frame is dropped only if all the slots are busy. The references of a consumer that died are
+* given back by the producer.
+*
+***********************************************************************************************/
+
+class CShmRing : public CvMIFrameBufferOwner, public std::enable_shared_from_this<CShmRing>
+{
+#ifndef _WIN32
+    int             _shm_id;        /* shared memory identifier */
+#else
+    HANDLE          _shm_id;        /* shared memory identifier */
+#endif
+    int             _shm_key;       /* key of the shared memory segment */
+    char*           _shm_data;      /* pointer to the shared memory segment */
+    bool            _isProducer;    /* true if this object created the segment */
+    ShmRingControl* _ctrl;          /* control header */
+    ShmRingSlot*    _slots;         /* slot descriptors */
+    unsigned char*  _data;          /* first frame slot */
+    unsigned int    _readSeq;       /* next frame sequence to read (consumer) */
+    bool            _readSeqValid;
+    long long       _sessionId;     /* session of the ring when attached */
+    int             _nbSessions;    /* number of sessions followed by the consumer, tag the cookies */
+    ShmRingReader*  _reader;        /* reader record of the consumer, NULL if none is free */
+    std::mutex      _sessionMutex;  /* the frames can be released by other threads while the session changes */
+    long long       _lastRecovery;  /* last search of dead consumers, in ms */
+    int             _nbDropped;     /* frames dropped by the producer because all the slots were busy */
+    int             _nbSkipped;     /* busy slots skipped by the producer */
+    int             _nbLost;        /* frames missed by the consumer because it was too late */
+
+    void _wait(unsigned int seq, int timeoutMs);
+    void _wake();
+    void _attachReader();
+    void _detachReader();
+    void _recoverReaders();
+
+public:
+    CShmRing();
+    virtual ~CShmRing();
+
+    // Producer side
+    int  create(int shmkey, int nbSlots, int slotSize);
+    int  write(CvMIFrame* frame);
+
+    // Consumer side
+    int  open(int shmkey);
+    int  read(CvMIFrame* frame, int moduleId, bool zerocopy, int timeoutMs);
+    void releaseBuffer(int cookie);
+
+    void wakeup();
+    void close();
+
+    bool isValid()      { return _ctrl != NULL; };
+    bool isClosed()     { return _ctrl == NULL || _ctrl->closed.load() != 0; };
+    int  getSlotSize()  { return (_ctrl != NULL) ? _ctrl->slotSize : 0; };
+    int  getDropped()   { return _nbDropped; };
+    int  getSkipped()   { return _nbSkipped; };
+    int  getLost()      { return _nbLost; };
+};
+
+#endif // _SHMRING_H
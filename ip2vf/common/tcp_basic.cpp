@@ -26,6 +26,12 @@
 #include <sys/types.h>
 #include <assert.h>
 #include <ifaddrs.h>
+#include <linux/net_tstamp.h>   // SOF_TIMESTAMPING_*, struct sock_txtime
+#include <linux/errqueue.h>     // struct sock_extended_err
+#include <linux/rtnetlink.h>    // RTM_GETQDISC
+#include <net/if.h>             // if_nametoindex
+#include <poll.h>
+#include <sys/uio.h>            // struct iovec
 #endif
 
 // cat /proc/sys/net/core/rmem_max
@@ -33,6 +39,29 @@
 
 #include "log.h"
 #include "tcp_basic.h"
+#include "txpacer.h"
+
+#ifndef _WIN32
+#ifndef CLOCK_TAI
+#define CLOCK_TAI       11
+#endif
+#ifndef SO_TXTIME
+#define SO_TXTIME       61      /* linux >= 4.19 */
+#define SCM_TXTIME      SO_TXTIME
+#endif
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY     60      /* linux >= 4.14 */
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY    0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY       5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED  1
+#endif
+#endif
 
 #define SOCKET_IPV6
 #define SOCKET_IPV6_BUFLEN  100
@@ -358,6 +387,13 @@ TCP::TCP()
     _TCP_timeout = v_TCP_timeout;
     _isListening = false;
     _conn_attemp = 0;
+    _zeroCopyRequested = false;
+    _zeroCopy    = false;
+    _zcNextId    = 0;
+    _zcCopied    = 0;
+    _sndBufSize  = 0;
+    _rcvBufSize  = 0;
+    _bufApplied  = false;
 #ifdef _WIN32 
     WSADATA init_win32; 
     int result = WSAStartup(MAKEWORD(2,2), &init_win32);
@@ -425,6 +461,7 @@ int TCP::openSocket(const char* addr, int port, const char* bindToDevice)
         if( result < 0 ) {
             return E_FATAL;
         }
+        _on_connected();
     }
     else
     {
@@ -439,6 +476,7 @@ int TCP::openSocket(const char* addr, int port, const char* bindToDevice)
         }
         LOG_INFO("Ok to open connected socket on [%s]:%s", (addr==NULL?"NULL":addr), service);
         _sockClient = _sock;
+        _on_connected();
     }
 
     return E_OK;
@@ -551,6 +589,9 @@ int TCP::closeSocket()
 
     _isListening = false;
     _conn_attemp = 0;
+    _zeroCopy = false;
+    _zcNextId = 0;
+    _bufApplied = false;
     return ret;
 }
 
@@ -583,8 +624,8 @@ int  TCP::blockingReadSocket(const SOCKET &socketHandle,char *buffer,const int &
         return 0;
     }
 #else
-    //linux:
-    return READSOCKET(socketHandle, buffer, len);
+    //linux: the kernel waits for the whole buffer, instead of a syscall per segment
+    return recv(socketHandle, buffer, len, MSG_WAITALL);
 #endif
 }
 
@@ -719,6 +760,213 @@ int  TCP::writeSocket(char *buffer, int *len)
    return retval;
 }
 
+/*!
+* \fn writeGather
+* \brief send a message made of several buffers, with sendmsg() and an iovec of the parts, and
+*        with MSG_ZEROCOPY if enabled (see enableZeroCopy()): the buffers must then not be
+*        modified until the completions of the sends are read (see readZeroCopyCompletions())
+*
+* \param parts buffers of the message
+* \param nbParts nb of buffers, TCP_GATHER_MAX_PARTS at most
+* \param firstId receive the id of the first zero copy send, may be NULL
+* \param nbIds receive the nb of zero copy sends, 0 if the message was copied, may be NULL
+* \return E_OK if Ok, E_RESET if the connection is closed
+*/
+int TCP::writeGather(const TCPGather* parts, int nbParts, unsigned int* firstId, int* nbIds)
+{
+    if (firstId != NULL)
+        *firstId = _zcNextId;
+    if (nbIds != NULL)
+        *nbIds = 0;
+    if (nbParts <= 0 || nbParts > TCP_GATHER_MAX_PARTS)
+        return E_FATAL;
+#ifdef _WIN32
+    for (int i = 0; i < nbParts; i++) {
+        int len = parts[i].len;
+        int result = writeSocket((char*)parts[i].buffer, &len);
+        if (result != E_OK || len != parts[i].len)
+            return E_RESET;
+    }
+#else
+    struct iovec iov[TCP_GATHER_MAX_PARTS];
+    int nbIov = 0;
+    for (int i = 0; i < nbParts; i++) {
+        if (parts[i].len <= 0)
+            continue;
+        iov[nbIov].iov_base = (void*)parts[i].buffer;
+        iov[nbIov].iov_len = parts[i].len;
+        nbIov++;
+    }
+    int next = 0;
+    while (next < nbIov) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov[next];
+        msg.msg_iovlen = nbIov - next;
+        bool zeroCopy = _zeroCopy;
+        ssize_t sent = sendmsg(_sockClient, &msg, MSG_NOSIGNAL | (zeroCopy ? MSG_ZEROCOPY : 0));
+        if (sent < 0 && zeroCopy && errno == ENOBUFS) {
+            // Too many zero copy sends not completed (optmem_max): this one is copied
+            zeroCopy = false;
+            sent = sendmsg(_sockClient, &msg, MSG_NOSIGNAL);
+        }
+        if (sent < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            LOG_ERROR("sendmsg() failed: %s", strerror(errno));
+            closeSocket();
+            return E_RESET;
+        }
+        if (zeroCopy && sent > 0) {
+            _zcNextId++;
+            if (nbIds != NULL)
+                (*nbIds)++;
+        }
+        // Skip what was sent
+        while (next < nbIov && sent >= (ssize_t)iov[next].iov_len) {
+            sent -= iov[next].iov_len;
+            next++;
+        }
+        if (next < nbIov) {
+            iov[next].iov_base = (char*)iov[next].iov_base + sent;
+            iov[next].iov_len -= sent;
+        }
+    }
+#endif
+    return E_OK;
+}
+
+/*!
+* \fn enableZeroCopy
+* \brief send the messages of writeGather() with MSG_ZEROCOPY (linux >= 4.14), on this connection
+*        and the next ones. Ignored if the kernel doesn't support it.
+*/
+void TCP::enableZeroCopy()
+{
+    _zeroCopyRequested = true;
+    if (isValid() && !_zeroCopy)
+        _enable_zerocopy();
+}
+
+int TCP::_enable_zerocopy()
+{
+#ifndef _WIN32
+    int one = 1;
+    if (setsockopt(_sockClient, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) != 0) {
+        LOG_WARNING("SO_ZEROCOPY not supported (%s), the frames are copied by the kernel", strerror(errno));
+        return E_FATAL;
+    }
+    _zeroCopy = true;
+    _zcNextId = 0;
+    LOG_INFO("MSG_ZEROCOPY enabled");
+    return E_OK;
+#else
+    return E_FATAL;
+#endif
+}
+
+/*!
+* \fn readZeroCopyCompletions
+* \brief read the completions of the zero copy sends on the error queue: each one is a range of
+*        send ids whose buffers are no longer used by the kernel
+*
+* \param first receive the first id of each range
+* \param last receive the last id of each range
+* \param max max nb of ranges
+* \param timeoutMs time to wait for a completion, 0 to return at once
+* \return nb of ranges read
+*/
+int TCP::readZeroCopyCompletions(unsigned int* first, unsigned int* last, int max, int timeoutMs)
+{
+    int count = 0;
+#ifndef _WIN32
+    if (!_zeroCopy)
+        return 0;
+    if (timeoutMs > 0) {
+        struct pollfd pfd;
+        pfd.fd = _sockClient;
+        pfd.events = 0;         // POLLERR is always reported
+        pfd.revents = 0;
+        poll(&pfd, 1, timeoutMs);
+    }
+    while (count < max) {
+        char ctrl[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        if (recvmsg(_sockClient, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+            if ((cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVERR) ||
+                (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+                struct sock_extended_err* err = (struct sock_extended_err*)CMSG_DATA(cm);
+                if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY || err->ee_errno != 0)
+                    continue;
+                if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    if (_zcCopied == 0)
+                        LOG_INFO("zero copy sends copied by the kernel (loopback, or device without scatter-gather)");
+                    _zcCopied++;
+                }
+                first[count] = err->ee_info;
+                last[count] = err->ee_data;
+                count++;
+            }
+        }
+    }
+#endif
+    return count;
+}
+
+/*!
+* \fn setBufferSize
+* \brief enlarge the socket buffers, on this connection and the next ones: to hold a frame, so
+*        that it's sent or received without waiting for the application
+*
+* \param sndBufSize min size of the send buffer, 0 to keep the default
+* \param rcvBufSize min size of the receive buffer, 0 to keep the default
+*/
+void TCP::setBufferSize(int sndBufSize, int rcvBufSize)
+{
+    if (sndBufSize <= _sndBufSize && rcvBufSize <= _rcvBufSize && (_bufApplied || !isValid()))
+        return;
+    _sndBufSize = (sndBufSize > _sndBufSize ? sndBufSize : _sndBufSize);
+    _rcvBufSize = (rcvBufSize > _rcvBufSize ? rcvBufSize : _rcvBufSize);
+    if (isValid())
+        _apply_buffer_size();
+}
+
+void TCP::_apply_buffer_size()
+{
+    _bufApplied = true;
+#ifndef _WIN32
+    const int opts[2][2] = { { SO_SNDBUF, SO_SNDBUFFORCE }, { SO_RCVBUF, SO_RCVBUFFORCE } };
+    const int sizes[2] = { _sndBufSize, _rcvBufSize };
+    for (int i = 0; i < 2; i++) {
+        if (sizes[i] <= 0)
+            continue;
+        int current = 0;
+        socklen_t optlen = sizeof(current);
+        getsockopt(_sockClient, SOL_SOCKET, opts[i][0], &current, &optlen);
+        if (current >= sizes[i])
+            continue;
+        // Beyond wmem_max/rmem_max with CAP_NET_ADMIN only
+        if (setsockopt(_sockClient, SOL_SOCKET, opts[i][1], &sizes[i], sizeof(sizes[i])) != 0)
+            setsockopt(_sockClient, SOL_SOCKET, opts[i][0], &sizes[i], sizeof(sizes[i]));
+        getsockopt(_sockClient, SOL_SOCKET, opts[i][0], &current, &optlen);
+        LOG_INFO("%s: %d bytes requested, %d bytes set", (i == 0 ? "SO_SNDBUF" : "SO_RCVBUF"), sizes[i], current);
+    }
+#endif
+}
+
+void TCP::_on_connected()
+{
+    if (_zeroCopyRequested)
+        _enable_zerocopy();
+    if (_sndBufSize > 0 || _rcvBufSize > 0)
+        _apply_buffer_size();
+}
+
 /*
  *
  *
@@ -727,9 +975,95 @@ int  TCP::writeSocket(char *buffer, int *len)
  *
  */
 
+/*
+ * Ring of received packets. With batch receive, recvmmsg() fills up to nbPackets buffers in one
+ * syscall, and readPacket() drains them. Without, it's a single buffer filled by readSocket().
+ */
+#define UDP_RXRING_SINGLE_SIZE  65536       /* max size of an UDP datagram */
+#define UDP_RXRING_CTRL_SIZE    128         /* control messages (SO_TIMESTAMPING) of a packet */
+#define UDP_SCATTER_IOV         3           /* headers, payload, and overflow in the ring buffer */
+
+struct UDPRxRing {
+    bool        batch;                      /* recvmmsg() batches, single buffer otherwise */
+    bool        timestamping;               /* kernel RX timestamps requested */
+    int         nbPackets;                  /* nb of packet buffers */
+    int         packetSize;                 /* size of a packet buffer */
+    char*       buffers;
+    int         count;                      /* nb of packets received by the last batch */
+    int         next;                       /* next packet to drain */
+    unsigned long long nbRcvPackets;
+    unsigned long long nbSyscalls;
+#ifndef _WIN32
+    struct mmsghdr*          msgs;
+    struct iovec*            iov;           /* one per packet, on the ring buffers */
+    struct iovec*            scatterIov;    /* UDP_SCATTER_IOV per packet, see readScatter() */
+    bool                     scattered;     /* msgs are set up for readScatter() */
+    struct sockaddr_storage* addrs;
+    char*                    ctrl;
+#endif
+};
+
+static UDPRxRing* newRxRing(bool batch, int nbPackets, int packetSize)
+{
+    UDPRxRing* ring = new UDPRxRing();
+    ring->batch = batch;
+    ring->timestamping = false;
+    ring->nbPackets = nbPackets;
+    ring->packetSize = packetSize;
+    ring->buffers = new char[(size_t)nbPackets * packetSize];
+    ring->count = 0;
+    ring->next = 0;
+    ring->nbRcvPackets = 0;
+    ring->nbSyscalls = 0;
+#ifndef _WIN32
+    ring->msgs = NULL;
+    ring->iov = NULL;
+    ring->scatterIov = NULL;
+    ring->scattered = false;
+    ring->addrs = NULL;
+    ring->ctrl = NULL;
+    if (batch) {
+        // Register the buffers once: recvmmsg() only updates msg_len, msg_namelen, msg_controllen and msg_flags
+        ring->msgs = new struct mmsghdr[nbPackets];
+        ring->iov = new struct iovec[nbPackets];
+        ring->scatterIov = new struct iovec[(size_t)nbPackets * UDP_SCATTER_IOV];
+        ring->addrs = new struct sockaddr_storage[nbPackets];
+        ring->ctrl = new char[(size_t)nbPackets * UDP_RXRING_CTRL_SIZE];
+        memset(ring->msgs, 0, sizeof(struct mmsghdr) * nbPackets);
+        for (int i = 0; i < nbPackets; i++) {
+            ring->iov[i].iov_base = ring->buffers + (size_t)i * packetSize;
+            ring->iov[i].iov_len = packetSize;
+            ring->msgs[i].msg_hdr.msg_iov = &ring->iov[i];
+            ring->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+#endif
+    return ring;
+}
+
+static void deleteRxRing(UDPRxRing* ring)
+{
+    if (ring == NULL)
+        return;
+    delete[] ring->buffers;
+#ifndef _WIN32
+    delete[] ring->msgs;
+    delete[] ring->iov;
+    delete[] ring->scatterIov;
+    delete[] ring->addrs;
+    delete[] ring->ctrl;
+#endif
+    delete ring;
+}
+
 UDP::UDP() 
 {
     _sock = INVALID_SOCKET;
+    _rxRing = NULL;
+    _txTimeRequested = false;
+    _txTime = false;
+    _lastTxTime = 0;
+    _txTimeDrops = 0;
     _TCP_timeout = v_TCP_timeout;
 #ifdef _WIN32 
     WSADATA init_win32; 
@@ -744,6 +1078,7 @@ UDP::~UDP()
 {
     if( _sock != INVALID_SOCKET) 
         closeSocket();
+    deleteRxRing(_rxRing);
 #ifdef _WIN32 
     int result = WSACleanup();
     if( result != 0 ) {
@@ -1040,6 +1375,24 @@ int UDP::openSocket(const char* remote_addr,const char* local_addr, int port,
 	 * Configure the socket 
 	 */
 	res = configureSocket(remote_addr, local_addr, port, modelisten, ifname);
+
+    /*
+     * Packets of a previous socket are lost, and the new one must be configured for batch receive
+     */
+    if (_rxRing != NULL) {
+        _rxRing->count = 0;
+        _rxRing->next = 0;
+        if (_rxRing->batch && _rxRing->timestamping)
+            enableBatchReceive(_rxRing->nbPackets, true);
+    }
+
+    /*
+     * Launch time mode, see enableTxTime()
+     */
+    _txTime = false;
+    if (_txTimeRequested && !modelisten && res == E_OK) {
+        _enable_txtime();
+    }
 	return res;
 }
 
@@ -1115,6 +1468,23 @@ int  UDP::closeSocket()
 
 int  UDP::readSocket(char *buffer, int *len) 
 {
+    if (isBatchReceive()) {
+        // Drain the ring of received packets
+        char* packet;
+        int size;
+        int result = readPacket(&packet, &size);
+        if (result <= 0) {
+            *len = 0;
+            return result;
+        }
+        if (size > *len) {
+            LOG_ERROR("packet of %d bytes truncated to %d bytes", size, *len);
+            size = *len;
+        }
+        memcpy(buffer, packet, size);
+        *len = size;
+        return size;
+    }
 #ifdef _WIN32
     int size
 #else
@@ -1140,56 +1510,274 @@ int  UDP::readSocket(char *buffer, int *len)
     return result;
 }
 
-/*
- * not completed
- */
-/*
-#define BATCH_SIZE  10
-struct batch {
-    int count;
-    char buf[BATCH_SIZE][1500];
-    struct iovec iovec[BATCH_SIZE][1];
-    struct sockaddr src_addr[BATCH_SIZE];
-    struct mmsghdr datagrams[BATCH_SIZE];
-};
-struct batch _batch;
+#ifndef _WIN32
+static long long rxTimestamp(struct msghdr* hdr)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING) {
+            // Array of 3 timestamps: 0 is SW, 1 is legacy (unused), 2 is HW
+            struct timespec* ts = (struct timespec*)CMSG_DATA(cmsg);
+            long long timestamp = 1000000000ll * ts[2].tv_sec + ts[2].tv_nsec;
+            if (timestamp == 0)
+                timestamp = 1000000000ll * ts[0].tv_sec + ts[0].tv_nsec;
+            return timestamp;
+        }
+    }
+    return 0;
+}
 
-int  UDP::readSocket2(char *buffer, int *len) 
+int UDP::_recv_msgs(int nbPackets)
 {
-    static int init=0;
-    if( init == 0 ) {
-        init = 1;
-        _batch.count=0;
-        for( int i=0; i<BATCH_SIZE; i++) {
-            _batch.iovec[i][0].iov_base=&_batch.buf[i][0];
-            _batch.iovec[i][0].iov_len=1500;
-            _batch.datagrams[i].msg_hdr.msg_name=&_batch.src_addr[i];
-            _batch.datagrams[i].msg_hdr.msg_namelen=sizeof(_batch.src_addr[i]);
-            _batch.datagrams[i].msg_hdr.msg_iov=_batch.iovec[i];
-            _batch.datagrams[i].msg_hdr.msg_iovlen=1;
-            _batch.datagrams[i].msg_hdr.msg_control=0;
-            _batch.datagrams[i].msg_hdr.msg_controllen=0;
+    UDPRxRing* ring = _rxRing;
+    for (int i = 0; i < nbPackets; i++) {
+        struct msghdr* hdr = &ring->msgs[i].msg_hdr;
+        hdr->msg_name = &ring->addrs[i];
+        hdr->msg_namelen = sizeof(struct sockaddr_storage);
+        if (ring->timestamping) {
+            hdr->msg_control = ring->ctrl + (size_t)i * UDP_RXRING_CTRL_SIZE;
+            hdr->msg_controllen = UDP_RXRING_CTRL_SIZE;
         }
+        else {
+            hdr->msg_control = NULL;
+            hdr->msg_controllen = 0;
+        }
+        hdr->msg_flags = 0;
     }
 
-    if( _batch.count>0 ) {
+    int result;
+    do {
+        ring->nbSyscalls++;
+        result = recvmmsg(_sock, ring->msgs, nbPackets, MSG_WAITFORONE, NULL);
+    } while (result == -1 && errno == EINTR && _sock != INVALID_SOCKET);
+    return result;
+}
+#endif
+
+/*!
+* \fn enableBatchReceive
+* \brief receive the packets by batches with recvmmsg() in a ring of pre-allocated buffers, instead of
+*        one syscall per packet. readPacket() (no copy) and readSocket() then drain the ring. Can be
+*        called before the socket is opened. Not available on Windows and for non kernel sockets,
+*        they stay with one read per packet.
+*
+* \param nbPackets max nb of packets per recvmmsg(), <= 1 to disable batch receive
+* \param timestamping if true, request kernel RX timestamps (SO_TIMESTAMPING), see readPacket()
+* \return E_OK if Ok, E_ERROR otherwise
+*/
+int UDP::enableBatchReceive(int nbPackets, bool timestamping)
+{
+#ifdef _WIN32
+    LOG_INFO("batch receive not available, read one packet at a time");
+    return E_OK;
+#else
+    if (!isKernelSocket() || nbPackets <= 1) {
+        LOG_INFO("batch receive disabled, read one packet at a time");
+        return E_OK;
     }
-    else {
-        LOG("ask for new batch with recvmmsg");
-        _batch.count = recvmmsg(_sock, _batch.datagrams, BATCH_SIZE, MSG_WAITFORONE, NULL);
-        if( _batch.count == -1 ) {
-            LOG_ERROR("error when recvmmsg=%s",strerror(errno));
-        } else {
-            LOG_ERROR("Ok, receive %d datagrams", _batch.count);
+    if (_rxRing == NULL || !_rxRing->batch || _rxRing->nbPackets != nbPackets) {
+        deleteRxRing(_rxRing);
+        _rxRing = newRxRing(true, nbPackets, UDP_RXRING_PACKET_SIZE);
+    }
+    _rxRing->timestamping = timestamping;
+    if (timestamping && _sock != INVALID_SOCKET) {
+        // The HW timestamps are only reported if the interface was configured for (SIOCSHWTSTAMP)
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+        if (setsockopt(_sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+            LOG_ERROR("setsockopt(SO_TIMESTAMPING) failed, error='%s'", strerror(errno));
+            return E_ERROR;
         }
     }
-    int result = -1;
-    if( result == -1 ) {
-        *len = 0;
+    LOG_INFO("batch receive of %d packets%s", nbPackets, timestamping ? ", with RX timestamps" : "");
+    return E_OK;
+#endif
+}
+
+bool UDP::isBatchReceive()
+{
+    return _rxRing != NULL && _rxRing->batch;
+}
+
+/*!
+* \fn readBatch
+* \brief receive a batch of packets in the ring with one recvmmsg(). Block until at least one packet
+*        is received. Packets not yet drained by readPacket() are lost.
+*
+* \return nb of packets received, 0 if the connection has been closed, -1 if error
+*/
+int UDP::readBatch()
+{
+    if (!isBatchReceive()) {
+        LOG_ERROR("batch receive not enabled");
+        return -1;
+    }
+#ifdef _WIN32
+    return -1;
+#else
+    UDPRxRing* ring = _rxRing;
+    if (ring->scattered) {
+        for (int i = 0; i < ring->nbPackets; i++) {
+            ring->msgs[i].msg_hdr.msg_iov = &ring->iov[i];
+            ring->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        ring->scattered = false;
+    }
+
+    ring->count = 0;
+    ring->next = 0;
+    int result = _recv_msgs(ring->nbPackets);
+    if (result == -1) {
+        LOG_ERROR("error occurred during recvmmsg: '%s'", strerror(errno));
+        return -1;
+    }
+    if (result == 0) {
+        LOG_INFO("the connection has been gracefully closed");
+        return 0;
     }
+    ring->count = result;
+    ring->nbRcvPackets += result;
+    LOG("recv %d packets from port %d (%llu packets in %llu syscalls)", result, _port, ring->nbRcvPackets, ring->nbSyscalls);
     return result;
+#endif
+}
+
+int UDP::_read_single(char **packet, int *len, long long *timestamp)
+{
+    if (_rxRing == NULL)
+        _rxRing = newRxRing(false, 1, UDP_RXRING_SINGLE_SIZE);
+    *packet = _rxRing->buffers;
+    *len = _rxRing->packetSize;
+    if (timestamp != NULL)
+        *timestamp = 0;
+    return readSocket(*packet, len);
+}
+
+/*!
+* \fn readPacket
+* \brief return the next received packet, without copy. With batch receive, the packet is drained
+*        from the ring, and a new batch is received when the ring is empty. Otherwise, it's one
+*        read per packet.
+*
+* \param packet pointer on the packet data, valid until the next read on the socket
+* \param len size of the packet
+* \param timestamp if not NULL, kernel RX timestamp of the packet in ns (HW if available, SW
+*        otherwise), 0 if not available
+* \return size of the packet, 0 if the connection has been closed, -1 if error
+*/
+int UDP::readPacket(char **packet, int *len, long long *timestamp)
+{
+#ifdef _WIN32
+    return _read_single(packet, len, timestamp);
+#else
+    if (!isBatchReceive())
+        return _read_single(packet, len, timestamp);
+
+    UDPRxRing* ring = _rxRing;
+    if (ring->next >= ring->count) {
+        int result = readBatch();
+        if (result <= 0) {
+            *len = 0;
+            return result;
+        }
+    }
+
+    int i = ring->next++;
+    struct msghdr* hdr = &ring->msgs[i].msg_hdr;
+    *packet = ring->buffers + (size_t)i * ring->packetSize;
+    *len = (int)ring->msgs[i].msg_len;
+    if (hdr->msg_flags & MSG_TRUNC)
+        LOG_ERROR("packet truncated to %d bytes", *len);
+
+    // Keep the sender, as readSocket() does
+    if (_af == AF_INET && hdr->msg_namelen == sizeof(struct sockaddr_in))
+        memcpy(&_remote_addr4, &ring->addrs[i], sizeof(struct sockaddr_in));
+    else if (_af == AF_INET6 && hdr->msg_namelen == sizeof(struct sockaddr_in6))
+        memcpy(&_remote_addr6, &ring->addrs[i], sizeof(struct sockaddr_in6));
+
+    if (timestamp != NULL)
+        *timestamp = ring->timestamping ? rxTimestamp(hdr) : 0;
+    return *len;
+#endif
 }
+
+/*!
+* \fn readScatter
+* \brief receive packets directly at their final location: the headers of each packet are received in
+*        its header buffer, and the payload in its payload buffer, without intermediate copy. With
+*        batch receive, up to nbPackets packets are received with one recvmmsg(), otherwise (and for
+*        the packets already in the ring), the packet is read then copied.
+*        The part of the payload that doesn't fit in the payload buffer is discarded: the caller
+*        detects it with len > headerLen + payloadLen.
+*
+* \param packets destinations of the packets. len (and timestamp) are set for the received packets
+* \param nbPackets nb of packets to receive at most
+* \return nb of packets received, 0 if the connection has been closed, -1 if error
 */
+int UDP::readScatter(UDPScatter* packets, int nbPackets)
+{
+    if (nbPackets <= 0)
+        return 0;
+
+#ifndef _WIN32
+    UDPRxRing* ring = _rxRing;
+    if (isBatchReceive() && ring->next >= ring->count) {
+        if (nbPackets > ring->nbPackets)
+            nbPackets = ring->nbPackets;
+        for (int i = 0; i < nbPackets; i++) {
+            struct iovec* iov = &ring->scatterIov[(size_t)i * UDP_SCATTER_IOV];
+            iov[0].iov_base = packets[i].header;
+            iov[0].iov_len = packets[i].headerLen;
+            iov[1].iov_base = packets[i].payload;
+            iov[1].iov_len = packets[i].payloadLen;
+            iov[2].iov_base = ring->buffers + (size_t)i * ring->packetSize;
+            iov[2].iov_len = ring->packetSize;
+            ring->msgs[i].msg_hdr.msg_iov = iov;
+            ring->msgs[i].msg_hdr.msg_iovlen = UDP_SCATTER_IOV;
+        }
+        ring->scattered = true;
+
+        int result = _recv_msgs(nbPackets);
+        if (result == -1) {
+            LOG_ERROR("error occurred during recvmmsg: '%s'", strerror(errno));
+            return -1;
+        }
+        if (result == 0) {
+            LOG_INFO("the connection has been gracefully closed");
+            return 0;
+        }
+        ring->nbRcvPackets += result;
+        for (int i = 0; i < result; i++) {
+            struct msghdr* hdr = &ring->msgs[i].msg_hdr;
+            packets[i].len = (int)ring->msgs[i].msg_len;
+            packets[i].timestamp = ring->timestamping ? rxTimestamp(hdr) : 0;
+            if (hdr->msg_flags & MSG_TRUNC)
+                LOG_ERROR("packet truncated to %d bytes", packets[i].len);
+        }
+        if (_af == AF_INET && ring->msgs[result - 1].msg_hdr.msg_namelen == sizeof(struct sockaddr_in))
+            memcpy(&_remote_addr4, &ring->addrs[result - 1], sizeof(struct sockaddr_in));
+        else if (_af == AF_INET6 && ring->msgs[result - 1].msg_hdr.msg_namelen == sizeof(struct sockaddr_in6))
+            memcpy(&_remote_addr6, &ring->addrs[result - 1], sizeof(struct sockaddr_in6));
+        LOG("recv %d scattered packets from port %d", result, _port);
+        return result;
+    }
+#endif
+
+    // One packet, then copy it at its destination
+    char* packet;
+    int len;
+    long long timestamp;
+    int result = readPacket(&packet, &len, &timestamp);
+    if (result <= 0)
+        return result;
+    int size = (len < packets[0].headerLen ? len : packets[0].headerLen);
+    memcpy(packets[0].header, packet, size);
+    if (len > packets[0].headerLen && packets[0].payloadLen > 0) {
+        size = len - packets[0].headerLen;
+        memcpy(packets[0].payload, packet + packets[0].headerLen, (size < packets[0].payloadLen ? size : packets[0].payloadLen));
+    }
+    packets[0].len = len;
+    packets[0].timestamp = timestamp;
+    return 1;
+}
 
 int  UDP::writeSocket(char *buffer, int *len) 
 {
@@ -1250,6 +1838,278 @@ int  UDP::writeBatchedSocket(char **buffer, int *len, int count) {
 }
 
 
+/*!
+* \fn enableTxTime
+* \brief launch time mode: the kernel sends each packet at its time (SO_TXTIME), given with
+*        writeTimedBatchedSocket() or CUDPBatchSender. It needs an ETF qdisc on the egress
+*        interface, e.g. "tc qdisc replace dev eth0 root etf clockid CLOCK_TAI delta 300000".
+*        Without it, or if the kernel doesn't support SO_TXTIME, the socket stays in normal mode
+*        (isTxTime() is false) and the packets are paced by the sender. Can be called before the
+*        socket is opened.
+*
+* \param enable true to enable the launch time mode
+* \return E_OK if the mode is enabled (or disabled), E_ERROR if it is not available
+*/
+int UDP::enableTxTime(bool enable)
+{
+    _txTimeRequested = enable;
+    _txTime = false;
+    if (!enable || _sock == INVALID_SOCKET)
+        return E_OK;
+    return _enable_txtime();
+}
+
+#ifndef _WIN32
+/* true if an ETF qdisc is configured on an interface (netlink dump of the qdiscs) */
+static bool has_etf_qdisc(int ifindex)
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    if (fd < 0)
+        return false;
+    struct {
+        struct nlmsghdr nh;
+        struct tcmsg    tc;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+    req.nh.nlmsg_type = RTM_GETQDISC;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.tc.tcm_family = AF_UNSPEC;
+    bool found = false;
+    if (send(fd, &req, req.nh.nlmsg_len, 0) < 0) {
+        close(fd);
+        return false;
+    }
+    char buffer[16384];
+    bool done = false;
+    while (!done) {
+        int len = (int)recv(fd, buffer, sizeof(buffer), 0);
+        if (len <= 0)
+            break;
+        for (struct nlmsghdr* nh = (struct nlmsghdr*)buffer; NLMSG_OK(nh, (unsigned)len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type == NLMSG_DONE || nh->nlmsg_type == NLMSG_ERROR) {
+                done = true;
+                break;
+            }
+            if (nh->nlmsg_type != RTM_NEWQDISC)
+                continue;
+            struct tcmsg* tc = (struct tcmsg*)NLMSG_DATA(nh);
+            if (tc->tcm_ifindex != ifindex)
+                continue;
+            int attrLen = (int)(nh->nlmsg_len - NLMSG_LENGTH(sizeof(*tc)));
+            for (struct rtattr* attr = TCA_RTA(tc); RTA_OK(attr, attrLen); attr = RTA_NEXT(attr, attrLen)) {
+                if (attr->rta_type == TCA_KIND && strcmp((const char*)RTA_DATA(attr), "etf") == 0)
+                    found = true;
+            }
+        }
+    }
+    close(fd);
+    return found;
+}
+#endif
+
+/* Index of the interface the packets to the remote address are sent on, 0 if unknown */
+int UDP::_get_egress_ifindex()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    // Route lookup: local address of a socket connected to the remote address
+    SOCKET sock = socket(_af, SOCK_DGRAM, 0);
+    if (sock == INVALID_SOCKET)
+        return 0;
+    if (_af == AF_INET) {
+        struct in_addr mcastIf;
+        socklen_t len = sizeof(mcastIf);
+        if (getsockopt(_sock, IPPROTO_IP, IP_MULTICAST_IF, &mcastIf, &len) == 0)
+            setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &mcastIf, len);
+    }
+    int addrlen;
+    const struct sockaddr* remote = getRemoteAddr(&addrlen);
+    struct sockaddr_storage local;
+    socklen_t len = sizeof(local);
+    int ifindex = 0;
+    if (connect(sock, remote, addrlen) == 0 && getsockname(sock, (struct sockaddr*)&local, &len) == 0) {
+        struct ifaddrs* addrs = NULL;
+        if (getifaddrs(&addrs) == 0) {
+            for (struct ifaddrs* current = addrs; current != NULL && ifindex == 0; current = current->ifa_next) {
+                if (current->ifa_addr == NULL || current->ifa_addr->sa_family != local.ss_family)
+                    continue;
+                if ((_af == AF_INET && ((struct sockaddr_in*)current->ifa_addr)->sin_addr.s_addr == ((struct sockaddr_in*)&local)->sin_addr.s_addr) ||
+                    (_af == AF_INET6 && memcmp(&((struct sockaddr_in6*)current->ifa_addr)->sin6_addr, &((struct sockaddr_in6*)&local)->sin6_addr, sizeof(struct in6_addr)) == 0))
+                    ifindex = if_nametoindex(current->ifa_name);
+            }
+            freeifaddrs(addrs);
+        }
+    }
+    CLOSESOCKET(sock);
+    return ifindex;
+#endif
+}
+
+int UDP::_enable_txtime()
+{
+#ifdef _WIN32
+    LOG_WARNING("launch time not available, the packets are paced by the sender");
+    return E_ERROR;
+#else
+    char ifname[IF_NAMESIZE] = "?";
+    int ifindex = _get_egress_ifindex();
+    if (ifindex != 0)
+        if_indextoname(ifindex, ifname);
+    if (ifindex == 0 || !has_etf_qdisc(ifindex)) {
+        LOG_WARNING("no ETF qdisc on interface '%s', launch time disabled: the packets are paced by the sender", ifname);
+        return E_ERROR;
+    }
+    struct sock_txtime config;
+    config.clockid = CLOCK_TAI;
+    config.flags = SOF_TXTIME_REPORT_ERRORS;
+    if (setsockopt(_sock, SOL_SOCKET, SO_TXTIME, &config, sizeof(config)) < 0) {
+        LOG_WARNING("setsockopt(SO_TXTIME) failed, error='%s', launch time disabled: the packets are paced by the sender", strerror(errno));
+        return E_ERROR;
+    }
+    // The packets dropped by the qdisc are reported on the error queue
+    int optval = 1;
+    if (_af == AF_INET)
+        setsockopt(_sock, IPPROTO_IP, IP_RECVERR, &optval, sizeof(optval));
+    else
+        setsockopt(_sock, IPPROTO_IPV6, IPV6_RECVERR, &optval, sizeof(optval));
+    _txTime = true;
+    _lastTxTime = 0;
+    LOG_INFO("launch time enabled, ETF qdisc on interface '%s'", ifname);
+    return E_OK;
+#endif
+}
+
+/*!
+* \fn adjustTxTime
+* \brief launch time of a packet accepted by the ETF qdisc: not in the past, and not before the
+*        previous packet
+*
+* \param time time to send the packet at, in ns (TAI, see CTxPacer::now())
+* \param now current time
+* \return launch time
+*/
+long long UDP::adjustTxTime(long long time, long long now)
+{
+    if (time < now + UDP_TXTIME_MIN_ADVANCE_NS)
+        time = now + UDP_TXTIME_MIN_ADVANCE_NS;
+    if (time < _lastTxTime)
+        time = _lastTxTime;
+    _lastTxTime = time;
+    return time;
+}
+
+/*!
+* \fn checkTxTimeErrors
+* \brief read the packets dropped by the qdisc (launch time missed or invalid) on the error queue
+*
+* \return nb of packets dropped since the last call
+*/
+int UDP::checkTxTimeErrors()
+{
+    int drops = 0;
+#ifndef _WIN32
+    if (!_txTime)
+        return 0;
+    while (true) {
+        char data[64];
+        char ctrl[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+        struct iovec iov;
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        iov.iov_base = data;
+        iov.iov_len = sizeof(data);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+        if (recvmsg(_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+            if ((cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVERR) ||
+                (cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+                struct sock_extended_err* err = (struct sock_extended_err*)CMSG_DATA(cm);
+                if (err->ee_origin == SO_EE_ORIGIN_TXTIME)
+                    drops++;
+            }
+        }
+    }
+    if (drops > 0) {
+        _txTimeDrops += drops;
+        LOG_WARNING("%d packets dropped by the qdisc, launch time missed (%llu in total)", drops, _txTimeDrops);
+    }
+#endif
+    return drops;
+}
+
+/*!
+* \fn writeTimedBatchedSocket
+* \brief send packets, each one at its launch time. In launch time mode (see enableTxTime()), the
+*        packets are sent with one sendmmsg() and launched by the kernel, otherwise the function
+*        waits for the time of each packet.
+*
+* \param buffer packets
+* \param len size of each packet
+* \param txtime time to send each packet at, in ns (TAI, see CTxPacer::now())
+* \param count nb of packets
+* \return nb of packets sent, -1 if error
+*/
+int UDP::writeTimedBatchedSocket(char **buffer, int *len, long long *txtime, int count)
+{
+#ifndef _WIN32
+    if (_txTime) {
+        long long now = CTxPacer::now();
+        if (count > 0 && txtime[0] - now > UDP_TXTIME_HORIZON_NS)
+            now = CTxPacer::waitUntil(txtime[0] - UDP_TXTIME_HORIZON_NS, 0);
+        struct mmsghdr  datagrams[count];
+        struct iovec    iovec[count];
+        char            ctrl[count][CMSG_SPACE(sizeof(unsigned long long))];
+        for (int i = 0; i < count; i++) {
+            memset(&datagrams[i], 0, sizeof(datagrams[i]));
+            iovec[i].iov_base = buffer[i];
+            iovec[i].iov_len = len[i];
+            struct msghdr* hdr = &datagrams[i].msg_hdr;
+            hdr->msg_iov = &iovec[i];
+            hdr->msg_iovlen = 1;
+            hdr->msg_name = (_af == AF_INET ? (struct sockaddr*) &_remote_addr4 : (struct sockaddr*) &_remote_addr6);
+            hdr->msg_namelen = (_af == AF_INET ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
+            hdr->msg_control = ctrl[i];
+            hdr->msg_controllen = sizeof(ctrl[i]);
+            struct cmsghdr* cm = CMSG_FIRSTHDR(hdr);
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_TXTIME;
+            cm->cmsg_len = CMSG_LEN(sizeof(unsigned long long));
+            unsigned long long time = (unsigned long long)adjustTxTime(txtime[i], now);
+            memcpy(CMSG_DATA(cm), &time, sizeof(time));
+        }
+        int sent = 0;
+        while (sent < count) {
+            int result = sendmmsg(_sock, &datagrams[sent], count - sent, 0);
+            if (result == -1) {
+                if (errno == EINTR)
+                    continue;
+                LOG_ERROR("failed to send timed messages batch, %d/%d sent, error=%s", sent, count, strerror(errno));
+                checkTxTimeErrors();
+                return -1;
+            }
+            sent += result;
+        }
+        checkTxTimeErrors();
+        return sent;
+    }
+#endif
+    // No launch time: wait for the time of each packet
+    for (int i = 0; i < count; i++) {
+        CTxPacer::waitUntil(txtime[i], (long long)TXPACER_DEFAULT_SPIN_US * 1000);
+        int size = len[i];
+        if (writeSocket(buffer[i], &size) == -1)
+            return -1;
+    }
+    return count;
+}
+
+
 #ifdef USE_NETMAP
 #include <netinet/if_ether.h>
 #include <netinet/ip.h>
@@ -21,9 +21,22 @@
 #define E_ERROR 3
 #define E_FATAL -1
 
+#define UDP_RXRING_DEFAULT_PACKETS  64      /* packets per recvmmsg() */
+#define UDP_RXRING_PACKET_SIZE      9216    /* jumbo frames */
+#define UDP_TXTIME_MIN_ADVANCE_NS   50000       /* launch time at least 50 us after the send */
+#define UDP_TXTIME_HORIZON_NS       100000000   /* packets launched more than 100 ms ahead wait in the sender */
+
 #define C_INADDR_ANY            "INADDR_ANY"
 #define C_INADDR_ANY_REUSE      "INADDR_ANY_REUSE"      /* Reuse address and port */
 
+#define TCP_GATHER_MAX_PARTS    8       /* parts of a message sent with writeGather() */
+
+/* Part of a message sent with writeGather() */
+struct TCPGather {
+    const char* buffer;
+    int         len;
+};
+
 class TCP 
 { 
 private:
@@ -34,11 +47,21 @@ private:
     bool    _isListening;
     struct sockaddr_in _addr;
     int     _conn_attemp;
+    bool    _zeroCopyRequested;     /* MSG_ZEROCOPY requested, see enableZeroCopy() */
+    bool    _zeroCopy;              /* MSG_ZEROCOPY enabled on _sockClient */
+    unsigned int _zcNextId;         /* id of the next zero copy send on _sockClient */
+    unsigned long long _zcCopied;   /* zero copy sends the kernel copied anyway */
+    int     _sndBufSize;            /* SO_SNDBUF requested, see setBufferSize() */
+    int     _rcvBufSize;            /* SO_RCVBUF requested */
+    bool    _bufApplied;            /* buffer sizes applied on _sockClient */
 public:
     TCP();
     virtual ~TCP();
 private:
     int waitForClientConnection();
+    void _on_connected();
+    int  _enable_zerocopy();
+    void _apply_buffer_size();
 public:
     void init(const int tcp_timeout);
     int  openSocket(const char* addr, int port, const char* bindToDevice=NULL);
@@ -46,10 +69,27 @@ public:
     int  readSocket(char *buffer, int *len);
     int  blockingReadSocket(const SOCKET &socketHandle,char *buffer, const int &len);
     int  writeSocket(char *buffer, int *len);
+    int  writeGather(const TCPGather* parts, int nbParts, unsigned int* firstId = NULL, int* nbIds = NULL);
+    void enableZeroCopy();
+    bool isZeroCopy() { return _zeroCopy; };
+    int  readZeroCopyCompletions(unsigned int* first, unsigned int* last, int max, int timeoutMs);
+    void setBufferSize(int sndBufSize, int rcvBufSize);
     bool isValid() { return _sockClient!=INVALID_SOCKET; };
 };  // TCP
 
 
+struct UDPRxRing;
+
+/* Destination of a received packet, split between its headers and its payload (see readScatter) */
+struct UDPScatter {
+    char*       header;         /* buffer for the headers */
+    int         headerLen;      /* size of the headers */
+    char*       payload;        /* final location of the payload */
+    int         payloadLen;     /* room at payload, the overflow is discarded */
+    int         len;            /* [out] size of the packet, headers included */
+    long long   timestamp;      /* [out] kernel RX timestamp in ns, 0 if not available */
+};
+
 class UDP 
 { 
 protected:
@@ -61,6 +101,16 @@ protected:
     struct sockaddr_in6 _local_addr6;
     struct sockaddr_in _remote_addr4;
     struct sockaddr_in6 _remote_addr6;
+    UDPRxRing* _rxRing;     /* ring of received packets, see enableBatchReceive() */
+    bool   _txTimeRequested;    /* launch time mode requested, see enableTxTime() */
+    bool   _txTime;             /* launch time mode enabled on _sock */
+    long long _lastTxTime;      /* last launch time, the launch times must not decrease */
+    unsigned long long _txTimeDrops;    /* packets dropped by the qdisc */
+
+    int  _read_single(char **packet, int *len, long long *timestamp);
+    int  _recv_msgs(int nbPackets);
+    int  _get_egress_ifindex();
+    int  _enable_txtime();
 public:
     UDP();
     virtual ~UDP();
@@ -72,11 +122,25 @@ public:
     int  openRawSocket();
     virtual int  closeSocket();
     virtual int  readSocket(char *buffer, int *len);
-    //int  readSocket2(char *buffer, int *len);
+    virtual int  enableBatchReceive(int nbPackets = UDP_RXRING_DEFAULT_PACKETS, bool timestamping = false);
+    bool isBatchReceive();
+    int  readBatch();
+    int  readPacket(char **packet, int *len, long long *timestamp = NULL);
+    int  readScatter(UDPScatter* packets, int nbPackets);
     virtual int  writeSocket(char *buffer, int *len);
     virtual int  writeBatchedSocket(char **buffer, int *len, int count);
+    int  enableTxTime(bool enable = true);
+    bool isTxTime() { return _txTime; };
+    long long adjustTxTime(long long time, long long now);
+    int  checkTxTimeErrors();
+    int  writeTimedBatchedSocket(char **buffer, int *len, long long *txtime, int count);
     bool isValid() { return _sock!=INVALID_SOCKET; };
     SOCKET getSock() { return _sock; };
+    virtual bool isKernelSocket() { return true; };    /* false if the packets don't go through _sock */
+    const struct sockaddr* getRemoteAddr(int* len) {
+        *len = (_af == AF_INET ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
+        return (_af == AF_INET ? (struct sockaddr*) &_remote_addr4 : (struct sockaddr*) &_remote_addr6);
+    };
 
     virtual void pktTSctl(int, unsigned int = 0, long long = 0) {};
 };  // UDP
@@ -105,6 +169,7 @@ public:
     virtual int  readSocket(char *buffer, int *len);
     virtual int  writeSocket(char *buffer, int *len);
     virtual int  writeBatchedSocket(char **buffer, int count, int *len);
+    virtual bool isKernelSocket() { return false; };
 
 private:
     int readSocketNonBlocking(char *buffer, int *len);
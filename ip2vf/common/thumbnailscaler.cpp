@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <thread>
+
+#include "common.h"
+#include "tools.h"
+#include "log.h"
+#include "workerpool.h"
+#include "thumbnailscaler.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define THUMB_HAVE_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+#define THUMB_TARGET(isa)
+#else
+#define THUMB_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+#define THUMB_MAX_BANDS     16      /* max nb of bands of output lines processed in parallel */
+#define THUMB_COEF_SHIFT    13      /* fixed point of the conversion matrix */
+
+/*
+* The averaged components are stored as Y-16, Cb-128 and Cr-128 in 16 bits. With the Q13
+* coefficients, each product and the sum of two of them fit in 32 bits, so the SSE2/AVX2
+* kernels use pmaddwd on (Y, Cb) and (Y, Cr) pairs. The scalar kernel gives the same result.
+*/
+
+typedef void (*accumulateKernel)(const unsigned char* in, int n, uint16_t* acc);
+typedef void (*toRGBAKernel)(const int16_t* y, const int16_t* cb, const int16_t* cr, int n, const int16_t* coefs, unsigned char* out);
+
+/*!
+* \fn _accumulate_scalar
+* \brief reference implementation: add n 8 bits components to the accumulators
+*/
+static void _accumulate_scalar(const unsigned char* in, int n, uint16_t* acc) {
+    for (int i = 0; i < n; i++)
+        acc[i] += in[i];
+}
+
+/*!
+* \fn _reciprocal
+* \brief Q32 reciprocal of the nb of components averaged: the averages are computed with
+*        _average(), a multiply instead of a division
+*/
+static inline uint64_t _reciprocal(int count) {
+    return (((uint64_t)1 << 32) + count - 1) / count;
+}
+
+static inline int _average(int sum, uint64_t reciprocal, int half) {
+    return (int)(((uint64_t)(sum + half) * reciprocal) >> 32);
+}
+
+static inline unsigned char _clamp8(int v) {
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+/*!
+* \fn _to_rgba_scalar
+* \brief reference implementation: convert n pixels from Y-16, Cb-128, Cr-128 to RGBA
+*/
+static void _to_rgba_scalar(const int16_t* y, const int16_t* cb, const int16_t* cr, int n, const int16_t* coefs, unsigned char* out) {
+    const int round = 1 << (THUMB_COEF_SHIFT - 1);
+    for (int i = 0; i < n; i++) {
+        int l = coefs[0] * y[i] + round;
+        out[0] = _clamp8((l + coefs[1] * cr[i]) >> THUMB_COEF_SHIFT);
+        out[1] = _clamp8((l + coefs[2] * cb[i] + coefs[3] * cr[i]) >> THUMB_COEF_SHIFT);
+        out[2] = _clamp8((l + coefs[4] * cb[i]) >> THUMB_COEF_SHIFT);
+        out[3] = 255;
+        out += 4;
+    }
+}
+
+#ifdef THUMB_HAVE_X86
+
+/* 32 bits lane holding the pmaddwd coefficients of a (low, high) pair of 16 bits components */
+#define THUMB_PAIR(low, high)   ((int)(((uint32_t)(uint16_t)(high) << 16) | (uint16_t)(low)))
+
+THUMB_TARGET("sse2")
+static void _accumulate_sse2(const unsigned char* in, int n, uint16_t* acc) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(acc + i + 8));
+        _mm_storeu_si128((__m128i*)(acc + i), _mm_add_epi16(a, _mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128((__m128i*)(acc + i + 8), _mm_add_epi16(b, _mm_unpackhi_epi8(v, zero)));
+    }
+    _accumulate_scalar(in + i, n - i, acc + i);
+}
+
+THUMB_TARGET("sse2")
+static void _to_rgba_sse2(const int16_t* y, const int16_t* cb, const int16_t* cr, int n, const int16_t* coefs, unsigned char* out) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (THUMB_COEF_SHIFT - 1));
+    const __m128i kr = _mm_set1_epi32(THUMB_PAIR(coefs[0], coefs[1]));
+    const __m128i kg = _mm_set1_epi32(THUMB_PAIR(coefs[0], coefs[2]));
+    const __m128i kgv = _mm_set1_epi32(THUMB_PAIR(coefs[3], 0));
+    const __m128i kb = _mm_set1_epi32(THUMB_PAIR(coefs[0], coefs[4]));
+    const __m128i alpha = _mm_set1_epi16(255);
+    int i = 0;
+    // 8 pixels per iteration
+    for (; i + 8 <= n; i += 8) {
+        __m128i vy = _mm_loadu_si128((const __m128i*)(y + i));
+        __m128i vcb = _mm_loadu_si128((const __m128i*)(cb + i));
+        __m128i vcr = _mm_loadu_si128((const __m128i*)(cr + i));
+        __m128i ycr_lo = _mm_unpacklo_epi16(vy, vcr), ycr_hi = _mm_unpackhi_epi16(vy, vcr);
+        __m128i ycb_lo = _mm_unpacklo_epi16(vy, vcb), ycb_hi = _mm_unpackhi_epi16(vy, vcb);
+        __m128i cr_lo = _mm_unpacklo_epi16(vcr, zero), cr_hi = _mm_unpackhi_epi16(vcr, zero);
+        __m128i r = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycr_lo, kr), round), THUMB_COEF_SHIFT),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycr_hi, kr), round), THUMB_COEF_SHIFT));
+        __m128i g = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(ycb_lo, kg), _mm_madd_epi16(cr_lo, kgv)), round), THUMB_COEF_SHIFT),
+            _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(ycb_hi, kg), _mm_madd_epi16(cr_hi, kgv)), round), THUMB_COEF_SHIFT));
+        __m128i b = _mm_packs_epi32(
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycb_lo, kb), round), THUMB_COEF_SHIFT),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ycb_hi, kb), round), THUMB_COEF_SHIFT));
+        // r0..r7 b0..b7 and g0..g7 a0..a7, interleaved to r g b a
+        __m128i rb = _mm_packus_epi16(r, b);
+        __m128i ga = _mm_packus_epi16(g, alpha);
+        __m128i rg = _mm_unpacklo_epi8(rb, ga);
+        __m128i ba = _mm_unpackhi_epi8(rb, ga);
+        _mm_storeu_si128((__m128i*)(out + i * 4), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i*)(out + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+    }
+    _to_rgba_scalar(y + i, cb + i, cr + i, n - i, coefs, out + i * 4);
+}
+
+THUMB_TARGET("avx2")
+static void _accumulate_avx2(const unsigned char* in, int n, uint16_t* acc) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in + i)));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in + i + 16)));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(acc + i + 16));
+        _mm256_storeu_si256((__m256i*)(acc + i), _mm256_add_epi16(a, lo));
+        _mm256_storeu_si256((__m256i*)(acc + i + 16), _mm256_add_epi16(b, hi));
+    }
+    _accumulate_sse2(in + i, n - i, acc + i);
+}
+
+THUMB_TARGET("avx2")
+static void _to_rgba_avx2(const int16_t* y, const int16_t* cb, const int16_t* cr, int n, const int16_t* coefs, unsigned char* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(1 << (THUMB_COEF_SHIFT - 1));
+    const __m256i kr = _mm256_set1_epi32(THUMB_PAIR(coefs[0], coefs[1]));
+    const __m256i kg = _mm256_set1_epi32(THUMB_PAIR(coefs[0], coefs[2]));
+    const __m256i kgv = _mm256_set1_epi32(THUMB_PAIR(coefs[3], 0));
+    const __m256i kb = _mm256_set1_epi32(THUMB_PAIR(coefs[0], coefs[4]));
+    const __m256i alpha = _mm256_set1_epi16(255);
+    int i = 0;
+    // 16 pixels per iteration. unpack and pack work by 128 bits lane: after packs_epi32 the
+    // components are back in order, the RGBA quads are reordered at the store
+    for (; i + 16 <= n; i += 16) {
+        __m256i vy = _mm256_loadu_si256((const __m256i*)(y + i));
+        __m256i vcb = _mm256_loadu_si256((const __m256i*)(cb + i));
+        __m256i vcr = _mm256_loadu_si256((const __m256i*)(cr + i));
+        __m256i ycr_lo = _mm256_unpacklo_epi16(vy, vcr), ycr_hi = _mm256_unpackhi_epi16(vy, vcr);
+        __m256i ycb_lo = _mm256_unpacklo_epi16(vy, vcb), ycb_hi = _mm256_unpackhi_epi16(vy, vcb);
+        __m256i cr_lo = _mm256_unpacklo_epi16(vcr, zero), cr_hi = _mm256_unpackhi_epi16(vcr, zero);
+        __m256i r = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycr_lo, kr), round), THUMB_COEF_SHIFT),
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycr_hi, kr), round), THUMB_COEF_SHIFT));
+        __m256i g = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycb_lo, kg), _mm256_madd_epi16(cr_lo, kgv)), round), THUMB_COEF_SHIFT),
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycb_hi, kg), _mm256_madd_epi16(cr_hi, kgv)), round), THUMB_COEF_SHIFT));
+        __m256i b = _mm256_packs_epi32(
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycb_lo, kb), round), THUMB_COEF_SHIFT),
+            _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ycb_hi, kb), round), THUMB_COEF_SHIFT));
+        __m256i rb = _mm256_packus_epi16(r, b);
+        __m256i ga = _mm256_packus_epi16(g, alpha);
+        __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+        __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+        __m256i lo = _mm256_unpacklo_epi16(rg, ba);     /* pixels 0-3, 8-11 */
+        __m256i hi = _mm256_unpackhi_epi16(rg, ba);     /* pixels 4-7, 12-15 */
+        _mm256_storeu_si256((__m256i*)(out + i * 4), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + i * 4 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    _to_rgba_sse2(y + i, cb + i, cr + i, n - i, coefs, out + i * 4);
+}
+
+#endif // THUMB_HAVE_X86
+
+static accumulateKernel g_accumulate = _accumulate_scalar;
+static toRGBAKernel     g_toRGBA = _to_rgba_scalar;
+static std::once_flag   g_thumbInitFlag;
+
+/*!
+* \fn _init_kernels
+* \brief select the kernels for the CPU, with the instruction set of the 10/8 bits conversions
+*/
+static void _init_kernels() {
+    const char* name = "scalar";
+#ifdef THUMB_HAVE_X86
+    int level = tools::getSIMDLevel();
+    if (level >= TOOLS_SIMD_AVX2) {
+        g_accumulate = _accumulate_avx2;
+        g_toRGBA = _to_rgba_avx2;
+        name = "avx2";
+    }
+    else if (level >= TOOLS_SIMD_SSE41) {
+        g_accumulate = _accumulate_sse2;
+        g_toRGBA = _to_rgba_sse2;
+        name = "sse2";
+    }
+#endif
+    LOG_INFO("thumbnail kernels: %s", name);
+}
+
+/**********************************************************************************************
+*
+* CThumbnailScaler
+*
+***********************************************************************************************/
+
+CThumbnailScaler::CThumbnailScaler() {
+    _src_w = 0;
+    _src_h = 0;
+    _fmt = SAMPLINGFMT::YCbCr_4_2_2;
+    _depth = 8;
+    _colorimetry = COLORIMETRY::BT709_2;
+    _ratio = 1;
+    _out_depth = 4;
+    _dst_w = 0;
+    _dst_h = 0;
+    _src_line = 0;
+    _acc_line = 0;
+    _bpp = 0;
+    memset(_coefs, 0, sizeof(_coefs));
+    _bConfigured = false;
+}
+
+/*!
+* \fn configure
+* \brief set the source format and the downscale ratio, and allocate the work buffers
+*
+* \param src_w width of the source
+* \param src_h height of the source
+* \param fmt sampling format of the source
+* \param depth bits per component of a YCbCr source (8 or 10)
+* \param colorimetry matrix of a YCbCr source
+* \param ratio downscale ratio, from 1 to THUMB_MAX_RATIO
+* \param out_depth 3 for RGB, 4 for RGBA output pixels
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CThumbnailScaler::configure(int src_w, int src_h, SAMPLINGFMT fmt, int depth, COLORIMETRY colorimetry, int ratio, int out_depth) {
+
+    std::call_once(g_thumbInitFlag, _init_kernels);
+    _bConfigured = false;
+
+    if (src_w <= 0 || src_h <= 0 || ratio < 1 || ratio > THUMB_MAX_RATIO || (out_depth != 3 && out_depth != 4)
+        || src_w / ratio == 0 || src_h / ratio == 0) {
+        LOG_ERROR("invalid thumbnail parameters: %dx%d, ratio=%d, output depth=%d", src_w, src_h, ratio, out_depth);
+        return VMI_E_INVALID_PARAMETER;
+    }
+    if (fmt == SAMPLINGFMT::YCbCr_4_2_2) {
+        if ((depth != 8 && depth != 10) || (src_w % 2) != 0) {
+            LOG_ERROR("thumbnail not supported for YCbCr 4:2:2 %d bits, width %d", depth, src_w);
+            return VMI_E_NOT_SUPPORTED;
+        }
+        _src_line = (depth == 8 ? src_w * 2 : src_w / 2 * 5);
+        _acc_line = src_w * 2;
+        _bpp = 0;
+    }
+    else if (fmt == SAMPLINGFMT::RGB || fmt == SAMPLINGFMT::BGR || fmt == SAMPLINGFMT::RGBA || fmt == SAMPLINGFMT::BGRA) {
+        _bpp = (fmt == SAMPLINGFMT::RGB || fmt == SAMPLINGFMT::BGR ? 3 : 4);
+        _src_line = src_w * _bpp;
+        _acc_line = _src_line;
+    }
+    else {
+        LOG_ERROR("thumbnail not supported for sampling format %d", fmt);
+        return VMI_E_NOT_SUPPORTED;
+    }
+
+    _src_w = src_w;
+    _src_h = src_h;
+    _fmt = fmt;
+    _depth = depth;
+    _colorimetry = colorimetry;
+    _ratio = ratio;
+    _out_depth = out_depth;
+    _dst_w = src_w / ratio;
+    _dst_h = src_h / ratio;
+
+    // Video range Y'CbCr to full range R'G'B'
+    double kr = 0.2126, kb = 0.0722;
+    if (colorimetry == COLORIMETRY::BT601_5) {
+        kr = 0.299;
+        kb = 0.114;
+    }
+    else if (colorimetry == COLORIMETRY::SMPTE240M) {
+        kr = 0.212;
+        kb = 0.087;
+    }
+    double kg = 1.0 - kr - kb;
+    double ys = 255.0 / 219.0, cs = 255.0 / 224.0, one = (double)(1 << THUMB_COEF_SHIFT);
+    _coefs[0] = (int16_t)lround(ys * one);
+    _coefs[1] = (int16_t)lround(2.0 * (1.0 - kr) * cs * one);
+    _coefs[2] = (int16_t)lround(-2.0 * kb * (1.0 - kb) / kg * cs * one);
+    _coefs[3] = (int16_t)lround(-2.0 * kr * (1.0 - kr) / kg * cs * one);
+    _coefs[4] = (int16_t)lround(2.0 * (1.0 - kb) * cs * one);
+
+    int nbBands = std::min(std::min(_dst_h, THUMB_MAX_BANDS), std::max((int)std::thread::hardware_concurrency(), 1));
+    _bands.resize(nbBands);
+    for (Band& b : _bands) {
+        b.acc.assign(_acc_line, 0);
+        b.line.assign(_depth == 10 && _bpp == 0 ? _acc_line : 0, 0);
+        b.planes.assign(3 * _dst_w, 0);
+        b.rgba.assign(4 * _dst_w, 0);
+    }
+
+    LOG_INFO("thumbnail of %dx%d fmt=%d %d bits, colorimetry=%d: %dx%d %s, %d bands", _src_w, _src_h, _fmt, _depth, _colorimetry,
+        _dst_w, _dst_h, (_out_depth == 3 ? "RGB" : "RGBA"), nbBands);
+    _bConfigured = true;
+    return VMI_E_OK;
+}
+
+/*!
+* \fn isConfigured
+* \brief check if the scaler is configured for a source format
+*/
+bool CThumbnailScaler::isConfigured(int src_w, int src_h, SAMPLINGFMT fmt, int depth, COLORIMETRY colorimetry) {
+    return _bConfigured && src_w == _src_w && src_h == _src_h && fmt == _fmt
+        && (_bpp != 0 || (depth == _depth && colorimetry == _colorimetry));
+}
+
+/*!
+* \fn process
+* \brief build the thumbnail of a frame
+*
+* \param src media buffer of the frame
+* \param src_size size of the media buffer
+* \param dst buffer receiving the thumbnail, of getSize() bytes
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CThumbnailScaler::process(const unsigned char* src, int src_size, unsigned char* dst) {
+
+    if (!_bConfigured)
+        return VMI_E_BAD_INIT;
+    if (src == NULL || dst == NULL || src_size < _src_line * _src_h) {
+        LOG_ERROR("invalid media buffer for a %dx%d thumbnail source: %d bytes", _src_w, _src_h, src_size);
+        return VMI_E_INVALID_FRAME;
+    }
+
+    int nbBands = (int)_bands.size();
+    if (nbBands == 1)
+        _process_band(src, dst, 0);
+    else
+        CWorkerPool::getInstance()->parallelFor(nbBands, [=](int band) { _process_band(src, dst, band); });
+    return VMI_E_OK;
+}
+
+/*!
+* \fn _process_band
+* \brief build the output lines of a band
+*/
+void CThumbnailScaler::_process_band(const unsigned char* src, unsigned char* dst, int band) {
+
+    Band& b = _bands[band];
+    int nbBands = (int)_bands.size();
+    int first = band * _dst_h / nbBands;
+    int last = (band + 1) * _dst_h / nbBands;
+    int dstLine = _dst_w * _out_depth;
+
+    for (int dy = first; dy < last; dy++) {
+        // Sum the source lines of the output line
+        std::fill(b.acc.begin(), b.acc.end(), 0);
+        for (int r = 0; r < _ratio; r++) {
+            const unsigned char* in = src + (size_t)(dy * _ratio + r) * _src_line;
+            if (!b.line.empty()) {
+                tools::convert10bitsto8bits((unsigned char*)in, _src_line, b.line.data());
+                in = b.line.data();
+            }
+            g_accumulate(in, _acc_line, b.acc.data());
+        }
+
+        // Average and convert the output pixels
+        unsigned char* out = dst + (size_t)dy * dstLine;
+        int16_t* p0 = b.planes.data();
+        int16_t* p1 = p0 + _dst_w;
+        int16_t* p2 = p1 + _dst_w;
+        if (_bpp == 0) {
+            _average_ycbcr(b, _ratio * _ratio);
+            g_toRGBA(p0, p1, p2, _dst_w, _coefs, _out_depth == 4 ? out : b.rgba.data());
+            if (_out_depth == 3) {
+                const unsigned char* rgba = b.rgba.data();
+                for (int x = 0; x < _dst_w; x++, out += 3, rgba += 4) {
+                    out[0] = rgba[0];
+                    out[1] = rgba[1];
+                    out[2] = rgba[2];
+                }
+            }
+        }
+        else {
+            _average_rgb(b, _ratio * _ratio);
+            for (int x = 0; x < _dst_w; x++, out += _out_depth) {
+                out[0] = (unsigned char)p0[x];
+                out[1] = (unsigned char)p1[x];
+                out[2] = (unsigned char)p2[x];
+                if (_out_depth == 4)
+                    out[3] = 255;
+            }
+        }
+    }
+}
+
+/*!
+* \fn _average_ycbcr
+* \brief average the accumulated Cb Y Cr Y components of each output pixel, to the Y-16,
+*        Cb-128 and Cr-128 planes
+*/
+void CThumbnailScaler::_average_ycbcr(Band& b, int count) {
+
+    const uint16_t* acc = b.acc.data();
+    int16_t* py = b.planes.data();
+    int16_t* pcb = py + _dst_w;
+    int16_t* pcr = pcb + _dst_w;
+    int half = count / 2;
+    uint64_t rcp = _reciprocal(count);
+    int pairs = _ratio / 2;
+    for (int x = 0; x < _dst_w; x++) {
+        int sy = 0, scb = 0, scr = 0;
+        if ((_ratio & 1) == 0) {
+            // even ratio: whole Cb Y Cr Y pairs, each Cb and Cr is shared by 2 pixels
+            const uint16_t* a = acc + 4 * x * pairs;
+            for (int i = 0; i < pairs; i++, a += 4) {
+                scb += a[0];
+                sy += a[1] + a[3];
+                scr += a[2];
+            }
+            scb *= 2;
+            scr *= 2;
+        }
+        else {
+            int p = x * _ratio;
+            for (int i = 0; i < _ratio; i++, p++) {
+                // a pixel has its own Y, and the Cb and Cr of its pair
+                sy += acc[2 * p + 1];
+                scb += acc[4 * (p >> 1)];
+                scr += acc[4 * (p >> 1) + 2];
+            }
+        }
+        py[x] = (int16_t)(_average(sy, rcp, half) - 16);
+        pcb[x] = (int16_t)(_average(scb, rcp, half) - 128);
+        pcr[x] = (int16_t)(_average(scr, rcp, half) - 128);
+    }
+}
+
+/*!
+* \fn _average_rgb
+* \brief average the accumulated components of each output pixel, to the R, G and B planes
+*/
+void CThumbnailScaler::_average_rgb(Band& b, int count) {
+
+    const uint16_t* acc = b.acc.data();
+    int16_t* pr = b.planes.data();
+    int16_t* pg = pr + _dst_w;
+    int16_t* pb = pg + _dst_w;
+    int ir = (_fmt == SAMPLINGFMT::BGR || _fmt == SAMPLINGFMT::BGRA ? 2 : 0);
+    int ib = 2 - ir;
+    int half = count / 2;
+    uint64_t rcp = _reciprocal(count);
+    for (int x = 0; x < _dst_w; x++) {
+        int sr = 0, sg = 0, sb = 0;
+        const uint16_t* a = acc + x * _ratio * _bpp;
+        for (int i = 0; i < _ratio; i++, a += _bpp) {
+            sr += a[ir];
+            sg += a[1];
+            sb += a[ib];
+        }
+        pr[x] = (int16_t)_average(sr, rcp, half);
+        pg[x] = (int16_t)_average(sg, rcp, half);
+        pb[x] = (int16_t)_average(sb, rcp, half);
+    }
+}
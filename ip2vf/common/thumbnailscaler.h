@@ -0,0 +1,67 @@
+#ifndef _THUMBNAILSCALER_H
+#define _THUMBNAILSCALER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "libvMI.h"
+
+#define THUMB_MAX_RATIO     64      /* max downscale ratio, the accumulators are 16 bits */
+
+/**********************************************************************************************
+*
+* CThumbnailScaler
+*
+* Preview of a video frame: each output pixel is the average of the ratio x ratio source
+* pixels it covers (box filter), and the YCbCr sources are converted to RGB(A) with the matrix
+* of their colorimetry. The source lines of a band of output lines are summed in 16 bits
+* accumulators, the averaging is done in YCbCr and only the output pixels are converted. The
+* bands are processed in parallel on the worker pool.
+*
+* Supported sources: packed YCbCr 4:2:2 (Cb Y Cr Y) 8 or 10 bits, RGB, RGBA, BGR and BGRA. The
+* output is R, G, B (and A) bytes.
+*
+***********************************************************************************************/
+
+class CThumbnailScaler
+{
+    /* Work buffers of a band of output lines */
+    struct Band {
+        std::vector<uint16_t>       acc;            /* sum of the source lines, per component */
+        std::vector<unsigned char>  line;           /* 10 bits source line converted to 8 bits */
+        std::vector<int16_t>        planes;         /* averaged components of an output line: 3 planes of _dst_w */
+        std::vector<unsigned char>  rgba;           /* converted output line, RGBA */
+    };
+
+    int         _src_w;
+    int         _src_h;
+    SAMPLINGFMT _fmt;
+    int         _depth;                 /* bits per component of the source */
+    COLORIMETRY _colorimetry;
+    int         _ratio;
+    int         _out_depth;             /* 3 (RGB) or 4 (RGBA) bytes per output pixel */
+    int         _dst_w;
+    int         _dst_h;
+    int         _src_line;              /* bytes per source line */
+    int         _acc_line;              /* components per source line, once in 8 bits */
+    int         _bpp;                   /* bytes per source pixel, RGB(A) sources only */
+    int16_t     _coefs[5];              /* Q13 conversion matrix: Y, Cr->R, Cb->G, Cr->G, Cb->B */
+    std::vector<Band> _bands;
+    bool        _bConfigured;
+
+    void _process_band(const unsigned char* src, unsigned char* dst, int band);
+    void _average_ycbcr(Band& b, int count);
+    void _average_rgb(Band& b, int count);
+
+public:
+    CThumbnailScaler();
+
+    int  configure(int src_w, int src_h, SAMPLINGFMT fmt, int depth, COLORIMETRY colorimetry, int ratio, int out_depth);
+    bool isConfigured(int src_w, int src_h, SAMPLINGFMT fmt, int depth, COLORIMETRY colorimetry);
+    int  process(const unsigned char* src, int src_size, unsigned char* dst);
+    int  getWidth() { return _dst_w; };
+    int  getHeight() { return _dst_h; };
+    int  getSize() { return _dst_w * _dst_h * _out_depth; };
+};
+
+#endif // _THUMBNAILSCALER_H
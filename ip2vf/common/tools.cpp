@@ -459,55 +459,6 @@ int tools::getIPAddressFromString(const char* str) {
     return ip;
 }
 
-VMILIBRARY_API_TOOLS int tools::convert10bitsto8bits(unsigned char* in, int in_size, unsigned char* out) {
-    try {
-        unsigned int w[4];
-        while ((in_size - 5) >= 0)
-        {
-            w[0] = ((in[0]) << 2) + ((in[1] & 0b11000000) >> 6);
-            w[1] = ((in[1] & 0b00111111) << 4) + ((in[2] & 0b11110000) >> 4);
-            w[2] = ((in[2] & 0b00001111) << 6) + ((in[3] & 0b11111100) >> 2);
-            w[3] = ((in[3] & 0b00000011) << 8) + ((in[4]));
-            for (int k = 0; k < 4; k++)
-            {
-                out[k] = (unsigned char)(w[k] >> 2);
-            }
-            in += 5; in_size -= 5;
-            out += 4;
-        }
-    }
-    catch (...) {
-        LOG_ERROR("catch exception ...");
-    }
-    return 0;
-}
-
-VMILIBRARY_API_TOOLS int tools::convert8bitsto10bits(unsigned char* in, int in_size, unsigned char* out) {
-    try {
-        //for (int i = 0; i < in_size; i++)
-        //    tools::set10bitsWord(out, i, MAX(16, MIN(in[i], !!(i % 2) ? 235 : 240)) << 2);
-        unsigned int w[4];
-        int i = 0;
-        while ((in_size - 4) >= 0)
-        {
-            for (int k = 0; k < 4; k++, i++) {
-                w[k] = MAX(16, MIN(in[i], !!(i % 2) ? 235 : 240)) << 2;
-            }
-            out[0] = (unsigned char) ((w[0] & 0b1111111100) >> 2);
-            out[1] = (unsigned char)(((w[0] & 0b0000000011) << 6) + ((w[1] & 0b1111110000) >> 4));
-            out[2] = (unsigned char)(((w[1] & 0b0000001111) << 4) + ((w[2] & 0b1111000000) >> 6));
-            out[3] = (unsigned char)(((w[2] & 0b0000111111) << 2) + ((w[3] & 0b1100000000) >> 8));
-            out[4] = (unsigned char)  (w[3] & 0b0011111111);
-            in_size -= 4;
-            out += 5;
-        }
-    }
-    catch (...) {
-        LOG_ERROR("catch exception ...");
-    }
-    return 0;
-}
-
 VMILIBRARY_API_TOOLS string tools::getEnv(const string & var) {
 
     const char * val = ::getenv(var.c_str());
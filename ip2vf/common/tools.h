@@ -34,6 +34,12 @@ const unsigned char SET_IN1_MASK[8] = { 0b00000000, 0b00111111, 0b11000000, 0b00
 const unsigned char SET_IN2_MASK[8] = { 0b11111111, 0b11000000, 0b00111111, 0b11110000, 0b00001111, 0b11111100, 0b00000011, 0b11111111 };
 const unsigned char SET_INDICES[8] = { 2, 6, 4, 4, 6, 2, 8, 0 };
 
+// Instruction sets usable by the SIMD kernels, see tools::getSIMDLevel()
+#define TOOLS_SIMD_SCALAR   0
+#define TOOLS_SIMD_SSE41    1
+#define TOOLS_SIMD_AVX2     2
+#define TOOLS_SIMD_AVX512   3
+
 void DUMP_RGBPIXEL_AT(unsigned char* rgb, int w, int h, int x, int y);
 void DUMP_YUV8PIXEL_AT(unsigned char* yuv, int w, int h, int x, int y);
 
@@ -65,6 +71,10 @@ namespace tools
     VMILIBRARY_API_TOOLS int             getIPAddressFromString(const char* str);
     VMILIBRARY_API_TOOLS int             convert10bitsto8bits(unsigned char* in, int in_size, unsigned char* out);
     VMILIBRARY_API_TOOLS int             convert8bitsto10bits(unsigned char* in, int in_size, unsigned char* out);
+    VMILIBRARY_API_TOOLS int             convert10bitsto8bitsScalar(unsigned char* in, int in_size, unsigned char* out);
+    VMILIBRARY_API_TOOLS int             convert8bitsto10bitsScalar(unsigned char* in, int in_size, unsigned char* out);
+    VMILIBRARY_API_TOOLS const char*     getConvertKernelName();
+    VMILIBRARY_API_TOOLS int             getSIMDLevel();
     VMILIBRARY_API_TOOLS string          getEnv(const string & var);
     VMILIBRARY_API_TOOLS void            convertYUV8ToRGB(unsigned char* src, int src_w, int src_h, unsigned char* dest, int factor, int depth);
     VMILIBRARY_API_TOOLS void            convertRGBAToRGB(unsigned char* src, int src_w, int src_h, unsigned char* dest, int factor, int depth);
@@ -0,0 +1,505 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "common.h"
+#include "error.h"
+#include "log.h"
+#include "txpacer.h"
+
+#ifndef _WIN32
+#ifndef CLOCK_TAI
+#define CLOCK_TAI       11
+#endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TXPACER_USE_TSC
+#endif
+
+#define NS_PER_SECOND   1000000000LL
+
+std::mutex CTxPacer::_instancesMtx;
+std::vector<CTxPacer*> CTxPacer::_instances;
+
+#ifdef TXPACER_USE_TSC
+/* TSC ticks per ns, calibrated once against the clock */
+static double g_tscPerNs = 0;
+static std::once_flag g_tscOnce;
+
+static void _calibrate_tsc()
+{
+    long long t0 = CTxPacer::now();
+    unsigned long long c0 = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    long long t1 = CTxPacer::now();
+    unsigned long long c1 = __rdtsc();
+    if (t1 > t0 && c1 > c0)
+        g_tscPerNs = (double)(c1 - c0) / (t1 - t0);
+    LOG_INFO("TSC: %.3f GHz", g_tscPerNs);
+}
+#endif
+
+static int _find_first_bit(unsigned long long word)
+{
+#ifdef _WIN32
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int)index;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+/**********************************************************************************************
+*
+* CTxPacer
+*
+***********************************************************************************************/
+
+CTxPacer::CTxPacer(int core)
+{
+    _core = core;
+    _bExit = false;
+    _spin = (long long)TXPACER_DEFAULT_SPIN_US * 1000;
+    _packets.resize(TXPACER_MAX_PACKETS);
+    for (int i = 0; i < TXPACER_MAX_PACKETS; i++)
+        _packets[i].next = i + 1;
+    _packets[TXPACER_MAX_PACKETS - 1].next = -1;
+    _free = 0;
+    _head.assign(TXPACER_WHEEL_SLOTS, -1);
+    _tail.assign(TXPACER_WHEEL_SLOTS, -1);
+    _bitmap.assign(TXPACER_WHEEL_SLOTS / 64, 0);
+    _tick = now() / TXPACER_TICK_NS;
+    _wakeup = 0;
+    _nbQueued = 0;
+    _due.reserve(TXPACER_MAX_PACKETS);
+    memset(&_stats, 0, sizeof(_stats));
+#ifdef TXPACER_USE_TSC
+    std::call_once(g_tscOnce, _calibrate_tsc);
+#endif
+    _thread = std::thread([this] { _tx_process(); });
+}
+
+CTxPacer::~CTxPacer()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _bExit = true;
+    }
+    _cv.notify_all();
+    if (_thread.joinable())
+        _thread.join();
+}
+
+/*!
+* \fn getInstance
+* \brief get the pacing engine running on a core, created on first use
+*
+* \param core index of the core of the TX thread
+* \return engine
+*/
+CTxPacer* CTxPacer::getInstance(int core)
+{
+    std::unique_lock<std::mutex> lock(_instancesMtx);
+    for (CTxPacer* pacer : _instances) {
+        if (pacer->_core == core)
+            return pacer;
+    }
+    LOG_INFO("start pacing engine on core %d", core);
+    CTxPacer* pacer = new CTxPacer(core);
+    _instances.push_back(pacer);
+    return pacer;
+}
+
+/*!
+* \fn now
+* \brief current time of the pacing (TAI, the clock of PTP and of the ETF qdisc)
+*
+* \return nb of ns since the epoch
+*/
+long long CTxPacer::now()
+{
+#ifdef _WIN32
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_TAI, &ts);
+    return ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+#endif
+}
+
+/*!
+* \fn setThreadCore
+* \brief pin the calling thread on a core
+*
+* \param core index of the core
+* \return true if Ok
+*/
+bool CTxPacer::setThreadCore(int core)
+{
+#ifdef _WIN32
+    if (core < 0 || core >= (int)(sizeof(DWORD_PTR) * 8))
+        return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core) != 0;
+#else
+    if (core < 0 || core >= CPU_SETSIZE)
+        return false;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core, &cpuset);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
+#endif
+}
+
+/*!
+* \fn waitUntil
+* \brief sleep until shortly before deadline, then busy-wait
+*
+* \param deadline nb of ns since the epoch
+* \param spin busy-wait duration, in ns
+* \return time at the end of the wait
+*/
+long long CTxPacer::waitUntil(long long deadline, long long spin)
+{
+    long long t = now();
+    if (deadline - t > spin) {
+        long long wakeup = deadline - spin;
+#ifdef _WIN32
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wakeup - t));
+#else
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wakeup / NS_PER_SECOND);
+        ts.tv_nsec = (long)(wakeup % NS_PER_SECOND);
+        while (clock_nanosleep(CLOCK_TAI, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+#endif
+        t = now();
+    }
+#ifdef TXPACER_USE_TSC
+    // Spin on the TSC, cheaper to read than the clock
+    if (g_tscPerNs > 0 && deadline > t) {
+        unsigned long long end = __rdtsc() + (unsigned long long)((deadline - t) * g_tscPerNs);
+        while (__rdtsc() < end)
+            _mm_pause();
+        return now();
+    }
+#endif
+    while ((t = now()) < deadline)
+        ;
+    return t;
+}
+
+/*!
+* \fn submit
+* \brief queue packets, each one to be sent at its time. Blocks while the engine is full, or
+*        while the time of a packet is beyond the wheel.
+*
+* \param sock socket to send the packets on
+* \param packets packets, the time of each packet being set
+* \param nbPackets nb of packets
+* \param iov iovecs of the packets. The headers (the first iovec, if headerLen>0) are copied,
+*        the other iovecs must stay valid until the packets are sent (see wait())
+* \param ticket completion of the packets
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CTxPacer::submit(UDP* sock, const UDPBatchPacket* packets, int nbPackets, const udp_iovec* iov, TxPacerTicket* ticket)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    bool bWakeup = false;
+    for (int i = 0; i < nbPackets; i++) {
+        const UDPBatchPacket& src = packets[i];
+        if (src.headerLen > TXPACER_MAX_HEADER || src.nbIov > UDPBATCH_MAX_IOV) {
+            LOG_ERROR("packet not supported (headers %d bytes, %d iovecs)", src.headerLen, src.nbIov);
+            return VMI_E_INVALID_PARAMETER;
+        }
+        // The wheel only turns while it holds packets: after an idle period it's moved to the
+        // current time. A packet too far ahead waits for the wheel to turn, checked every ms
+        // as the wheel may be idle meanwhile.
+        long long tick = src.time / TXPACER_TICK_NS;
+        while (true) {
+            if (_nbQueued == 0)
+                _tick = std::max(_tick, now() / TXPACER_TICK_NS);
+            if (_bExit || (_free != -1 && tick < _tick + TXPACER_WHEEL_SLOTS))
+                break;
+            _cvDone.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        if (_bExit)
+            return VMI_E_FAILED_TO_SND_SOCKET;
+        tick = std::max(tick, _tick);
+
+        // Copy the packet
+        int index = _free;
+        Packet& packet = _packets[index];
+        _free = packet.next;
+        packet.time = src.time;
+        packet.sock = sock;
+        packet.ticket = ticket;
+        packet.next = -1;
+        packet.nbIov = src.nbIov;
+        for (int k = 0; k < src.nbIov; k++)
+            packet.iov[k] = iov[src.iovFirst + k];
+        if (src.headerLen > 0) {
+#ifdef _WIN32
+            memcpy(packet.header, packet.iov[0].buf, src.headerLen);
+            packet.iov[0].buf = packet.header;
+#else
+            memcpy(packet.header, packet.iov[0].iov_base, src.headerLen);
+            packet.iov[0].iov_base = packet.header;
+#endif
+        }
+
+        // Add it on its wheel slot
+        int slot = (int)(tick % TXPACER_WHEEL_SLOTS);
+        if (_head[slot] == -1)
+            _head[slot] = index;
+        else
+            _packets[_tail[slot]].next = index;
+        _tail[slot] = index;
+        _bitmap[slot / 64] |= (1ULL << (slot % 64));
+        _nbQueued++;
+        ticket->pending++;
+        if (_wakeup == 0 || src.time < _wakeup)
+            bWakeup = true;
+    }
+    lock.unlock();
+    if (bWakeup)
+        _cv.notify_one();
+    return VMI_E_OK;
+}
+
+/*!
+* \fn wait
+* \brief wait until all the packets of a ticket are sent
+*
+* \param ticket completion of the packets
+* \return VMI_E_OK if Ok, VMI_E_FAILED_TO_SND_SOCKET if packets failed to be sent
+*/
+int CTxPacer::wait(TxPacerTicket* ticket)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    _cvDone.wait(lock, [&] { return _bExit || ticket->pending == 0; });
+    int result = (ticket->errors > 0 ? VMI_E_FAILED_TO_SND_SOCKET : VMI_E_OK);
+    ticket->errors = 0;
+    return result;
+}
+
+/* First non-empty tick from _tick, -1 if the wheel is empty. Called with _mtx locked. */
+long long CTxPacer::_next_tick()
+{
+    if (_nbQueued == 0)
+        return -1;
+    int start = (int)(_tick % TXPACER_WHEEL_SLOTS);
+    for (int n = 0; n <= TXPACER_WHEEL_SLOTS / 64; n++) {
+        int word = (start / 64 + n) % (TXPACER_WHEEL_SLOTS / 64);
+        unsigned long long bits = _bitmap[word];
+        if (n == 0)
+            bits &= ~0ULL << (start % 64);
+        else if (n == TXPACER_WHEEL_SLOTS / 64)
+            bits &= (start % 64 == 0 ? 0 : ~0ULL >> (64 - start % 64));
+        if (bits != 0) {
+            int slot = word * 64 + _find_first_bit(bits);
+            return _tick + (slot - start + TXPACER_WHEEL_SLOTS) % TXPACER_WHEEL_SLOTS;
+        }
+    }
+    return -1;
+}
+
+/* Move the packets of the ticks up to tick (included) to _due. Called with _mtx locked. */
+void CTxPacer::_collect(long long tick)
+{
+    while (_tick <= tick && _nbQueued > 0) {
+        long long next = _next_tick();
+        if (next > tick)
+            break;
+        int slot = (int)(next % TXPACER_WHEEL_SLOTS);
+        for (int index = _head[slot]; index != -1; index = _packets[index].next) {
+            _due.push_back(index);
+            _nbQueued--;
+        }
+        _head[slot] = -1;
+        _tail[slot] = -1;
+        _bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+        _tick = next + 1;
+    }
+    _tick = std::max(_tick, tick + 1);
+}
+
+/* Send _due[first] ... _due[first+count-1], all on the same socket. Return the nb of syscalls. */
+int CTxPacer::_send(int first, int count, long long t)
+{
+    UDP* sock = _packets[_due[first]].sock;
+    int syscalls = 0;
+    for (int i = 0; i < count; i++) {
+        _packets[_due[first + i]].sent = t;
+        _packets[_due[first + i]].bError = false;
+    }
+    int addrlen;
+    const struct sockaddr* addr = sock->getRemoteAddr(&addrlen);
+
+#ifdef _WIN32
+    for (int i = 0; i < count; i++) {
+        Packet& packet = _packets[_due[first + i]];
+        DWORD sent = 0;
+        syscalls++;
+        if (WSASendTo(sock->getSock(), packet.iov, packet.nbIov, &sent, 0, addr, addrlen, NULL, NULL) != 0)
+            packet.bError = true;
+    }
+#else
+    struct mmsghdr msgs[UDPBATCH_MAX_PACKETS];
+    for (int done = 0; done < count; ) {
+        int nbMsgs = std::min(count - done, UDPBATCH_MAX_PACKETS);
+        for (int i = 0; i < nbMsgs; i++) {
+            Packet& packet = _packets[_due[first + done + i]];
+            struct msghdr* hdr = &msgs[i].msg_hdr;
+            memset(hdr, 0, sizeof(*hdr));
+            hdr->msg_name = (void*)addr;
+            hdr->msg_namelen = addrlen;
+            hdr->msg_iov = packet.iov;
+            hdr->msg_iovlen = packet.nbIov;
+        }
+        int sent = 0;
+        while (sent < nbMsgs) {
+            syscalls++;
+            int result = sendmmsg(sock->getSock(), &msgs[sent], nbMsgs - sent, 0);
+            if (result == -1) {
+                if (errno == EINTR)
+                    continue;
+                // Skip the packet which failed
+                _packets[_due[first + done + sent]].bError = true;
+                result = 1;
+            }
+            sent += result;
+        }
+        done += nbMsgs;
+    }
+#endif
+
+    return syscalls;
+}
+
+void CTxPacer::_tx_process()
+{
+    if (!setThreadCore(_core))
+        LOG_ERROR("can't run the pacing engine on core %d", _core);
+#ifndef _WIN32
+    sched_param sch_params;
+    sch_params.sched_priority = 2;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sch_params))
+        LOG("can't change the pacing engine thread priority");
+#endif
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (!_bExit) {
+        long long next = _next_tick();
+        if (next == -1) {
+            _cv.wait(lock);
+            continue;
+        }
+
+        // Wait for the next packets: sleep (waken up by packets to send earlier), then spin
+        long long time = next * TXPACER_TICK_NS;
+        long long t = now();
+        if (time - t > _spin) {
+            _wakeup = time;
+            _cv.wait_for(lock, std::chrono::nanoseconds(time - t - _spin));
+            _wakeup = 0;
+            continue;
+        }
+        lock.unlock();
+        t = waitUntil(time, _spin);
+        lock.lock();
+
+        // Send the packets of the elapsed ticks, by socket
+        _collect(t / TXPACER_TICK_NS);
+        lock.unlock();
+        int count = (int)_due.size();
+        int syscalls = 0;
+        for (int first = 0; first < count; ) {
+            int n = 1;
+            while (first + n < count && _packets[_due[first + n]].sock == _packets[_due[first]].sock)
+                n++;
+            syscalls += _send(first, n, t);
+            first += n;
+        }
+        lock.lock();
+
+        // Release the packets, and account for their lateness
+        _stats.syscalls += syscalls;
+        for (int index : _due) {
+            Packet& packet = _packets[index];
+            long long lateness = packet.sent - packet.time;
+            int bucket = 0;
+            for (long long us = lateness / 1000; us > 0 && bucket < TXPACER_HISTOGRAM_BUCKETS - 1; us >>= 1)
+                bucket++;
+            _stats.histogram[bucket]++;
+            if (lateness > TXPACER_LATE_NS)
+                _stats.latePackets++;
+            _stats.maxLateness = std::max(_stats.maxLateness, lateness);
+            _stats.packets++;
+            if (packet.bError) {
+                _stats.errors++;
+                packet.ticket->errors++;
+            }
+            packet.ticket->pending--;
+            packet.next = _free;
+            _free = index;
+        }
+        _due.clear();
+        _cvDone.notify_all();
+    }
+    _cvDone.notify_all();
+}
+
+/*!
+* \fn getStats
+* \brief get the statistics of the engine
+*
+* \param stats copy of the statistics
+*/
+void CTxPacer::getStats(TxPacerStats* stats)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    *stats = _stats;
+}
+
+/*!
+* \fn dumpStats
+* \brief log the lateness histogram of the packets, and reset the statistics
+*
+* \param name name of the caller
+*/
+void CTxPacer::dumpStats(const char* name)
+{
+    TxPacerStats stats;
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        stats = _stats;
+        memset(&_stats, 0, sizeof(_stats));
+    }
+    char histogram[512] = "";
+    int len = 0;
+    for (int i = 0; i < TXPACER_HISTOGRAM_BUCKETS && len < (int)sizeof(histogram); i++) {
+        if (stats.histogram[i] > 0)
+            len += snprintf(histogram + len, sizeof(histogram) - len, " <%dus:%llu", 1 << i, stats.histogram[i]);
+    }
+    LOG_INFO("%s: pacing engine on core %d, %llu packets in %llu syscalls, %llu errors, %llu late packets, max lateness %lld ns, lateness histogram:%s",
+        name, _core, stats.packets, stats.syscalls, stats.errors, stats.latePackets, stats.maxLateness, histogram);
+}
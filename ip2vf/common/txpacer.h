@@ -0,0 +1,105 @@
+#ifndef _TXPACER_H
+#define _TXPACER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "udpbatchsender.h"
+
+#define TXPACER_TICK_NS             1000    /* granularity of the timer wheel */
+#define TXPACER_WHEEL_SLOTS         65536   /* nb of ticks of the wheel: 65 ms ahead */
+#define TXPACER_MAX_PACKETS         16384   /* packets queued on an engine */
+#define TXPACER_MAX_HEADER          128     /* max size of the headers of a packet, copied on submit */
+#define TXPACER_DEFAULT_SPIN_US     20      /* busy-wait the last µs before a release, sleep before */
+#define TXPACER_LATE_NS             10000   /* a packet sent later than its time + 10 µs is late */
+#define TXPACER_HISTOGRAM_BUCKETS   16      /* lateness histogram: < 1 µs, 1-2 µs, 2-4 µs, ... */
+
+/* Completion of the packets submitted by a sender, see CTxPacer::wait() */
+struct TxPacerTicket {
+    int     pending;                    /* packets submitted, not yet sent */
+    int     errors;                     /* packets that failed to be sent */
+};
+
+/* Statistics of a pacing engine */
+struct TxPacerStats {
+    unsigned long long packets;
+    unsigned long long syscalls;
+    unsigned long long errors;
+    unsigned long long latePackets;     /* sent later than TXPACER_LATE_NS after their time */
+    unsigned long long histogram[TXPACER_HISTOGRAM_BUCKETS];   /* send time - packet time, in µs, log2 buckets */
+    long long maxLateness;              /* in ns */
+};
+
+/**********************************************************************************************
+*
+* CTxPacer
+*
+* Per-packet pacing engine shared by the output pins. Each engine is a TX thread pinned on a
+* core, owning a timer wheel of packets: the packetizers submit their packets with the time
+* they must be sent at (through CUDPBatchSender::setPacer()), and the TX thread releases the
+* packets of each tick, with one sendmmsg() per socket. The wait before a release is a sleep
+* then a busy-wait, on the TSC when it's available. The headers of the packets are copied on
+* submit, the payloads are referenced: the sender waits for its packets (wait()) before
+* releasing the buffers.
+*
+***********************************************************************************************/
+
+class CTxPacer
+{
+    struct Packet {
+        long long   time;                           /* time to send the packet, in ns */
+        long long   sent;                           /* time it was sent at */
+        bool        bError;                         /* failed to be sent */
+        UDP*        sock;
+        TxPacerTicket* ticket;
+        int         next;                           /* next packet of the wheel slot, or of the free list */
+        int         nbIov;
+        udp_iovec   iov[UDPBATCH_MAX_IOV];
+        char        header[TXPACER_MAX_HEADER];     /* copy of the headers (first iovec) */
+    };
+
+    int                         _core;
+    std::thread                 _thread;
+    std::mutex                  _mtx;
+    std::condition_variable     _cv;                /* signaled to the TX thread: new packets, exit */
+    std::condition_variable     _cvDone;            /* signaled to the senders: packets sent */
+    bool                        _bExit;
+    long long                   _spin;              /* busy-wait duration, in ns */
+    std::vector<Packet>         _packets;           /* pool of packets */
+    int                         _free;              /* free list of the pool */
+    std::vector<int>            _head;              /* packets of each tick of the wheel */
+    std::vector<int>            _tail;
+    std::vector<unsigned long long> _bitmap;        /* non-empty wheel slots */
+    long long                   _tick;              /* next tick to release */
+    long long                   _wakeup;            /* time the TX thread sleeps until, 0 if not sleeping */
+    int                         _nbQueued;
+    std::vector<int>            _due;               /* packets being sent by the TX thread */
+    TxPacerStats                _stats;
+
+    static std::mutex           _instancesMtx;
+    static std::vector<CTxPacer*> _instances;
+
+    CTxPacer(int core);
+    ~CTxPacer();
+
+    void _tx_process();
+    long long _next_tick();
+    void _collect(long long tick);
+    int  _send(int first, int count, long long t);
+
+public:
+    static CTxPacer* getInstance(int core);
+    static long long now();
+    static bool setThreadCore(int core);
+    static long long waitUntil(long long deadline, long long spin);
+
+    int  submit(UDP* sock, const UDPBatchPacket* packets, int nbPackets, const udp_iovec* iov, TxPacerTicket* ticket);
+    int  wait(TxPacerTicket* ticket);
+
+    void getStats(TxPacerStats* stats);
+    void dumpStats(const char* name);
+};
+
+#endif // _TXPACER_H
@@ -0,0 +1,483 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>       // std::this_thread
+#include <algorithm>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <Ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#endif
+
+#include "common.h"
+#include "error.h"
+#include "log.h"
+#include "rtpframe.h"
+#include "udpbatchsender.h"
+#include "txpacer.h"
+
+#ifndef _WIN32
+#ifndef SOL_UDP
+#define SOL_UDP         17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT     103     /* linux >= 4.18 */
+#endif
+#ifndef SCM_TXTIME
+#define SCM_TXTIME      61      /* linux >= 4.19 */
+#endif
+#endif
+
+#define UDPBATCH_PADDING_SIZE   9216    /* jumbo frames */
+
+static const char g_padding[UDPBATCH_PADDING_SIZE] = { 0 };
+
+/**********************************************************************************************
+*
+* CUDPBatchSender
+*
+***********************************************************************************************/
+
+CUDPBatchSender::CUDPBatchSender()
+{
+    _headers = NULL;
+    _headerSize = 0;
+    _nbPackets = 0;
+    _nbIov = 0;
+    _gsoSock = INVALID_SOCKET;
+    _gso = false;
+    _linear = NULL;
+    _pacing = 0;
+    _nbSentPackets = 0;
+    _nbSyscalls = 0;
+    _pacer = NULL;
+    _ticket = NULL;
+    _pacingStart = 0;
+    _pacingInterval = 0;
+    _pacingIndex = 0;
+    _frameStart = 0;
+    _framePeriod = 0;
+    _capture = NULL;
+#ifndef _WIN32
+    memset(_msgs, 0, sizeof(_msgs));
+    memset(_ctrl, 0, sizeof(_ctrl));
+#endif
+}
+
+CUDPBatchSender::~CUDPBatchSender()
+{
+    sync();
+    delete[] _headers;
+    delete[] _linear;
+    delete _ticket;
+}
+
+/*!
+* \fn init
+* \brief allocate the ring of packet headers
+*
+* \param headerSize max size of the headers of a packet
+*/
+void CUDPBatchSender::init(int headerSize)
+{
+    delete[] _headers;
+    _headerSize = headerSize;
+    _headers = new char[(size_t)UDPBATCH_MAX_PACKETS * _headerSize];
+    _nbPackets = 0;
+    _nbIov = 0;
+}
+
+/*!
+* \fn setPacer
+* \brief send the packets through a pacing engine, at their time
+*
+* \param pacer pacing engine, NULL to send the packets on flush()
+*/
+void CUDPBatchSender::setPacer(CTxPacer* pacer)
+{
+    sync();
+    _pacer = pacer;
+    if (_pacer != NULL && _ticket == NULL) {
+        _ticket = new TxPacerTicket;
+        _ticket->pending = 0;
+        _ticket->errors = 0;
+    }
+}
+
+/*!
+* \fn beginPacing
+* \brief spread the next packets evenly: the packet n is sent at start + n x interval
+*
+* \param start time of the first packet, in ns (see CTxPacer::now())
+* \param interval time between two packets, in ns
+*/
+void CUDPBatchSender::beginPacing(long long start, double interval)
+{
+    _pacingStart = start;
+    _pacingInterval = interval;
+    _pacingIndex = 0;
+}
+
+/*!
+* \fn beginFrame
+* \brief start the schedule of a frame: the frame starts one frame period after the previous one,
+*        or now if it is late, and its packets are spread evenly on a part of the frame period.
+*        The times are used by the pacing engine and by the sockets in launch time mode.
+*
+* \param nbPackets nb of packets of the frame
+* \param framePeriod frame period, in ns, 0 if unknown
+* \param ratio part of the frame period the packets are spread on
+* \return time of the start of the frame, in ns
+*/
+long long CUDPBatchSender::beginFrame(int nbPackets, double framePeriod, double ratio)
+{
+    long long t = CTxPacer::now();
+    long long next = _frameStart + (long long)framePeriod;
+    _framePeriod = framePeriod;
+    _frameStart = (_frameStart != 0 && framePeriod > 0 && next >= t ? next : t);
+    double interval = UDPBATCH_PACING_DEFAULT_NS;
+    if (framePeriod > 0 && nbPackets > 0)
+        interval = framePeriod * ratio / nbPackets;
+    beginPacing(_frameStart, interval);
+    return _frameStart;
+}
+
+/*!
+* \fn sync
+* \brief wait until the packets queued on the pacing engine are sent, before releasing their
+*        payloads. Nothing to wait for without a pacing engine.
+*
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CUDPBatchSender::sync()
+{
+    if (_pacer == NULL)
+        return VMI_E_OK;
+    return _pacer->wait(_ticket);
+}
+
+/*!
+* \fn addPacket
+* \brief start a new packet in the batch. The batch must not be full (see isFull() and flush()).
+*
+* \param headerLen size of the headers of the packet
+* \return pointer on the headers of the packet, to be filled by the caller
+*/
+char* CUDPBatchSender::addPacket(int headerLen)
+{
+    if (isFull() || headerLen > _headerSize) {
+        LOG_ERROR("can't add packet (nb=%d, headers len=%d/%d)", _nbPackets, headerLen, _headerSize);
+        return NULL;
+    }
+    char* header = getNextHeader();
+    UDPBatchPacket& packet = _packets[_nbPackets++];
+    packet.iovFirst = _nbIov;
+    packet.nbIov = 0;
+    packet.len = 0;
+    packet.headerLen = headerLen;
+    packet.time = _pacingStart + (long long)(_pacingIndex++ * _pacingInterval);
+    if (headerLen > 0)
+        _add_iov(header, headerLen);
+    return header;
+}
+
+/*!
+* \fn addPayload
+* \brief add data on the current packet, without copy
+*
+* \param data pointer to the data, must stay valid until the batch is sent
+* \param len size of data
+*/
+void CUDPBatchSender::addPayload(const char* data, int len)
+{
+    if (len > 0)
+        _add_iov(data, len);
+}
+
+/*!
+* \fn addPadding
+* \brief add zero bytes on the current packet
+*
+* \param len nb of zero bytes
+*/
+void CUDPBatchSender::addPadding(int len)
+{
+    if (len > UDPBATCH_PADDING_SIZE) {
+        LOG_ERROR("padding too big (%d bytes)", len);
+        len = UDPBATCH_PADDING_SIZE;
+    }
+    if (len > 0)
+        _add_iov(g_padding, len);
+}
+
+void CUDPBatchSender::_add_iov(const char* data, int len)
+{
+    UDPBatchPacket& packet = _packets[_nbPackets - 1];
+    if (packet.nbIov >= UDPBATCH_MAX_IOV) {
+        LOG_ERROR("too many iovecs for the packet");
+        return;
+    }
+#ifdef _WIN32
+    _iov[_nbIov].buf = (char*)data;
+    _iov[_nbIov].len = (ULONG)len;
+#else
+    _iov[_nbIov].iov_base = (void*)data;
+    _iov[_nbIov].iov_len = len;
+#endif
+    _nbIov++;
+    packet.nbIov++;
+    packet.len += len;
+}
+
+/*!
+* \fn flush
+* \brief send all the packets of the batch
+*
+* \param sock socket to use
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CUDPBatchSender::flush(UDP* sock)
+{
+    if (_nbPackets == 0)
+        return VMI_E_OK;
+
+    if (_capture != NULL) {
+        // Packetize once: the packets are sent later, from the list
+        _capture->append(_packets, _nbPackets, _iov, _frameStart);
+        _capture->setFramePeriod(_framePeriod);
+        _nbPackets = 0;
+        _nbIov = 0;
+        return VMI_E_OK;
+    }
+
+    int result;
+    if (_pacer != NULL && sock->isKernelSocket() && !sock->isTxTime()) {
+        // Queue the packets on the pacing engine, which sends each one at its time
+        result = _pacer->submit(sock, _packets, _nbPackets, _iov, _ticket);
+        _nbSentPackets += _nbPackets;
+    }
+    else {
+        result = sock->isKernelSocket() ? _flush_kernel(sock) : _flush_linear(sock);
+
+        // Micro pacing, unless the kernel launches the packets at their time
+        unsigned int before = _nbSentPackets;
+        _nbSentPackets += _nbPackets;
+        if (_pacing > 0 && !sock->isTxTime() && before / _pacing != _nbSentPackets / _pacing)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    _nbPackets = 0;
+    _nbIov = 0;
+    return result;
+}
+
+int CUDPBatchSender::_flush_linear(UDP* sock)
+{
+    if (_linear == NULL)
+        _linear = new char[RTP_MAX_FRAME_LENGTH];
+    for (int i = 0; i < _nbPackets; i++) {
+        int len = 0;
+        for (int k = 0; k < _packets[i].nbIov; k++) {
+            udp_iovec& iov = _iov[_packets[i].iovFirst + k];
+#ifdef _WIN32
+            memcpy(_linear + len, iov.buf, iov.len);
+            len += iov.len;
+#else
+            memcpy(_linear + len, iov.iov_base, iov.iov_len);
+            len += (int)iov.iov_len;
+#endif
+        }
+        _nbSyscalls++;
+        if (sock->writeSocket(_linear, &len) == -1)
+            return VMI_E_FAILED_TO_SND_SOCKET;
+    }
+    return VMI_E_OK;
+}
+
+int CUDPBatchSender::_flush_kernel(UDP* sock)
+{
+    int addrlen;
+    const struct sockaddr* addr = sock->getRemoteAddr(&addrlen);
+
+#ifdef _WIN32
+    // No sendmmsg: one gather send per packet
+    for (int i = 0; i < _nbPackets; i++) {
+        DWORD sent = 0;
+        _nbSyscalls++;
+        if (WSASendTo(sock->getSock(), &_iov[_packets[i].iovFirst], _packets[i].nbIov, &sent, 0, addr, addrlen, NULL, NULL) != 0) {
+            int windowsErrorCode = WSAGetLastError();
+            LOG_ERROR("error=%d", windowsErrorCode);
+            return VMI_E_FAILED_TO_SND_SOCKET;
+        }
+    }
+    return VMI_E_OK;
+#else
+    // Probe GSO support when the socket change
+    if (_gsoSock != sock->getSock()) {
+        int value = 0;
+        _gsoSock = sock->getSock();
+        _gso = (setsockopt(_gsoSock, SOL_UDP, UDP_SEGMENT, &value, sizeof(value)) == 0);
+        LOG_INFO("UDP GSO is %s", _gso ? "supported" : "not supported");
+    }
+
+    // Launch time mode: the packets are sent with their time, and must not be too far ahead
+    bool txtime = sock->isTxTime();
+    long long now = 0;
+    if (txtime) {
+        now = CTxPacer::now();
+        if (_packets[0].time - now > UDP_TXTIME_HORIZON_NS)
+            now = CTxPacer::waitUntil(_packets[0].time - UDP_TXTIME_HORIZON_NS, 0);
+    }
+
+    while (true) {
+        // Build the messages: with GSO, consecutive packets of the same size (the last one can be
+        // shorter) are sent as one message. Not in launch time mode, each packet having its time.
+        int nbMsgs = 0;
+        for (int i = 0; i < _nbPackets; ) {
+            int segSize = _packets[i].len;
+            int nbSegs = 1;
+            int total = segSize;
+            int nbIov = _packets[i].nbIov;
+            if (_gso && !txtime) {
+                while (i + nbSegs < _nbPackets && nbSegs < UDPBATCH_GSO_MAX_SEGMENTS) {
+                    const UDPBatchPacket& next = _packets[i + nbSegs];
+                    if (next.len > segSize || total + next.len > UDPBATCH_GSO_MAX_SIZE)
+                        break;
+                    total += next.len;
+                    nbIov += next.nbIov;
+                    nbSegs++;
+                    if (next.len < segSize)
+                        break;
+                }
+            }
+            struct msghdr* hdr = &_msgs[nbMsgs].msg_hdr;
+            hdr->msg_name = (void*)addr;
+            hdr->msg_namelen = addrlen;
+            hdr->msg_iov = &_iov[_packets[i].iovFirst];
+            hdr->msg_iovlen = nbIov;
+            hdr->msg_flags = 0;
+            if (nbSegs > 1) {
+                hdr->msg_control = _ctrl[nbMsgs];
+                hdr->msg_controllen = sizeof(_ctrl[nbMsgs]);
+                struct cmsghdr* cm = CMSG_FIRSTHDR(hdr);
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(unsigned short));
+                *((unsigned short*)CMSG_DATA(cm)) = (unsigned short)segSize;
+            }
+            else if (txtime) {
+                hdr->msg_control = _ctrl[nbMsgs];
+                hdr->msg_controllen = sizeof(_ctrl[nbMsgs]);
+                struct cmsghdr* cm = CMSG_FIRSTHDR(hdr);
+                cm->cmsg_level = SOL_SOCKET;
+                cm->cmsg_type = SCM_TXTIME;
+                cm->cmsg_len = CMSG_LEN(sizeof(unsigned long long));
+                unsigned long long time = (unsigned long long)sock->adjustTxTime(_packets[i].time, now);
+                memcpy(CMSG_DATA(cm), &time, sizeof(time));
+            }
+            else {
+                hdr->msg_control = NULL;
+                hdr->msg_controllen = 0;
+            }
+            nbMsgs++;
+            i += nbSegs;
+        }
+
+        int sent = 0;
+        while (sent < nbMsgs) {
+            _nbSyscalls++;
+            int result = sendmmsg(_gsoSock, &_msgs[sent], nbMsgs - sent, 0);
+            if (result == -1) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            sent += result;
+        }
+        if (txtime)
+            sock->checkTxTimeErrors();
+        if (sent == nbMsgs)
+            return VMI_E_OK;
+
+        if (_gso && sent == 0 && (errno == EIO || errno == EINVAL)) {
+            // The route or the device doesn't support segmentation offload: send packet by packet
+            LOG_WARNING("UDP GSO send failed (%s), disable it", strerror(errno));
+            _gso = false;
+            continue;
+        }
+        LOG_ERROR("failed to send messages batch, %d/%d sent, error=%s", sent, nbMsgs, strerror(errno));
+        return VMI_E_FAILED_TO_SND_SOCKET;
+    }
+#endif
+}
+
+/**********************************************************************************************
+*
+* CUDPPacketList
+*
+***********************************************************************************************/
+
+/*!
+* \fn append
+* \brief copy packets of a batch at the end of the list
+*
+* \param packets packets of the batch
+* \param nbPackets nb of packets
+* \param iov iovecs of the packets
+* \param frameStart start of the frame, in ns: the times of the packets are kept from it
+*/
+void CUDPPacketList::append(const UDPBatchPacket* packets, int nbPackets, const udp_iovec* iov, long long frameStart)
+{
+    for (int i = 0; i < nbPackets; i++) {
+        const UDPBatchPacket& packet = packets[i];
+        if (_size + packet.len > (int)_data.size())
+            _data.resize(std::max((size_t)(_size + packet.len), _data.size() * 2));
+        UDPListPacket p;
+        p.offset = _size;
+        p.len = packet.len;
+        p.time = packet.time - frameStart;
+        for (int k = 0; k < packet.nbIov; k++) {
+            const udp_iovec& v = iov[packet.iovFirst + k];
+#ifdef _WIN32
+            memcpy(&_data[_size], v.buf, v.len);
+            _size += v.len;
+#else
+            memcpy(&_data[_size], v.iov_base, v.iov_len);
+            _size += (int)v.iov_len;
+#endif
+        }
+        _packets.push_back(p);
+    }
+}
+
+/*!
+* \fn send
+* \brief send the packets of the list, with the schedule of a batch sender: the frame starts one
+*        frame period after the previous one sent by this batch sender, or now if it is late
+*
+* \param batch batch sender, without headers (init(0))
+* \param sock socket to use
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CUDPPacketList::send(CUDPBatchSender* batch, UDP* sock)
+{
+    int nbPackets = (int)_packets.size();
+    long long frameStart = batch->beginFrame(nbPackets, _framePeriod);
+    for (int i = 0; i < nbPackets; i++) {
+        if (batch->isFull() && batch->flush(sock) != VMI_E_OK) {
+            batch->sync();
+            return VMI_E_FAILED_TO_SND_SOCKET;
+        }
+        batch->addPacket(0);
+        batch->addPayload(&_data[_packets[i].offset], _packets[i].len);
+        batch->setPacketTime(frameStart + _packets[i].time);
+    }
+    if (batch->flush(sock) != VMI_E_OK || batch->sync() != VMI_E_OK)
+        return VMI_E_FAILED_TO_SND_SOCKET;
+    return VMI_E_OK;
+}
@@ -0,0 +1,151 @@
+#ifndef _UDPBATCHSENDER_H
+#define _UDPBATCHSENDER_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef WSABUF udp_iovec;
+#else
+#include <sys/socket.h>
+#include <sys/uio.h>
+typedef struct iovec udp_iovec;
+#endif
+
+#include <vector>
+
+#include "tcp_basic.h"
+
+#define UDPBATCH_MAX_PACKETS        256     /* packets per batch (one sendmmsg) */
+#define UDPBATCH_MAX_IOV            4       /* iovecs per packet: headers, payload and padding */
+#define UDPBATCH_GSO_MAX_SEGMENTS   64      /* kernel limit of segments per UDP_SEGMENT send */
+#define UDPBATCH_GSO_MAX_SIZE       65000   /* max size of a UDP_SEGMENT send */
+#define UDPBATCH_PACING_RATIO       0.9     /* with a pacer, the packets of a frame are spread on 90% of the frame period */
+#define UDPBATCH_PACING_DEFAULT_NS  2000    /* time between two packets when the frame period is unknown */
+
+class CTxPacer;
+struct TxPacerTicket;
+class CUDPBatchSender;
+
+/* A packet of a batch */
+struct UDPBatchPacket {
+    int         iovFirst;           /* index of the first iovec of the packet */
+    int         nbIov;              /* nb of iovecs of the packet */
+    int         len;                /* total size of the packet */
+    int         headerLen;          /* size of the headers (first iovec), built in the ring */
+    long long   time;               /* time to send the packet at, in ns (with a pacer) */
+};
+
+/* A packet of a packet list */
+struct UDPListPacket {
+    int         offset;             /* offset of the packet in the data of the list */
+    int         len;                /* size of the packet */
+    long long   time;               /* time to send the packet at, from the start of the frame, in ns */
+};
+
+/**********************************************************************************************
+*
+* CUDPPacketList
+*
+* Packets of a frame, built once by a packetizer (see CUDPBatchSender::setCapture()) and sent
+* as many times as needed: the headers, payloads and padding of each packet are copied one after
+* the other in the list, which doesn't reference the frame anymore.
+*
+***********************************************************************************************/
+
+class CUDPPacketList
+{
+    std::vector<char>   _data;
+    int                 _size;                          /* bytes used in _data */
+    std::vector<UDPListPacket> _packets;
+    double              _framePeriod;                   /* in ns, 0 if unknown */
+
+public:
+    CUDPPacketList() : _size(0), _framePeriod(0) {};
+
+    void  clear() { _size = 0; _packets.clear(); _framePeriod = 0; };
+    void  append(const UDPBatchPacket* packets, int nbPackets, const udp_iovec* iov, long long frameStart);
+    void  setFramePeriod(double ns) { _framePeriod = ns; };
+    int   send(CUDPBatchSender* batch, UDP* sock);
+
+    int   getNbPackets() { return (int)_packets.size(); };
+    int   getSize() { return _size; };
+    double getFramePeriod() { return _framePeriod; };
+};
+
+/**********************************************************************************************
+*
+* CUDPBatchSender
+*
+* Batched UDP transmit engine shared by the packetizers. Packet headers are built in a
+* pre-allocated ring, payloads are referenced by iovecs pointing into the frame buffer (no copy),
+* and a full batch is sent with one sendmmsg(). Consecutive packets of the same size are merged
+* in one UDP_SEGMENT (GSO) message when the kernel supports it. The referenced payloads must
+* stay valid until flush() returns.
+*
+* With a pacing engine (setPacer()), flush() queues the packets on the engine, each one to be
+* sent at its time (setPacketTime(), beginPacing() or beginFrame()), and the payloads must stay
+* valid until sync() returns. On a socket in launch time mode (UDP::enableTxTime()), each packet
+* is sent with its time (SCM_TXTIME), and launched by the kernel.
+*
+* With a capture list (setCapture()), flush() copies the packets in the list instead of sending
+* them: the packetizers then build the packets of a frame once, for several destinations.
+*
+***********************************************************************************************/
+
+class CUDPBatchSender
+{
+    char*       _headers;                               /* ring of packet headers */
+    int         _headerSize;                            /* max size of the headers of a packet */
+    UDPBatchPacket _packets[UDPBATCH_MAX_PACKETS];
+    int         _nbPackets;                             /* nb of packets in the current batch */
+    udp_iovec   _iov[UDPBATCH_MAX_PACKETS * UDPBATCH_MAX_IOV];
+    int         _nbIov;
+#ifndef _WIN32
+    struct mmsghdr _msgs[UDPBATCH_MAX_PACKETS];
+    char        _ctrl[UDPBATCH_MAX_PACKETS][CMSG_SPACE(sizeof(unsigned long long))];  /* UDP_SEGMENT or SCM_TXTIME control messages */
+#endif
+    SOCKET      _gsoSock;                               /* socket on which GSO support was probed */
+    bool        _gso;                                   /* GSO supported on _gsoSock */
+    char*       _linear;                                /* packet copy, for sockets which are not kernel sockets */
+    int         _pacing;                                /* sleep 1ms every _pacing packets, 0 to disable */
+    unsigned int _nbSentPackets;
+    unsigned int _nbSyscalls;
+    CTxPacer*   _pacer;                                 /* pacing engine, NULL to send on flush() */
+    TxPacerTicket* _ticket;                             /* completion of the packets queued on _pacer */
+    long long   _pacingStart;                           /* time of the first packet, see beginPacing() */
+    double      _pacingInterval;                        /* time between two packets, in ns */
+    int         _pacingIndex;                           /* index of the next packet */
+    long long   _frameStart;                            /* start of the current frame, see beginFrame() */
+    double      _framePeriod;                           /* frame period given to beginFrame(), in ns */
+    CUDPPacketList* _capture;                           /* list the packets are copied in, NULL to send them */
+
+    void _add_iov(const char* data, int len);
+    int  _flush_linear(UDP* sock);
+    int  _flush_kernel(UDP* sock);
+
+public:
+    CUDPBatchSender();
+    ~CUDPBatchSender();
+
+    void  init(int headerSize);
+    void  setPacing(int nbPackets) { _pacing = nbPackets; };
+    void  setPacer(CTxPacer* pacer);
+    bool  hasPacer() { return _pacer != NULL; };
+    void  setCapture(CUDPPacketList* list) { _capture = list; };
+    bool  isCapturing() { return _capture != NULL; };
+    void  beginPacing(long long start, double interval);
+    long long beginFrame(int nbPackets, double framePeriod, double ratio = UDPBATCH_PACING_RATIO);
+    void  setPacketTime(long long time) { if (_nbPackets > 0) _packets[_nbPackets - 1].time = time; };  /* time of the last added packet */
+
+    bool  isFull() { return _nbPackets >= UDPBATCH_MAX_PACKETS; };
+    char* getNextHeader() { return _headers + (size_t)_nbPackets * _headerSize; };  /* headers of the next packet, before addPacket() */
+    char* addPacket(int headerLen);
+    void  addPayload(const char* data, int len);
+    void  addPadding(int len);
+    int   flush(UDP* sock);
+    int   sync();
+
+    unsigned int getNbSentPackets() { return _nbSentPackets; };
+    unsigned int getNbSyscalls()    { return _nbSyscalls; };
+};
+
+#endif // _UDPBATCHSENDER_H
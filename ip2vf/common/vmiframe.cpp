@@ -6,15 +6,21 @@
 #include <fstream>      // for file saving
 #include <iostream>     // for file saving
 #include <thread>
+#include <vector>
 
 #include "common.h"
 #include "log.h"
 #include "vmiframe.h"
 #include "rtpframe.h"
 #include "tools.h"
+#include "framearena.h"
 
 using namespace std;
 
+#define VMIFRAME_SCATTER_PACKETS    64      /* packets received per readScatter() */
+
+static_assert(FRAME_HEADER_LENGTH % FRAMEARENA_ALIGN == 0, "the media buffer of a frame must be aligned as its frame buffer");
+
 
 CvMIFrame::CvMIFrame() {
 
@@ -24,6 +30,10 @@ CvMIFrame::CvMIFrame() {
     _frame_size   = 0;
     _media_size   = 0;
     _ref_counter  = 0;
+    _handle       = -1;
+    _ext_cookie   = -1;
+    _own_buffer   = NULL;
+    _own_buffer_size = 0;
 
     // By default, add a reference because of the caller which create this instance
     addRef();
@@ -43,8 +53,9 @@ CvMIFrame::~CvMIFrame() {
 
 void CvMIFrame::_reset() {
 
+    _detach_external_buffer(false);
     if (_frame_buffer != NULL)
-        delete[] _frame_buffer;
+        CFrameArena::getInstance()->release(_frame_buffer);
     _frame_buffer = NULL;
     _media_buffer = NULL;
     _buffer_size = 0;
@@ -58,7 +69,9 @@ CvMIFrame & CvMIFrame::operator=(const CvMIFrame &other) {
     this->_frame_size = other._frame_size;
     this->_media_size = other._media_size;
     this->_init_buffer(this->_frame_size);
-    memcpy(this->_frame_buffer, other._frame_buffer, other._frame_size);
+    // Headers and media are copied separately, as they are not contiguous when 'other' has an external buffer
+    memcpy(this->_frame_buffer, other._frame_buffer, CFrameHeaders::GetHeadersLength());
+    memcpy(this->_media_buffer, other._media_buffer, other._media_size);
     int result = this->_fh.ReadHeaders(this->_frame_buffer);
     if (result != VMI_E_OK) {
         LOG_ERROR("Incorrect header format... do we have corrupted data?");
@@ -68,16 +81,60 @@ CvMIFrame & CvMIFrame::operator=(const CvMIFrame &other) {
 
 int CvMIFrame::addRef() {
 
-    std::unique_lock<std::mutex> lock(_mtx);
-    _ref_counter++;
-    return _ref_counter;
+    return _ref_counter.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
 int CvMIFrame::releaseRef() {
 
-    std::unique_lock<std::mutex> lock(_mtx);
-    _ref_counter--;
-    return _ref_counter;
+    int ret = _ref_counter.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    if (ret == 0) {
+        // Nobody use this frame anymore: give back the external buffer, if any, to its owner
+        _detach_external_buffer(false);
+    }
+    return ret;
+}
+
+/**
+* \brief Give back the external buffer to its owner, and come back to the own buffer of the frame
+*
+* \param keepContent if true, the content of the external buffer is copied to the own buffer before the release
+*/
+void CvMIFrame::_detach_external_buffer(bool keepContent) {
+
+    if (!_ext_owner)
+        return;
+
+    unsigned char* ext_media_buffer = _media_buffer;
+    int media_size = _media_size;
+    std::shared_ptr<CvMIFrameBufferOwner> owner = _ext_owner;
+    int cookie = _ext_cookie;
+    _ext_owner.reset();
+    _ext_cookie = -1;
+
+    // Restore the own buffer
+    _frame_buffer = _own_buffer;
+    _buffer_size  = _own_buffer_size;
+    _media_buffer = (_frame_buffer != NULL) ? _frame_buffer + CFrameHeaders::GetHeadersLength() : NULL;
+    _frame_size   = 0;
+    _media_size   = 0;
+    _own_buffer   = NULL;
+    _own_buffer_size = 0;
+
+    if (keepContent) {
+        if (_init_buffer(media_size + CFrameHeaders::GetHeadersLength()) == VMI_E_OK) {
+            memcpy(_frame_buffer, _ext_headers, CFrameHeaders::GetHeadersLength());
+            memcpy(_media_buffer, ext_media_buffer, media_size);
+        }
+    }
+    owner->releaseBuffer(cookie);
+}
+
+unsigned char* CvMIFrame::getFrameBuffer() {
+
+    // Caller expects headers and media in a single buffer: an external buffer must be copied first
+    if (_ext_owner)
+        _detach_external_buffer(true);
+    return _frame_buffer;
 }
 
 int CvMIFrame::_init_buffer(int framesize) {
@@ -87,24 +144,31 @@ int CvMIFrame::_init_buffer(int framesize) {
         return VMI_E_MEM_FAILED_TO_ALLOC;
     }
 
+    // An external buffer can't be resized or modified: work on an own copy
+    _detach_external_buffer(true);
+
     if (_frame_buffer == NULL || framesize > _buffer_size) {
 
         unsigned char* old_frame_buffer = NULL;
         if (_frame_buffer != NULL)
             old_frame_buffer = _frame_buffer;
         LOG_INFO("resize frame from %d to %d bytes", _buffer_size, framesize);
-        _buffer_size = framesize;
-        _frame_buffer = (unsigned char*)new unsigned char[_buffer_size];
-        _media_buffer = (unsigned char*)_frame_buffer + CFrameHeaders::GetHeadersLength();
+        // Buffers of the frame arena: aligned, the media too as the headers length is a
+        // multiple of FRAMEARENA_ALIGN, and recycled by size class
+        size_t capacity = 0;
+        _frame_buffer = CFrameArena::getInstance()->alloc(framesize, &capacity);
         if (_frame_buffer == NULL) {
-            LOG_ERROR("failed to allocate to %d bytes", _buffer_size);
+            LOG_ERROR("failed to allocate to %d bytes", framesize);
+            _frame_buffer = old_frame_buffer;
             _reset();
             return VMI_E_MEM_FAILED_TO_ALLOC;
         }
+        _buffer_size = (int)capacity;
+        _media_buffer = (unsigned char*)_frame_buffer + CFrameHeaders::GetHeadersLength();
         if (old_frame_buffer != NULL) {
             // Keep the content of the old mem segment
             memcpy(_frame_buffer, old_frame_buffer, _frame_size);
-            delete[] old_frame_buffer;
+            CFrameArena::getInstance()->release(old_frame_buffer);
         }
     }
     _frame_size = framesize;
@@ -114,7 +178,8 @@ int CvMIFrame::_init_buffer(int framesize) {
 }
 
 void CvMIFrame::memset(int val) {
-    
+
+    _detach_external_buffer(true);
     if (_frame_buffer != NULL) {
         char* p = (char*)_frame_buffer;
         int size = sizeof(int);
@@ -212,6 +277,57 @@ int CvMIFrame::createFrameFromMem(unsigned char* buffer, int buffer_size, int mo
     return VMI_E_OK;
 }
 
+/**
+* \brief Create a vMI frame that reference, without copy, a memory area owned by another object. The owner is
+* notified with releaseBuffer(cookie) when the frame doesn't reference the memory area anymore. Headers are copied
+* on a private area, so that they can be modified without impact on the memory area. The media content must be
+* considered as read-only if the memory area is shared with other frames.
+*
+* \param owner object that own the memory area
+* \param cookie value given back to the owner on release
+* \param buffer memory area that contain a complete vMI frame (headers + media)
+* \param buffer_size size of the memory area in bytes
+* \param moduleId id of the module that receive the frame
+* \return VMI_E_OK if success
+*/
+int CvMIFrame::createFrameFromExternalMem(std::shared_ptr<CvMIFrameBufferOwner> owner, int cookie, unsigned char* buffer, int buffer_size, int moduleId) {
+
+    if (!owner || buffer == NULL)
+        return VMI_E_INVALID_PARAMETER;
+
+    CFrameHeaders fh;
+    int result = fh.ReadHeaders(buffer);
+    if (result != VMI_E_OK) {
+        LOG_ERROR("Incorrect header format... do we have corrupted data?");
+        return VMI_E_INVALID_FRAME;
+    }
+    int media_size = fh.GetMediaSize();
+    int frame_size = media_size + CFrameHeaders::GetHeadersLength();
+    if (frame_size > buffer_size) {
+        // This must not happen
+        LOG_ERROR("Invalid frame: frame size (%d) is greater than buffer size (%d)", frame_size, buffer_size);
+        return VMI_E_INVALID_FRAME;
+    }
+
+    // Give back any previous external buffer, then keep the own buffer aside
+    _detach_external_buffer(false);
+    _own_buffer      = _frame_buffer;
+    _own_buffer_size = _buffer_size;
+
+    _ext_owner    = owner;
+    _ext_cookie   = cookie;
+    _frame_buffer = _ext_headers;
+    _media_buffer = buffer + CFrameHeaders::GetHeadersLength();
+    _buffer_size  = frame_size;
+    _frame_size   = frame_size;
+    _media_size   = media_size;
+    _fh = fh;
+    _fh.SetModuleId(moduleId);
+    _fh.WriteHeaders(_frame_buffer);
+
+    return VMI_E_OK;
+}
+
 int CvMIFrame::createFrameUninitialized(int size) {
 
     int frame_size = size;
@@ -261,10 +377,12 @@ int CvMIFrame::createFrameFromTCP(TCP* sock, int moduleId) {
     _fh.WriteHeaders(_frame_buffer);
     //_fh.DumpHeaders();
 
-    // Second, receive media content
+    // Second, receive media content. Only the headers have to be kept if the buffer grows
     int media_size = _fh.GetMediaSize();
     int frame_size = media_size + CFrameHeaders::GetHeadersLength();
-    _init_buffer(frame_size);
+    _frame_size = CFrameHeaders::GetHeadersLength();
+    if (_init_buffer(frame_size) != VMI_E_OK)
+        return VMI_E_MEM_FAILED_TO_ALLOC;
     len = _media_size;
     result = sock->readSocket((char*)_frame_buffer+ CFrameHeaders::GetHeadersLength(), &len);
     if (result != VMI_E_OK)
@@ -272,7 +390,7 @@ int CvMIFrame::createFrameFromTCP(TCP* sock, int moduleId) {
     return VMI_E_OK;
 }
 
-int CvMIFrame::createFrameFromUDP(UDP* sock, int moduleId) {
+int CvMIFrame::createFrameFromUDP(UDP* sock, int moduleId, CvMIRxContext* ctx) {
 
     /*
      * Some validation...
@@ -288,29 +406,119 @@ int CvMIFrame::createFrameFromUDP(UDP* sock, int moduleId) {
         return VMI_E_MEM_FAILED_TO_ALLOC;
     }
 
+    // Without receiver context, any incomplete frame is dropped
+    vMIRxStats noStats = {};
+    vMIRxStats& stats = (ctx ? ctx->_stats : noStats);
+    int reorderWindow = (ctx ? ctx->_reorderWindow : 0);
+
+    // Packets received in advance with the previous frame. The context stays out of sync until
+    // the frame is complete, so that any error below leads to wait for the next frame.
+    std::vector<std::vector<char>> stash;
+    bool bSync = false;
+    int  nextSeq = 0;
+    if (ctx) {
+        stash.swap(ctx->_stash);
+        bSync = ctx->_bSync;
+        nextSeq = ctx->_nextSeq;
+        ctx->reset();
+    }
+
     /*
      * Keep the first packet. it must contain vMI headers.
      */
-    int len, result;
-    len = RTP_MAX_FRAME_LENGTH;
-    char packet[RTP_MAX_FRAME_LENGTH];
-    result = sock->readSocket(packet, &len);
-    if (result < 0) {
-        LOG_ERROR("error when read RTP frame: size readed=%d, result=%d", len, result);
-        return VMI_E_FAILED_TO_RCV_SOCKET;
-    }
-    else if (result == 0) {
-        LOG_INFO("the connection has been gracefully closed");
-        return VMI_E_CONNECTION_CLOSED;
+    int len = 0, result;
+    char packet[RTP_HEADERS_LENGTH];
+    char spill[RTP_MAX_FRAME_LENGTH];                           /* destination of a packet without full place in the frame */
+    int nbAhead = 0;                                            /* packets received before the first one of the frame */
+    if (bSync) {
+        for (size_t i = 0; i < stash.size(); i++) {
+            CRTPFrame rtp((unsigned char*)stash[i].data(), (int)stash[i].size());
+            if (rtp._seq == nextSeq && (int)stash[i].size() > RTP_HEADERS_LENGTH) {
+                len = (int)stash[i].size();
+                memcpy(packet, stash[i].data(), RTP_HEADERS_LENGTH);
+                memcpy(spill, stash[i].data() + RTP_HEADERS_LENGTH, len - RTP_HEADERS_LENGTH);
+                stash.erase(stash.begin() + i);
+                break;
+            }
+        }
     }
-    else if (result < RTP_HEADERS_LENGTH) {
-        LOG_INFO("Serious issue... read %d bytes, then less that RTP_HEADERS_LENGTH. Corrupted data?");
-        return VMI_E_INVALID_FRAME;
+    while (len == 0) {
+        UDPScatter first = { packet, RTP_HEADERS_LENGTH, spill, (int)sizeof(spill), 0, 0 };
+        result = sock->readScatter(&first, 1);
+        len = first.len;
+        if (result < 0) {
+            LOG_ERROR("error when read RTP frame: size readed=%d, result=%d", len, result);
+            return VMI_E_FAILED_TO_RCV_SOCKET;
+        }
+        else if (result == 0) {
+            LOG_INFO("the connection has been gracefully closed");
+            return VMI_E_CONNECTION_CLOSED;
+        }
+        else if (len <= RTP_HEADERS_LENGTH) {
+            LOG_INFO("Serious issue... read %d bytes, then less that RTP_HEADERS_LENGTH. Corrupted data?", len);
+            return VMI_E_INVALID_FRAME;
+        }
+        CRTPFrame rtp((unsigned char*)packet, len);
+        int k = (rtp._seq - nextSeq + 65536) % 65536;
+        if (!bSync)
+            continue;
+        if (k == 0) {
+            if (nbAhead > 0)
+                stats.reorderedPackets++;
+            continue;
+        }
+        if (k >= 32768) {
+            // Late packet of a previous frame
+            stats.latePackets++;
+            len = 0;
+            continue;
+        }
+
+        // The first packet of the frame, with the vMI headers, is not received yet: the packets
+        // following it are kept aside until it is received, or until reorderWindow of them
+        stash.push_back(std::vector<char>(len));
+        memcpy(stash.back().data(), packet, RTP_HEADERS_LENGTH);
+        memcpy(stash.back().data() + RTP_HEADERS_LENGTH, spill, len - RTP_HEADERS_LENGTH);
+        nbAhead++;
+        len = 0;
+        if ((int)stash.size() > reorderWindow) {
+            // Lost: the frame is dropped. If the packets kept aside contain its end of frame marker,
+            // the next frame starts after it, and its packets are kept for it.
+            int end = -1;
+            for (size_t i = 0; i < stash.size(); i++) {
+                CRTPFrame aside((unsigned char*)stash[i].data(), (int)stash[i].size());
+                int d = (aside._seq - nextSeq + 65536) % 65536;
+                if (aside.isEndOfFrame() && d < 32768 && (end < 0 || d < end))
+                    end = d;
+            }
+            if (end < 0) {
+                stats.lostPackets++;
+            }
+            else {
+                int nbAside = 0;
+                std::vector<std::vector<char>> keep;
+                for (size_t i = 0; i < stash.size(); i++) {
+                    CRTPFrame aside((unsigned char*)stash[i].data(), (int)stash[i].size());
+                    int d = (aside._seq - nextSeq + 65536) % 65536;
+                    if (d <= end)
+                        nbAside++;
+                    else if (d < 32768)
+                        keep.push_back(std::move(stash[i]));
+                }
+                stats.lostPackets += MAX(end + 1 - nbAside, 1);
+                ctx->setNextSeq(nextSeq + end + 1);
+                ctx->_stash.swap(keep);
+            }
+            LOG_ERROR("first RTP packet #%d of the frame not received, drop current frame", nextSeq);
+            return VMI_E_INVALID_FRAME;
+        }
     }
 
     // copy RTP payload on frame buffer
     int payloadLen = len - RTP_HEADERS_LENGTH;
-    memcpy((char*)_frame_buffer, packet + RTP_HEADERS_LENGTH, payloadLen);
+    if (payloadLen > _frame_size && _init_buffer(payloadLen) != VMI_E_OK)
+        return VMI_E_MEM_FAILED_TO_ALLOC;
+    memcpy((char*)_frame_buffer, spill, payloadLen);
     // then read headers
     result = _fh.ReadHeaders(_frame_buffer);
     if (result != VMI_E_OK) {
@@ -322,7 +530,6 @@ int CvMIFrame::createFrameFromUDP(UDP* sock, int moduleId) {
 
     // Get seq number of this first packet
     CRTPFrame frame((unsigned char*)packet, len);
-    int lastSeq = frame._seq;
 
     // verify the size of media content, buffer will growth if needed
     int media_size = _fh.GetMediaSize();
@@ -332,63 +539,230 @@ int CvMIFrame::createFrameFromUDP(UDP* sock, int moduleId) {
         return VMI_E_INVALID_FRAME;
 
     /*
-     * Now, keep the remaining data...
+     * Now, receive the remaining packets directly at their place in the frame buffer. All the packets
+     * have the same payload size (the last one is padded), so the payload of the packet #k of the
+     * frame is at k*payloadLen, with k computed from its seq number. The next packets in sequence are
+     * expected: a packet which lands at the wrong place (out of order) is moved to its own place.
+     * The packets of the next frame are kept aside: after reorderWindow of them, the packets still
+     * missing are considered as lost.
      */
-    //int offset = _headers.GetHeadersLength();
-    char* p = (char*)_frame_buffer + payloadLen;
-    int remainingLen = _frame_size - payloadLen;
-    bool bEndOfFrame = false;
+    int firstSeq = frame._seq;
+    int nbPackets = (_frame_size + payloadLen - 1) / payloadLen;
+    std::vector<bool> received(nbPackets, false);
+    received[0] = true;
+    int nbReceived = 1;
+    int nextIndex = 1;                                          /* index following the highest received one */
+    int nbCounted = 0;                                          /* missing packets already counted as lost */
+    std::vector<std::vector<char>> next;                        /* packets of the next frame(s) */
+
+    // Check a received packet, and give its index in the frame. The index is -1 if the packet must
+    // be ignored: late, duplicated, or kept aside because it belongs to the next frame.
+    auto classify = [&](const char* header, const char* payload, int len, int room, int* index) -> int {
+        CRTPFrame rtp((unsigned char*)header, len);
+        int k = (rtp._seq - firstSeq + 65536) % 65536;
+        *index = -1;
+        if (k >= 32768) {
+            // Late packet of a previous frame
+            stats.latePackets++;
+            return VMI_E_OK;
+        }
+        if (k >= nbPackets) {
+            if (len - RTP_HEADERS_LENGTH <= room) {
+                next.push_back(std::vector<char>(len));
+                memcpy(next.back().data(), header, RTP_HEADERS_LENGTH);
+                memcpy(next.back().data() + RTP_HEADERS_LENGTH, payload, len - RTP_HEADERS_LENGTH);
+            }
+            else {
+                // Truncated, as it landed in the place of a packet of this frame: lost. Its header is
+                // kept, so that the next frame doesn't count it twice.
+                stats.lostPackets++;
+                next.push_back(std::vector<char>(header, header + RTP_HEADERS_LENGTH));
+            }
+            return VMI_E_OK;
+        }
+        if (len - RTP_HEADERS_LENGTH != payloadLen) {
+            LOG_ERROR("unexpected payload size %d for RTP packet #%d, %d expected", len - RTP_HEADERS_LENGTH, rtp._seq, payloadLen);
+            return VMI_E_INVALID_FRAME;
+        }
+        if (rtp.isEndOfFrame() != (k == nbPackets - 1)) {
+            LOG_ERROR("end of frame marker %s for RTP packet #%d, _frame_size=%d", (rtp.isEndOfFrame() ? "found" : "not found"), rtp._seq, _frame_size);
+            return VMI_E_INVALID_FRAME;
+        }
+        if (received[k]) {
+            stats.duplicatedPackets++;
+            return VMI_E_OK;
+        }
+        if (k < nextIndex)
+            stats.reorderedPackets++;
+        else
+            nextIndex = k + 1;
+        *index = k;
+        return VMI_E_OK;
+    };
+
+    // First, the packets of this frame received in advance
+    for (size_t i = 0; i < stash.size(); i++) {
+        int index;
+        int size = (int)stash[i].size();
+        if (size == RTP_HEADERS_LENGTH) {
+            // Truncated packet, already counted as lost
+            CRTPFrame rtp((unsigned char*)stash[i].data(), size);
+            if ((rtp._seq - firstSeq + 65536) % 65536 < nbPackets) {
+                nbCounted++;
+                continue;
+            }
+        }
+        result = classify(stash[i].data(), stash[i].data() + RTP_HEADERS_LENGTH, size, size - RTP_HEADERS_LENGTH, &index);
+        if (result != VMI_E_OK)
+            return result;
+        if (index < 0)
+            continue;
+        int offset = index * payloadLen;
+        memcpy((char*)_frame_buffer + offset, stash[i].data() + RTP_HEADERS_LENGTH, MIN(payloadLen, _frame_size - offset));
+        received[index] = true;
+        nbReceived++;
+    }
+    stash.clear();
+
+    UDPScatter scatter[VMIFRAME_SCATTER_PACKETS];
+    char headers[VMIFRAME_SCATTER_PACKETS][RTP_HEADERS_LENGTH];
+    int  landing[VMIFRAME_SCATTER_PACKETS];                     /* packet index expected in each destination, -1 for spill */
+    int  misplaced[VMIFRAME_SCATTER_PACKETS];
+    int  misplacedIndex[VMIFRAME_SCATTER_PACKETS];
+    std::vector<char> reorder;                                  /* out of order payloads being moved */
 
     sock->pktTSctl(1, _fh.GetMediaTimestamp());                 /* PktTS hook */
-    while ( !bEndOfFrame && remainingLen>0) {
+    while (nbReceived < nbPackets && (int)next.size() <= reorderWindow) {
+
+        // Expect the next packets in sequence. The last one of the frame is partial: it lands in the spill buffer
+        int nb = 0;
+        for (int k = nextIndex; k < nbPackets && nb < VMIFRAME_SCATTER_PACKETS - 1 && (k + 1) * payloadLen <= _frame_size; k++, nb++) {
+            scatter[nb].payload = (char*)_frame_buffer + k * payloadLen;
+            scatter[nb].payloadLen = payloadLen;
+            landing[nb] = k;
+        }
+        scatter[nb].payload = spill;
+        scatter[nb].payloadLen = sizeof(spill);
+        landing[nb++] = -1;
+        for (int i = 0; i < nb; i++) {
+            scatter[i].header = headers[i];
+            scatter[i].headerLen = RTP_HEADERS_LENGTH;
+        }
 
-        // First, keep the full RTP frame from the current UDP packet
-        len = RTP_MAX_FRAME_LENGTH;
-        result = sock->readSocket(packet, &len);
-        if (result < 0) {
-            LOG_ERROR("error when read RTP frame: size readed=%d, result=%d", len, result);
+        int n = sock->readScatter(scatter, nb);
+        if (n < 0) {
+            LOG_ERROR("error when read RTP frame: result=%d", n);
             return VMI_E_FAILED_TO_RCV_SOCKET;
         }
-        else if (result == 0) {
+        else if (n == 0) {
             LOG_INFO("the connection has been gracefully closed");
             return VMI_E_CONNECTION_CLOSED;
         }
-        else if (result <= RTP_HEADERS_LENGTH) {
-            LOG_INFO("Serious issue... read %d bytes, then less than RTP_HEADERS_LENGTH. Corrupted data?");
-            return VMI_E_INVALID_FRAME;
-        }
 
-        CRTPFrame frame((unsigned char*)packet, len);
-        if (frame._seq>lastSeq && frame._seq != lastSeq + 1) {
-            LOG_ERROR("lost %d RTP packet (last=%d, current=%d), drop current frame", (frame._seq - (lastSeq + 1)), lastSeq, frame._seq);
-            // Drop current frame
-            return VMI_E_INVALID_FRAME;
+        int nbMisplaced = 0;
+        for (int i = 0; i < n; i++) {
+            if (scatter[i].len <= RTP_HEADERS_LENGTH) {
+                LOG_INFO("Serious issue... read %d bytes, then less than RTP_HEADERS_LENGTH. Corrupted data?", scatter[i].len);
+                return VMI_E_INVALID_FRAME;
+            }
+            int index;
+            result = classify(headers[i], scatter[i].payload, scatter[i].len, scatter[i].payloadLen, &index);
+            if (result != VMI_E_OK)
+                return result;
+            if (index < 0)
+                continue;
+            if (index == landing[i]) {
+                received[index] = true;
+                nbReceived++;
+            }
+            else {
+                misplacedIndex[nbMisplaced] = index;
+                misplaced[nbMisplaced++] = i;
+            }
         }
-        // LOG_INFO("%s: recv RTP frame: size=%d, seq=%d", _name.c_str(), result, frame._seq);
-        lastSeq = frame._seq;
-
-        // Then read RTP payload on frame buffer
-        int payloadLen = MIN(remainingLen, len - RTP_HEADERS_LENGTH);
-        memcpy(p, packet + RTP_HEADERS_LENGTH, payloadLen);
-        p += payloadLen;
-        remainingLen -= payloadLen;
-        //LOG_INFO("%sread (size=%d) from socket, result=%d, RTP packet #%d, payloadlen=%d, remaining=%d ", (frame.isEndOfFrame()?"####E###":""),len, result, frame._seq, payloadLen, remainingLen);
-
-        if (frame.isEndOfFrame()) {
-            if (remainingLen != 0)
-                LOG_ERROR("end of frame marker found, but remaining data: remain=%d, RTP packet #%d", remainingLen, frame._seq);
-            bEndOfFrame = true;
+
+        // Move the out of order packets. Their payload is saved first, as it can be where another one goes.
+        if (nbMisplaced > 0) {
+            if (reorder.size() < (size_t)nbMisplaced * payloadLen)
+                reorder.resize((size_t)nbMisplaced * payloadLen);
+            for (int m = 0; m < nbMisplaced; m++)
+                memcpy(&reorder[(size_t)m * payloadLen], scatter[misplaced[m]].payload, payloadLen);
+            for (int m = 0; m < nbMisplaced; m++) {
+                int index = misplacedIndex[m];
+                if (received[index])
+                    continue;
+                int offset = index * payloadLen;
+                memcpy((char*)_frame_buffer + offset, &reorder[(size_t)m * payloadLen], MIN(payloadLen, _frame_size - offset));
+                received[index] = true;
+                nbReceived++;
+            }
         }
-        else if (remainingLen == 0) {
-            LOG_ERROR("no more data to read, but end of frame marker not found... _frame_size=%d, RTP packet #%d", _frame_size, frame._seq);
+    }
+    sock->pktTSctl(0, _fh.GetMediaTimestamp());                 /* PktTS hook */
+
+    // The position of the next frame is known, even if this one is dropped
+    if (ctx) {
+        ctx->setNextSeq(firstSeq + nbPackets);
+        ctx->_stash.swap(next);
+    }
+
+    int nbLost = nbPackets - nbReceived;
+    if (nbLost > 0) {
+        stats.lostPackets += MAX(nbLost - nbCounted, 0);
+        if (ctx == NULL || nbLost > ctx->_maxLost) {
+            LOG_ERROR("lost %d RTP packet (first=%d), drop current frame", nbLost, firstSeq);
             return VMI_E_INVALID_FRAME;
         }
+        _repair_lost_packets(received, payloadLen, (ctx->_conceal ? &ctx->_previous : NULL));
+        stats.repairedFrames++;
+        LOG_INFO("lost %d RTP packet (first=%d), frame #%d %s", nbLost, firstSeq, _fh.GetFrameNumber(), (ctx->_conceal ? "concealed" : "flagged"));
     }
-    sock->pktTSctl(0, _fh.GetMediaTimestamp());                 /* PktTS hook */
+    if (ctx && ctx->_conceal)
+        ctx->_previous.assign(_frame_buffer, _frame_buffer + _frame_size);
 
     return VMI_E_OK;
 }
 
+/*!
+* \fn _repair_lost_packets
+* \brief fill the place of the lost packets of a frame received on a vMI RTP stream, and flag them
+*        in the headers (nb of lost packets, and lost parts of the media)
+*
+* \param received received flag of each packet of the frame
+* \param payloadLen payload size of the RTP packets
+* \param previous previous frame, to copy the data of the lost packets from. If NULL, or of a
+*        different size, the lost data is replaced by zeros.
+*/
+void CvMIFrame::_repair_lost_packets(const std::vector<bool>& received, int payloadLen, const std::vector<unsigned char>* previous) {
+
+    int headersLen = CFrameHeaders::GetHeadersLength();
+    bool conceal = (previous != NULL && previous->size() == (size_t)_frame_size);
+    int nbLost = 0;
+    unsigned long long lostMap = 0;
+    for (size_t k = 0; k < received.size(); k++) {
+        if (received[k])
+            continue;
+        int offset = (int)k * payloadLen;
+        int size = MIN(payloadLen, _frame_size - offset);
+        if (conceal)
+            memcpy(_frame_buffer + offset, previous->data() + offset, size);
+        else
+            ::memset(_frame_buffer + offset, 0, size);
+        nbLost++;
+
+        // Flag the 1/64 parts of the media covered by this packet
+        if (_media_size > 0) {
+            long long first = MAX(offset - headersLen, 0);
+            long long last = offset + size - 1 - headersLen;
+            for (long long bit = first * 64 / _media_size; bit <= last * 64 / _media_size && bit < 64; bit++)
+                lostMap |= 1ULL << bit;
+        }
+    }
+    _fh.SetLostPackets(_fh.GetLostPackets() + nbLost);
+    _fh.SetLostMap(_fh.GetLostMap() | lostMap);
+    _fh.WriteHeaders(_frame_buffer);
+}
+
 int CvMIFrame::createFrameFromHeaders(CFrameHeaders* fh) {
 
     _fh = *fh;
@@ -418,7 +792,11 @@ int CvMIFrame::copyFrameToMem(unsigned char* buffer, int size) {
         LOG_ERROR("ERROR, invalid size (%d>%d)", size, _frame_size);
         return VMI_E_INVALID_PARAMETER;
     }
-    memcpy(buffer, _frame_buffer, size);
+    // Headers and media are not contiguous for an external buffer
+    int headers_size = MIN(size, CFrameHeaders::GetHeadersLength());
+    memcpy(buffer, _frame_buffer, headers_size);
+    if (size > headers_size)
+        memcpy(buffer + headers_size, _media_buffer, size - headers_size);
     return VMI_E_OK;
 }
 
@@ -432,14 +810,31 @@ int CvMIFrame::copyMediaToMem(unsigned char* buffer, int size) {
     return VMI_E_OK;
 }
 
-int CvMIFrame::sendToTCP(TCP* sock) {
+/**
+* \brief Send the frame on a TCP connection: headers and media with one sendmsg() (see
+* TCP::writeGather()). With MSG_ZEROCOPY, the frame must not be modified until the completions of
+* the sends are read.
+*
+* \param sock the connection
+* \param zcFirstId receive the id of the first zero copy send, may be NULL
+* \param zcNbIds receive the nb of zero copy sends, 0 if the frame was copied, may be NULL
+* \return VMI_E_OK if Ok, VMI_E_FAILED_TO_SND_SOCKET otherwise
+*/
+int CvMIFrame::sendToTCP(TCP* sock, unsigned int* zcFirstId, int* zcNbIds) {
 
+    if (zcNbIds != NULL)
+        *zcNbIds = 0;
     if (sock && sock->isValid())
     {
-        int len = _frame_size;
-        int result = sock->writeSocket((char*)_frame_buffer, &len);
-        if (result != E_OK || len == 0) {
-            LOG_ERROR("error writing %d bytes on the TCP socket, result=%d", len, result);
+        // Headers and media are not contiguous for an external buffer
+        TCPGather parts[2];
+        parts[0].buffer = (const char*)_frame_buffer;
+        parts[0].len = CFrameHeaders::GetHeadersLength();
+        parts[1].buffer = (const char*)_media_buffer;
+        parts[1].len = _media_size;
+        int result = sock->writeGather(parts, 2, zcFirstId, zcNbIds);
+        if (result != E_OK) {
+            LOG_ERROR("error writing %d bytes on the TCP socket, result=%d", _frame_size, result);
             return VMI_E_FAILED_TO_SND_SOCKET;
         }
     }
@@ -557,6 +952,10 @@ void CvMIFrame::set_header(MediaHeader header, void* value) {
             _fh.SetOutputTimestamp(*static_cast<unsigned long long*>(value)); break;
         case NAME_INFORMATION:
             _fh.SetName(static_cast<const char*>(value)); break;
+        case MEDIA_LOST_PACKETS:
+            _fh.SetLostPackets(*static_cast<int*>(value)); break;
+        case MEDIA_LOST_MAP:
+            _fh.SetLostMap(*static_cast<unsigned long long*>(value)); break;
         default:
             break;
         }
@@ -610,6 +1009,10 @@ void CvMIFrame::get_header(MediaHeader header, void* value) {
             *static_cast<int*>(value) = _fh.GetSmpteframeCode(); break;
         case NAME_INFORMATION:
             *static_cast<const char**>(value) = _fh.GetName(); break;
+        case MEDIA_LOST_PACKETS:
+            *static_cast<int*>(value) = _fh.GetLostPackets(); break;
+        case MEDIA_LOST_MAP:
+            *static_cast<unsigned long long*>(value) = _fh.GetLostMap(); break;
         default:
             break;
         }
@@ -2,12 +2,113 @@
 #define _VMIFRAME_H
 
 
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
 #include "common.h"
 #include "frameheaders.h"
 #include "./pins/st2022/smpteframe.h"
 #include "tcp_basic.h"
 #include "libvMI.h"
 
+/*
+*  Interface of an object owning a memory area that a vMIFrame can reference without copy
+*/
+
+class CvMIFrameBufferOwner
+{
+public:
+    virtual ~CvMIFrameBufferOwner() {};
+    virtual void releaseBuffer(int cookie) = 0;     /* called when the vMIFrame doesn't reference the memory area anymore */
+};
+
+/*
+*  Packet loss and reordering counters of a vMI RTP receiver
+*/
+
+struct vMIRxStats
+{
+    unsigned long long lostPackets;         /* packets never received */
+    unsigned long long reorderedPackets;    /* packets received out of order, but in time */
+    unsigned long long duplicatedPackets;
+    unsigned long long latePackets;         /* packets of a frame already delivered or dropped */
+    unsigned long long droppedFrames;       /* frames dropped, because of too many lost packets or corrupted data */
+    unsigned long long repairedFrames;      /* frames delivered with lost packets, flagged or concealed */
+};
+
+/*
+*  Counters of the output pipeline of a vMI output pin (see CvMIOutput): the times are summed
+*  over the frames, in µs
+*/
+
+struct vMITxStats
+{
+    unsigned long long frames;              /* frames sent */
+    unsigned long long prepareTime;         /* time spent in the prepare stage */
+    unsigned long long waitTime;            /* time between the end of the preparation and the start of the transmission */
+    unsigned long long transmitTime;        /* time spent in the transmit stage, sync wait excluded */
+    int                queueDepth;          /* frames waiting for the prepare stage */
+    int                ringDepth;           /* frames prepared, waiting for the transmit stage */
+};
+
+/*
+*  Counters of a SMPTE ST 2022-7 receiver (see CSPSRTPDataSource), for each leg and for the
+*  merged stream
+*/
+
+#define SPS_NB_LEGS     2
+
+struct vMISPSLegStats
+{
+    unsigned long long packets;             /* packets received on the leg */
+    unsigned long long lostPackets;         /* packets missing on the leg, while later ones were received */
+    unsigned long long recoveredPackets;    /* packets missing on the leg, taken from another leg */
+};
+
+struct vMISPSStats
+{
+    vMISPSLegStats     legs[SPS_NB_LEGS];
+    unsigned long long lostPackets;         /* packets missing on all the legs */
+};
+
+/*
+*  Reassembly state of a vMI RTP receiver, kept from one frame to the next
+*/
+
+class CvMIRxContext
+{
+public:
+    int         _reorderWindow;     /* nb of packets of the next frame to receive before declaring missing packets lost */
+    int         _maxLost;           /* max nb of lost packets to deliver a frame, 0 to drop all incomplete frames */
+    bool        _conceal;           /* repeat the previous frame data on lost packets, instead of zeros */
+    vMIRxStats  _stats;
+
+    bool        _bSync;             /* _nextSeq is valid */
+    int         _nextSeq;           /* seq number of the first packet of the next frame */
+    std::vector<std::vector<char>> _stash;      /* packets of the next frame(s) received while completing the current one */
+    std::vector<unsigned char>     _previous;   /* previous frame, for concealment */
+
+    CvMIRxContext() {
+        _reorderWindow = 0;
+        _maxLost = 0;
+        _conceal = false;
+        std::memset(&_stats, 0, sizeof(_stats));
+        reset();
+    };
+    void reset() {
+        _bSync = false;
+        _nextSeq = 0;
+        _stash.clear();
+    };
+    void setNextSeq(int seq) {
+        _bSync = true;
+        _nextSeq = seq & 0xFFFF;
+    };
+    bool isSync() { return _bSync; };
+};
+
 /*
 *  Contain a single vMIFrame
 */
@@ -21,8 +122,14 @@ class CvMIFrame
     int            _media_size;
     CFrameHeaders  _fh;
 
-    int            _ref_counter;
-    std::mutex     _mtx;
+    std::atomic<int> _ref_counter;
+    std::atomic<int> _handle;                           /* handle of the frame in the frame table of libvMI, -1 if none */
+
+    std::shared_ptr<CvMIFrameBufferOwner> _ext_owner;  /* owner of the external media buffer, if any */
+    int            _ext_cookie;                         /* cookie to give back to the owner on release */
+    unsigned char* _own_buffer;                         /* own buffer, kept aside while an external buffer is attached */
+    int            _own_buffer_size;
+    unsigned char  _ext_headers[FRAME_HEADER_LENGTH];   /* private copy of headers for an external buffer */
 
 public:
     CvMIFrame();
@@ -34,13 +141,15 @@ public:
     int  _refresh_from_headers();
     bool _is_sampling_fmt_supported();
     int  _calculate_pixel_size_in_bits();
+    void _detach_external_buffer(bool keepContent);
+    void _repair_lost_packets(const std::vector<bool>& received, int payloadLen, const std::vector<unsigned char>* previous);
 
 public:
     CvMIFrame & operator=(const CvMIFrame &other);
 
     // Accesseurs
     unsigned char* getMediaBuffer() { return _media_buffer; };
-    unsigned char* getFrameBuffer() { return _frame_buffer; };
+    unsigned char* getFrameBuffer();
     int getMediaSize() { return _media_size; };
     int getFrameSize() { return _media_size + CFrameHeaders::GetHeadersLength(); };
     CFrameHeaders* getMediaHeaders() { return &_fh; };
@@ -51,14 +160,20 @@ public:
     int releaseRef();
     int getRef() { return _ref_counter; };
 
+    // Handle in the frame table of libvMI
+    void setHandle(int handle) { _handle.store(handle, std::memory_order_relaxed); };
+    int getHandle() { return _handle.load(std::memory_order_relaxed); };
+
     // Frame creation
     int createFrameFromSmpteFrame(CSMPTPFrame* smpteframe, SMPTEFRAME_BUFFERS srcBuffer, int moduleId);
     int createFrameFromMem(unsigned char* buffer, int buffer_size, int moduleId);
     int createFrameUninitialized(int size);
     int createFrameFromMediaSize(int size);
     int createFrameFromTCP(TCP* sock, int moduleId);
-    int createFrameFromUDP(UDP* sock, int moduleId);
+    int createFrameFromUDP(UDP* sock, int moduleId, CvMIRxContext* ctx = NULL);
     int createFrameFromHeaders(CFrameHeaders* fh);
+    int createFrameFromExternalMem(std::shared_ptr<CvMIFrameBufferOwner> owner, int cookie, unsigned char* buffer, int buffer_size, int moduleId);
+    bool isExternal() { return _ext_owner != nullptr; };
 
     // Media content management
     int setMediaContent(unsigned char* media_buffer, int media_size);
@@ -66,7 +181,7 @@ public:
     // Frame export
     int copyFrameToMem(unsigned char* buffer, int size);
     int copyMediaToMem(unsigned char* buffer, int size);
-    int sendToTCP(TCP* sock);
+    int sendToTCP(TCP* sock, unsigned int* zcFirstId = NULL, int* zcNbIds = NULL);
 
     // HEaders management
     void set_header(MediaHeader header, void* value);
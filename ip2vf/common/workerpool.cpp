@@ -0,0 +1,225 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "common.h"
+#include "log.h"
+#include "tools.h"
+#include "workerpool.h"
+
+CWorkerPool* CWorkerPool::_instance = nullptr;
+
+CWorkerPool::CWorkerPool()
+{
+    _bConfigured = false;
+    _bExit = false;
+}
+
+CWorkerPool::~CWorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _bExit = true;
+    }
+    _cv_work.notify_all();
+    for (std::thread &t : _threads) {
+        if (t.joinable())
+            t.join();
+    }
+    _threads.clear();
+}
+
+/*!
+* \fn getInstance
+* \brief return the pool shared by all the pins of the module
+*
+* \return CWorkerPool object
+*/
+CWorkerPool* CWorkerPool::getInstance()
+{
+    static std::mutex mtx;
+    std::unique_lock<std::mutex> lock(mtx);
+    if (_instance)
+        return _instance;
+    _instance = new CWorkerPool();
+    return _instance;
+}
+
+/*!
+* \fn parseCpuList
+* \brief parse a list of CPU cores, like "2;3;8-11"
+*
+* \param cpus list of cores or ranges of cores, separated by ';'
+* \return vector of core indexes
+*/
+std::vector<int> CWorkerPool::parseCpuList(const std::string& cpus)
+{
+    std::vector<int> result;
+    std::vector<std::string> tokens = tools::split(cpus, ';');
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i].empty())
+            continue;
+        std::vector<std::string> range = tools::split(tokens[i], '-');
+        int first = atoi(range[0].c_str());
+        int last = (range.size() > 1) ? atoi(range[1].c_str()) : first;
+        for (int cpu = first; cpu <= last && result.size() < WORKERPOOL_MAX_WORKERS; cpu++)
+            result.push_back(cpu);
+    }
+    return result;
+}
+
+/*!
+* \fn configure
+* \brief configure and start the workers. Only the first configuration is applied, as the pool
+*        is shared between all the pins of the module.
+*
+* \param nbWorkers nb of workers. If <0, one worker per CPU core in the list, or a default
+*        number depending of the number of cores of the host
+* \param cpus list of cores to pin the workers on (see parseCpuList), empty for no pinning
+* \return VMI_E_OK if Ok, error code otherwise
+*/
+int CWorkerPool::configure(int nbWorkers, const std::string& cpus)
+{
+    std::unique_lock<std::mutex> lock(_config_mtx);
+
+    std::vector<int> cpuList = parseCpuList(cpus);
+    if (_bConfigured) {
+        if ((nbWorkers >= 0 && nbWorkers != (int)_threads.size()) || cpuList != _cpus)
+            LOG_WARNING("worker pool already started with %d workers, ignore new configuration", (int)_threads.size());
+        return VMI_E_OK;
+    }
+
+    if (nbWorkers < 0) {
+        if (!cpuList.empty())
+            nbWorkers = (int)cpuList.size();
+        else
+            nbWorkers = std::min(std::max((int)std::thread::hardware_concurrency() / 2, 1), 8);
+    }
+    if (nbWorkers > WORKERPOOL_MAX_WORKERS) {
+        LOG_WARNING("%d workers requested, limit to %d", nbWorkers, WORKERPOOL_MAX_WORKERS);
+        nbWorkers = WORKERPOOL_MAX_WORKERS;
+    }
+    _cpus = cpuList;
+    _start(nbWorkers);
+    return VMI_E_OK;
+}
+
+void CWorkerPool::_start(int nbWorkers)
+{
+    _bConfigured = true;
+    for (int i = 0; i < nbWorkers; i++) {
+        _threads.push_back(std::thread(&CWorkerPool::_worker_process, this, i));
+        if (!_cpus.empty()) {
+            int cpu = _cpus[i % _cpus.size()];
+            if (!_pin_thread(_threads.back(), cpu))
+                LOG_WARNING("failed to pin worker %d on cpu %d", i, cpu);
+        }
+    }
+    LOG_INFO("worker pool started with %d workers, %d cpus", nbWorkers, (int)_cpus.size());
+}
+
+bool CWorkerPool::_pin_thread(std::thread& t, int cpu)
+{
+#ifdef _WIN32
+    if (cpu < 0 || cpu >= (int)(sizeof(DWORD_PTR) * 8))
+        return false;
+    return SetThreadAffinityMask((HANDLE)t.native_handle(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    return pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &cpuset) == 0;
+#endif
+}
+
+/*!
+* \fn parallelFor
+* \brief execute job(0) ... job(nbJobs-1) on the workers and the calling thread, and wait for
+*        their completion
+*
+* \param nbJobs nb of jobs in the batch
+* \param job function to execute, with the job index as parameter
+*/
+void CWorkerPool::parallelFor(int nbJobs, std::function<void(int)> job)
+{
+    if (nbJobs <= 0)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(_config_mtx);
+        if (!_bConfigured)
+            _start(std::min(std::max((int)std::thread::hardware_concurrency() / 2, 1), 8));
+    }
+
+    if (nbJobs == 1 || _threads.empty()) {
+        for (int i = 0; i < nbJobs; i++)
+            job(i);
+        return;
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->job = job;
+    batch->nbJobs = nbJobs;
+    batch->nextJob = 0;
+    batch->pendingJobs = nbJobs;
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _batches.push_back(batch);
+    }
+    _cv_work.notify_all();
+
+    _run_jobs(batch.get());
+    _retire(batch);
+
+    // The last jobs may still run on workers
+    std::unique_lock<std::mutex> lock(batch->mtx);
+    batch->cvDone.wait(lock, [&] { return batch->pendingJobs.load() == 0; });
+}
+
+void CWorkerPool::_run_jobs(Batch* batch)
+{
+    int index;
+    while ((index = batch->nextJob.fetch_add(1)) < batch->nbJobs) {
+        batch->job(index);
+        if (batch->pendingJobs.fetch_sub(1) == 1) {
+            std::unique_lock<std::mutex> lock(batch->mtx);
+            batch->cvDone.notify_all();
+        }
+    }
+}
+
+/* Remove a batch whose jobs are all started from the queue of the workers */
+void CWorkerPool::_retire(const std::shared_ptr<Batch>& batch)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    auto it = std::find(_batches.begin(), _batches.end(), batch);
+    if (it != _batches.end())
+        _batches.erase(it);
+}
+
+void CWorkerPool::_worker_process(int index)
+{
+    LOG("worker %d: started", index);
+    while (true) {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cv_work.wait(lock, [&] { return _bExit || !_batches.empty(); });
+            if (_bExit)
+                break;
+            batch = _batches.front();
+        }
+        _run_jobs(batch.get());
+        _retire(batch);
+    }
+    LOG("worker %d: exit", index);
+}
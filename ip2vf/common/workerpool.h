@@ -0,0 +1,71 @@
+#ifndef _WORKERPOOL_H
+#define _WORKERPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define WORKERPOOL_MAX_WORKERS  64
+
+/**********************************************************************************************
+*
+* CWorkerPool
+*
+* Module-wide pool of persistent worker threads, optionally pinned on a list of CPU cores. The
+* per-frame parallel kernels (SMPTE 425M demux, ...) submit a batch of jobs with parallelFor()
+* instead of creating and joining threads for each frame. The submitting thread executes jobs
+* too, so a pool without worker runs the batch inline.
+*
+* The batches of concurrent submitters share the queue of the workers, each batch with its own
+* completion: no lock is held for the lifetime of a batch, and a job can submit a batch itself.
+*
+***********************************************************************************************/
+
+class CWorkerPool
+{
+    /* Batch of jobs submitted by parallelFor() */
+    struct Batch {
+        std::function<void(int)>    job;            /* job to execute, with the job index as parameter */
+        int                         nbJobs;         /* nb of jobs in the batch */
+        std::atomic<int>            nextJob;        /* next job index to execute */
+        std::atomic<int>            pendingJobs;    /* nb of jobs not yet completed */
+        std::mutex                  mtx;
+        std::condition_variable     cvDone;         /* signaled when the last job completes */
+    };
+
+    std::vector<std::thread>        _threads;       /* persistent workers */
+    std::vector<int>                _cpus;          /* cores the workers are pinned on, empty if not pinned */
+    std::mutex                      _config_mtx;    /* serialize the configuration */
+    std::mutex                      _mtx;
+    std::condition_variable         _cv_work;       /* signaled when a new batch is available */
+    std::deque<std::shared_ptr<Batch>> _batches;    /* batches with jobs not yet started */
+    bool                            _bConfigured;
+    bool                            _bExit;
+
+    static CWorkerPool* _instance;
+
+    CWorkerPool();
+    ~CWorkerPool();
+
+    void _worker_process(int index);
+    void _run_jobs(Batch* batch);
+    void _retire(const std::shared_ptr<Batch>& batch);
+    void _start(int nbWorkers);
+    static bool _pin_thread(std::thread& t, int cpu);
+
+public:
+    static CWorkerPool* getInstance();
+    static std::vector<int> parseCpuList(const std::string& cpus);
+
+    int  configure(int nbWorkers, const std::string& cpus);
+    void parallelFor(int nbJobs, std::function<void(int)> job);
+    int  getNbWorkers() { return (int)_threads.size(); };
+};
+
+#endif // _WORKERPOOL_H
@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <cstring>      // strcmp
 #include <set>
+#include <atomic>
 #include <pins/pins.h>
 
 #include "log.h"
@@ -12,6 +13,7 @@
 #include "tools.h"
 #include "framecounter.h"
 #include "vmiframe.h"
+#include "framearena.h"
 
 #include "vMI_input.h"
 #include "vMI_output.h"
@@ -20,27 +22,136 @@
 /**
 * Frame management,
 * Note: frame are not linked to a module
+*
+* Frames are stored in a fixed table of slots. A frame handle encodes the slot index in its low bits and
+* the slot generation in its high bits, so that looking up a handle is a direct O(1) access, and a stale
+* handle (released then re-used slot) never matches the new owner of the slot. Free slots are chained in
+* a lock-free stack, and the ref counter of the CvMIFrame is atomic: no lock is taken on handle operations.
 */
 
-#define MAX_FRAME_IN_LIST   10
+#define MAX_FRAME_IN_LIST       10
+#define FRAME_SLOT_INDEX_BITS   12
+#define FRAME_SLOT_MAX          (1 << FRAME_SLOT_INDEX_BITS)    /* hard limit for MAX_FRAMES_IN_LIST */
+#define FRAME_SLOT_INDEX_MASK   (FRAME_SLOT_MAX - 1)
+#define FRAME_SLOT_GEN_MASK     (0x7FFFFFFF >> FRAME_SLOT_INDEX_BITS)
+#define FRAME_SLOT_NONE         (-1)
 
 /**
-* \brief Struct that contains all about a frame
+* \brief Struct that contains all about a frame slot
 *
-* This struct contains a unique handle, the pointer to the corresponding object, and a bool to indicate if
-* the frame is free or not.
+* This struct contains the handle currently associated with the slot, the pointer to the corresponding object,
+* the generation counter used to build the next handle, and the link to the next free slot.
 * INTERNAL USE ONLY (do not expose this across the API)
 *
 */
-using tFrameItem = std::tuple<  libvMI_frame_handle,    /* Handle associated with this item. Available only if in use (free item flag = LIBVMI_INVALID_HANDLE) */
-                                CvMIFrame*,             /* Pointer to the vMIFrame associated to this item */
-                                bool                    /* free item flag: true if free, false if in used */
-                             >;
+struct tFrameSlot {
+    std::atomic<libvMI_frame_handle> handle;    /* Handle associated with this slot. LIBVMI_INVALID_HANDLE if the slot is free */
+    std::atomic<CvMIFrame*> frame;              /* Pointer to the vMIFrame associated to this slot */
+    std::atomic<int>        next;               /* Index of next free slot when this slot is on the free list */
+    unsigned int            gen;                /* Generation of the slot, only modified by the owner of the slot */
+
+    // Constant initialization: a slot not yet written matches no handle, not even handle 0
+    constexpr tFrameSlot() : handle(LIBVMI_INVALID_HANDLE), frame(nullptr), next(FRAME_SLOT_NONE), gen(0) {}
+};
+
+tFrameSlot g_vMIFramesArray[FRAME_SLOT_MAX];                /* table of all frames processed by this library instance */
+std::atomic<unsigned long long> g_vMIFramesFreeHead(((unsigned long long)0 << 32) | (unsigned int)FRAME_SLOT_NONE);   /* free list head: ABA tag (high 32 bits) + slot index (low 32 bits) */
+std::atomic<int> g_vMIFramesReserved(0);                    /* number of slots already reserved in g_vMIFramesArray */
+std::atomic<int> g_vMIFramesCount(0);                       /* number of slots published, see _frame_slot_publish() */
+std::atomic<int> g_vMIFramesFreeCount(0);                   /* number of slots currently on the free list */
+std::atomic<int> g_vMIMaxFramesInList(MAX_FRAME_IN_LIST);   /* maximum number of frames in g_vMIFramesArray. Can be set/get with parameter */
+
+/**
+* INTERNAL USE ONLY. Not exposed across the API.
+*
+* \brief Push a slot on the lock-free free list
+*/
+static void _frame_slot_push(int index) {
+
+    unsigned long long head = g_vMIFramesFreeHead.load(std::memory_order_relaxed);
+    unsigned long long next;
+    do {
+        g_vMIFramesArray[index].next.store((int)(head & 0xFFFFFFFF), std::memory_order_relaxed);
+        next = (((head >> 32) + 1) << 32) | (unsigned int)index;
+    } while (!g_vMIFramesFreeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    g_vMIFramesFreeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+* INTERNAL USE ONLY. Not exposed across the API.
+*
+* \brief Pop a slot from the lock-free free list
+*
+* \return the slot index, FRAME_SLOT_NONE if the free list is empty
+*/
+static int _frame_slot_pop() {
+
+    unsigned long long head = g_vMIFramesFreeHead.load(std::memory_order_acquire);
+    unsigned long long next;
+    int index;
+    do {
+        index = (int)(head & 0xFFFFFFFF);
+        if (index == FRAME_SLOT_NONE)
+            return FRAME_SLOT_NONE;
+        // Slots are never deallocated, so reading 'next' of a slot popped meanwhile is safe: the tag makes the CAS fail
+        int nextIndex = g_vMIFramesArray[index].next.load(std::memory_order_relaxed);
+        next = (((head >> 32) + 1) << 32) | (unsigned int)nextIndex;
+    } while (!g_vMIFramesFreeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire));
+    g_vMIFramesFreeCount.fetch_sub(1, std::memory_order_relaxed);
+    return index;
+}
+
+/**
+* INTERNAL USE ONLY. Not exposed across the API.
+*
+* \brief Reserve a never used slot in g_vMIFramesArray, within the MAX_FRAMES_IN_LIST limit
+*
+* \return the slot index, FRAME_SLOT_NONE if the limit is reached
+*/
+static int _frame_slot_alloc() {
+
+    int count = g_vMIFramesReserved.load(std::memory_order_relaxed);
+    int max = MIN(g_vMIMaxFramesInList.load(std::memory_order_relaxed), FRAME_SLOT_MAX);
+    while (count < max) {
+        if (g_vMIFramesReserved.compare_exchange_weak(count, count + 1, std::memory_order_relaxed))
+            return count;
+    }
+    return FRAME_SLOT_NONE;
+}
+
+/**
+* INTERNAL USE ONLY. Not exposed across the API.
+*
+* \brief Make a slot reserved by _frame_slot_alloc() visible to the lookups, once its frame and handle
+* are written. The slots reserved concurrently may be published out of order: a lower slot not yet
+* written has no frame and an invalid handle, so the lookups skip it.
+*/
+static void _frame_slot_publish(int index) {
+
+    int count = g_vMIFramesCount.load(std::memory_order_relaxed);
+    while (count < index + 1) {
+        if (g_vMIFramesCount.compare_exchange_weak(count, index + 1, std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+}
+
+/**
+* INTERNAL USE ONLY. Not exposed across the API.
+*
+* \brief Return the slot associated to a handle, NULL if the handle is not (or no more) valid
+*/
+static inline tFrameSlot* _frame_slot_get(const libvMI_frame_handle hFrame) {
 
-std::vector< tFrameItem > g_vMIFramesArray;             /* vector of all frames processed by this library instance */
-std::mutex g_vMIFramesMutex;                            /* mutex used for elementary operation on g_vMIFramesArray*/
-int g_vMIFramesNextHandle = 0;                          /* counter for next handle value */
-int g_vMIMaxFramesInList = MAX_FRAME_IN_LIST;           /* maximum number of frames in g_vMIFramesArray. Can be set/get with parameter */
+    if (hFrame < 0)
+        return NULL;
+    int index = hFrame & FRAME_SLOT_INDEX_MASK;
+    if (index >= g_vMIFramesCount.load(std::memory_order_acquire))
+        return NULL;
+    tFrameSlot* slot = &g_vMIFramesArray[index];
+    if (slot->handle.load(std::memory_order_acquire) != hFrame)
+        return NULL;
+    return slot;
+}
 
 /**
 * \brief Search and return a handle to an available vMIFrame. A new frame is created if no available frames.
@@ -50,35 +161,35 @@ int g_vMIMaxFramesInList = MAX_FRAME_IN_LIST;           /* maximum number of fra
 */
 libvMI_frame_handle libvmi_frame_create() {
 
-    std::unique_lock<std::mutex> lock(g_vMIFramesMutex);
-
-    // First, search for a free item on g_vMIFramesArray
-    for (std::vector< tFrameItem >::iterator it = g_vMIFramesArray.begin(); it != g_vMIFramesArray.end(); ++it) {
-        if (std::get<2>(*it)) {
-            // We find a free item on the list
-            std::get<0>(*it) = g_vMIFramesNextHandle++;
-            std::get<1>(*it)->addRef();
-            std::get<2>(*it) = false;
-            LOG("re-use item with new handle [%d], frame array size=%d", std::get<0>(*it), g_vMIFramesArray.size());
-            return std::get<0>(*it);
-        }
+    // First, search for a free slot on g_vMIFramesArray
+    int index = _frame_slot_pop();
+    if (index != FRAME_SLOT_NONE) {
+        tFrameSlot* slot = &g_vMIFramesArray[index];
+        slot->frame.load(std::memory_order_relaxed)->addRef();
+        slot->gen = (slot->gen + 1) & FRAME_SLOT_GEN_MASK;
+        libvMI_frame_handle hFrame = (libvMI_frame_handle)((slot->gen << FRAME_SLOT_INDEX_BITS) | index);
+        slot->frame.load(std::memory_order_relaxed)->setHandle(hFrame);
+        slot->handle.store(hFrame, std::memory_order_release);
+        LOG("re-use item with new handle [%d], frame array size=%d", hFrame, g_vMIFramesCount.load());
+        return hFrame;
     }
 
-    if (g_vMIFramesArray.size() >= g_vMIMaxFramesInList) {
-        LOG_ERROR("Error, too much frame in list. Current size is '%d'", g_vMIFramesArray.size());
-        //for (std::vector< tFrameItem >::iterator it = g_vMIFramesArray.begin(); it != g_vMIFramesArray.end(); ++it) {
-        //    LOG_INFO("Frame#%d, ref=%d", std::get<0>(*it), std::get<1>(*it)->getRef());
-        //}
-        //exit(0);
+    // At this point, we have no more free slot... create a new one.
+    index = _frame_slot_alloc();
+    if (index == FRAME_SLOT_NONE) {
+        LOG_ERROR("Error, too much frame in list. Current size is '%d'", g_vMIFramesCount.load());
         return LIBVMI_INVALID_HANDLE;
     }
-
-    // At this point, we have no more free item... create a new one.
-    CvMIFrame* newFrame = new CvMIFrame();
-    auto item = std::make_tuple(g_vMIFramesNextHandle++, newFrame, false);
-    g_vMIFramesArray.push_back(item);
-    LOG_INFO("create new item with handle [%d], now frame array size =%d", std::get<0>(item), g_vMIFramesArray.size());
-    return std::get<0>(item);
+    tFrameSlot* slot = &g_vMIFramesArray[index];
+    CvMIFrame* frame = new CvMIFrame();
+    slot->gen = 0;
+    libvMI_frame_handle hFrame = (libvMI_frame_handle)index;
+    frame->setHandle(hFrame);
+    slot->frame.store(frame, std::memory_order_relaxed);
+    slot->handle.store(hFrame, std::memory_order_release);
+    _frame_slot_publish(index);
+    LOG_INFO("create new item with handle [%d], now frame array size =%d", hFrame, g_vMIFramesCount.load());
+    return hFrame;
 }
 
 /**
@@ -88,13 +199,7 @@ libvMI_frame_handle libvmi_frame_create() {
 */
 int libvMI_get_free_frame_number() {
 
-    int count = 0;
-    std::unique_lock<std::mutex> lock(g_vMIFramesMutex);
-    for (std::vector< tFrameItem >::iterator it = g_vMIFramesArray.begin(); it != g_vMIFramesArray.end(); ++it) {
-        if (std::get<2>(*it))
-            count++;
-    }
-    return count;
+    return g_vMIFramesFreeCount.load(std::memory_order_relaxed);
 }
 
 /**
@@ -185,28 +290,26 @@ libvMI_frame_handle libvmi_frame_create_ext(struct vMIFrameInitStruct &init) {
 */
 int libvmi_frame_release(const libvMI_frame_handle hFrame) {
 
-    std::unique_lock<std::mutex> lock(g_vMIFramesMutex);
+    tFrameSlot* slot = _frame_slot_get(hFrame);
+    if (slot == NULL) {
+        // Not found
+        return -1;
+    }
 
-    LOG("release frame handle [%d], current array size=%d", hFrame, g_vMIFramesArray.size());
-    //LOG_COLOR(LOG_COLOR_GREEN, "release frame handle [%d], current array size=%d", hFrame, g_vMIFramesArray.size());
-    for (std::vector< tFrameItem >::iterator it = g_vMIFramesArray.begin(); it != g_vMIFramesArray.end(); ++it) {
-        if (std::get<0>(*it) == hFrame) {
-            int ret = std::get<1>(*it)->releaseRef();
-            if (ret < 0) {
-                // TODO, manage this properly
-                LOG_ERROR("Error, refcount=%d for frame [%d]. This not be happen.", hFrame);
-            }
-            if (ret == 0) {
-                std::get<2>(*it) = true;
-                std::get<0>(*it) = LIBVMI_INVALID_HANDLE;   // Optional, just for clarity...
-            }
-            LOG("refcounter for frame handle [%d] is %d", hFrame, ret);
-            //LOG_COLOR(LOG_COLOR_GREEN, "refcounter for frame handle [%d] is %d", hFrame, ret);
-            return ret;
-        }
+    LOG("release frame handle [%d], current array size=%d", hFrame, g_vMIFramesCount.load());
+    int ret = slot->frame.load(std::memory_order_relaxed)->releaseRef();
+    if (ret < 0) {
+        // TODO, manage this properly
+        LOG_ERROR("Error, refcount=%d for frame [%d]. This not be happen.", ret, hFrame);
     }
-    // Not found
-    return -1;
+    if (ret == 0) {
+        // Only the release that drops the last reference gives the slot back to the free list
+        libvMI_frame_handle expected = hFrame;
+        if (slot->handle.compare_exchange_strong(expected, LIBVMI_INVALID_HANDLE, std::memory_order_acq_rel))
+            _frame_slot_push((int)(slot - g_vMIFramesArray));
+    }
+    LOG("refcounter for frame handle [%d] is %d", hFrame, ret);
+    return ret;
 }
 
 /**
@@ -217,18 +320,14 @@ int libvmi_frame_release(const libvMI_frame_handle hFrame) {
 */
 int libvmi_frame_addref(const libvMI_frame_handle hFrame) {
 
-    std::unique_lock<std::mutex> lock(g_vMIFramesMutex);
-
-    for (std::vector< tFrameItem >::iterator it = g_vMIFramesArray.begin(); it != g_vMIFramesArray.end(); ++it) {
-        if (std::get<0>(*it) == hFrame) {
-            int ret = std::get<1>(*it)->addRef();
-            LOG("refcounter for frame handle [%d] is %d", hFrame, ret);
-            //LOG_COLOR(LOG_COLOR_GREEN, "refcounter for frame handle [%d] is %d", hFrame, ret);
-            return ret;
-        }
+    tFrameSlot* slot = _frame_slot_get(hFrame);
+    if (slot == NULL) {
+        // Not found
+        return -1;
     }
-    // Not found
-    return -1;
+    int ret = slot->frame.load(std::memory_order_relaxed)->addRef();
+    LOG("refcounter for frame handle [%d] is %d", hFrame, ret);
+    return ret;
 }
 
 /**
@@ -241,14 +340,32 @@ int libvmi_frame_addref(const libvMI_frame_handle hFrame) {
 */
 CvMIFrame* libvMI_frame_get(const libvMI_frame_handle hFrame) {
 
-    std::unique_lock<std::mutex> lock(g_vMIFramesMutex);
-
-    for (std::vector< tFrameItem >::iterator it = g_vMIFramesArray.begin(); it != g_vMIFramesArray.end(); ++it) {
-        if (std::get<0>(*it) == hFrame)
-            return std::get<1>(*it);
+    tFrameSlot* slot = _frame_slot_get(hFrame);
+    if (slot == NULL) {
+        // not found
+        return NULL;
     }
-    // not found
-    return NULL;    
+    return slot->frame.load(std::memory_order_relaxed);
+}
+
+/**
+* Not exposed from the API.
+*
+* \brief Return the handle of a vMIFrame, to keep a reference on it (see libvmi_frame_addref()). The handle is
+* kept by the frame when its slot is published or re-used.
+*
+* \param frame the vMIFrame, referenced by the caller
+* \return the handle, LIBVMI_INVALID_HANDLE if the frame is not in g_vMIFramesArray
+*/
+libvMI_frame_handle libvMI_frame_get_handle(CvMIFrame* frame) {
+
+    if (frame == NULL)
+        return LIBVMI_INVALID_HANDLE;
+    libvMI_frame_handle hFrame = (libvMI_frame_handle)frame->getHandle();
+    tFrameSlot* slot = _frame_slot_get(hFrame);
+    if (slot == NULL || slot->frame.load(std::memory_order_relaxed) != frame)
+        return LIBVMI_INVALID_HANDLE;
+    return hFrame;
 }
 
 /**
@@ -327,11 +444,22 @@ void libvMI_get_parameter(VMIPARAMETER param, void* value) {
     try {
         switch (param) {
         case MAX_FRAMES_IN_LIST:
-            *static_cast<int*>(value) = g_vMIMaxFramesInList; break;
+            *static_cast<int*>(value) = g_vMIMaxFramesInList.load(); break;
         case CUR_FRAMES_IN_LIST:
-            *static_cast<int*>(value) = (int)g_vMIFramesArray.size(); break;
+            *static_cast<int*>(value) = g_vMIFramesCount.load(); break;
         case FREE_FRAMES_IN_LIST:
             *static_cast<int*>(value) = libvMI_get_free_frame_number(); break;
+        case ARENA_BYTES_RESERVED:
+        case ARENA_BYTES_IN_USE:
+        case ARENA_BYTES_HUGEPAGES:
+        case ARENA_FAULTS_AVOIDED: {
+            FrameArenaStats stats;
+            CFrameArena::getInstance()->getStats(&stats);
+            *static_cast<long long*>(value) = (param == ARENA_BYTES_RESERVED ? stats.bytesReserved :
+                param == ARENA_BYTES_IN_USE ? stats.bytesInUse :
+                param == ARENA_BYTES_HUGEPAGES ? stats.bytesHugePages : stats.faultsAvoided);
+            break;
+        }
         default:
             break;
         }
@@ -353,7 +481,9 @@ void libvMI_set_parameter(VMIPARAMETER param, void* value) {
     try {
         switch (param) {
         case MAX_FRAMES_IN_LIST:
-            g_vMIMaxFramesInList = *static_cast<int*>(value); break;
+            if (*static_cast<int*>(value) > FRAME_SLOT_MAX)
+                LOG_WARNING("MAX_FRAMES_IN_LIST limited to %d (requested %d)", FRAME_SLOT_MAX, *static_cast<int*>(value));
+            g_vMIMaxFramesInList = MIN(*static_cast<int*>(value), FRAME_SLOT_MAX); break;
         default:
             break;
         }
@@ -919,6 +1049,10 @@ int libvMI_close(const libvMI_module_handle hModule) {
     if (currentModule == NULL)
         return -1;
     currentModule->close();
+    FrameArenaStats stats;
+    CFrameArena::getInstance()->getStats(&stats);
+    LOG_INFO("frame arena: %lld bytes reserved (%lld on huge pages), %lld buffers given, %lld recycled, %lld page faults avoided",
+        stats.bytesReserved, stats.bytesHugePages, stats.allocations, stats.recycled, stats.faultsAvoided);
     delete g_Ip2VfModules[hModule];
     g_Ip2VfModules.erase(g_Ip2VfModules.begin() + hModule);
 	closeLog();
@@ -70,6 +70,10 @@ enum VMIPARAMETER {
     MAX_FRAMES_IN_LIST,    /*!< GET/SET Maximal number of frames on the internal frame list */
     CUR_FRAMES_IN_LIST,    /*!< GET     number of frames on the internal frame list */
     FREE_FRAMES_IN_LIST,   /*!< GET     number of frames on the internal frame list */
+    ARENA_BYTES_RESERVED,  /*!< GET     bytes of frame memory mapped by the frame arena (long long) */
+    ARENA_BYTES_IN_USE,    /*!< GET     bytes of frame memory given to the frames (long long) */
+    ARENA_BYTES_HUGEPAGES, /*!< GET     bytes of frame memory mapped on huge pages (long long) */
+    ARENA_FAULTS_AVOIDED,  /*!< GET     page faults avoided by recycling the frame buffers (long long) */
 };
 
 /**
@@ -111,6 +115,8 @@ enum MediaHeader {
     MEDIA_OUT_TIMESTAMP = 17, /*!< media timestamp */
     VIDEO_SMPTEFRMCODE  = 18, /*!< media format video only: SAMPLE parameter from the source stream */
     NAME_INFORMATION    = 19, /*!< name information from sender module */
+    MEDIA_LOST_PACKETS  = 20, /*!< nb of RTP packets lost in the frame: their data is missing or concealed */
+    MEDIA_LOST_MAP      = 21, /*!< bit i is set if the i-th 1/64 of the media payload contains lost data */
 };
 
 /**
@@ -327,6 +333,8 @@ VMILIBRARY_API char*  libvMI_get_frame_buffer(const libvMI_frame_handle hFrame);
 * <tr><td>MEDIA_OUT_TIMESTAMP  </td><td>unsigned long long      </td></tr>
 * <tr><td>VIDEO_SMPTEFRMCODE   </td><td>int                     </td></tr>
 * <tr><td>NAME_INFORMATION     </td><td>char*                   </td></tr>
+* <tr><td>MEDIA_LOST_PACKETS   </td><td>int                     </td></tr>
+* <tr><td>MEDIA_LOST_MAP       </td><td>unsigned long long      </td></tr>
 * </table>
 *
 * \param hFrame handle of the frame
@@ -360,6 +368,8 @@ VMILIBRARY_API void libvMI_get_frame_headers(const libvMI_frame_handle hFrame, M
 * <tr><td>MEDIA_OUT_TIMESTAMP  </td><td>unsigned long long      </td></tr>
 * <tr><td>VIDEO_SMPTEFRMCODE   </td><td>int                     </td></tr>
 * <tr><td>NAME_INFORMATION     </td><td>char*                   </td></tr>
+* <tr><td>MEDIA_LOST_PACKETS   </td><td>int                     </td></tr>
+* <tr><td>MEDIA_LOST_MAP       </td><td>unsigned long long      </td></tr>
 * </table>
 *
 * Note that setting some headers content as VIDEO_DEPTH, MEDIA_PAYLOAD_SIZE, VIDEO_WIDTH and VIDEO_HEIGHT effectively change
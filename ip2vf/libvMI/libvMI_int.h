@@ -20,6 +20,7 @@
 #include "vmiframe.h"
 
 CvMIFrame* libvMI_frame_get(const libvMI_frame_handle hFrame);
+libvMI_frame_handle libvMI_frame_get_handle(CvMIFrame* frame);
 int        libvMI_get_free_frame_number();
 
 #ifdef _WIN32
@@ -167,6 +167,8 @@ void CvMIModuleController::_parseAndInitModuleConfig() {
         if (m_zmqlogger != NULL) {
             auto input = inputStream->getInputManager();
             inputStream->getFrameCounter()->setZMQLogger(m_zmqlogger, pin_id);
+            inputStream->getFrameCounter()->setRxStats(input->getRxStats());
+            inputStream->getFrameCounter()->setSPSStats(input->getSPSStats());
             m_zmqlogger->setPinInfo(pin_id, (PinType)input->getType(), PinDirection::DIRECTION_INPUT, 5184128/*input->getVideoFrameSize()*/);
         }
     }
@@ -177,6 +179,7 @@ void CvMIModuleController::_parseAndInitModuleConfig() {
         if (m_zmqlogger != NULL) {
             auto output = outputStream->getOutputManager();
             outputStream->getFrameCounter()->setZMQLogger(m_zmqlogger, pin_id);
+            outputStream->getFrameCounter()->setTxStats(outputStream->getTxStats());
             m_zmqlogger->setPinInfo(pin_id, (PinType)output->getType(), PinDirection::DIRECTION_OUTPUT, 5184128/*output->getVideoFrameSize()*/);
         }
     }
@@ -6,13 +6,21 @@
 #include "libvMI_int.h"
 #include "vMI_output.h"
 
+static long long now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 CvMIOutput::CvMIOutput(const std::string &configurationString,
         libvMI_pin_handle handle, const void* user_data) :
         m_handle(handle), m_preconfig(configurationString), m_userData(
                 user_data), m_state(STATE_NOTINIT), m_inSync(false), m_syncTimestamp(0), m_syncClock(148500000),
-        m_name(0)
+        m_name(0), m_frameQueue(VMIOUTPUT_QUEUE_SIZE), m_preparedRing(COUT_STAGES), m_creditRing(COUT_STAGES)
 {
     m_Outframefactory = new CFrameHeaders();
+    std::memset(&m_txStats, 0, sizeof(m_txStats));
+    for (int i = 0; i < COUT_STAGES; i++)
+        m_creditRing.push(1);
 }
 
 CvMIOutput::~CvMIOutput()
@@ -50,8 +58,16 @@ int CvMIOutput::send(libvMI_frame_handle hFrame)
     libvMI_set_frame_headers(hFrame, NAME_INFORMATION, m_name);
 
     libvmi_frame_addref(hFrame);
-    auto newVal = std::make_pair(false, hFrame);
-    m_frameQueue.push(newVal);
+    bool pushed;
+    if (m_state == STATE_STARTED && !m_quit_process)
+        pushed = (m_frameQueue.push(hFrame) != RING_CLOSED);
+    else
+        pushed = m_frameQueue.tryPush(hFrame);
+    if (!pushed) {
+        // Not started, or stopping (queue closed): nobody to wait for, drop the frame
+        LOG("[%d] output not started, drop frame [%d]", m_handle, hFrame);
+        libvmi_frame_release(hFrame);
+    }
     return 0;
 }
 
@@ -151,13 +167,16 @@ void CvMIOutput::start()
         return;
     }
     m_quit_process = false;
+    m_frameQueue.reopen();
     m_th_process = std::thread( [this] { _process(); } );
+    m_th_transmit = std::thread( [this] { _transmit(); } );
 #ifndef WIN32
     sched_param sch_params;
     sch_params.sched_priority = 2;
-    LOG_INFO("[%d] change output thread priority to %d", m_handle, sch_params.sched_priority);
-    if (pthread_setschedparam(m_th_process.native_handle(), SCHED_FIFO, &sch_params)) {
-        LOG_ERROR("[%d] Failed to set Thread scheduling : %d", m_handle, std::strerror(errno) );
+    LOG_INFO("[%d] change output threads priority to %d", m_handle, sch_params.sched_priority);
+    if (pthread_setschedparam(m_th_process.native_handle(), SCHED_FIFO, &sch_params) ||
+        pthread_setschedparam(m_th_transmit.native_handle(), SCHED_FIFO, &sch_params)) {
+        LOG_ERROR("[%d] Failed to set Thread scheduling : %s", m_handle, std::strerror(errno) );
     }
 #endif
 
@@ -165,11 +184,71 @@ void CvMIOutput::start()
     LOG_INFO("[%d] <--", m_handle);
 }
 
+/*!
+* \fn _process
+* \brief prepare stage of the output pipeline: prepare each frame of the queue, when a buffer
+*        is available for it, and hand it over to the transmit stage
+*/
 void CvMIOutput::_process()
 {
     int count = 0;
     LOG_INFO("[%d] -->", m_handle);
 
+#ifndef WIN32
+    //Blocking all other signals
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+#endif
+
+    while (!m_quit_process && m_output != NULL)
+    {
+        LOG("[%d] iterate, c=%d", m_handle, count);
+
+        libvMI_frame_handle hFrame;
+        if (!m_frameQueue.pop(hFrame))
+        {
+            break;      // queue closed by stop()
+        }
+        if (hFrame == LIBVMI_INVALID_HANDLE) {
+            LOG_ERROR("Invalid handle...");
+            break;
+        }
+
+        // Wait for the transmission of the frame COUT_STAGES frames before
+        m_creditRing.pop();
+
+        vMIOutputItem item = { false, hFrame, 0, 0 };
+        long long start = now_us();
+        try {
+            CvMIFrame* frame = libvMI_frame_get(hFrame);
+            if (frame)
+                m_output->prepare(frame);
+        }
+        catch (...) {
+            LOG_ERROR("Catch exception on process() loop...");
+        }
+        item.prepared = now_us();
+        item.prepareTime = (int)(item.prepared - start);
+        m_preparedRing.push(item);
+    }
+
+    // Stop the transmit stage once it has sent the frames already prepared
+    vMIOutputItem quit = { true, LIBVMI_INVALID_HANDLE, 0, 0 };
+    m_preparedRing.push(quit);
+
+    LOG_INFO("[%d] <--", m_handle);
+}
+
+/*!
+* \fn _transmit
+* \brief transmit stage of the output pipeline: send each prepared frame, at the time given by
+*        its timestamp if the output is synchronized
+*/
+void CvMIOutput::_transmit()
+{
+    LOG_INFO("[%d] -->", m_handle);
+
 #ifndef WIN32
     //Blocking all other signals
     sigset_t mask;
@@ -179,78 +258,37 @@ void CvMIOutput::_process()
 
     if (m_output == NULL)
     {
-        LOG("[%d] No input configurate. exit.", m_handle, count);
+        LOG("[%d] No input configurate. exit.", m_handle);
         return;
     }
 
-    while (!m_quit_process)
+    while (true)
     {
-        LOG("[%d] iterate, c=%d", m_handle, count);
-
-        auto res = m_frameQueue.pop();
-        if (res.first)
-        {
+        vMIOutputItem item = m_preparedRing.pop();
+        if (item.quit)
             break;
-        }
-        else
-        {
-            if (res.second == LIBVMI_INVALID_HANDLE) {
-                LOG_ERROR("Invalid handle...");
-                break;
-            }
-            try {
-                CvMIFrame* frame = libvMI_frame_get(res.second);
-                if (frame) {
-                    if (m_inSync) {
-
-                        // keep frame number
-                        int framenumber = 0;
-                        frame->get_header(MEDIA_FRAME_NB, &framenumber);
-
-                        // Keep frame timestamp
-                        unsigned int frameTimestamp = 0;
-                        frame->get_header(MEDIA_TIMESTAMP, &frameTimestamp);
-
-                        // calculate real timestamp i.e timestamp that correspond to current time (warning, will loop)
-                        auto t = std::chrono::high_resolution_clock::now();
-                        std::chrono::duration<double, std::milli> elapsed = t - m_syncRefTime;
-                        unsigned int curTimestamp = m_syncTimestamp + (unsigned int)(elapsed.count()*(m_syncClock / 1000.0));
-                        int timeToWait = (frameTimestamp - curTimestamp);
-                        if (curTimestamp < m_oldClockTimestamp && frameTimestamp > m_oldFrameTimestamp) {
-                            // Clock timestamp loop, but not yet frame timestamp... be careful
-                            int oldTimeToWait = timeToWait;
-                            timeToWait = ULONG_MAX - frameTimestamp + curTimestamp;
-                            LOG_INFO("[%d] frame#%d, old timeToWait=%d, new=%d", m_handle, framenumber, oldTimeToWait, timeToWait);
-                        }
-                        //LOG_INFO("[%d] frame#%d, ref=%lu, cur=%lu, frame=%lu", m_handle, framenumber, m_syncTimestamp, curTimestamp, frameTimestamp);
-
-                        if (timeToWait > 0) {
-                            std::chrono::duration<double, std::milli> toWaitInMs (1000.0 * timeToWait / m_syncClock);
-                            //LOG_INFO("[%d] must wait %lu (%lums)", m_handle, toWait, (unsigned int)toWaitInMs.count());
-                            if (toWaitInMs.count() > 2000.0) {
-                                LOG_INFO("[%d] frame#%d, ref=%lu, cur=%lu, frame=%lu", m_handle, framenumber, m_syncTimestamp, curTimestamp, frameTimestamp);
-                                LOG_ERROR("[%d] frame#%d, must wait %d (%lums)", m_handle, framenumber, timeToWait, (unsigned int)toWaitInMs.count());
-                            }
-                            else 
-                                // Note: in case of compile error: C:\Program Files (x86)\Microsoft Visual Studio 14.0\VC\include\chrono(769): error C2679: binary '+=': no operator found which takes a right-hand operand of type 'const std::chrono::duration<double,std::milli>' (or there is no acceptable conversion) (compiling source file vMI_output.cpp)
-                                // Then ensure you running VS2015 Update 3. Upgrade if not.
-                                std::this_thread::sleep_for(toWaitInMs);
-                        }
-                        if (framenumber % 10 == 0)
-                            LOG("[%d] send frame #%d with timestamp %lu", m_handle, framenumber, frameTimestamp);
-                        m_oldClockTimestamp = curTimestamp;
-                        m_oldFrameTimestamp = frameTimestamp;
-                    }
-                    LOG("[%d] send frame [%d] frame ptr=0x%x, queue size=%d", m_handle, res.second, frame, m_frameQueue.size());
-                    m_output->send(frame);
-                    libvmi_frame_release(res.second);
-                }
-                }
-            catch (...) {
-                LOG_ERROR("Catch exception on process() loop...");
+        try {
+            CvMIFrame* frame = libvMI_frame_get(item.handle);
+            if (frame) {
+                if (m_inSync)
+                    _wait_sync(frame);
+                long long start = now_us();
+                LOG("[%d] send frame [%d] frame ptr=0x%x, queue size=%d", m_handle, item.handle, frame, m_frameQueue.size());
+                m_output->send(frame);
+                libvmi_frame_release(item.handle);
+                m_txStats.frames++;
+                m_txStats.prepareTime += item.prepareTime;
+                m_txStats.waitTime += (start > item.prepared ? start - item.prepared : 0);
+                m_txStats.transmitTime += now_us() - start;
             }
         }
+        catch (...) {
+            LOG_ERROR("Catch exception on transmit() loop...");
+        }
+        m_creditRing.push(1);
 
+        m_txStats.queueDepth = m_frameQueue.size();
+        m_txStats.ringDepth = m_preparedRing.size();
         m_counter.tick("");
     }
     m_state = STATE_STOPPED;
@@ -258,6 +296,53 @@ void CvMIOutput::_process()
     LOG_INFO("[%d] <--", m_handle);
 }
 
+/*!
+* \fn _wait_sync
+* \brief wait until the current time of the sync clock reaches the timestamp of the frame
+*
+* \param frame frame to send
+*/
+void CvMIOutput::_wait_sync(CvMIFrame* frame)
+{
+    // keep frame number
+    int framenumber = 0;
+    frame->get_header(MEDIA_FRAME_NB, &framenumber);
+
+    // Keep frame timestamp
+    unsigned int frameTimestamp = 0;
+    frame->get_header(MEDIA_TIMESTAMP, &frameTimestamp);
+
+    // calculate real timestamp i.e timestamp that correspond to current time (warning, will loop)
+    auto t = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = t - m_syncRefTime;
+    unsigned int curTimestamp = m_syncTimestamp + (unsigned int)(elapsed.count()*(m_syncClock / 1000.0));
+    int timeToWait = (frameTimestamp - curTimestamp);
+    if (curTimestamp < m_oldClockTimestamp && frameTimestamp > m_oldFrameTimestamp) {
+        // Clock timestamp loop, but not yet frame timestamp... be careful
+        int oldTimeToWait = timeToWait;
+        timeToWait = ULONG_MAX - frameTimestamp + curTimestamp;
+        LOG_INFO("[%d] frame#%d, old timeToWait=%d, new=%d", m_handle, framenumber, oldTimeToWait, timeToWait);
+    }
+    //LOG_INFO("[%d] frame#%d, ref=%lu, cur=%lu, frame=%lu", m_handle, framenumber, m_syncTimestamp, curTimestamp, frameTimestamp);
+
+    if (timeToWait > 0) {
+        std::chrono::duration<double, std::milli> toWaitInMs (1000.0 * timeToWait / m_syncClock);
+        //LOG_INFO("[%d] must wait %lu (%lums)", m_handle, toWait, (unsigned int)toWaitInMs.count());
+        if (toWaitInMs.count() > 2000.0) {
+            LOG_INFO("[%d] frame#%d, ref=%lu, cur=%lu, frame=%lu", m_handle, framenumber, m_syncTimestamp, curTimestamp, frameTimestamp);
+            LOG_ERROR("[%d] frame#%d, must wait %d (%lums)", m_handle, framenumber, timeToWait, (unsigned int)toWaitInMs.count());
+        }
+        else 
+            // Note: in case of compile error: C:\Program Files (x86)\Microsoft Visual Studio 14.0\VC\include\chrono(769): error C2679: binary '+=': no operator found which takes a right-hand operand of type 'const std::chrono::duration<double,std::milli>' (or there is no acceptable conversion) (compiling source file vMI_output.cpp)
+            // Then ensure you running VS2015 Update 3. Upgrade if not.
+            std::this_thread::sleep_for(toWaitInMs);
+    }
+    if (framenumber % 10 == 0)
+        LOG("[%d] send frame #%d with timestamp %lu", m_handle, framenumber, frameTimestamp);
+    m_oldClockTimestamp = curTimestamp;
+    m_oldFrameTimestamp = frameTimestamp;
+}
+
 void CvMIOutput::stop()
 {
     if (m_state != STATE_STARTED)
@@ -266,14 +351,27 @@ void CvMIOutput::stop()
                 m_handle);
         return;
     }
+    // Closing the queue wakes the prepare thread and the senders blocked on a full queue: their
+    // frames are released, and so are the ones left in the queue once the threads are stopped
     m_quit_process = true;
-    auto newVal = std::make_pair(true, LIBVMI_INVALID_HANDLE);
-    m_frameQueue.push(newVal);
+    m_frameQueue.close();
 
     if (m_th_process.joinable())
     {
         m_th_process.join();
     }
+    if (m_th_transmit.joinable())
+    {
+        m_th_transmit.join();
+    }
+    libvMI_frame_handle hFrame;
+    int dropped = 0;
+    while (m_frameQueue.tryPop(hFrame)) {
+        libvmi_frame_release(hFrame);
+        dropped++;
+    }
+    if (dropped > 0)
+        LOG_INFO("[%d] %d frames not sent, released", m_handle, dropped);
     m_state=STATE_STOPPED;
 
 }
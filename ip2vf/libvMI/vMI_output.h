@@ -5,12 +5,35 @@
 #include <string>
 #include <pins/pins.h>
 #include "common.h"
-#include "queue.h"
+#include "ringqueue.h"
 #include "moduleconfiguration.h"
 #include "tools.h"
 
 #include "libvMI.h"
 
+#define VMIOUTPUT_QUEUE_SIZE    16      /* frames queued on an output: beyond, libvMI_send() waits */
+
+/*
+* Frame of the output pipeline, from the prepare stage to the transmit stage
+*/
+struct vMIOutputItem {
+    bool                   quit;            /* last item, the pipeline is stopping */
+    libvMI_frame_handle    handle;
+    long long              prepared;        /* time the preparation of the frame ended, in µs */
+    int                    prepareTime;     /* time spent in the prepare stage, in µs */
+};
+
+/**********************************************************************************************
+*
+* CvMIOutput
+*
+* Output of a module. The frames are sent by a pipeline of two threads: the prepare thread
+* calls COut::prepare() (framing, CRC, copy of the headers and media in a single buffer) and
+* hands the frame over to the transmit thread through a SPSC ring, the transmit thread calls
+* COut::send(). Credits returned by the transmit thread limit the frames in the pipeline to
+* COUT_STAGES, the nb of buffers of prepared frames of the pins.
+*
+***********************************************************************************************/
 class CvMIOutput {
     int                    m_id;
     libvMI_pin_handle      m_handle;
@@ -22,9 +45,13 @@ class CvMIOutput {
     CFrameCounter          m_counter;
     const void*            m_userData;
     State                  m_state;
-    bool                   m_quit_process = false;
-    std::thread            m_th_process;
-    CQueue<std::pair <bool, libvMI_frame_handle> > m_frameQueue;
+    std::atomic<bool>      m_quit_process{false};
+    std::thread            m_th_process;    // prepare stage
+    std::thread            m_th_transmit;   // transmit stage
+    CMPSCRing<libvMI_frame_handle> m_frameQueue;   // frames to send, closed by stop()
+    CSPSCRing<vMIOutputItem> m_preparedRing;    // frames prepared, to transmit
+    CSPSCRing<int>         m_creditRing;    // frames transmitted, their buffer can be prepared again
+    vMITxStats             m_txStats;
     bool                   m_inSync;
     unsigned int           m_syncTimestamp;
     unsigned int           m_syncClock;     // In MHz
@@ -50,6 +77,10 @@ public:
         return &m_counter;
     }
 
+    inline const vMITxStats* getTxStats() {
+        return &m_txStats;
+    }
+
     inline CFrameHeaders * getFrameHeaders() {
         return m_Outframefactory;
     }
@@ -80,6 +111,10 @@ public:
 
     void _process();
 
+    void _transmit();
+
+    void _wait_sync(CvMIFrame* frame);
+
     void _enable_sync(bool flag);
 
 };
@@ -0,0 +1,101 @@
+#ifndef _BENCHTOOLS_H
+#define _BENCHTOOLS_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>      // strcmp
+#include <iostream>     // cout
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "tools.h"
+
+/*
+ * Scaffolding shared by the vMI_bench* tools: command line options with their usage, elapsed
+ * time, and the result line. A bench exits with 0 when its check passed, 1 otherwise.
+ */
+
+class CBenchOptions
+{
+    struct Option {
+        const char*  name;      // e.g. "-n"
+        const char*  arg;       // e.g. "<frames>", NULL for a flag
+        const char*  help;
+        int*         number;
+        const char** text;
+        bool*        flag;
+    };
+    std::vector<Option> _options;
+
+public:
+    void add(const char* name, const char* arg, int* value, const char* help) {
+        _options.push_back({ name, arg, help, value, NULL, NULL });
+    };
+    void add(const char* name, const char* arg, const char** value, const char* help) {
+        _options.push_back({ name, arg, help, NULL, value, NULL });
+    };
+    void add(const char* name, bool* value, const char* help) {
+        _options.push_back({ name, NULL, help, NULL, NULL, value });
+    };
+
+    void usage(const char* program) {
+        std::cout << "usage: " << program;
+        for (Option& o : _options)
+            std::cout << " [" << o.name << (o.arg ? " " : "") << (o.arg ? o.arg : "") << "]";
+        std::cout << "\n";
+        for (Option& o : _options) {
+            std::string option = std::string(o.name) + (o.arg ? " " : "") + (o.arg ? o.arg : "");
+            std::cout << "         " << option << std::string(option.size() < 19 ? 19 - option.size() : 1, ' ') << o.help << "\n";
+        }
+    };
+
+    /* Parse the command line, return false when the bench has to exit (usage or version displayed) */
+    bool parse(int argc, char* argv[]) {
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-v") == 0) {
+                tools::displayVersion();
+                return false;
+            }
+            Option* option = NULL;
+            for (Option& o : _options) {
+                if (strcmp(argv[i], o.name) == 0 && (o.arg == NULL || i + 1 < argc))
+                    option = &o;
+            }
+            if (option == NULL) {
+                usage(argv[0]);
+                return false;
+            }
+            if (option->number)
+                *option->number = atoi(argv[++i]);
+            else if (option->text)
+                *option->text = argv[++i];
+            else
+                *option->flag = true;
+        }
+        return true;
+    };
+};
+
+/* Elapsed time since the creation or the last restart */
+class CBenchTimer
+{
+    std::chrono::steady_clock::time_point _start;
+
+public:
+    CBenchTimer() : _start(std::chrono::steady_clock::now()) {};
+    void restart() { _start = std::chrono::steady_clock::now(); };
+    double seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count(); };
+};
+
+/* Print the result line of the bench, return its exit code */
+inline int benchResult(bool ok, const char* passed, const char* failed)
+{
+    if (ok)
+        printf("%s\n", passed);
+    else
+        printf("ERROR: %s\n", failed);
+    return (ok ? 0 : 1);
+}
+
+#endif //_BENCHTOOLS_H
@@ -0,0 +1,230 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>      // memcmp
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "benchtools.h"
+#include "log.h"
+
+using namespace std;
+
+#include "moduleconfiguration.h"
+#include "rtpframe.h"
+#include "pins/st2022/datasource.h"
+#include "pins/st2110/st2110frame.h"
+#include "pins/tr03/tr03frameparser.h"
+
+/*
+ * Check and benchmark of the SMPTE ST 2110-20 receive engine. Generated frames are assembled
+ * from packets in order, reordered and duplicated, then with a lost packet too: the frame must
+ * be complete and bit exact, except with the lost packet. Then the packets of a capture are
+ * loaded in memory, and assembled in frames as fast as possible, with CST2110FrameAssembler and
+ * with the TR-03 parser for reference.
+ */
+
+struct Packet {
+    const unsigned char* data;
+    int len;
+};
+
+struct Result {
+    double seconds;
+    unsigned long long packets;
+    unsigned long long bytes;
+    unsigned long long frames;
+};
+
+static void print_result(const char* name, const Result& r)
+{
+    double s = (r.seconds > 0 ? r.seconds : 1e-9);
+    printf("%-8s: %llu packets in %.3f s, %.3f Mpps, %.2f Gbps, %llu frames, %.1f fps\n", name, r.packets, r.seconds,
+        r.packets / s / 1e6, r.bytes * 8 / s / 1e9, r.frames, r.frames / s);
+}
+
+/* RFC 4175 packets of a progressive frame, one sample row data each, the last one with the marker */
+static vector<vector<unsigned char>> make_packets(const vector<unsigned char>& frame, int lineSize, int height, int pgroupSize,
+    unsigned int firstSeq, unsigned int timestamp)
+{
+    vector<vector<unsigned char>> packets;
+    int chunk = 1200 / pgroupSize * pgroupSize;
+    unsigned int seq = firstSeq;
+    for (int line = 0; line < height; line++) {
+        for (int offset = 0; offset < lineSize; offset += chunk, seq++) {
+            int length = std::min(chunk, lineSize - offset);
+            int pixel = offset / pgroupSize * 2;
+            bool marker = (line == height - 1 && offset + length == lineSize);
+            unsigned char header[RTP_HEADERS_LENGTH + ST2110_EXT_SEQ_LENGTH + ST2110_SRD_HEADER_LENGTH] = {
+                0x80, (unsigned char)(ST2110_PAYLOAD_TYPE | (marker ? 0x80 : 0)), (unsigned char)(seq >> 8), (unsigned char)seq,
+                (unsigned char)(timestamp >> 24), (unsigned char)(timestamp >> 16), (unsigned char)(timestamp >> 8), (unsigned char)timestamp,
+                0, 0, 0, 1,
+                (unsigned char)(seq >> 24), (unsigned char)(seq >> 16),
+                (unsigned char)(length >> 8), (unsigned char)length, (unsigned char)(line >> 8), (unsigned char)line,
+                (unsigned char)(pixel >> 8), (unsigned char)pixel,
+            };
+            vector<unsigned char> packet(header, header + sizeof(header));
+            packet.insert(packet.end(), frame.begin() + line * lineSize + offset, frame.begin() + line * lineSize + offset + length);
+            packets.push_back(packet);
+        }
+    }
+    return packets;
+}
+
+/* Assemble a frame from the packets, return true if it is complete and bit exact */
+static bool check_st2110(const char* name, const vector<vector<unsigned char>>& packets, const vector<unsigned char>& ref,
+    CST2110FrameAssembler& assembler, bool expectComplete)
+{
+    vector<unsigned char> frame(ref.size(), 0);
+    bool complete = false;
+    assembler.resync();
+    assembler.beginFrame(frame.data(), (int)frame.size());
+    for (const vector<unsigned char>& p : packets) {
+        if (assembler.addPacket(p.data(), (int)p.size()) == ST2110_PACKET_END_OF_FRAME)
+            complete = assembler.isComplete();
+    }
+    bool exact = (memcmp(frame.data(), ref.data(), ref.size()) == 0);
+    printf("%-28s: %d packets, frame %s%s\n", name, (int)packets.size(), complete ? "complete" : "incomplete",
+        complete ? (exact ? " and bit exact" : " but NOT bit exact") : "");
+    return (complete == expectComplete && (!complete || exact));
+}
+
+/* Frames in order, reordered and duplicated, then with a lost packet, return the nb of failed cases */
+static int check_st2110(int w, int h, int fmt)
+{
+    CST2110FrameAssembler assembler;
+    if (assembler.init(w, h, fmt, false) != VMI_E_OK)
+        return 1;
+    vector<unsigned char> ref(assembler.getFrameSize());
+    for (size_t i = 0; i < ref.size(); i++)
+        ref[i] = (unsigned char)rand();
+    int lineSize = assembler.getFrameSize() / h;
+    vector<vector<unsigned char>> packets = make_packets(ref, lineSize, h, assembler.getPgroupSize(), 0xFFFFFF00, 90000);
+    int errors = 0;
+    if (!check_st2110("in order", packets, ref, assembler, true))
+        errors++;
+
+    // Swap neighbour packets, and repeat some packets later in the frame, the marker staying last
+    vector<vector<unsigned char>> swapped(packets.begin(), packets.end() - 1);
+    for (size_t i = 0; i + 1 < swapped.size(); i += 7)
+        std::swap(swapped[i], swapped[i + 1]);
+    vector<vector<unsigned char>> reordered = swapped;
+    for (size_t i = 0; i < packets.size() - 1; i += 97)
+        reordered.insert(reordered.begin() + std::min(reordered.size(), i + 40), packets[i]);
+    reordered.push_back(packets.back());
+    if (!check_st2110("reordered, duplicated", reordered, ref, assembler, true))
+        errors++;
+
+    // Then lose a packet, and repeat late another one of the same size: the frame must not be complete
+    size_t lost = packets.size() / 2;
+    while (lost + 1 < packets.size() && packets[lost].size() != packets[0].size())
+        lost++;
+    vector<vector<unsigned char>> lossy;
+    for (const vector<unsigned char>& p : swapped) {
+        if (p != packets[lost])
+            lossy.push_back(p);
+    }
+    lossy.insert(lossy.begin() + lost + 40, packets[0]);
+    lossy.push_back(packets.back());
+    if (!check_st2110("reordered, duplicated, lost", lossy, ref, assembler, false))
+        errors++;
+    return errors;
+}
+
+static Result bench_st2110(const vector<Packet>& packets, int loops, int w, int h, int fmt, bool interlaced)
+{
+    Result r = { 0, 0, 0, 0 };
+    CST2110FrameAssembler assembler;
+    if (assembler.init(w, h, fmt, interlaced) != VMI_E_OK)
+        return r;
+    vector<unsigned char> frame(assembler.getFrameSize());
+
+    CBenchTimer timer;
+    assembler.beginFrame(frame.data(), (int)frame.size());
+    for (int l = 0; l < loops; l++) {
+        // The sequence numbers restart with the capture
+        assembler.resync();
+        for (const Packet& p : packets) {
+            int result = assembler.addPacket(p.data, p.len);
+            if (result == ST2110_PACKET_NEXT_FRAME) {
+                assembler.beginFrame(frame.data(), (int)frame.size());
+                result = assembler.addPacket(p.data, p.len);
+            }
+            if (result == ST2110_PACKET_END_OF_FRAME) {
+                if (assembler.isComplete())
+                    r.frames++;
+                assembler.beginFrame(frame.data(), (int)frame.size());
+            }
+            r.bytes += p.len;
+        }
+        r.packets += packets.size();
+    }
+    r.seconds = timer.seconds();
+
+    const ST2110RxStats* stats = assembler.getStats();
+    printf("st2110  : %llu sample row data, %llu lost packets, %llu invalid packets, %llu incomplete frames\n",
+        stats->srds, stats->lostPackets, stats->invalidPackets, stats->incompleteFrames);
+    return r;
+}
+
+static Result bench_tr03(const vector<Packet>& packets, int loops, int w, int h, int fmt)
+{
+    Result r = { 0, 0, 0, 0 };
+    CTR03FrameParser parser(w, h, 2 * fmt, w * h * 2 * fmt / 8);
+    parser.resetFrame();
+
+    CBenchTimer timer;
+    for (int l = 0; l < loops; l++) {
+        for (const Packet& p : packets) {
+            CRTPFrame frame(p.data, p.len);
+            parser.addRtpFrame(&frame, [&]() { r.frames++; });
+            r.bytes += p.len;
+        }
+        r.packets += packets.size();
+    }
+    r.seconds = timer.seconds();
+    return r;
+}
+
+int main(int argc, char* argv[]) {
+    const char* filename = NULL;
+    int w = 1920, h = 1080, fmt = 10, port = -1, loops = 10;
+    bool interlaced = false;
+    bool notr03 = false;
+
+    CBenchOptions options;
+    options.add("-f", "<capture.pcap>", &filename, "pcap or pcapng recording of a 2110-20 stream to benchmark");
+    options.add("-w", "<width>", &w, "frame width (default 1920)");
+    options.add("-h", "<height>", &h, "frame height (default 1080)");
+    options.add("-fmt", "<8|10|12>", &fmt, "bits per component (default 10)");
+    options.add("-i", &interlaced, "interlaced stream");
+    options.add("-p", "<dst port>", &port, "keep only the packets of this UDP destination port");
+    options.add("-n", "<loops>", &loops, "nb of times the capture is processed (default 10)");
+    options.add("-notr03", &notr03, "don't run the TR-03 parser for reference");
+    if (!options.parse(argc, argv))
+        return 0;
+
+    setLogLevel(LOG_LEVEL_WARNING);
+    bool ok = (check_st2110(w, h, fmt) == 0);
+    if (filename != NULL) {
+        // Load the packets of the capture (kept in the file mapping)
+        char config[1024];
+        snprintf(config, sizeof(config), "id=1,name=vMI_bench2110,loglevel=1,in_type=st2110,filename=%s,speed=0,loop=0,dstport=%d", filename, port);
+        CModuleConfiguration cfg(config);
+        CPcapDataSource source;
+        source.init(&cfg._in[0]);
+        vector<Packet> packets;
+        const char* data;
+        int len;
+        while ((len = source.nextPacket(&data)) > 0)
+            packets.push_back({ (const unsigned char*)data, len });
+        printf("%d packets loaded from '%s', %dx%d%s %d bits, %d loops\n", (int)packets.size(), filename, w, h, interlaced ? "i" : "p", fmt, loops);
+        if (packets.empty())
+            return 1;
+
+        print_result("st2110", bench_st2110(packets, loops, w, h, fmt, interlaced));
+        if (!notr03)
+            print_result("tr03", bench_tr03(packets, loops, w, h, fmt));
+    }
+    return benchResult(ok, "frames complete and bit exact unless a packet is lost", "wrong frame completion");
+}
@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>      // strcmp
+#include <cmath>
+#include <iostream>     // cout
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "common.h"
+#include "tools.h"
+#include "log.h"
+#include "framecodec.h"
+#include "workerpool.h"
+
+using namespace std;
+
+/*
+ * Benchmark of the frame codec of the rtp pins (codec=dpcm): compression ratio, encoding and
+ * decoding time of recorded frames (raw media back to back, as written by the file output pin),
+ * or of synthetic frames (bars, gradients and noise). Each frame is decoded and compared with
+ * the source: the codec is lossless.
+ */
+
+class CBench
+{
+public:
+    /* Synthetic frame: color bars on the left, moving gradient on the right, and noise */
+    static void synthetic(vector<unsigned char>& media, int w, int h, SAMPLINGFMT fmt, int depth, int noise, int index)
+    {
+        int period = (fmt == SAMPLINGFMT::YCbCr_4_2_2 ? 2 : (fmt == SAMPLINGFMT::RGB || fmt == SAMPLINGFMT::BGR ? 3 : 4));
+        int n = w * period;
+        int maxv = (1 << depth) - 1;
+        int lineSize = (int)(media.size() / h);
+        vector<int> samples(n);
+        for (int y = 0; y < h; y++) {
+            for (int i = 0; i < n; i++) {
+                double v = (i < n / 2) ? ((i * 8 / n) * 0.12 + 0.1) : (0.5 + 0.4 * sin(i * 0.003 + y * 0.01 + index * 0.05));
+                int s = (int)(v * maxv) + (noise > 0 ? rand() % (2 * noise + 1) - noise : 0);
+                samples[i] = (s < 0 ? 0 : (s > maxv ? maxv : s));
+            }
+            unsigned char* p = media.data() + (size_t)y * lineSize;
+            if (depth == 8) {
+                for (int i = 0; i < n; i++)
+                    p[i] = (unsigned char)samples[i];
+            }
+            else {
+                // 10 bits, big endian: 4 samples in 5 bytes
+                for (int i = 0; i + 3 < n; i += 4, p += 5) {
+                    unsigned long long v = ((unsigned long long)samples[i] << 30) | ((unsigned long long)samples[i + 1] << 20)
+                        | ((unsigned long long)samples[i + 2] << 10) | (unsigned long long)samples[i + 3];
+                    for (int b = 0; b < 5; b++)
+                        p[b] = (unsigned char)(v >> (32 - 8 * b));
+                }
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int w = 1920, h = 1080, depth = 10, fmt = (int)SAMPLINGFMT::YCbCr_4_2_2, slices = FRAMECODEC_DEFAULT_SLICES;
+    int workers = -1, frames = 50, noise = 2;
+    const char* input = NULL;
+
+    // Check parameters
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            w = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+            h = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            fmt = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            slices = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-z") == 0 && i + 1 < argc) {
+            noise = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            tools::displayVersion();
+            return 0;
+        } else {
+            std::cout << "usage: " << argv[0] << " [-i <file>] [-w <width>] [-h <height>] [-d <depth>] [-f <format>] [-s <slices>] [-p <workers>] [-n <frames>] [-z <noise>]\n";
+            std::cout << "         -i <file>          recorded frames, raw media back to back (default: synthetic frames)\n";
+            std::cout << "         -w <width>         width of the frames (default 1920)\n";
+            std::cout << "         -h <height>        height of the frames (default 1080)\n";
+            std::cout << "         -d <depth>         bits per component, 8 or 10 (default 10)\n";
+            std::cout << "         -f <format>        SAMPLINGFMT: 1=RGB, 2=RGBA, 3=BGR, 4=BGRA, 6=YCbCr 4:2:2 (default 6)\n";
+            std::cout << "         -s <slices>        slices per frame (default 16)\n";
+            std::cout << "         -p <workers>       nb of workers (default: one per core)\n";
+            std::cout << "         -n <frames>        max nb of frames (default 50)\n";
+            std::cout << "         -z <noise>         amplitude of the noise of the synthetic frames (default 2)\n";
+            std::cout << "       VMI_SIMD=scalar in the environment disables the SIMD kernels\n";
+            return 0;
+        }
+    }
+    if (frames <= 0)
+        return 1;
+
+    setLogLevel(LOG_LEVEL_WARNING);
+    CWorkerPool::getInstance()->configure(workers, "");
+    CFrameCodec codec;
+    if (codec.configure(w, h, (SAMPLINGFMT)fmt, depth, slices) != VMI_E_OK) {
+        printf("unsupported frames: %dx%d, format %d, %d bits\n", w, h, fmt, depth);
+        return 1;
+    }
+    int mediaSize = codec.getMediaSize();
+
+    // Frames to code
+    vector<vector<unsigned char>> sources;
+    if (input != NULL) {
+        std::ifstream file(input, std::ios::binary);
+        if (!file) {
+            printf("can't open '%s'\n", input);
+            return 1;
+        }
+        vector<unsigned char> media(mediaSize);
+        while ((int)sources.size() < frames && file.read((char*)media.data(), mediaSize))
+            sources.push_back(media);
+        if (sources.empty()) {
+            printf("no frame of %d bytes in '%s'\n", mediaSize, input);
+            return 1;
+        }
+    }
+    else {
+        srand(1);
+        for (int i = 0; i < frames; i++) {
+            sources.push_back(vector<unsigned char>(mediaSize));
+            CBench::synthetic(sources.back(), w, h, (SAMPLINGFMT)fmt, depth, noise, i);
+        }
+    }
+    printf("%d frames %dx%d, format %d, %d bits, %d bytes, %d slices, %s\n", (int)sources.size(), w, h, fmt, depth,
+        mediaSize, slices, (input != NULL ? input : "synthetic"));
+
+    vector<unsigned char> coded(codec.getMaxCodedSize());
+    vector<unsigned char> decoded(mediaSize);
+    double encoding = 0, decoding = 0;
+    long long raw = 0, compressed = 0;
+    int errors = 0;
+    for (vector<unsigned char>& source : sources) {
+        int codedSize = 0;
+        auto start = std::chrono::steady_clock::now();
+        if (codec.encode(source.data(), mediaSize, coded.data(), (int)coded.size(), &codedSize) != VMI_E_OK) {
+            errors++;
+            continue;
+        }
+        auto middle = std::chrono::steady_clock::now();
+        int result = codec.decode(coded.data(), codedSize, decoded.data(), mediaSize);
+        auto end = std::chrono::steady_clock::now();
+        encoding += std::chrono::duration<double>(middle - start).count();
+        decoding += std::chrono::duration<double>(end - middle).count();
+        if (result != VMI_E_OK || decoded != source)
+            errors++;
+        raw += mediaSize;
+        compressed += codedSize;
+    }
+    int n = (int)sources.size();
+    printf("ratio:    %.2f (%.1f%% of the media)\n", (double)raw / compressed, 100.0 * compressed / raw);
+    printf("encoding: %.2f ms/frame, %.0f MB/s\n", encoding * 1e3 / n, raw / encoding / 1e6);
+    printf("decoding: %.2f ms/frame, %.0f MB/s\n", decoding * 1e3 / n, raw / decoding / 1e6);
+    printf("%s\n", errors == 0 ? "all the frames decoded bit exact" : "ERROR: frames not decoded bit exact");
+    return (errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>      // memcmp
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "benchtools.h"
+#include "log.h"
+
+using namespace std;
+
+/*
+ * Check and throughput of the 10/8 bits conversion kernels: for each instruction set level
+ * (capped with VMI_SIMD, in a child process as the kernels are selected once per process), the
+ * dispatched conversions must be bit-exact with the scalar reference, for any size, alignment,
+ * in place, and on frame sizes splitted in slices. Gives then the throughput in GB/s of the input
+ * on 1080p and 2160p 4:2:2 10 bits frames.
+ */
+
+class CBench
+{
+public:
+    /* Compare the dispatched conversions with the scalar ones, return the nb of mismatches */
+    static int check()
+    {
+        int errors = 0;
+        vector<unsigned char> in(3840 * 2160 * 5 / 2 / 4 * 5 + 128), out(in.size()), ref(in.size());
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = (unsigned char)rand();
+
+        // Every size up to 2000 groups, with a tail and an unaligned start, then frame sizes
+        vector<int> sizes;
+        for (int n = 0; n < 2000 * 5; n += 1 + rand() % 11)
+            sizes.push_back(n);
+        sizes.push_back(1920 * 1080 * 5 / 2);
+        sizes.push_back(3840 * 2160 * 5 / 2);
+        for (int size : sizes) {
+            int offset = rand() % 32;
+            size_t used = offset + size / 4 * 5 + 64;
+            std::fill(out.begin(), out.begin() + used, 0xa5);
+            std::fill(ref.begin(), ref.begin() + used, 0xa5);
+            tools::convert10bitsto8bits(in.data() + offset, size, out.data() + offset);
+            tools::convert10bitsto8bitsScalar(in.data() + offset, size, ref.data() + offset);
+            if (memcmp(out.data(), ref.data(), offset + size) != 0) {
+                printf("  10 to 8 bits: mismatch for %d bytes at offset %d\n", size, offset);
+                errors++;
+            }
+            std::fill(out.begin(), out.begin() + used, 0xa5);
+            std::fill(ref.begin(), ref.begin() + used, 0xa5);
+            tools::convert8bitsto10bits(in.data() + offset, size, out.data() + offset);
+            tools::convert8bitsto10bitsScalar(in.data() + offset, size, ref.data() + offset);
+            if (memcmp(out.data(), ref.data(), used) != 0) {
+                printf("  8 to 10 bits: mismatch for %d bytes at offset %d\n", size, offset);
+                errors++;
+            }
+            // In place, as vMI_converter does
+            memcpy(out.data(), in.data(), size);
+            tools::convert10bitsto8bits(out.data(), size, out.data());
+            tools::convert10bitsto8bitsScalar(in.data(), size, ref.data());
+            if (memcmp(out.data(), ref.data(), size / 5 * 4) != 0) {
+                printf("  10 to 8 bits in place: mismatch for %d bytes\n", size);
+                errors++;
+            }
+        }
+        return errors;
+    }
+
+    /* Throughput of a conversion of size bytes, in GB/s of the input */
+    static double throughput(int (*convert)(unsigned char*, int, unsigned char*), int size, int iterations)
+    {
+        vector<unsigned char> in(size), out(size / 4 * 5 + 64);
+        for (int i = 0; i < size; i++)
+            in[i] = (unsigned char)rand();
+        convert(in.data(), size, out.data());
+        CBenchTimer timer;
+        for (int i = 0; i < iterations; i++)
+            convert(in.data(), size, out.data());
+        return (double)size * iterations / timer.seconds() / 1e9;
+    }
+
+    /* Check and measure the kernels of a level, return the nb of mismatches */
+    static int run(const char* level, int iterations)
+    {
+        if (level != NULL)
+            setenv("VMI_SIMD", level, 1);
+        else
+            unsetenv("VMI_SIMD");
+        int errors = check();
+        printf("%-8s: kernels %s, %s\n", level != NULL ? level : "best", tools::getConvertKernelName(),
+            errors == 0 ? "bit-exact with the scalar version" : "ERROR: mismatches with the scalar version");
+
+        const struct { const char* name; int size; } frames[] = {
+            { "1080p", 1920 * 1080 * 5 / 2 },
+            { "2160p", 3840 * 2160 * 5 / 2 },
+        };
+        for (auto& frame : frames) {
+            printf("          %s: 10 to 8 bits %6.2f GB/s (scalar %5.2f GB/s), 8 to 10 bits %6.2f GB/s (scalar %5.2f GB/s)\n", frame.name,
+                throughput(tools::convert10bitsto8bits, frame.size, iterations),
+                throughput(tools::convert10bitsto8bitsScalar, frame.size, iterations),
+                throughput(tools::convert8bitsto10bits, frame.size / 5 * 4, iterations),
+                throughput(tools::convert8bitsto10bitsScalar, frame.size / 5 * 4, iterations));
+        }
+        fflush(stdout);
+        return errors;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int iterations = 50;
+
+    CBenchOptions options;
+    options.add("-n", "<iterations>", &iterations, "conversions per frame size and kernel (default 50)");
+    if (!options.parse(argc, argv))
+        return 0;
+    if (iterations <= 0)
+        return 1;
+
+    setLogLevel(LOG_LEVEL_WARNING);
+    const char* levels[] = { "scalar", "sse4.1", "avx2", NULL };
+    bool ok = true;
+    for (const char* level : levels) {
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(CBench::run(level, iterations) == 0 ? 0 : 1);
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ok = false;
+    }
+    return benchResult(ok, "all the kernels bit-exact with the scalar version", "kernels not bit-exact with the scalar version");
+}
@@ -0,0 +1,198 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "benchtools.h"
+#include "log.h"
+#include "workerpool.h"
+#include "pins/st2022/smptecrc.h"
+#include "pins/st2022/smpteframe.h"
+
+using namespace std;
+
+/*
+ * Check and throughput of the SMPTE line CRC (ST 292-1, CRC(X) = X^18 + X^5 + X^4 + 1): the
+ * CRC engines of CSMPTPCrc must give the known CRC of reference vectors, and the same CRC as a
+ * bit-serial implementation of the polynomial on random lines. Then video content is inserted
+ * in a 1080i frame with the CRC computation on, without worker then on the worker pool (in a
+ * child process each, as the pool is configured once per process): the CRC words of every line
+ * are checked, and the insertion is timed with and without the CRC computation.
+ */
+
+class CBench
+{
+public:
+    /* Bit-serial CRC of 10 bits words, LSB first, straight from the polynomial */
+    static unsigned int reference(const vector<unsigned int>& words)
+    {
+        unsigned int crc = 0;
+        for (unsigned int word : words) {
+            for (int bit = 0; bit < 10; bit++) {
+                unsigned int feedback = (crc ^ (word >> bit)) & 1;
+                crc >>= 1;
+                if (feedback)
+                    crc ^= (1 << 17) | (1 << 13) | (1 << 12);     // X^0, X^4, X^5 taps
+            }
+        }
+        return crc;
+    }
+
+    /* CRC of one channel with compute_crc18_scanline(), given the xCR0/xCR1 words */
+    static unsigned int scanline(const vector<unsigned int>& words)
+    {
+        vector<unsigned char> buffer((words.size() * 10 + 7) / 8 + 8, 0);
+        for (size_t i = 0; i < words.size(); i++)
+            tools::set10bitsWord(buffer.data(), (int)i, words[i]);
+        CSMPTPCrc crc;
+        crc.compute_crc18_scanline(buffer.data(), (unsigned int)words.size(), 0, 1);
+        return (crc.getCRC0() & 0x1FF) | ((crc.getCRC1() & 0x1FF) << 9);
+    }
+
+    /* CRCs of two channels with compute_crc18_interleaved() */
+    static void interleaved(const vector<unsigned int>& c, const vector<unsigned int>& y, unsigned int* crcC, unsigned int* crcY)
+    {
+        vector<unsigned char> buffer((c.size() * 20 + 7) / 8 + 8, 0);
+        for (size_t i = 0; i < c.size(); i++) {
+            tools::set10bitsWord(buffer.data(), (int)i * 2, c[i]);
+            tools::set10bitsWord(buffer.data(), (int)i * 2 + 1, y[i]);
+        }
+        CSMPTPCrc crc0, crc1;
+        CSMPTPCrc::compute_crc18_interleaved(buffer.data(), (unsigned int)c.size(), crc0, crc1);
+        *crcC = (crc0.getCRC0() & 0x1FF) | ((crc0.getCRC1() & 0x1FF) << 9);
+        *crcY = (crc1.getCRC0() & 0x1FF) | ((crc1.getCRC1() & 0x1FF) << 9);
+    }
+
+    /* Check the engines on the known vectors then on random lines, return the nb of errors */
+    static int checkVectors()
+    {
+        int errors = 0;
+        vector<unsigned int> ramp;
+        for (unsigned int i = 0; i < 1024; i++)
+            ramp.push_back(i);
+        const struct { const char* name; vector<unsigned int> words; unsigned int crc; } vectors[] = {
+            { "empty",                      {},                                     0x00000 },
+            { "0x3FF",                      { 0x3FF },                              0x3df08 },
+            { "EAV",                        { 0x3FF, 0x000, 0x000, 0x274 },         0x358ed },
+            { "1926 black C words",         vector<unsigned int>(1926, 0x200),      0x0f9ff },
+            { "1926 black Y words",         vector<unsigned int>(1926, 0x040),      0x3bb3f },
+            { "ramp 0 to 1023",             ramp,                                   0x3f275 },
+        };
+        for (auto& v : vectors) {
+            unsigned int ref = reference(v.words), crc = scanline(v.words), crcC, crcY;
+            interleaved(v.words, v.words, &crcC, &crcY);
+            if (ref != v.crc || crc != v.crc || crcC != v.crc || crcY != v.crc) {
+                printf("  %s: CRC %05x, expected %05x (bit-serial %05x, interleaved %05x/%05x)\n", v.name, crc, v.crc, ref, crcC, crcY);
+                errors++;
+            }
+        }
+        for (int n = 0; n < 2000; n += 1 + rand() % 7) {
+            vector<unsigned int> c(n), y(n);
+            for (int i = 0; i < n; i++) {
+                c[i] = rand() & 0x3FF;
+                y[i] = rand() & 0x3FF;
+            }
+            unsigned int crcC, crcY;
+            interleaved(c, y, &crcC, &crcY);
+            if (scanline(c) != reference(c) || crcC != reference(c) || crcY != reference(y)) {
+                printf("  random line of %d words: CRC differs from the bit-serial one\n", n);
+                errors++;
+            }
+        }
+        return errors;
+    }
+
+    /* Check the CRC words of every line with the bit-serial CRC, return the nb of wrong lines */
+    static int checkFrame(CSMPTPProfile* profile, unsigned char* frame)
+    {
+        int errors = 0;
+        int nbWords = profile->getActiveWidth() + 6;
+        for (int i = 0; i < profile->getScanlinesNb() - 1; i++) {
+            unsigned char* p = frame + i * profile->getScanlineSize() + profile->getXOffset();
+            vector<unsigned int> c(nbWords), y(nbWords);
+            for (int j = 0; j < nbWords; j++) {
+                c[j] = tools::get10bitsWord(p, j * 2);
+                y[j] = tools::get10bitsWord(p, j * 2 + 1);
+            }
+            unsigned int crcC = reference(c), crcY = reference(y);
+            unsigned char* next = frame + (i + 1) * profile->getScanlineSize();
+            unsigned int words[4] = { crcC & 0x1FF, crcY & 0x1FF, crcC >> 9, crcY >> 9 };
+            for (int k = 0; k < 4; k++) {
+                words[k] |= ((~words[k] >> 8) & 1) << 9;
+                if ((unsigned int)tools::get10bitsWord(next, 12 + k) != words[k]) {
+                    errors++;
+                    break;
+                }
+            }
+        }
+        return errors;
+    }
+
+    /* Insert video content in a 1080i frame with its CRCs, check and time it, return the nb of errors */
+    static int run(int workers, int frames)
+    {
+        CWorkerPool::getInstance()->configure(workers, "");
+        CSMPTPFrame smpte;
+        smpte.initNewFrame();
+        smpte.setProfile("1080i59.94");
+        smpte.prepareFrame();
+        CSMPTPProfile* profile = smpte.getProfile();
+        unsigned char* frame = smpte.getBuffer();
+        vector<char> video(profile->getActiveWidth() * profile->getActiveHeight() * 5 / 2);
+        for (size_t i = 0; i < video.size(); i++)
+            video[i] = (char)rand();
+
+        // Clear the CRC words first, so that the check only sees the ones of the insertion
+        for (int i = 1; i < profile->getScanlinesNb(); i++) {
+            for (int k = 12; k < 16; k++)
+                tools::set10bitsWord(frame + i * profile->getScanlineSize(), k, 0);
+        }
+        smpte.setComputeCRC(true);
+        smpte.insertVideoContentToSMPTEFrame(video.data());
+        int wrongLines = checkFrame(profile, frame);
+
+        CBenchTimer timer;
+        for (int i = 0; i < frames; i++)
+            smpte.insertVideoContentToSMPTEFrame(video.data());
+        double withCRC = timer.seconds();
+        smpte.setComputeCRC(false);
+        timer.restart();
+        for (int i = 0; i < frames; i++)
+            smpte.insertVideoContentToSMPTEFrame(video.data());
+        double withoutCRC = timer.seconds();
+        printf("%d workers: %d lines, CRCs in %.3f ms per frame (insertion %.3f ms), %d lines with a wrong CRC\n",
+            CWorkerPool::getInstance()->getNbWorkers(), profile->getScanlinesNb() - 1, (withCRC - withoutCRC) * 1000 / frames,
+            withCRC * 1000 / frames, wrongLines);
+        fflush(stdout);
+        return wrongLines;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int workers = -1, frames = 100;
+
+    CBenchOptions options;
+    options.add("-p", "<workers>", &workers, "nb of workers of the pool (default: one per 2 cores, up to 8)");
+    options.add("-n", "<frames>", &frames, "nb of frames inserted (default 100)");
+    if (!options.parse(argc, argv))
+        return 0;
+    if (frames <= 0)
+        return 1;
+
+    setLogLevel(LOG_LEVEL_WARNING);
+    int errors = CBench::checkVectors();
+    printf("vectors:  %s\n", errors == 0 ? "known CRCs and bit-serial CRCs matched" : "ERROR: wrong CRCs");
+    fflush(stdout);
+
+    const int pools[] = { 0, workers };
+    for (int nbWorkers : pools) {
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(CBench::run(nbWorkers, frames) == 0 ? 0 : 1);
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            errors++;
+    }
+    return benchResult(errors == 0, "all the CRCs matched", "wrong CRCs");
+}
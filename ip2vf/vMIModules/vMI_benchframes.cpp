@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <vector>
+#include <thread>
+
+#include "benchtools.h"
+#include "log.h"
+#include "libvMI.h"
+#include "libvMI_int.h"
+
+using namespace std;
+
+/*
+ * Contention benchmark of the frame handle table of libvMI: several threads create, look up,
+ * reference and release frames as fast as possible, each one keeping a few frames alive. Gives
+ * the cost of a create/get/get_handle/addref/release/release cycle, and checks that every handle
+ * is found while referenced, also from its frame, and no more once released, even when its slot
+ * has been reused.
+ */
+
+class CBench
+{
+public:
+    unsigned long long  cycles;
+    unsigned long long  errors;
+    double              seconds;
+
+    CBench() : cycles(0), errors(0), seconds(0) {};
+
+    void run(int iterations, int hold)
+    {
+        vector<libvMI_frame_handle> held(hold, LIBVMI_INVALID_HANDLE);
+        CBenchTimer timer;
+        for (int i = 0; i < iterations; i++) {
+            libvMI_frame_handle h = libvmi_frame_create();
+            if (h == LIBVMI_INVALID_HANDLE) {
+                errors++;
+                continue;
+            }
+            CvMIFrame* frame = libvMI_frame_get(h);
+            if (frame == NULL || libvMI_frame_get_handle(frame) != h)
+                errors++;
+            if (libvmi_frame_addref(h) != 2 || libvmi_frame_release(h) != 1)
+                errors++;
+
+            // Keep the frame alive for a while, and release the oldest one
+            libvMI_frame_handle old = held[i % hold];
+            held[i % hold] = h;
+            if (old != LIBVMI_INVALID_HANDLE) {
+                if (libvmi_frame_release(old) != 0)
+                    errors++;
+                // A released handle is stale, even if its slot has already been reused
+                if (libvMI_frame_get(old) != NULL || libvmi_frame_addref(old) != -1)
+                    errors++;
+            }
+            cycles++;
+        }
+        seconds = timer.seconds();
+        for (libvMI_frame_handle h : held) {
+            if (h != LIBVMI_INVALID_HANDLE)
+                libvmi_frame_release(h);
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int threads = 8, iterations = 200000, hold = 4;
+
+    CBenchOptions options;
+    options.add("-t", "<threads>", &threads, "nb of threads (default 8)");
+    options.add("-n", "<iterations>", &iterations, "create/release cycles per thread (default 200000)");
+    options.add("-k", "<frames>", &hold, "frames kept alive by each thread (default 4)");
+    if (!options.parse(argc, argv))
+        return 0;
+    if (threads <= 0 || iterations <= 0 || hold <= 0)
+        return 1;
+
+    setLogLevel(LOG_LEVEL_WARNING);
+    int maxFrames = threads * (hold + 1);
+    libvMI_set_parameter(MAX_FRAMES_IN_LIST, &maxFrames);
+    printf("%d threads, %d cycles per thread, %d frames kept alive per thread\n", threads, iterations, hold);
+
+    vector<CBench> benches(threads);
+    vector<std::thread> th;
+    CBenchTimer timer;
+    for (int t = 0; t < threads; t++)
+        th.push_back(std::thread([&, t]() { benches[t].run(iterations, hold); }));
+    for (std::thread& t : th)
+        t.join();
+    double seconds = timer.seconds();
+
+    unsigned long long cycles = 0, errors = 0;
+    double busy = 0;
+    for (CBench& b : benches) {
+        cycles += b.cycles;
+        errors += b.errors;
+        busy += b.seconds;
+    }
+    int frames = 0;
+    libvMI_get_parameter(CUR_FRAMES_IN_LIST, &frames);
+    printf("cycles:   %llu in %.3f s, %.2f M cycles/s, %.0f ns per cycle and thread\n", cycles, seconds,
+        cycles / seconds / 1e6, busy * 1e9 / (cycles ? cycles : 1));
+    printf("frames:   %d allocated for %d\n", frames, maxFrames);
+    return benchResult(errors == 0, "all the handles valid while referenced, stale once released", "invalid handles");
+}
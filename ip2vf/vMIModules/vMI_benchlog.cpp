@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>      // strcmp
+#include <iostream>     // cout
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include "tools.h"
+#include "log.h"
+
+using namespace std;
+
+/*
+ * Benchmark of the LOG macros: cost of a disabled log statement, with the level checked by the
+ * macro, compared with the previous macros that built the method name and called the log
+ * function before checking the level; then cost of an enabled log statement for the calling
+ * thread, with the asynchronous sink and with VMI_LOG_ASYNC=0 (written at once).
+ */
+
+class CBench
+{
+public:
+    /* Previous macro: method name built at run time, level checked by the function */
+    static std::string oldMethodName(const std::string& prettyFunction)
+    {
+        size_t begin, end;
+        size_t colons = prettyFunction.find("::");
+        if (colons == std::string::npos) {
+            begin = prettyFunction.find(" ") + 1;
+            end = prettyFunction.rfind("(") - begin;
+        }
+        else {
+            begin = prettyFunction.substr(0, colons).rfind(" ") + 1;
+            end = prettyFunction.rfind("(") - begin;
+        }
+        return prettyFunction.substr(begin, end) + "()";
+    }
+    static __attribute__((noinline)) void oldLog(std::string method, const char* message, ...)
+    {
+        if (getLogLevel() < LOG_LEVEL_VERBOSE)
+            return;
+        internal_LOG(LogMethod{ method.c_str(), (int)method.size() - 2 }, "%s", message);
+    }
+
+    static double disabled(int items)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < items; i++) {
+            LOG("disabled record %d of %d", i, items);
+            asm volatile("" ::: "memory");      // level loaded again, as by statements in different places
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    static double disabledOld(int items)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < items; i++) {
+            oldLog(oldMethodName(__PRETTY_FUNCTION__), "disabled record %d of %d", i, items);
+            asm volatile("" ::: "memory");
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    static double enabled(int items, int threads, int gap)
+    {
+        vector<std::thread> th;
+        vector<double> seconds(threads);
+        for (int t = 0; t < threads; t++) {
+            th.push_back(std::thread([&, t]() {
+                double total = 0;
+                for (int i = 0; i < items; i++) {
+                    auto begin = std::chrono::steady_clock::now();
+                    LOG_INFO("enabled record %d of %d, thread %d", i, items, t);
+                    total += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                    if (gap > 0)
+                        std::this_thread::sleep_for(std::chrono::microseconds(gap));
+                }
+                seconds[t] = total;
+            }));
+        }
+        for (std::thread& t : th)
+            t.join();
+        double total = 0;
+        for (double s : seconds)
+            total += s;
+        return total / threads;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int items = 10000000, records = 100000, threads = 2, gap = 0;
+    const char* output = "/dev/null";
+
+    // Check parameters
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            items = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            records = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            gap = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            tools::displayVersion();
+            return 0;
+        } else {
+            std::cout << "usage: " << argv[0] << " [-n <items>] [-r <records>] [-p <threads>] [-g <gap>] [-o <file>]\n";
+            std::cout << "         -n <items>         nb of disabled log statements (default 10000000)\n";
+            std::cout << "         -r <records>       nb of records logged by each thread (default 100000)\n";
+            std::cout << "         -p <threads>       nb of logging threads (default 2)\n";
+            std::cout << "         -g <gap>           time between two records of a thread, in us (default 0: as fast as possible)\n";
+            std::cout << "         -o <file>          file the records are written to (default /dev/null)\n";
+            std::cout << "       VMI_LOG_ASYNC=0 in the environment writes the records at once\n";
+            return 0;
+        }
+    }
+    if (items <= 0 || records <= 0 || threads <= 0)
+        return 1;
+    const char* env = getenv("VMI_LOG_ASYNC");
+    printf("%d disabled statements, %d records x %d threads, gap %d us, %s sink\n", items, records, threads, gap,
+        (env != NULL && strcmp(env, "0") == 0 ? "synchronous" : "asynchronous"));
+
+    setLogLevel(LOG_LEVEL_INFO);
+    double s = CBench::disabled(items);
+    printf("disabled LOG:          %.2f ns/op\n", s * 1e9 / items);
+    s = CBench::disabledOld(items);
+    printf("disabled LOG (before): %.2f ns/op\n", s * 1e9 / items);
+
+    if (freopen(output, "w", stderr) == NULL) {
+        printf("can't open '%s'\n", output);
+        return 1;
+    }
+    s = CBench::enabled(records, threads, gap);
+    printf("enabled LOG_INFO:      %.2f ns/op for the logging thread\n", s * 1e9 / records);
+    closeLog();
+    return 0;
+}
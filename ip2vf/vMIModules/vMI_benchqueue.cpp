@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>      // strcmp
+#include <iostream>     // cout
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "tools.h"
+#include "queue.h"
+#include "ringqueue.h"
+
+using namespace std;
+
+/*
+ * Benchmark of the queues between the threads of a module: items stamped with their push time
+ * go from one or several producer threads to a consumer thread, through the CQueue of the
+ * baseline and through the bounded ring queues (CSPSCRing, CMPSCRing) that replace it on the
+ * hot paths. Gives the cost per item and the push-to-pop latency distribution.
+ */
+
+struct Result {
+    double seconds;
+    unsigned long long items;
+    vector<long long> latencies;    /* push-to-pop latency of each item, in ns */
+};
+
+static long long now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void spin_ns(long long ns)
+{
+    long long end = now_ns() + ns;
+    while (now_ns() < end)
+        ;
+}
+
+static void print_result(const char* name, int producers, Result& r)
+{
+    double s = (r.seconds > 0 ? r.seconds : 1e-9);
+    std::sort(r.latencies.begin(), r.latencies.end());
+    size_t n = r.latencies.size();
+    auto pct = [&](double p) { return n ? r.latencies[std::min(n - 1, (size_t)(p * n))] : 0LL; };
+    printf("%-10s %dP/1C: %llu items in %.3f s, %.1f ns/op, %.2f Mops, latency p50 %lld ns, p99 %lld ns, p99.9 %lld ns, max %lld ns\n",
+        name, producers, r.items, r.seconds, r.seconds * 1e9 / (r.items ? r.items : 1), r.items / s / 1e6,
+        pct(0.5), pct(0.99), pct(0.999), n ? r.latencies[n - 1] : 0LL);
+}
+
+/*
+ * Q is CQueue<long long> or a CRingQueue<long long, ...>: both have push(value) and pop()
+ */
+template <typename Q>
+static Result bench(Q& q, int producers, int items, long long gap)
+{
+    Result r;
+    r.items = (unsigned long long)producers * items;
+    r.latencies.resize(r.items);
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread consumer([&]() {
+        for (unsigned long long i = 0; i < r.items; i++) {
+            long long stamp = q.pop();
+            r.latencies[i] = now_ns() - stamp;
+        }
+    });
+    vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.push_back(std::thread([&]() {
+            for (int i = 0; i < items; i++) {
+                if (gap > 0)
+                    spin_ns(gap);
+                q.push(now_ns());
+            }
+        }));
+    }
+    for (std::thread& t : threads)
+        t.join();
+    consumer.join();
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+int main(int argc, char* argv[]) {
+    int items = 1000000, capacity = 1024, producers = 2;
+    long long gap = 0;
+
+    // Check parameters
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            items = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            capacity = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            producers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            gap = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            tools::displayVersion();
+            return 0;
+        } else {
+            std::cout << "usage: " << argv[0] << " [-n <items>] [-c <capacity>] [-p <producers>] [-g <gap>]\n";
+            std::cout << "         -n <items>         nb of items pushed by each producer (default 1000000)\n";
+            std::cout << "         -c <capacity>      capacity of the ring queues (default 1024)\n";
+            std::cout << "         -p <producers>     nb of producers of the multi-producer run (default 2)\n";
+            std::cout << "         -g <gap>           time between two pushes of a producer, in ns (default 0: as fast as possible)\n";
+            return 0;
+        }
+    }
+    if (items <= 0 || capacity <= 0 || producers <= 0)
+        return 1;
+    printf("%d items per producer, ring capacity %d, gap %lld ns\n", items, capacity, gap);
+
+    // Single producer
+    {
+        CQueue<long long> q;
+        Result r = bench(q, 1, items, gap);
+        print_result("CQueue", 1, r);
+    }
+    {
+        CSPSCRing<long long> q(capacity);
+        Result r = bench(q, 1, items, gap);
+        print_result("CSPSCRing", 1, r);
+    }
+    {
+        CMPSCRing<long long> q(capacity);
+        Result r = bench(q, 1, items, gap);
+        print_result("CMPSCRing", 1, r);
+    }
+
+    // Several producers
+    if (producers > 1) {
+        {
+            CQueue<long long> q;
+            Result r = bench(q, producers, items, gap);
+            print_result("CQueue", producers, r);
+        }
+        {
+            CMPSCRing<long long> q(capacity);
+            Result r = bench(q, producers, items, gap);
+            print_result("CMPSCRing", producers, r);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "benchtools.h"
+#include "common.h"
+#include "log.h"
+#include "moduleconfiguration.h"
+#include "tcp_basic.h"
+#include "packetizer.h"
+#include "rtpframe.h"
+#include "pins/st2022/datasource.h"
+#include "pins/st2022/smpteframe.h"
+
+using namespace std;
+
+/*
+ * Allocation check of the SMPTE ST 2022-6 receive path: 1080i59.94 frames are packetized, then
+ * assembled in SMPTE frames as the receive thread of the smpte input pin does: from the packets
+ * in memory, then replayed from a capture file by the pcap data source (zero-copy bursts, or
+ * payloads received in place). The heap allocations of the receiving thread are counted (not
+ * the ones of the log writer thread): after the first frame, there must be none from memory.
+ * On replay, the rewinds of the capture file are counted too, so there must be less than one
+ * per thousand packets.
+ */
+
+static std::atomic<unsigned long long> g_allocations(0);
+static thread_local bool g_counted = false;
+
+void* operator new(std::size_t size)
+{
+    if (g_counted)
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    operator delete[](p);
+}
+
+/* Socket keeping the packets it is given, instead of sending them */
+class CCaptureUDP : public UDP
+{
+public:
+    vector<vector<char>> packets;
+
+    CCaptureUDP() { _sock = socket(AF_INET, SOCK_DGRAM, 0); };
+    virtual bool isKernelSocket() { return false; };
+    virtual int writeSocket(char* buffer, int* len) {
+        packets.push_back(vector<char>(buffer, buffer + *len));
+        return *len;
+    };
+};
+
+class CBench
+{
+public:
+    /* Write the packets in a pcap file, as UDP/IPv4 packets on Ethernet */
+    static bool writePcap(const char* filename, const vector<vector<char>>& packets, int port)
+    {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file)
+            return false;
+        unsigned int header[6] = { 0xa1b2c3d4, 0x00040002, 0, 0, 65535, 1 };
+        file.write((const char*)header, sizeof(header));
+        for (const vector<char>& packet : packets) {
+            int udpLen = 8 + (int)packet.size();
+            int ipLen = 20 + udpLen;
+            unsigned char eth[14] = { 0x01, 0x00, 0x5e, 0, 0, 1, 0x02, 0, 0, 0, 0, 1, 0x08, 0x00 };
+            unsigned char ip[20] = { 0x45, 0, (unsigned char)(ipLen >> 8), (unsigned char)ipLen, 0, 0, 0x40, 0, 64, 17, 0, 0,
+                127, 0, 0, 1, 127, 0, 0, 1 };
+            unsigned char udp[8] = { 0x13, 0x88, (unsigned char)(port >> 8), (unsigned char)port,
+                (unsigned char)(udpLen >> 8), (unsigned char)udpLen, 0, 0 };
+            unsigned int record[4] = { 0, 0, (unsigned int)(14 + ipLen), (unsigned int)(14 + ipLen) };
+            file.write((const char*)record, sizeof(record));
+            file.write((const char*)eth, sizeof(eth));
+            file.write((const char*)ip, sizeof(ip));
+            file.write((const char*)udp, sizeof(udp));
+            file.write(packet.data(), packet.size());
+        }
+        return (bool)file;
+    }
+
+    /* Assemble frames from the packets, as CInSMPTE::_rcv_process() does */
+    static int receive(const vector<vector<char>>& packets, CSMPTPFrame& frame, int frames,
+        unsigned long long* firstFrameAllocations, unsigned long long* received)
+    {
+        size_t next = 0;
+        int completed = 0;
+        *received = 0;
+        while (completed < frames) {
+            frame.initNewFrame();
+            while (!frame.isComplete()) {
+                const vector<char>& packet = packets[next];
+                next = (next + 1) % packets.size();
+                CRTPFrame rtp((const unsigned char*)packet.data(), (int)packet.size());
+                frame.addRTPPacket(&rtp);
+                (*received)++;
+            }
+            if (++completed == 1)
+                *firstFrameAllocations = g_allocations.load();
+        }
+        return completed;
+    }
+
+    /* Assemble frames from the source, as CInSMPTE::_rcv_process() does */
+    static int receive(CPcapDataSource& source, CSMPTPFrame& frame, int frames, bool scatter,
+        unsigned long long* firstFrameAllocations, unsigned long long* packets)
+    {
+        DataSourcePacket burst[64];
+        UDPScatter scatters[64];
+        unsigned char headers[64][RTP_HEADERS_LENGTH + HBRMP_HEADERS_LENGTH];
+        unsigned char rtp_packet[RTP_PACKET_SIZE];
+        int burstPos = 0, burstNb = 0;  /* the next frame can start in the current burst */
+        int completed = 0;
+        *packets = 0;
+        while (completed < frames) {
+            frame.initNewFrame();
+            while (!frame.isComplete()) {
+                if (!scatter) {
+                    if (burstPos == burstNb) {
+                        source.releaseBurst(burst, burstNb);
+                        burstPos = 0;
+                        burstNb = source.readBurst(burst, 64);
+                        if (burstNb < 0)
+                            burstNb = 0;
+                    }
+                    for (; burstPos < burstNb && !frame.isComplete(); burstPos++) {
+                        CRTPFrame rtp((unsigned char*)burst[burstPos].data, burst[burstPos].len);
+                        frame.addRTPPacket(&rtp, NULL);
+                        (*packets)++;
+                    }
+                    continue;
+                }
+                // Payloads received in place once the frame size is known
+                int room, nb = 0;
+                int payloadLen = RTP_PACKET_SIZE - RTP_HEADERS_LENGTH - HBRMP_HEADERS_LENGTH;
+                unsigned char* writer = frame.getWritePointer(&room);
+                for (; writer != NULL && nb < 64 && (nb + 1) * payloadLen <= room; nb++) {
+                    scatters[nb].header = (char*)headers[nb];
+                    scatters[nb].headerLen = RTP_HEADERS_LENGTH + HBRMP_HEADERS_LENGTH;
+                    scatters[nb].payload = (char*)writer + nb * payloadLen;
+                    scatters[nb].payloadLen = payloadLen;
+                }
+                if (nb == 0) {
+                    scatters[0].header = (char*)rtp_packet;
+                    scatters[0].headerLen = RTP_PACKET_SIZE;
+                    scatters[0].payload = NULL;
+                    scatters[0].payloadLen = 0;
+                    nb = 1;
+                }
+                int n = source.readScatter(scatters, nb);
+                for (int i = 0; i < n && !frame.isComplete(); i++) {
+                    CRTPFrame rtp((unsigned char*)scatters[i].header, scatters[i].len);
+                    frame.addRTPPacket(&rtp, (unsigned char*)scatters[i].payload);
+                    (*packets)++;
+                }
+            }
+            if (++completed == 1)
+                *firstFrameAllocations = g_allocations.load();
+        }
+        source.releaseBurst(burst, burstNb);
+        return completed;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int frames = 200;
+    const char* filename = "/tmp/vMI_benchsmpterx.pcap";
+
+    CBenchOptions options;
+    options.add("-n", "<frames>", &frames, "nb of frames received on each path (default 200)");
+    options.add("-o", "<file>", &filename, "capture file written then replayed (default /tmp/vMI_benchsmpterx.pcap)");
+    if (!options.parse(argc, argv))
+        return 0;
+    if (frames < 2)
+        return 1;
+
+    setLogLevel(LOG_LEVEL_ERROR);
+
+    // Packets of 3 frames, the video content being a gradient
+    CSMPTPFrame tx;
+    tx.initNewFrame();
+    tx.setProfile("1080i59.94");
+    tx.prepareFrame();
+    vector<char> video(1920 * 1080 * 5 / 2);
+    for (size_t i = 0; i < video.size(); i++)
+        video[i] = (char)(i * 7);
+    CHBRMPPacketizer packetizer;
+    packetizer.setProfile(tx.getProfile());
+    CCaptureUDP capture;
+    for (int i = 0; i < 3; i++) {
+        tx.insertVideoContentToSMPTEFrame(video.data());
+        packetizer.send(&capture, (char*)tx.getBuffer(), tx.getBufferSize());
+    }
+    if (!CBench::writePcap(filename, capture.packets, 5000)) {
+        printf("can't write '%s'\n", filename);
+        return 1;
+    }
+    printf("%d packets of 3 frames written in '%s', %d frames received on each path\n", (int)capture.packets.size(), filename, frames);
+
+    const char* names[] = { "memory", "burst", "scatter" };
+    bool ok = true;
+    for (int path = 0; path < 3; path++) {
+        std::string config = std::string("id=1,name=bench,in_type=smpte,speed=0,loop=1,filename=") + filename;
+        CModuleConfiguration cfg(config.c_str());
+        CPcapDataSource source;
+        source.init(&cfg._in[0]);
+        CSMPTPFrame frame;
+
+        unsigned long long start = g_allocations.load(), first = 0, packets = 0;
+        CBenchTimer timer;
+        g_counted = true;
+        if (path == 0)
+            CBench::receive(capture.packets, frame, frames, &first, &packets);
+        else
+            CBench::receive(source, frame, frames, path == 2, &first, &packets);
+        g_counted = false;
+        double seconds = timer.seconds();
+        unsigned long long after = g_allocations.load() - first;
+        printf("%-8s: %llu packets in %.3f s, %.2f Mpps, %llu allocations for the first frame, %llu for the next %d frames\n",
+            names[path], packets, seconds, packets / seconds / 1e6, first - start, after, frames - 1);
+        if (path == 0 ? after != 0 : after * 1000 >= packets)
+            ok = false;
+    }
+    unlink(filename);
+    return benchResult(ok, "no allocation per packet after the first frame", "allocations per packet after the first frame");
+}
@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "benchtools.h"
+#include "common.h"
+#include "log.h"
+#include "tcp_basic.h"
+#include "txpacer.h"
+
+using namespace std;
+
+/*
+ * Loopback test of the launch time mode of the UDP sockets (txtime=1): packets scheduled at a
+ * fixed spacing are sent with writeTimedBatchedSocket(), and received with kernel RX timestamps.
+ * Gives the spacing of the delivered packets, and fails if packets are lost or if the median
+ * spacing is off by more than the tolerance: the median is not moved by the few packets delayed
+ * by the scheduling of the host. Without ETF qdisc on the loopback interface, the socket falls
+ * back to the pacing of the sender, whose spacing depends on the load of the host: its median
+ * is checked against a wider tolerance.
+ */
+
+class CBench
+{
+public:
+    /* Send nbPackets packets of size bytes, the i-th one at start + i * spacing */
+    static void sender(UDP* sock, int nbPackets, int size, long long spacing, int batch, long long start)
+    {
+        vector<vector<char>> packets(batch, vector<char>(size, 0));
+        vector<char*> buffers(batch);
+        vector<int> lens(batch, size);
+        vector<long long> times(batch);
+        for (int i = 0; i < nbPackets; i += batch) {
+            int count = std::min(batch, nbPackets - i);
+            for (int j = 0; j < count; j++) {
+                int index = i + j;
+                memcpy(packets[j].data(), &index, sizeof(index));
+                buffers[j] = packets[j].data();
+                times[j] = start + index * spacing;
+            }
+            if (sock->writeTimedBatchedSocket(buffers.data(), lens.data(), times.data(), count) != count) {
+                printf("failed to send packets %d to %d\n", i, i + count - 1);
+                return;
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int port = 5700, nbPackets = 2000, size = 1200, spacing = 20000, batch = 32;
+    const char* toleranceArg = "0.1";
+    const char* pacedToleranceArg = "0.5";
+
+    CBenchOptions options;
+    options.add("-p", "<port>", &port, "UDP port on the loopback interface (default 5700)");
+    options.add("-n", "<packets>", &nbPackets, "nb of packets (default 2000)");
+    options.add("-s", "<size>", &size, "size of the packets, in bytes (default 1200)");
+    options.add("-g", "<spacing>", &spacing, "time between two packets, in ns (default 20000)");
+    options.add("-b", "<batch>", &batch, "packets per writeTimedBatchedSocket() (default 32)");
+    options.add("-t", "<tolerance>", &toleranceArg, "max relative error of the median spacing (default 0.1)");
+    options.add("-T", "<tolerance>", &pacedToleranceArg, "same, when paced by the sender without ETF qdisc (default 0.5)");
+    if (!options.parse(argc, argv))
+        return 0;
+    double tolerance = atof(toleranceArg);
+    double pacedTolerance = atof(pacedToleranceArg);
+    if (nbPackets < 2 || size < (int)sizeof(int) || spacing <= 0 || batch <= 0)
+        return 1;
+
+    setLogLevel(LOG_LEVEL_WARNING);
+    UDP rx;
+    rx.enableBatchReceive(64, true);
+    if (rx.openSocket("127.0.0.1", NULL, port, true) != E_OK) {
+        printf("can't listen on port %d\n", port);
+        return 1;
+    }
+    struct timeval timeout = { 1, 0 };
+    setsockopt(rx.getSock(), SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    UDP tx;
+    tx.enableTxTime(true);
+    if (tx.openSocket("127.0.0.1", NULL, port, false) != E_OK) {
+        printf("can't send to port %d\n", port);
+        return 1;
+    }
+    printf("%d packets of %d bytes, %d ns apart, %s\n", nbPackets, size, spacing,
+        tx.isTxTime() ? "launch time mode (ETF)" : "no ETF qdisc, paced by the sender");
+
+    long long start = CTxPacer::now() + 1000000;
+    std::thread th([&] { CBench::sender(&tx, nbPackets, size, spacing, batch, start); });
+
+    // Kernel RX timestamp of each packet, by index
+    vector<long long> rxTimes(nbPackets, 0);
+    int received = 0, invalid = 0;
+    while (received + invalid < nbPackets) {
+        char* packet;
+        int len;
+        long long timestamp = 0;
+        if (rx.readPacket(&packet, &len, &timestamp) <= 0)
+            break;
+        int index = -1;
+        if (len == size)
+            memcpy(&index, packet, sizeof(index));
+        if (index < 0 || index >= nbPackets || rxTimes[index] != 0 || timestamp == 0) {
+            invalid++;
+            continue;
+        }
+        rxTimes[index] = timestamp;
+        received++;
+    }
+    th.join();
+
+    // Spacing between consecutive packets both received
+    vector<long long> gaps;
+    for (int i = 1; i < nbPackets; i++) {
+        if (rxTimes[i] != 0 && rxTimes[i - 1] != 0)
+            gaps.push_back(rxTimes[i] - rxTimes[i - 1]);
+    }
+    if (gaps.empty()) {
+        printf("ERROR: %d packets received, %d invalid, no spacing to measure\n", received, invalid);
+        return 1;
+    }
+    double mean = 0, deviation = 0;
+    for (long long gap : gaps)
+        mean += gap;
+    mean /= gaps.size();
+    for (long long gap : gaps)
+        deviation += (gap - mean) * (gap - mean);
+    deviation = sqrt(deviation / gaps.size());
+    std::sort(gaps.begin(), gaps.end());
+    size_t n = gaps.size();
+    auto pct = [&](double p) { return gaps[std::min(n - 1, (size_t)(p * n))]; };
+    printf("received: %d/%d packets, %d invalid\n", received, nbPackets, invalid);
+    printf("spacing:  mean %.0f ns, std dev %.0f ns, min %lld ns, p50 %lld ns, p99 %lld ns, max %lld ns\n",
+        mean, deviation, gaps[0], pct(0.5), pct(0.99), gaps[n - 1]);
+
+    if (!tx.isTxTime())
+        tolerance = pacedTolerance;
+    bool ok = (received == nbPackets && fabs((double)pct(0.5) - spacing) <= tolerance * spacing);
+    return benchResult(ok, "median spacing within the tolerance", "packets lost or median spacing out of the tolerance");
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstring>      // memcpy
+#include <vector>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "benchtools.h"
+#include "common.h"
+#include "log.h"
+#include "tcp_basic.h"
+
+using namespace std;
+
+/*
+ * Loopback benchmark of the UDP receive paths: one recv per packet (readSocket() without batch
+ * receive, the previous path), and the recvmmsg ring of enableBatchReceive() drained without
+ * copy by readPacket(), with and without kernel RX timestamps, or with a copy by readSocket().
+ * Bursts of packets are sent, then received: only the receive is timed, so the rate is the one
+ * of the receive path, not of the sender. Fails if a packet is lost or out of order.
+ */
+
+enum RX_PATH {
+    RX_RECV = 0,            // readSocket(), one recv per packet
+    RX_BATCH,               // readPacket() on the ring
+    RX_BATCH_TIMESTAMPS,    // readPacket() on the ring, with RX timestamps
+    RX_BATCH_COPY,          // readSocket() on the ring
+};
+
+class CBench
+{
+public:
+    unsigned long long  received;
+    unsigned long long  errors;
+    double              seconds;
+
+    CBench() : received(0), errors(0), seconds(0) {};
+
+    /* Receive nbPackets packets, numbered from first */
+    void receive(UDP* sock, RX_PATH path, int first, int nbPackets, int size)
+    {
+        vector<char> buffer(size + 64);
+        CBenchTimer timer;
+        for (int i = 0; i < nbPackets; i++) {
+            char* packet = buffer.data();
+            int len = (int)buffer.size();
+            long long timestamp = 0;
+            int result;
+            if (path == RX_RECV || path == RX_BATCH_COPY)
+                result = sock->readSocket(packet, &len);
+            else
+                result = sock->readPacket(&packet, &len, path == RX_BATCH_TIMESTAMPS ? &timestamp : NULL);
+            if (result <= 0) {
+                errors += nbPackets - i;
+                break;
+            }
+            int index = -1;
+            if (len == size)
+                memcpy(&index, packet, sizeof(index));
+            if (index != first + i || (path == RX_BATCH_TIMESTAMPS && timestamp == 0))
+                errors++;
+            received++;
+        }
+        seconds += timer.seconds();
+    }
+
+    /* Send nbPackets packets numbered from first, in batches */
+    static bool send(UDP* sock, int first, int nbPackets, int size, int batch)
+    {
+        vector<vector<char>> packets(batch, vector<char>(size, 0));
+        vector<char*> buffers(batch);
+        vector<int> lens(batch, size);
+        for (int i = 0; i < nbPackets; i += batch) {
+            int count = std::min(batch, nbPackets - i);
+            for (int j = 0; j < count; j++) {
+                int index = first + i + j;
+                memcpy(packets[j].data(), &index, sizeof(index));
+                buffers[j] = packets[j].data();
+            }
+            if (sock->writeBatchedSocket(buffers.data(), lens.data(), count) != count)
+                return false;
+        }
+        return true;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int port = 5800, nbPackets = 200000, size = 1200, burst = 1000, batch = 64;
+
+    CBenchOptions options;
+    options.add("-p", "<port>", &port, "first UDP port on the loopback interface, one per path (default 5800)");
+    options.add("-n", "<packets>", &nbPackets, "nb of packets per path (default 200000)");
+    options.add("-s", "<size>", &size, "size of the packets, in bytes (default 1200)");
+    options.add("-k", "<burst>", &burst, "packets sent before being received, must fit in SO_RCVBUF (default 1000)");
+    options.add("-b", "<batch>", &batch, "packets per recvmmsg of the ring (default 64)");
+    if (!options.parse(argc, argv))
+        return 0;
+    if (nbPackets <= 0 || size < (int)sizeof(int) || burst <= 0 || batch <= 1)
+        return 1;
+
+    setLogLevel(LOG_LEVEL_ERROR);
+    printf("%d packets of %d bytes per path, in bursts of %d\n", nbPackets, size, burst);
+
+    const char* names[] = { "recv", "batch", "batch+ts", "batch+copy" };
+    double recvRate = 0;
+    bool ok = true;
+    for (int path = RX_RECV; path <= RX_BATCH_COPY; path++) {
+        UDP rx;
+        if (path != RX_RECV)
+            rx.enableBatchReceive(batch, path == RX_BATCH_TIMESTAMPS);
+        if (rx.openSocket("127.0.0.1", NULL, port + path, true) != E_OK) {
+            printf("can't listen on port %d\n", port + path);
+            return 1;
+        }
+        struct timeval timeout = { 1, 0 };
+        setsockopt(rx.getSock(), SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+        UDP tx;
+        if (tx.openSocket("127.0.0.1", NULL, port + path, false) != E_OK) {
+            printf("can't send to port %d\n", port + path);
+            return 1;
+        }
+
+        CBench bench;
+        for (int i = 0; i < nbPackets; i += burst) {
+            int count = std::min(burst, nbPackets - i);
+            if (!CBench::send(&tx, i, count, size, batch)) {
+                printf("failed to send packets %d to %d\n", i, i + count - 1);
+                return 1;
+            }
+            bench.receive(&rx, (RX_PATH)path, i, count, size);
+            if (bench.errors != 0)
+                break;
+        }
+        double rate = bench.received / bench.seconds;
+        if (path == RX_RECV)
+            recvRate = rate;
+        printf("%-10s: %llu packets in %.3f s, %.0f kpps, %.0f ns per packet, x%.2f, %llu errors\n", names[path], bench.received,
+            bench.seconds, rate / 1e3, bench.seconds * 1e9 / (bench.received ? bench.received : 1), rate / recvRate, bench.errors);
+        if (bench.errors != 0 || bench.received != (unsigned long long)nbPackets)
+            ok = false;
+    }
+    return benchResult(ok, "all the packets received in order on each path", "packets lost or out of order");
+}